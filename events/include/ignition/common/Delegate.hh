@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_COMMON_DELEGATE_HH_
+#define IGNITION_COMMON_DELEGATE_HH_
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace ignition
+{
+  namespace common
+  {
+    /// \brief A non-owning reference to a function, a member function
+    /// bound to an object, or a callable object. It is the size of two
+    /// pointers, never allocates, and calling it is a single indirect call
+    /// to a stub in which the target is inlined.
+    ///
+    /// A delegate doesn't keep the bound object alive, so the object must
+    /// outlive every call through the delegate.
+    ///
+    /// \code
+    ///   auto d = Delegate<void(int)>::Bind<&Robot::OnCommand>(&robot);
+    ///   d(3);
+    /// \endcode
+    /// \tparam T Function signature
+    template<typename T>
+    class Delegate;
+
+    /// \brief Specialization that unpacks the signature.
+    template<typename R, typename ... Args>
+    class Delegate<R(Args...)>
+    {
+      /// \brief Constructor of an empty delegate, which must not be called.
+      public: Delegate() = default;
+
+      /// \brief Bind a function known at compile time.
+      /// \tparam Function Free or static member function
+      /// \return The delegate.
+      public: template<auto Function>
+              static Delegate Bind()
+      {
+        return Delegate(nullptr, &FunctionStub<Function>);
+      }
+
+      /// \brief Bind a member function to an object.
+      /// \tparam Method Member function
+      /// \param[in] _object Object that the function is called on. Use a
+      /// pointer to const to bind a const member function.
+      /// \return The delegate.
+      public: template<auto Method, typename C>
+              static Delegate Bind(C *_object)
+      {
+        return Delegate(
+            const_cast<void *>(static_cast<const void *>(_object)),
+            &MethodStub<Method, C>);
+      }
+
+      /// \brief Bind a callable object, such as a lambda, by reference.
+      /// A function whose signature only converts to the one of the
+      /// delegate is bound the same way.
+      /// \param[in] _callable Callable object or function
+      /// \return The delegate.
+      public: template<typename F>
+              static Delegate Bind(F &_callable)
+      {
+        if constexpr (std::is_function_v<F>)
+        {
+          return Delegate(reinterpret_cast<void *>(&_callable),
+              &FunctionRefStub<F>);
+        }
+        else
+        {
+          return Delegate(
+              const_cast<void *>(static_cast<const void *>(
+                  std::addressof(_callable))),
+              &CallableStub<F>);
+        }
+      }
+
+      /// \brief Bind a function pointer known at run time.
+      /// \param[in] _function Function to call
+      /// \return The delegate.
+      public: static Delegate Bind(R (*_function)(Args...))
+      {
+        Delegate result;
+        result.data.function = _function;
+        result.stub = &PointerStub;
+        return result;
+      }
+
+      /// \brief Call the target.
+      /// \param[in] _args Arguments
+      /// \return What the target returned.
+      public: R operator()(Args ... _args) const
+      {
+        return this->stub(this->data, std::forward<Args>(_args)...);
+      }
+
+      /// \brief Whether the delegate has a target.
+      /// \return False for a default constructed delegate.
+      public: explicit operator bool() const
+      {
+        return this->stub != nullptr;
+      }
+
+      /// \brief Whether two delegates call the same target.
+      /// \param[in] _other Delegate to compare with
+      /// \return True if both call the same function on the same object.
+      public: bool operator==(const Delegate &_other) const
+      {
+        if (this->stub != _other.stub)
+          return false;
+        if (this->stub == &PointerStub)
+          return this->data.function == _other.data.function;
+        return this->data.object == _other.data.object;
+      }
+
+      /// \brief Whether two delegates call different targets.
+      /// \param[in] _other Delegate to compare with
+      /// \return True if they call different functions or objects.
+      public: bool operator!=(const Delegate &_other) const
+      {
+        return !(*this == _other);
+      }
+
+      /// \brief Object or function pointer that the stub calls.
+      private: union Data
+      {
+        /// \brief Bound object, or null
+        void *object;
+
+        /// \brief Function pointer bound at run time
+        R (*function)(Args...);
+      };
+
+      /// \brief Type of the stubs.
+      private: using Stub = R (*)(Data, Args...);
+
+      /// \brief Constructor.
+      /// \param[in] _object Bound object
+      /// \param[in] _stub Stub that calls the target
+      private: Delegate(void *_object, const Stub _stub)
+               : stub(_stub)
+      {
+        this->data.object = _object;
+      }
+
+      /// \brief Stub of a function known at compile time.
+      private: template<auto Function>
+               static R FunctionStub(Data, Args ... _args)
+      {
+        return Function(std::forward<Args>(_args)...);
+      }
+
+      /// \brief Stub of a member function.
+      private: template<auto Method, typename C>
+               static R MethodStub(Data _data, Args ... _args)
+      {
+        return (static_cast<C *>(_data.object)->*Method)(
+            std::forward<Args>(_args)...);
+      }
+
+      /// \brief Stub of a callable object.
+      private: template<typename F>
+               static R CallableStub(Data _data, Args ... _args)
+      {
+        return (*static_cast<F *>(_data.object))(
+            std::forward<Args>(_args)...);
+      }
+
+      /// \brief Stub of a function bound by reference.
+      private: template<typename F>
+               static R FunctionRefStub(Data _data, Args ... _args)
+      {
+        return reinterpret_cast<F *>(_data.object)(
+            std::forward<Args>(_args)...);
+      }
+
+      /// \brief Stub of a function pointer.
+      private: static R PointerStub(Data _data, Args ... _args)
+      {
+        return _data.function(std::forward<Args>(_args)...);
+      }
+
+      /// \brief Object or function pointer
+      private: Data data = {nullptr};
+
+      /// \brief Stub that calls the target
+      private: Stub stub = nullptr;
+    };
+  }
+}
+#endif
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_COMMON_DELEGATEEVENT_HH_
+#define IGNITION_COMMON_DELEGATEEVENT_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <ignition/common/Delegate.hh>
+#include <ignition/common/Event.hh>
+#include <ignition/common/detail/EventSnapshots.hh>
+
+namespace ignition
+{
+  namespace common
+  {
+    /// \brief An event whose subscribers are delegates instead of
+    /// std::function objects. The delegates are stored by value in a
+    /// contiguous array, so signaling walks a single block of memory and
+    /// calls each subscriber through one indirect call, and binding a
+    /// member function never allocates.
+    ///
+    /// Delegates don't own what they call: an object bound to the event
+    /// must stay alive until its connection is released. Apart from that,
+    /// DelegateEventT behaves like EventT. Signaling is lock-free, Connect
+    /// and Disconnect may be called from any thread, including from inside
+    /// a callback, and a running signal skips the subscribers disconnected
+    /// in the meantime.
+    ///
+    /// \code
+    ///   DelegateEventT<void(double)> updateEvent;
+    ///   auto conn = updateEvent.Connect<&Robot::OnUpdate>(&robot);
+    ///   updateEvent(0.001);
+    /// \endcode
+    /// \tparam T Callback function signature, returning void
+    /// \tparam N Optional type to disambiguate events with the same
+    /// signature
+    template<typename T, typename N = void>
+    class DelegateEventT;
+
+    /// \brief Specialization that unpacks the signature.
+    template<typename ... Args, typename N>
+    class DelegateEventT<void(Args...), N> : public Event
+    {
+      /// \brief Type of the subscribers.
+      public: using DelegateT = Delegate<void(Args...)>;
+
+      /// \brief Constructor.
+      public: DelegateEventT();
+
+      /// \brief Destructor.
+      public: virtual ~DelegateEventT();
+
+      /// \brief Connect a delegate to this event.
+      /// \param[in] _subscriber Delegate called when the event is signaled.
+      /// \return A Connection object, which will automatically call
+      /// Disconnect when it goes out of scope.
+      public: ConnectionPtr Connect(const DelegateT &_subscriber);
+
+      /// \brief Connect a member function of an object to this event.
+      /// \tparam Method Member function to call
+      /// \param[in] _object Object to call the function on
+      /// \return A Connection object, which will automatically call
+      /// Disconnect when it goes out of scope.
+      public: template<auto Method, typename C>
+              ConnectionPtr Connect(C *_object)
+      {
+        return this->Connect(DelegateT::template Bind<Method>(_object));
+      }
+
+      /// \brief Connect a function to this event.
+      /// \tparam Function Free or static member function to call
+      /// \return A Connection object, which will automatically call
+      /// Disconnect when it goes out of scope.
+      public: template<auto Function>
+              ConnectionPtr Connect()
+      {
+        return this->Connect(DelegateT::template Bind<Function>());
+      }
+
+      /// \brief Disconnect a delegate from this event.
+      /// \param[in] _id The id of the connection to disconnect.
+      public: virtual void Disconnect(int _id);
+
+      /// \brief Get the number of connections.
+      /// \return Number of connections to this event.
+      public: unsigned int ConnectionCount() const;
+
+      /// \brief Access the signal.
+      /// \param[in] _args Arguments passed to every subscriber
+      public: template<typename ... Params>
+              void operator()(Params && ... _args)
+      {
+        this->Signal(std::forward<Params>(_args)...);
+      }
+
+      /// \brief Signal the event for all subscribers.
+      /// \param[in] _args Arguments passed to every subscriber
+      public: template<typename ... Params>
+              void Signal(Params && ... _args)
+      {
+        if (!this->Signaled())
+          this->SetSignaled(true);
+
+        typename detail::EventSnapshots<Snapshot>::ReadGuard guard(
+            this->snapshots);
+        const Snapshot &snapshot = guard.Snapshot();
+        const Slot *end = snapshot.slots.get() + snapshot.count;
+        for (const Slot *slot = snapshot.slots.get(); slot != end; ++slot)
+        {
+          if (slot->on.load(std::memory_order_relaxed))
+            slot->delegate(_args...);
+        }
+      }
+
+      /// \brief One subscriber.
+      private: class Slot
+      {
+        /// \brief Delegate to call
+        public: DelegateT delegate;
+
+        /// \brief Cleared when the connection is released
+        public: mutable std::atomic<bool> on{true};
+
+        /// \brief Id of the connection
+        public: int id = -1;
+      };
+
+      /// \brief Immutable array of subscribers read by Signal.
+      private: class Snapshot
+      {
+        /// \brief Constructor
+        /// \param[in] _count Number of slots
+        public: explicit Snapshot(const std::size_t _count)
+                : slots(new Slot[_count]), count(_count)
+        {
+        }
+
+        /// \brief Subscribers, in the order they connected
+        public: std::unique_ptr<Slot[]> slots;
+
+        /// \brief Number of subscribers
+        public: std::size_t count;
+      };
+
+      /// \brief Snapshots of the subscribers, replaced under the mutex.
+      private: detail::EventSnapshots<Snapshot> snapshots;
+
+      /// \brief Id of the next connection.
+      private: int nextId = 0;
+
+      /// \brief A thread lock, serializing the changes to the snapshot.
+      private: mutable std::mutex mutex;
+    };
+
+    /////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    DelegateEventT<void(Args...), N>::DelegateEventT()
+    : Event(), snapshots(std::make_unique<Snapshot>(0))
+    {
+    }
+
+    /////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    DelegateEventT<void(Args...), N>::~DelegateEventT()
+    {
+    }
+
+    /////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    ConnectionPtr DelegateEventT<void(Args...), N>::Connect(
+        const DelegateT &_subscriber)
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      const int index = this->nextId++;
+
+      const Snapshot *old = &this->snapshots.Current();
+      std::unique_ptr<Snapshot> snapshot(new Snapshot(old->count + 1));
+      for (std::size_t i = 0; i < old->count; ++i)
+      {
+        snapshot->slots[i].delegate = old->slots[i].delegate;
+        snapshot->slots[i].id = old->slots[i].id;
+      }
+      snapshot->slots[old->count].delegate = _subscriber;
+      snapshot->slots[old->count].id = index;
+      this->snapshots.Publish(std::move(snapshot));
+
+      return ConnectionPtr(new Connection(this, index));
+    }
+
+    /////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    unsigned int DelegateEventT<void(Args...), N>::ConnectionCount() const
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      return static_cast<unsigned int>(this->snapshots.Current().count);
+    }
+
+    /////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    void DelegateEventT<void(Args...), N>::Disconnect(int _id)
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      const Snapshot *old = &this->snapshots.Current();
+
+      std::size_t found = old->count;
+      for (std::size_t i = 0; i < old->count; ++i)
+      {
+        if (old->slots[i].id == _id)
+        {
+          found = i;
+          break;
+        }
+      }
+      if (found == old->count)
+        return;
+
+      // Signals that are already running skip it from now on, whichever
+      // snapshot they are reading.
+      old->slots[found].on = false;
+      for (const auto &snapshot : this->snapshots.Retired())
+      {
+        for (std::size_t i = 0; i < snapshot->count; ++i)
+        {
+          if (snapshot->slots[i].id == _id)
+            snapshot->slots[i].on = false;
+        }
+      }
+
+      std::unique_ptr<Snapshot> snapshot(new Snapshot(old->count - 1));
+      std::size_t j = 0;
+      for (std::size_t i = 0; i < old->count; ++i)
+      {
+        if (i == found)
+          continue;
+        snapshot->slots[j].delegate = old->slots[i].delegate;
+        snapshot->slots[j].id = old->slots[i].id;
+        ++j;
+      }
+      this->snapshots.Publish(std::move(snapshot));
+    }
+  }
+}
+#endif
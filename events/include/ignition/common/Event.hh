@@ -17,17 +17,18 @@
 #ifndef IGNITION_COMMON_EVENT_HH_
 #define IGNITION_COMMON_EVENT_HH_
 
+#include <algorithm>
 #include <atomic>
 #include <functional>
-#include <list>
-#include <map>
 #include <memory>
 #include <mutex>
 #include <utility>
+#include <vector>
 
 #include <ignition/common/config.hh>
 #include <ignition/common/events/Export.hh>
 #include <ignition/common/events/Types.hh>
+#include <ignition/common/detail/EventSnapshots.hh>
 
 namespace ignition
 {
@@ -55,8 +56,16 @@ namespace ignition
       /// \param[in] _sig True if the event has been signaled.
       public: void SetSignaled(const bool _sig);
 
+#ifdef _WIN32
+// Disable warning C4251
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
       /// \brief True if the event has been signaled.
-      private: bool signaled;
+      private: std::atomic<bool> signaled;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
     };
 
     /// \brief A class that encapsulates a connection.
@@ -96,6 +105,14 @@ namespace ignition
     };
 
     /// \brief A class for event processing.
+    ///
+    /// Signaling is lock-free. The connections are kept in an immutable,
+    /// contiguous snapshot that Signal only reads. Connect and Disconnect
+    /// build a new snapshot under a lock and publish it atomically, so they
+    /// may be called from any thread, including from inside a callback.
+    /// A signal that is already running keeps using the snapshot it
+    /// started with, except that connections disconnected in the meantime
+    /// are skipped.
     /// \tparam T function event callback function signature
     /// \tparam N optional additional type to disambiguate events with same
     ///   function signature
@@ -137,33 +154,36 @@ namespace ignition
       public: template <typename ... Args>
               void Signal(Args && ... args)
       {
-        this->Cleanup();
-
-        this->SetSignaled(true);
-        for (const auto &iter : this->connections)
+        // Only write the flag once, so that threads signaling concurrently
+        // don't keep invalidating each other's cache line.
+        if (!this->Signaled())
+          this->SetSignaled(true);
+
+        typename detail::EventSnapshots<Snapshot>::ReadGuard guard(
+            this->snapshots);
+        for (const auto &conn : guard.Snapshot().connections)
         {
-          if (iter.second->on)
-            iter.second->callback(std::forward<Args>(args)...);
+          if (conn->on)
+            conn->callback(std::forward<Args>(args)...);
         }
       }
 
-      /// \internal
-      /// \brief Removes queued connections.
-      /// We assume that this function is called from a Signal function.
-      private: void Cleanup();
-
       /// \brief A private helper class used in maintaining connections.
       private: class EventConnection
       {
         /// \brief Constructor
-        public: EventConnection(const bool _on, const std::function<T> &_cb)
-                : callback(_cb)
+        public: EventConnection(const int _id, const bool _on,
+                                const std::function<T> &_cb)
+                : id(_id), callback(_cb)
         {
           // Windows Visual Studio 2012 does not have atomic_bool constructor,
           // so we have to set "on" using operator=
           this->on = _on;
         }
 
+        /// \brief Id of the connection
+        public: const int id;
+
         /// \brief On/off value for the event callback
         public: std::atomic_bool on;
 
@@ -171,25 +191,27 @@ namespace ignition
         public: std::function<T> callback;
       };
 
-      /// \def EvtConnectionMap
-      /// \brief Event Connection map typedef.
-      typedef std::map<int, std::unique_ptr<EventConnection>> EvtConnectionMap;
+      /// \brief Immutable list of connections read by Signal.
+      private: class Snapshot
+      {
+        /// \brief Connections, in the order they were made
+        public: std::vector<std::shared_ptr<EventConnection>> connections;
+      };
 
-      /// \brief Array of connection callbacks.
-      private: EvtConnectionMap connections;
+      /// \brief Snapshots of the connections, replaced under the mutex.
+      private: detail::EventSnapshots<Snapshot> snapshots;
 
-      /// \brief A thread lock.
-      private: std::mutex mutex;
+      /// \brief Id of the next connection.
+      private: int nextId = 0;
 
-      /// \brief List of connections to remove
-      private: std::list<typename EvtConnectionMap::const_iterator>
-              connectionsToRemove;
+      /// \brief A thread lock, serializing the changes to the snapshot.
+      private: mutable std::mutex mutex;
     };
 
     /// \brief Constructor.
     template<typename T, typename N>
     EventT<T, N>::EventT()
-    : Event()
+    : Event(), snapshots(std::make_unique<Snapshot>())
     {
     }
 
@@ -197,7 +219,6 @@ namespace ignition
     template<typename T, typename N>
     EventT<T, N>::~EventT()
     {
-      this->connections.clear();
     }
 
     /// \brief Adds a connection.
@@ -205,13 +226,15 @@ namespace ignition
     template<typename T, typename N>
     ConnectionPtr EventT<T, N>::Connect(const std::function<T> &_subscriber)
     {
-      int index = 0;
-      if (!this->connections.empty())
-      {
-        auto const &iter = this->connections.rbegin();
-        index = iter->first + 1;
-      }
-      this->connections[index].reset(new EventConnection(true, _subscriber));
+      std::lock_guard<std::mutex> lock(this->mutex);
+      const int index = this->nextId++;
+
+      std::unique_ptr<Snapshot> snapshot(
+          new Snapshot(this->snapshots.Current()));
+      snapshot->connections.push_back(
+          std::make_shared<EventConnection>(index, true, _subscriber));
+      this->snapshots.Publish(std::move(snapshot));
+
       return ConnectionPtr(new Connection(this, index));
     }
 
@@ -220,7 +243,8 @@ namespace ignition
     template<typename T, typename N>
     unsigned int EventT<T, N>::ConnectionCount() const
     {
-      return this->connections.size();
+      std::lock_guard<std::mutex> lock(this->mutex);
+      return this->snapshots.Current().connections.size();
     }
 
     /// \brief Removes a connection.
@@ -228,26 +252,30 @@ namespace ignition
     template<typename T, typename N>
     void EventT<T, N>::Disconnect(int _id)
     {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      const Snapshot *old = &this->snapshots.Current();
+
       // Find the connection
-      auto const &it = this->connections.find(_id);
+      auto it = std::find_if(old->connections.begin(), old->connections.end(),
+          [_id](const std::shared_ptr<EventConnection> &_conn)
+          {
+            return _conn->id == _id;
+          });
 
-      if (it != this->connections.end())
+      if (it != old->connections.end())
       {
-        it->second->on = false;
-        this->connectionsToRemove.push_back(it);
+        // Signals that are already running skip it from now on
+        (*it)->on = false;
+
+        std::unique_ptr<Snapshot> snapshot(new Snapshot);
+        snapshot->connections.reserve(old->connections.size() - 1);
+        snapshot->connections.insert(snapshot->connections.end(),
+            old->connections.begin(), it);
+        snapshot->connections.insert(snapshot->connections.end(),
+            it + 1, old->connections.end());
+        this->snapshots.Publish(std::move(snapshot));
       }
     }
-
-    /////////////////////////////////////////////
-    template<typename T, typename N>
-    void EventT<T, N>::Cleanup()
-    {
-      std::lock_guard<std::mutex> lock(this->mutex);
-      // Remove all queue connections.
-      for (auto &conn : this->connectionsToRemove)
-        this->connections.erase(conn);
-      this->connectionsToRemove.clear();
-    }
   }
 }
 #endif
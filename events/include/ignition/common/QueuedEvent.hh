@@ -0,0 +1,527 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_COMMON_QUEUEDEVENT_HH_
+#define IGNITION_COMMON_QUEUEDEVENT_HH_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <ignition/common/Event.hh>
+#include <ignition/common/Time.hh>
+#include <ignition/common/WorkerPool.hh>
+#include <ignition/common/detail/MpmcRing.hh>
+
+namespace ignition
+{
+  namespace common
+  {
+    /// \class QueuedEvent QueuedEvent.hh ignition/common/QueuedEvent.hh
+    /// \brief Base class for events whose delivery is deferred, see
+    /// QueuedEventT.
+    class QueuedEvent
+    {
+      /// \enum OverflowPolicy
+      /// \brief What to do when an event is signaled while the queue is
+      /// full.
+      public: enum class OverflowPolicy
+      {
+        /// \brief Drop the oldest queued event to make room for the new
+        /// one. The publisher never waits.
+        DROP_OLDEST = 0,
+
+        /// \brief Block the publisher until the consumer makes room.
+        BLOCK = 1,
+
+        /// \brief Keep only the latest of the events that don't fit. They
+        /// are delivered after the queued ones, and the intermediate ones
+        /// are lost. Useful for state updates where only the last value
+        /// matters. The publisher never waits.
+        COALESCE_LATEST = 2
+      };
+
+      /// \brief Destructor
+      public: virtual ~QueuedEvent() = default;
+
+      /// \brief Deliver queued events to the subscribers, on the calling
+      /// thread.
+      /// \param[in] _max Maximum number of events to deliver, zero for all
+      /// the events that are queued.
+      /// \return Number of events delivered.
+      public: virtual std::size_t Drain(const std::size_t _max = 0) = 0;
+    };
+
+    /// \brief An event whose delivery is deferred. Signal copies the
+    /// arguments into a bounded ring buffer and returns, and the
+    /// subscribers are called later, in signal order, when a consumer
+    /// drains the queue. This keeps a slow subscriber from throttling a
+    /// high-rate publisher.
+    ///
+    /// Events may be signaled from any number of threads. They are
+    /// delivered either by calling Drain, for example from the loop of a
+    /// consumer thread that waits with WaitForEvents, or automatically on a
+    /// WorkerPool, see SetDrainPool. Only one drain runs at a time.
+    ///
+    /// \code
+    ///   QueuedEventT<void(const Pose3d &)> poseEvent(
+    ///       256, QueuedEvent::OverflowPolicy::COALESCE_LATEST);
+    ///   auto conn = poseEvent.Connect(&OnPose);
+    ///   poseEvent.SetDrainPool(&WorkerPool::Shared());
+    ///   poseEvent(pose);
+    /// \endcode
+    ///
+    /// \tparam T Callback function signature, returning void.
+    /// \tparam N Optional type to disambiguate events with the same
+    /// signature.
+    template<typename T, typename N = void>
+    class QueuedEventT;
+
+    /// \brief Specialization that unpacks the arguments of the signature.
+    template<typename ... Args, typename N>
+    class QueuedEventT<void(Args...), N> : public QueuedEvent
+    {
+      /// \brief Type of the subscriber callbacks.
+      public: using CallbackT = std::function<void(Args...)>;
+
+      /// \brief Constructor.
+      /// \param[in] _capacity Number of events that fit in the queue,
+      /// rounded up to a power of two, at least 2.
+      /// \param[in] _policy What to do when the queue is full.
+      public: explicit QueuedEventT(const std::size_t _capacity = 1024,
+                  const OverflowPolicy _policy = OverflowPolicy::DROP_OLDEST);
+
+      /// \brief Destructor. Events still in the queue are not delivered:
+      /// a drain scheduled on a WorkerPool is cancelled, and a drain in
+      /// progress on another thread stops after its current event, which
+      /// the destructor waits for.
+      public: virtual ~QueuedEventT();
+
+      /// \brief Connect a callback to this event.
+      /// \param[in] _subscriber Callback called when an event is delivered.
+      /// \return A Connection object, which will automatically call
+      /// Disconnect when it goes out of scope.
+      public: ConnectionPtr Connect(const CallbackT &_subscriber);
+
+      /// \brief Get the number of connections.
+      /// \return Number of connections to this event.
+      public: unsigned int ConnectionCount() const;
+
+      /// \brief Queue an event for delivery.
+      /// \param[in] _args Arguments of the event, copied into the queue.
+      /// \sa Signal
+      public: template<typename ... Params>
+              void operator()(Params && ... _args)
+      {
+        this->Signal(std::forward<Params>(_args)...);
+      }
+
+      /// \brief Queue an event for delivery. What happens when the queue
+      /// is full depends on the overflow policy.
+      /// \param[in] _args Arguments of the event, copied into the queue.
+      /// \note With OverflowPolicy::BLOCK, signaling from a subscriber of
+      /// the same event deadlocks once the queue is full.
+      public: template<typename ... Params>
+              void Signal(Params && ... _args);
+
+      // Documentation inherited
+      public: std::size_t Drain(const std::size_t _max = 0) override;
+
+      /// \brief Wait until there are events to deliver.
+      /// \param[in] _timeout How long to wait, default to forever
+      /// \return True if there are events to deliver.
+      public: bool WaitForEvents(const Time &_timeout = Time::Zero);
+
+      /// \brief Deliver the events automatically on a worker pool. Each
+      /// time events are queued while no drain is scheduled, a drain of at
+      /// most _batchSize events is added to the pool, and it reschedules
+      /// itself while events remain.
+      /// \param[in] _pool Pool that delivers the events, or null to stop
+      /// delivering automatically. The pool must outlive this event.
+      /// \param[in] _batchSize Maximum number of events per drain.
+      public: void SetDrainPool(WorkerPool *_pool,
+                                const std::size_t _batchSize = 64);
+
+      /// \brief Get the approximate number of events waiting to be
+      /// delivered, including the ones being signaled.
+      /// \return Number of queued events.
+      public: std::size_t Pending() const;
+
+      /// \brief Get the number of events that were dropped because the
+      /// queue was full, with OverflowPolicy::DROP_OLDEST.
+      /// \return Number of dropped events.
+      public: std::size_t DroppedCount() const;
+
+      /// \brief Get the number of events that were replaced by a later one
+      /// because the queue was full, with OverflowPolicy::COALESCE_LATEST.
+      /// \return Number of coalesced events.
+      public: std::size_t CoalescedCount() const;
+
+      /// \brief Get the overflow policy.
+      /// \return The policy given at construction.
+      public: OverflowPolicy Policy() const;
+
+      /// \brief Arguments of one event, as stored in the queue.
+      private: using Payload = std::tuple<std::decay_t<Args>...>;
+
+      /// \brief Queue and subscribers, shared with drains scheduled on a
+      /// worker pool.
+      private: class State;
+
+      /// \brief Shared state
+      private: std::shared_ptr<State> state;
+    };
+
+    /// \brief Queue and subscribers of a QueuedEventT.
+    template<typename ... Args, typename N>
+    class QueuedEventT<void(Args...), N>::State
+    {
+      /// \brief Constructor.
+      /// \param[in] _capacity Capacity of the ring
+      /// \param[in] _policy Overflow policy
+      public: State(const std::size_t _capacity, const OverflowPolicy _policy)
+        : ring(_capacity), policy(_policy)
+      {
+      }
+
+      /// \brief Queue an event according to the overflow policy.
+      /// \param[in] _payload Arguments of the event
+      public: void Push(Payload &&_payload)
+      {
+        ++this->pending;
+        switch (this->policy)
+        {
+          case OverflowPolicy::DROP_OLDEST:
+          default:
+          {
+            std::optional<Payload> oldest;
+            while (!this->ring.TryPush(_payload))
+            {
+              if (this->ring.TryPop(oldest))
+              {
+                --this->pending;
+                ++this->dropped;
+              }
+            }
+            break;
+          }
+          case OverflowPolicy::BLOCK:
+          {
+            if (this->ring.TryPush(_payload))
+              break;
+
+            std::unique_lock<std::mutex> lock(this->signalMutex);
+            ++this->blockedProducers;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!this->ring.TryPush(_payload))
+              this->spaceAvailable.wait(lock);
+            --this->blockedProducers;
+            break;
+          }
+          case OverflowPolicy::COALESCE_LATEST:
+          {
+            // While an overflowed event is waiting, newer events replace it
+            // instead of going in the ring, so that events stay in order.
+            if (!this->hasLatest && this->ring.TryPush(_payload))
+              break;
+
+            std::lock_guard<std::mutex> lock(this->latestMutex);
+            if (!this->hasLatest && this->ring.TryPush(_payload))
+              break;
+
+            if (this->latest)
+            {
+              --this->pending;
+              ++this->coalesced;
+            }
+            this->latest.emplace(std::move(_payload));
+            this->hasLatest = true;
+            break;
+          }
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (this->waitingConsumers > 0)
+        {
+          std::lock_guard<std::mutex> lock(this->signalMutex);
+          this->eventsAvailable.notify_all();
+        }
+      }
+
+      /// \brief Take the oldest event.
+      /// \param[out] _payload Payload that was taken
+      /// \return False if there are no events.
+      public: bool Pop(std::optional<Payload> &_payload)
+      {
+        bool found = this->ring.TryPop(_payload);
+        if (!found && this->hasLatest)
+        {
+          std::lock_guard<std::mutex> lock(this->latestMutex);
+          // Events may have been queued in the ring before the overflow,
+          // and they go first.
+          found = this->ring.TryPop(_payload);
+          if (!found && this->latest)
+          {
+            _payload.emplace(std::move(*this->latest));
+            this->latest.reset();
+            this->hasLatest = false;
+            found = true;
+          }
+        }
+
+        if (found)
+        {
+          --this->pending;
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          if (this->blockedProducers > 0)
+          {
+            std::lock_guard<std::mutex> lock(this->signalMutex);
+            this->spaceAvailable.notify_all();
+          }
+        }
+        return found;
+      }
+
+      /// \brief Deliver events.
+      /// \param[in] _max Maximum number of events, zero for no limit
+      /// \return Number of events delivered.
+      public: std::size_t Drain(const std::size_t _max)
+      {
+        std::lock_guard<std::mutex> lock(this->drainMutex);
+        this->drainThread = std::this_thread::get_id();
+
+        std::size_t count = 0;
+        std::optional<Payload> payload;
+        while ((_max == 0 || count < _max) && !this->closed &&
+               this->Pop(payload))
+        {
+          std::apply([this] (auto &... _args)
+              {
+                this->event.Signal(_args...);
+              }, *payload);
+          payload.reset();
+          ++count;
+        }
+
+        this->drainThread = std::thread::id();
+        return count;
+      }
+
+      /// \brief Schedule a drain on the pool, unless one is scheduled
+      /// already or there is no pool.
+      /// \param[in] _self Shared pointer to this state, kept alive by the
+      /// drain.
+      public: void ScheduleDrain(const std::shared_ptr<State> &_self)
+      {
+        WorkerPool *drainPool = this->pool.load();
+        if (!drainPool || this->drainScheduled.exchange(true))
+          return;
+
+        drainPool->AddWork([_self] ()
+            {
+              _self->Drain(_self->batchSize.load());
+              _self->drainScheduled = false;
+
+              // Events queued while we were draining may have seen the
+              // flag still set, so check for leftovers.
+              if (_self->pending > 0)
+                _self->ScheduleDrain(_self);
+            });
+      }
+
+      /// \brief Event that calls the subscribers
+      public: EventT<void(Args...), N> event;
+
+      /// \brief Ring buffer. Producers pop from it too, to drop the
+      /// oldest event.
+      public: detail::MpmcRing<Payload> ring;
+
+      /// \brief Number of events waiting to be delivered
+      public: alignas(64) std::atomic<std::size_t> pending{0};
+
+      /// \brief What to do when the ring is full
+      public: const OverflowPolicy policy;
+
+      /// \brief Number of events dropped by DROP_OLDEST
+      public: std::atomic<std::size_t> dropped{0};
+
+      /// \brief Number of events replaced by COALESCE_LATEST
+      public: std::atomic<std::size_t> coalesced{0};
+
+      /// \brief Guards latest
+      public: std::mutex latestMutex;
+
+      /// \brief Latest event that didn't fit, with COALESCE_LATEST
+      public: std::optional<Payload> latest;
+
+      /// \brief Whether latest holds an event, readable without the lock
+      public: std::atomic<bool> hasLatest{false};
+
+      /// \brief Serializes the drains
+      public: std::mutex drainMutex;
+
+      /// \brief Used with the condition variables below
+      public: std::mutex signalMutex;
+
+      /// \brief Signaled when a consumer makes room, for BLOCK
+      public: std::condition_variable spaceAvailable;
+
+      /// \brief Number of producers waiting for room
+      public: std::atomic<unsigned int> blockedProducers{0};
+
+      /// \brief Signaled when events are queued
+      public: std::condition_variable eventsAvailable;
+
+      /// \brief Number of consumers in WaitForEvents
+      public: std::atomic<unsigned int> waitingConsumers{0};
+
+      /// \brief Pool that drains automatically, if any
+      public: std::atomic<WorkerPool *> pool{nullptr};
+
+      /// \brief Maximum number of events per automatic drain
+      public: std::atomic<std::size_t> batchSize{64};
+
+      /// \brief True while a drain is scheduled on the pool
+      public: std::atomic<bool> drainScheduled{false};
+
+      /// \brief Set when the event is destroyed, to stop delivering
+      public: std::atomic<bool> closed{false};
+
+      /// \brief Thread running a drain, if any
+      public: std::atomic<std::thread::id> drainThread{std::thread::id()};
+    };
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    QueuedEventT<void(Args...), N>::QueuedEventT(const std::size_t _capacity,
+        const OverflowPolicy _policy)
+      : state(std::make_shared<State>(_capacity, _policy))
+    {
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    QueuedEventT<void(Args...), N>::~QueuedEventT()
+    {
+      State &s = *this->state;
+      s.pool = nullptr;
+      s.closed = true;
+
+      // Wait for a drain in progress, unless a subscriber called from that
+      // drain is destroying this event.
+      if (s.drainThread.load() != std::this_thread::get_id())
+      {
+        std::lock_guard<std::mutex> lock(s.drainMutex);
+      }
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    ConnectionPtr QueuedEventT<void(Args...), N>::Connect(
+        const CallbackT &_subscriber)
+    {
+      return this->state->event.Connect(_subscriber);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    unsigned int QueuedEventT<void(Args...), N>::ConnectionCount() const
+    {
+      return this->state->event.ConnectionCount();
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    template<typename ... Params>
+    void QueuedEventT<void(Args...), N>::Signal(Params && ... _args)
+    {
+      this->state->Push(Payload(std::forward<Params>(_args)...));
+      this->state->ScheduleDrain(this->state);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    std::size_t QueuedEventT<void(Args...), N>::Drain(const std::size_t _max)
+    {
+      // A subscriber may destroy this event during the drain, so keep the
+      // state alive until the drain returns.
+      const std::shared_ptr<State> s = this->state;
+      return s->Drain(_max);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    bool QueuedEventT<void(Args...), N>::WaitForEvents(const Time &_timeout)
+    {
+      State &s = *this->state;
+      std::unique_lock<std::mutex> lock(s.signalMutex);
+      ++s.waitingConsumers;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const bool result = detail::WaitFor(s.eventsAvailable, lock, _timeout,
+          [&s] () { return s.pending > 0; });
+      --s.waitingConsumers;
+      return result;
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    void QueuedEventT<void(Args...), N>::SetDrainPool(WorkerPool *_pool,
+        const std::size_t _batchSize)
+    {
+      this->state->batchSize = _batchSize;
+      this->state->pool = _pool;
+      if (this->state->pending > 0)
+        this->state->ScheduleDrain(this->state);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    std::size_t QueuedEventT<void(Args...), N>::Pending() const
+    {
+      return this->state->pending.load();
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    std::size_t QueuedEventT<void(Args...), N>::DroppedCount() const
+    {
+      return this->state->dropped.load();
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    std::size_t QueuedEventT<void(Args...), N>::CoalescedCount() const
+    {
+      return this->state->coalesced.load();
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args, typename N>
+    QueuedEvent::OverflowPolicy QueuedEventT<void(Args...), N>::Policy() const
+    {
+      return this->state->policy;
+    }
+  }
+}
+#endif
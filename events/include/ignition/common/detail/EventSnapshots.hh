@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_COMMON_DETAIL_EVENTSNAPSHOTS_HH_
+#define IGNITION_COMMON_DETAIL_EVENTSNAPSHOTS_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ignition
+{
+  namespace common
+  {
+    namespace detail
+    {
+      /// \brief The current snapshot of the subscribers of an event, read
+      /// without locking by the threads signaling the event. A new snapshot
+      /// is published by swapping a pointer, and the replaced ones are
+      /// retired until no signal can be reading them anymore.
+      ///
+      /// Readers are counted in one of two epochs. Publishing moves new
+      /// readers to the other epoch once the previous one has no readers
+      /// left, so the snapshots retired before that are freed even while
+      /// other threads keep signaling.
+      /// \tparam S Type of the snapshots
+      template<typename S>
+      class EventSnapshots
+      {
+        /// \brief Counts a thread as reading the current snapshot for as
+        /// long as it exists.
+        public: class ReadGuard
+        {
+          /// \brief Constructor
+          /// \param[in] _snapshots Snapshots to read
+          public: explicit ReadGuard(const EventSnapshots &_snapshots)
+                  : readers(_snapshots.readers[_snapshots.epoch.load() & 1u])
+          {
+            // Counted before the load, see Publish
+            ++this->readers;
+            this->snapshot = _snapshots.current.load();
+          }
+
+          /// \brief Destructor
+          public: ~ReadGuard()
+          {
+            --this->readers;
+          }
+
+          /// \brief Guards are not copyable.
+          public: ReadGuard(const ReadGuard &) = delete;
+
+          /// \brief Guards are not copyable.
+          public: ReadGuard &operator=(const ReadGuard &) = delete;
+
+          /// \brief Get the snapshot being read.
+          /// \return The snapshot, valid while the guard exists.
+          public: const S &Snapshot() const
+          {
+            return *this->snapshot;
+          }
+
+          /// \brief Counter of readers
+          private: std::atomic<unsigned int> &readers;
+
+          /// \brief Snapshot being read
+          private: const S *snapshot = nullptr;
+        };
+
+        /// \brief Constructor.
+        /// \param[in] _initial First snapshot
+        public: explicit EventSnapshots(std::unique_ptr<S> _initial)
+                : current(_initial.release())
+        {
+        }
+
+        /// \brief Destructor.
+        public: ~EventSnapshots()
+        {
+          this->retired.clear();
+          delete this->current.load();
+        }
+
+        /// \brief Snapshots are not copyable.
+        public: EventSnapshots(const EventSnapshots &) = delete;
+
+        /// \brief Snapshots are not copyable.
+        public: EventSnapshots &operator=(const EventSnapshots &) = delete;
+
+        /// \brief Get the current snapshot, to build the next one. Must be
+        /// called with the lock that serializes Publish.
+        /// \return The current snapshot.
+        public: const S &Current() const
+        {
+          return *this->current.load();
+        }
+
+        /// \brief Get the snapshots that a signal may still be reading.
+        /// Must be called with the lock that serializes Publish.
+        /// \return The retired snapshots.
+        public: const std::vector<std::unique_ptr<const S>> &Retired() const
+        {
+          return this->retired;
+        }
+
+        /// \brief Replace the current snapshot. Calls must be serialized
+        /// by a lock. The previous snapshot is deleted once no signal can
+        /// be reading it anymore.
+        /// \param[in] _snapshot The new snapshot
+        public: void Publish(std::unique_ptr<S> _snapshot)
+        {
+          this->retired.emplace_back(
+              this->current.exchange(_snapshot.release()));
+
+          // A reader counts itself in an epoch before it loads the current
+          // snapshot. The snapshots retired before the last change of
+          // epoch were replaced before any reader of the new epoch started,
+          // so they are in use only if the previous epoch has readers.
+          const unsigned int epochNow = this->epoch.load();
+          if (this->readers[(epochNow + 1) & 1u] != 0)
+            return;
+
+          this->retired.erase(this->retired.begin(), this->retired.begin() +
+              static_cast<std::ptrdiff_t>(this->draining));
+
+          // The current epoch becomes the previous one, and waits for its
+          // readers to finish
+          this->draining = this->retired.size();
+          this->epoch = epochNow + 1;
+
+          // Without any reader, nothing retired can be in use
+          if (this->readers[epochNow & 1u] == 0)
+          {
+            this->retired.clear();
+            this->draining = 0;
+          }
+        }
+
+        /// \brief Snapshot read by the signals.
+        private: std::atomic<const S *> current;
+
+        /// \brief Epoch of the new readers. Its parity selects their
+        /// counter.
+        private: std::atomic<unsigned int> epoch{0};
+
+        /// \brief Number of signals in progress in each epoch.
+        private: mutable std::atomic<unsigned int> readers[2] = {{0}, {0}};
+
+        /// \brief Snapshots replaced while a signal may still be reading
+        /// them, oldest first.
+        private: std::vector<std::unique_ptr<const S>> retired;
+
+        /// \brief Number of retired snapshots, at the start of retired,
+        /// that were replaced before the current epoch started.
+        private: std::size_t draining = 0;
+      };
+    }
+  }
+}
+
+#endif
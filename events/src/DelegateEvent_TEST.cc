@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/common/DelegateEvent.hh>
+#include "test/util.hh"
+
+using namespace ignition;
+
+class DelegateEventTest : public ignition::testing::AutoLogFixture { };
+
+/////////////////////////////////////////////////
+/// \brief Subscriber used by the tests
+class Counter
+{
+  public: void Add(int _value)
+  {
+    this->total += _value;
+  }
+
+  public: int Get() const
+  {
+    return this->total;
+  }
+
+  public: static void AddGlobal(int _value)
+  {
+    Counter::global += _value;
+  }
+
+  public: int total = 0;
+
+  public: static int global;
+};
+
+int Counter::global = 0;
+
+/////////////////////////////////////////////////
+int Twice(int _value)
+{
+  return 2 * _value;
+}
+
+/////////////////////////////////////////////////
+int Square(const int &_value)
+{
+  return _value * _value;
+}
+
+/////////////////////////////////////////////////
+TEST_F(DelegateEventTest, Delegate)
+{
+  using IntDelegate = common::Delegate<int(int)>;
+
+  IntDelegate empty;
+  EXPECT_FALSE(empty);
+
+  IntDelegate free = IntDelegate::Bind<&Twice>();
+  EXPECT_TRUE(free);
+  EXPECT_EQ(6, free(3));
+
+  IntDelegate pointer = IntDelegate::Bind(&Twice);
+  EXPECT_EQ(8, pointer(4));
+  EXPECT_TRUE(pointer == IntDelegate::Bind(&Twice));
+  EXPECT_TRUE(pointer != free);
+
+  int offset = 10;
+  auto lambda = [&offset](int _value) { return _value + offset; };
+  IntDelegate callable = IntDelegate::Bind(lambda);
+  EXPECT_EQ(11, callable(1));
+  // The lambda is referenced, not copied.
+  offset = 20;
+  EXPECT_EQ(21, callable(1));
+
+  // Functions can be bound by name, even if their signature only
+  // converts to the one of the delegate.
+  IntDelegate lvalue = IntDelegate::Bind(Twice);
+  EXPECT_EQ(10, lvalue(5));
+  IntDelegate converted = IntDelegate::Bind(Square);
+  EXPECT_EQ(9, converted(3));
+  EXPECT_TRUE(converted == IntDelegate::Bind(Square));
+  EXPECT_TRUE(converted != lvalue);
+
+  const Counter counter{5};
+  auto getter = common::Delegate<int()>::Bind<&Counter::Get>(&counter);
+  EXPECT_EQ(5, getter());
+
+  // Delegates are as small as two pointers.
+  EXPECT_EQ(2 * sizeof(void *), sizeof(IntDelegate));
+}
+
+/////////////////////////////////////////////////
+TEST_F(DelegateEventTest, SignalSubscribers)
+{
+  common::DelegateEventT<void(int)> evt;
+  Counter first;
+  Counter second;
+  Counter::global = 0;
+
+  auto conn1 = evt.Connect<&Counter::Add>(&first);
+  auto conn2 = evt.Connect<&Counter::Add>(&second);
+  auto conn3 = evt.Connect<&Counter::AddGlobal>();
+  EXPECT_EQ(3u, evt.ConnectionCount());
+  EXPECT_FALSE(evt.Signaled());
+
+  evt(2);
+  evt.Signal(3);
+  EXPECT_TRUE(evt.Signaled());
+  EXPECT_EQ(5, first.total);
+  EXPECT_EQ(5, second.total);
+  EXPECT_EQ(5, Counter::global);
+
+  conn2.reset();
+  EXPECT_EQ(2u, evt.ConnectionCount());
+  evt(1);
+  EXPECT_EQ(6, first.total);
+  EXPECT_EQ(5, second.total);
+  EXPECT_EQ(6, Counter::global);
+
+  std::vector<std::string> words;
+  auto collect = [&words](const std::string &_word)
+  {
+    words.push_back(_word);
+  };
+  common::DelegateEventT<void(const std::string &)> stringEvent;
+  auto conn4 = stringEvent.Connect(
+      common::Delegate<void(const std::string &)>::Bind(collect));
+  stringEvent("hello");
+  ASSERT_EQ(1u, words.size());
+  EXPECT_EQ("hello", words[0]);
+}
+
+/////////////////////////////////////////////////
+TEST_F(DelegateEventTest, DisconnectInCallback)
+{
+  common::DelegateEventT<void()> evt;
+  int firstCalls = 0;
+  int secondCalls = 0;
+  common::ConnectionPtr conn1;
+  common::ConnectionPtr conn2;
+
+  // The first subscriber releases the second one, which must not be called
+  // by the signal in progress.
+  auto first = [&]()
+  {
+    ++firstCalls;
+    conn2.reset();
+  };
+  auto second = [&]() { ++secondCalls; };
+
+  conn1 = evt.Connect(common::Delegate<void()>::Bind(first));
+  conn2 = evt.Connect(common::Delegate<void()>::Bind(second));
+
+  evt();
+  EXPECT_EQ(1, firstCalls);
+  EXPECT_EQ(0, secondCalls);
+  EXPECT_EQ(1u, evt.ConnectionCount());
+
+  evt();
+  EXPECT_EQ(2, firstCalls);
+  EXPECT_EQ(0, secondCalls);
+}
+
+/////////////////////////////////////////////////
+TEST_F(DelegateEventTest, ConcurrentSignalAndConnect)
+{
+  common::DelegateEventT<void(int)> evt;
+  std::atomic<int> calls{0};
+  auto count = [&calls](int) { ++calls; };
+  auto conn = evt.Connect(common::Delegate<void(int)>::Bind(count));
+
+  std::atomic<bool> stop{false};
+  std::thread signaler([&]
+      {
+        while (!stop)
+          evt(1);
+      });
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    auto extra = evt.Connect(common::Delegate<void(int)>::Bind(count));
+    EXPECT_GE(evt.ConnectionCount(), 2u);
+  }
+
+  stop = true;
+  signaler.join();
+
+  EXPECT_EQ(1u, evt.ConnectionCount());
+  const int before = calls;
+  evt(1);
+  EXPECT_EQ(before + 1, calls);
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -17,7 +17,11 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
 #include <ignition/common/Event.hh>
 #include "test/util.hh"
 
@@ -282,6 +286,113 @@ TEST_F(EventTest, typeid_test)
   EXPECT_NE(typeid(Event3).name(), typeid(Event2).name());
 }
 
+/////////////////////////////////////////////////
+TEST_F(EventTest, DisconnectInCallback)
+{
+  int first = 0;
+  int second = 0;
+
+  common::EventT<void ()> evt;
+  common::ConnectionPtr conn2;
+  common::ConnectionPtr conn1 = evt.Connect([&] ()
+      {
+        ++first;
+        conn2.reset();
+      });
+  conn2 = evt.Connect([&second] () { ++second; });
+  EXPECT_EQ(2u, evt.ConnectionCount());
+
+  // The second callback is disconnected before its turn comes
+  evt();
+  EXPECT_EQ(1, first);
+  EXPECT_EQ(0, second);
+  EXPECT_EQ(1u, evt.ConnectionCount());
+}
+
+/////////////////////////////////////////////////
+TEST_F(EventTest, ConnectInCallback)
+{
+  int count = 0;
+
+  common::EventT<void ()> evt;
+  std::vector<common::ConnectionPtr> added;
+  common::ConnectionPtr conn = evt.Connect([&] ()
+      {
+        ++count;
+        added.push_back(evt.Connect([&count] () { count += 10; }));
+      });
+
+  // Connections made during a signal are only called by the next one
+  evt();
+  EXPECT_EQ(1, count);
+  evt();
+  EXPECT_EQ(12, count);
+  EXPECT_EQ(3u, evt.ConnectionCount());
+}
+
+/////////////////////////////////////////////////
+TEST_F(EventTest, ConcurrentSignalAndConnect)
+{
+  common::EventT<void (int)> evt;
+  std::atomic<int> sum(0);
+  common::ConnectionPtr always = evt.Connect([&sum] (int _v) { sum += _v; });
+
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> signalers;
+  for (int t = 0; t < 2; ++t)
+  {
+    signalers.emplace_back([&evt, &stop] ()
+        {
+          while (!stop)
+            evt(1);
+        });
+  }
+
+  // Connect and disconnect while the other threads signal
+  for (int i = 0; i < 1000; ++i)
+  {
+    common::ConnectionPtr conn = evt.Connect([] (int) {});
+    EXPECT_GE(evt.ConnectionCount(), 2u);
+  }
+
+  stop = true;
+  for (auto &thread : signalers)
+    thread.join();
+
+  EXPECT_EQ(1u, evt.ConnectionCount());
+  const int before = sum;
+  evt(1);
+  EXPECT_EQ(before + 1, sum);
+}
+
+/////////////////////////////////////////////////
+TEST_F(EventTest, SnapshotsFreedWhileSignaling)
+{
+  using Snapshots = common::detail::EventSnapshots<int>;
+  Snapshots snapshots(std::make_unique<int>(0));
+
+  // There is always a signal in progress, but each one ends before the
+  // next publication after the one that started with it.
+  auto reading = std::make_unique<Snapshots::ReadGuard>(snapshots);
+  for (int i = 1; i <= 100; ++i)
+  {
+    EXPECT_EQ(i - 1, reading->Snapshot());
+    snapshots.Publish(std::make_unique<int>(i));
+    auto next = std::make_unique<Snapshots::ReadGuard>(snapshots);
+    EXPECT_EQ(i, next->Snapshot());
+
+    // The previous signal still reads its snapshot
+    EXPECT_EQ(i - 1, reading->Snapshot());
+    reading = std::move(next);
+    EXPECT_LE(snapshots.Retired().size(), 2u);
+  }
+
+  reading.reset();
+  snapshots.Publish(std::make_unique<int>(-1));
+  EXPECT_TRUE(snapshots.Retired().empty());
+  EXPECT_EQ(-1, snapshots.Current());
+}
+
 /////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
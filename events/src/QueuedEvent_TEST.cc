@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/common/QueuedEvent.hh>
+#include "test/util.hh"
+
+using namespace ignition;
+
+class QueuedEventTest : public ignition::testing::AutoLogFixture { };
+
+using Policy = common::QueuedEvent::OverflowPolicy;
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, DeferredDelivery)
+{
+  common::QueuedEventT<void(int, const std::string &)> evt(8);
+  EXPECT_EQ(0u, evt.Pending());
+
+  std::vector<int> values;
+  std::vector<std::string> names;
+  common::ConnectionPtr conn = evt.Connect(
+      [&](int _value, const std::string &_name)
+      {
+        values.push_back(_value);
+        names.push_back(_name);
+      });
+  EXPECT_EQ(1u, evt.ConnectionCount());
+
+  std::string name = "first";
+  evt(1, name);
+  name = "second";
+  evt.Signal(2, name);
+
+  // Nothing is delivered until the queue is drained, and the arguments
+  // were copied.
+  EXPECT_TRUE(values.empty());
+  EXPECT_EQ(2u, evt.Pending());
+
+  EXPECT_EQ(2u, evt.Drain());
+  EXPECT_EQ(0u, evt.Pending());
+  ASSERT_EQ(2u, values.size());
+  EXPECT_EQ(1, values[0]);
+  EXPECT_EQ(2, values[1]);
+  EXPECT_EQ("first", names[0]);
+  EXPECT_EQ("second", names[1]);
+
+  EXPECT_EQ(0u, evt.Drain());
+}
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, DrainBatch)
+{
+  common::QueuedEventT<void(int)> evt(16);
+  std::vector<int> values;
+  auto conn = evt.Connect([&](int _value) { values.push_back(_value); });
+
+  for (int i = 0; i < 10; ++i)
+    evt(i);
+
+  EXPECT_EQ(4u, evt.Drain(4));
+  EXPECT_EQ(6u, evt.Pending());
+  EXPECT_EQ(6u, evt.Drain(100));
+  ASSERT_EQ(10u, values.size());
+  for (int i = 0; i < 10; ++i)
+    EXPECT_EQ(i, values[i]);
+}
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, DropOldest)
+{
+  common::QueuedEventT<void(int)> evt(4, Policy::DROP_OLDEST);
+  EXPECT_EQ(Policy::DROP_OLDEST, evt.Policy());
+
+  std::vector<int> values;
+  auto conn = evt.Connect([&](int _value) { values.push_back(_value); });
+
+  for (int i = 0; i < 10; ++i)
+    evt(i);
+
+  EXPECT_EQ(4u, evt.Pending());
+  EXPECT_EQ(6u, evt.DroppedCount());
+  EXPECT_EQ(4u, evt.Drain());
+  EXPECT_EQ(std::vector<int>({6, 7, 8, 9}), values);
+}
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, CoalesceLatest)
+{
+  common::QueuedEventT<void(int)> evt(4, Policy::COALESCE_LATEST);
+
+  std::vector<int> values;
+  auto conn = evt.Connect([&](int _value) { values.push_back(_value); });
+
+  for (int i = 0; i < 10; ++i)
+    evt(i);
+
+  // The first four are queued, 4 to 8 are replaced by 9.
+  EXPECT_EQ(5u, evt.Pending());
+  EXPECT_EQ(5u, evt.CoalescedCount());
+  EXPECT_EQ(0u, evt.DroppedCount());
+
+  // Events signaled after the overflow stay behind the coalesced one, even
+  // when there is room in the queue again.
+  EXPECT_EQ(1u, evt.Drain(1));
+  evt(10);
+  EXPECT_EQ(6u, evt.CoalescedCount());
+
+  EXPECT_EQ(4u, evt.Drain());
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 10}), values);
+
+  // Back to normal once the coalesced event has been delivered.
+  evt(11);
+  evt(12);
+  EXPECT_EQ(2u, evt.Drain());
+  EXPECT_EQ(6u, evt.CoalescedCount());
+  EXPECT_EQ(12, values.back());
+}
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, Block)
+{
+  common::QueuedEventT<void(int)> evt(2, Policy::BLOCK);
+
+  std::vector<int> values;
+  auto conn = evt.Connect([&](int _value) { values.push_back(_value); });
+
+  std::atomic<int> signaled{0};
+  std::thread producer([&]
+      {
+        for (int i = 0; i < 100; ++i)
+        {
+          evt(i);
+          ++signaled;
+        }
+      });
+
+  // The producer can't get ahead of the consumer by more than the
+  // capacity, plus the event it's waiting to queue.
+  while (signaled < 100)
+  {
+    EXPECT_LE(evt.Pending(), 3u);
+    evt.Drain();
+    std::this_thread::yield();
+  }
+  producer.join();
+  evt.Drain();
+
+  ASSERT_EQ(100u, values.size());
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(i, values[i]);
+  EXPECT_EQ(0u, evt.DroppedCount());
+}
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, ConsumerThread)
+{
+  const int producers = 4;
+  const int perProducer = 5000;
+
+  common::QueuedEventT<void(int, int)> evt(64, Policy::BLOCK);
+
+  std::vector<int> last(producers, -1);
+  std::atomic<int> received{0};
+  bool ordered = true;
+  auto conn = evt.Connect([&](int _producer, int _value)
+      {
+        // Events of one producer arrive in order.
+        ordered = ordered && _value == last[_producer] + 1;
+        last[_producer] = _value;
+        ++received;
+      });
+
+  std::atomic<bool> stop{false};
+  std::thread consumer([&]
+      {
+        while (!stop || evt.Pending() > 0)
+        {
+          if (evt.WaitForEvents(common::Time(0, 10000000)))
+            evt.Drain(32);
+        }
+      });
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p)
+  {
+    threads.emplace_back([&evt, p, perProducer]
+        {
+          for (int i = 0; i < perProducer; ++i)
+            evt(p, i);
+        });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  stop = true;
+  consumer.join();
+
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(producers * perProducer, received);
+  for (int p = 0; p < producers; ++p)
+    EXPECT_EQ(perProducer - 1, last[p]);
+}
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, WaitForEventsTimeout)
+{
+  common::QueuedEventT<void()> evt;
+  EXPECT_FALSE(evt.WaitForEvents(common::Time(0, 1000000)));
+  evt();
+  EXPECT_TRUE(evt.WaitForEvents(common::Time(0, 1000000)));
+  EXPECT_EQ(1u, evt.Drain());
+}
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, DrainOnWorkerPool)
+{
+  common::WorkerPool pool(2u);
+  common::QueuedEventT<void(int)> evt(32, Policy::BLOCK);
+
+  std::atomic<int> sum{0};
+  std::atomic<int> concurrent{0};
+  std::atomic<bool> overlapped{false};
+  auto conn = evt.Connect([&](int _value)
+      {
+        // Drains are serialized.
+        if (++concurrent > 1)
+          overlapped = true;
+        sum += _value;
+        --concurrent;
+      });
+
+  // Events queued before the pool is set are delivered too.
+  evt(1000);
+  evt.SetDrainPool(&pool, 8);
+
+  for (int i = 0; i < 1000; ++i)
+    evt(i);
+
+  while (evt.Pending() > 0)
+    std::this_thread::yield();
+  pool.WaitForResults();
+
+  EXPECT_EQ(1000 + 999 * 1000 / 2, sum);
+  EXPECT_FALSE(overlapped);
+
+  // Stop delivering automatically.
+  evt.SetDrainPool(nullptr);
+  evt(1);
+  pool.WaitForResults();
+  EXPECT_EQ(1u, evt.Pending());
+}
+
+/////////////////////////////////////////////////
+/// \brief Payload that counts how many times it is taken out of a queue
+/// after the queue is destroyed.
+class Probe
+{
+  public: Probe(const std::atomic<bool> &_destroyed, std::atomic<int> &_late)
+          : destroyed(&_destroyed), late(&_late)
+  {
+  }
+
+  public: Probe(const Probe &_other)
+          : destroyed(_other.destroyed), late(_other.late)
+  {
+    if (*this->destroyed)
+      ++*this->late;
+  }
+
+  public: const std::atomic<bool> *destroyed;
+
+  public: std::atomic<int> *late;
+};
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, DestroyWithDrainScheduled)
+{
+  common::WorkerPool pool(1u);
+  std::atomic<bool> open{false};
+  std::atomic<bool> destroyed{false};
+  std::atomic<int> late{0};
+
+  // Keep the only worker busy, so that the drain is still pending when
+  // the event is destroyed.
+  pool.AddWork([&open] ()
+      {
+        while (!open)
+          std::this_thread::yield();
+      });
+
+  auto evt = std::make_unique<common::QueuedEventT<void(Probe)>>(1024);
+  evt->SetDrainPool(&pool, 1);
+  for (int i = 0; i < 100; ++i)
+    (*evt)(Probe(destroyed, late));
+  evt.reset();
+  destroyed = true;
+
+  // The scheduled drain keeps the queue alive, and it is cancelled.
+  open = true;
+  pool.WaitForResults();
+  EXPECT_EQ(0, late);
+}
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, DestroyInManualDrain)
+{
+  int delivered = 0;
+  auto evt = std::make_unique<common::QueuedEventT<void(int)>>(16);
+  common::ConnectionPtr conn;
+  conn = evt->Connect([&](int)
+      {
+        ++delivered;
+        conn.reset();
+        evt.reset();
+      });
+  for (int i = 0; i < 3; ++i)
+    (*evt)(i);
+
+  // The drain stops after the subscriber destroys the event.
+  common::QueuedEventT<void(int)> *raw = evt.get();
+  EXPECT_EQ(1u, raw->Drain());
+  EXPECT_EQ(1, delivered);
+  EXPECT_EQ(nullptr, evt);
+}
+
+/////////////////////////////////////////////////
+TEST_F(QueuedEventTest, DestroyWhileDraining)
+{
+  common::WorkerPool pool(1u);
+  std::atomic<bool> started{false};
+  std::atomic<bool> finished{false};
+  auto evt = std::make_unique<common::QueuedEventT<void(int)>>(1024);
+  auto conn = evt->Connect([&](int)
+      {
+        started = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        finished = true;
+      });
+  evt->SetDrainPool(&pool, 1);
+  for (int i = 0; i < 10; ++i)
+    (*evt)(i);
+
+  while (!started)
+    std::this_thread::yield();
+
+  // The destructor waits for the event being delivered.
+  conn.reset();
+  evt.reset();
+  EXPECT_TRUE(finished);
+  pool.WaitForResults();
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
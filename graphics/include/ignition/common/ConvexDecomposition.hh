@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef IGNITION_COMMON_CONVEXDECOMPOSITION_HH_
+#define IGNITION_COMMON_CONVEXDECOMPOSITION_HH_
+
+#include <memory>
+#include <vector>
+
+#include <ignition/common/graphics/Export.hh>
+
+namespace ignition
+{
+  namespace common
+  {
+    class Mesh;
+    class SubMesh;
+
+    /// \class ConvexDecomposition ConvexDecomposition.hh
+    /// ignition/common/ConvexDecomposition.hh
+    /// \brief Computes convex hulls of meshes, and splits meshes into a few
+    /// convex hulls, for physics engines that collide convex shapes much
+    /// faster than triangle meshes.
+    ///
+    /// Hulls are computed with the quickhull algorithm. Their submeshes are
+    /// made of triangles facing outward, with only vertex positions.
+    ///
+    /// Decomposition splits the triangles of a submesh with axis aligned
+    /// planes, always splitting the piece with the largest concavity, until
+    /// every piece is close enough to its hull or the number of hulls is
+    /// reached. The concavity of a piece is the largest distance between
+    /// its vertices and triangle centers and the surface of its hull. Of
+    /// the planes tried, the one that gives the smallest total hull volume
+    /// is kept.
+    class IGNITION_COMMON_GRAPHICS_VISIBLE ConvexDecomposition
+    {
+      /// \brief Default maximum number of hulls per submesh
+      public: static const unsigned int DefaultMaxHulls = 16;
+
+      /// \brief Default maximum concavity, as a fraction of the diagonal
+      /// of the bounding box of a submesh.
+      public: static constexpr double DefaultMaxConcavity = 0.02;
+
+      /// \brief Compute the convex hull of the vertices of a submesh that
+      /// are used by its indices, or of all its vertices if it has no
+      /// indices.
+      /// \param[in] _submesh The submesh
+      /// \return The hull, or nullptr if the vertices are all in one plane
+      /// or are not finite.
+      public: static std::unique_ptr<SubMesh> ConvexHull(
+                  const SubMesh &_submesh);
+
+      /// \brief Compute the convex hull of all the submeshes of a mesh.
+      /// \param[in] _mesh The mesh
+      /// \return The hull, or nullptr if the vertices are all in one plane
+      /// or are not finite.
+      public: static std::unique_ptr<SubMesh> ConvexHull(const Mesh &_mesh);
+
+      /// \brief Split a submesh into convex hulls. The submesh must use the
+      /// TRIANGLES primitive type.
+      /// \param[in] _submesh The submesh
+      /// \param[in] _maxHulls Largest number of hulls
+      /// \param[in] _maxConcavity Concavity at which pieces are not split
+      /// any more, as a fraction of the diagonal of the bounding box of the
+      /// submesh.
+      /// \return The hulls, named after the submesh and with its material
+      /// index. Empty if the submesh is not made of triangles, or if its
+      /// hull has no volume.
+      public: static std::vector<std::unique_ptr<SubMesh>> Decompose(
+                  const SubMesh &_submesh,
+                  const unsigned int _maxHulls = DefaultMaxHulls,
+                  const double _maxConcavity = DefaultMaxConcavity);
+
+      /// \brief Split all the submeshes of a mesh that are made of
+      /// triangles into convex hulls. Submeshes are processed in parallel.
+      /// The new mesh shares the materials of _mesh.
+      /// \param[in] _mesh The mesh
+      /// \param[in] _maxHulls Largest number of hulls per submesh
+      /// \param[in] _maxConcavity Concavity at which pieces are not split
+      /// any more, as a fraction of the diagonal of the bounding box of
+      /// each submesh.
+      /// \return A mesh with one submesh per hull, owned by the caller.
+      public: static Mesh *Decompose(const Mesh &_mesh,
+                  const unsigned int _maxHulls = DefaultMaxHulls,
+                  const double _maxConcavity = DefaultMaxConcavity);
+    };
+  }
+}
+
+#endif
@@ -26,6 +26,7 @@
 
 #include <ignition/common/graphics/Types.hh>
 #include <ignition/common/graphics/Export.hh>
+#include <ignition/common/Span.hh>
 #include <ignition/common/SuppressWarning.hh>
 
 namespace ignition
@@ -136,11 +137,31 @@ namespace ignition
       public: std::weak_ptr<SubMesh> SubMeshByName(
                   const std::string &_name) const;
 
-      /// \brief Put all the data into flat arrays
+      /// \brief Put all the data into flat arrays. The positions are
+      /// rounded to float precision, unlike FillBuffers with double values.
       /// \param[out] _vertArr the vertex array
-      /// \param[out] _indArr the index array
+      /// \param[out] _indArr the index array. Both arrays are set to
+      /// nullptr if the indices do not fit in an int.
+      /// \sa FillBuffers
       public: void FillArrays(double **_vertArr, int **_indArr) const;
 
+      /// \brief Copy the vertex positions and the indices of all the
+      /// submeshes into buffers allocated by the caller, converting them to
+      /// the requested types. The indices of each submesh are offset by
+      /// the number of vertices of the submeshes before it. Nothing is
+      /// allocated, and nothing is written if the function fails.
+      ///
+      /// The vertex type V can be float or double, and the index type I
+      /// can be uint16_t, uint32_t or int.
+      /// \param[out] _vertices Buffer of at least 3 * VertexCount()
+      /// values, filled with x, y and z of each vertex.
+      /// \param[out] _indices Buffer of at least IndexCount() values.
+      /// \return False if a buffer is too small, or if an index does not
+      /// fit in I.
+      /// \sa SubMesh::FillBuffers
+      public: template<typename V, typename I>
+              bool FillBuffers(Span<V> _vertices, Span<I> _indices) const;
+
       /// \brief Recalculate all the normals of each face defined by three
       /// indices.
       public: void RecalculateNormals();
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef IGNITION_COMMON_MESHBVH_HH_
+#define IGNITION_COMMON_MESHBVH_HH_
+
+#include <limits>
+#include <memory>
+
+#include <ignition/math/Vector3.hh>
+
+#include <ignition/common/graphics/Export.hh>
+#include <ignition/common/SuppressWarning.hh>
+
+namespace ignition
+{
+  namespace common
+  {
+    class Mesh;
+    class MeshBVHHit;
+    class MeshBVHPrivate;
+
+    /// \class MeshBVH MeshBVH.hh ignition/common/MeshBVH.hh
+    /// \brief Bounding volume hierarchy over the triangles of a mesh, for
+    /// ray casts and closest point queries in logarithmic time.
+    ///
+    /// The hierarchy is built with the surface area heuristic, and stored
+    /// depth first in one array of 32 byte nodes, so that a query walks
+    /// through memory mostly forward. Leaves hold up to four triangles,
+    /// stored as structures of arrays so that the compiler can test the
+    /// four triangles at once with SIMD instructions.
+    ///
+    /// The hierarchy keeps its own copy of the triangles, so it stays valid
+    /// if the mesh is changed or deleted, but does not follow the changes.
+    /// Queries are const and can run from several threads at once.
+    class IGNITION_COMMON_GRAPHICS_VISIBLE MeshBVH
+    {
+      /// \brief Build the hierarchy of the submeshes of a mesh that use the
+      /// TRIANGLES primitive type. Triangles with indices out of range,
+      /// with no area or with vertices that are not finite are skipped.
+      /// \param[in] _mesh The mesh
+      public: explicit MeshBVH(const Mesh &_mesh);
+
+      /// \brief Destructor
+      public: virtual ~MeshBVH();
+
+      /// \brief Get the number of triangles in the hierarchy.
+      /// \return Number of triangles
+      public: unsigned int TriangleCount() const;
+
+      /// \brief Get the number of nodes of the hierarchy.
+      /// \return Number of nodes, or 0 if there is no triangle.
+      public: unsigned int NodeCount() const;
+
+      /// \brief Find the first triangle hit by a ray. Both sides of the
+      /// triangles are hit.
+      /// \param[in] _origin Origin of the ray
+      /// \param[in] _direction Direction of the ray, which does not need to
+      /// be normalized.
+      /// \param[out] _hit The hit, if any
+      /// \param[in] _maxDistance Length of the ray
+      /// \return True if a triangle was hit, false if none was or if
+      /// _direction is zero.
+      public: bool Intersect(const math::Vector3d &_origin,
+                  const math::Vector3d &_direction, MeshBVHHit &_hit,
+                  const double _maxDistance =
+                    std::numeric_limits<double>::infinity()) const;
+
+      /// \brief Find the point of the mesh closest to a point.
+      /// \param[in] _point The point
+      /// \param[out] _hit The closest point, if any
+      /// \param[in] _maxDistance Largest distance to search
+      /// \return True if a triangle is within _maxDistance of _point.
+      public: bool ClosestPoint(const math::Vector3d &_point,
+                  MeshBVHHit &_hit,
+                  const double _maxDistance =
+                    std::numeric_limits<double>::infinity()) const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer.
+      private: std::unique_ptr<MeshBVHPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+
+    /// \brief Result of a MeshBVH query
+    class IGNITION_COMMON_GRAPHICS_VISIBLE MeshBVHHit
+    {
+      /// \brief Constructor.
+      public: MeshBVHHit();
+
+      /// \brief Distance from the origin of the query to the point
+      public: double distance;
+
+      /// \brief Point on the mesh
+      public: math::Vector3d point;
+
+      /// \brief Unit normal of the triangle, on the side where its corners
+      /// are in counter clockwise order.
+      public: math::Vector3d normal;
+
+      /// \brief Index of the submesh of the triangle in the mesh
+      public: unsigned int subMeshIndex;
+
+      /// \brief Index of the triangle in its submesh, which is the index of
+      /// its first index divided by three.
+      public: unsigned int triangleIndex;
+    };
+  }
+}
+
+#endif
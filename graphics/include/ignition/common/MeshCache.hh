@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef IGNITION_COMMON_MESHCACHE_HH_
+#define IGNITION_COMMON_MESHCACHE_HH_
+
+#include <string>
+
+#include <ignition/common/graphics/Export.hh>
+
+namespace ignition
+{
+  namespace common
+  {
+    class Mesh;
+
+    /// \class MeshCache MeshCache.hh ignition/common/MeshCache.hh
+    /// \brief Binary serialization of meshes, used to cache the meshes
+    /// loaded from COLLADA, OBJ and STL files, which are slow to parse.
+    ///
+    /// A cache file holds the submeshes, the materials, the skeleton and
+    /// its animations. The arrays of the submeshes are stored as they are
+    /// in memory, aligned to 8 bytes, so reading a file is a few copies
+    /// out of its memory mapping. Files are written in the byte order of
+    /// the machine, and are not read on a machine with another byte order.
+    ///
+    /// Each file records a key, usually the Key() of the source file, so
+    /// that a cache file is only used while its source is unchanged.
+    ///
+    /// \code
+    ///   std::string key = MeshCache::Key(source);
+    ///   Mesh *mesh = MeshCache::Read(cache, key);
+    ///   if (!mesh)
+    ///   {
+    ///     mesh = loader.Load(source);
+    ///     MeshCache::Write(*mesh, cache, key);
+    ///   }
+    /// \endcode
+    class IGNITION_COMMON_GRAPHICS_VISIBLE MeshCache
+    {
+      /// \brief Version of the file format. Files with another version are
+      /// not read.
+      public: static const unsigned int Version = 1;
+
+      /// \brief Compute the key of a source file, from its absolute path,
+      /// its modification time, its size and the SHA1 hash of its content.
+      /// \param[in] _filename Path to the source file
+      /// \return The key, or an empty string if the file can not be read.
+      public: static std::string Key(const std::string &_filename);
+
+      /// \brief Write a mesh to a file. The file is written next to its
+      /// destination and then renamed, so that other processes never read
+      /// a partial file.
+      /// \param[in] _mesh The mesh
+      /// \param[in] _filename Path to the cache file
+      /// \param[in] _key Key recorded in the file
+      /// \return True if the file was written.
+      public: static bool Write(const Mesh &_mesh,
+                  const std::string &_filename, const std::string &_key = "");
+
+      /// \brief Read a mesh from a file.
+      /// \param[in] _filename Path to the cache file
+      /// \param[in] _key Key that the file must record. An empty key
+      /// accepts any file.
+      /// \return A new mesh owned by the caller, or nullptr if the file
+      /// does not exist, has another version or key, or is corrupt.
+      public: static Mesh *Read(const std::string &_filename,
+                  const std::string &_key = "");
+    };
+  }
+}
+
+#endif
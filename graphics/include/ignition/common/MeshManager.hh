@@ -17,6 +17,7 @@
 #ifndef IGNITION_COMMON_MESHMANAGER_HH_
 #define IGNITION_COMMON_MESHMANAGER_HH_
 
+#include <future>
 #include <map>
 #include <utility>
 #include <string>
@@ -30,6 +31,7 @@
 #include <ignition/math/Vector3.hh>
 #include <ignition/math/Pose3.hh>
 
+#include <ignition/common/ConvexDecomposition.hh>
 #include <ignition/common/graphics/Types.hh>
 #include <ignition/common/SingletonT.hh>
 #include <ignition/common/graphics/Export.hh>
@@ -41,6 +43,7 @@ namespace ignition
   {
     /// \brief forward declaration
     class Mesh;
+    class MeshBVH;
     class SubMesh;
     class MeshManagerPrivate;
 
@@ -54,14 +57,115 @@ namespace ignition
 
       /// \brief Destructor.
       ///
-      /// Destroys the collada loader, the stl loader and all the meshes
+      /// Destroys all the meshes
       private: virtual ~MeshManager();
 
-      /// \brief Load a mesh from a file
+      /// \brief Load a mesh from a file. Different files can be loaded
+      /// from several threads at once. Requests for a file that is being
+      /// loaded wait for it and return the same mesh.
       /// \param[in] _filename the path to the mesh
       /// \return a pointer to the created mesh
+      /// \sa SetLoadOptimization
       public: const Mesh *Load(const std::string &_filename);
 
+      /// \brief Load meshes from files in parallel, on the threads of
+      /// WorkerPool::Shared(). Files that appear several times are loaded
+      /// once.
+      /// \param[in] _filenames the paths to the meshes
+      /// \return One future per file, in the same order, which gives the
+      /// mesh or nullptr if it could not be loaded.
+      /// \sa Load
+      public: std::vector<std::future<const Mesh *>> LoadAsync(
+                  const std::vector<std::string> &_filenames);
+
+      /// \brief Set the optimization passes applied to the meshes loaded
+      /// from files. The ACMR before and after is logged at debug level.
+      /// No pass is applied by default.
+      /// \param[in] _passes Bitwise combination of MeshOptimizer::Passes
+      public: void SetLoadOptimization(const unsigned int _passes);
+
+      /// \brief Get the optimization passes applied to loaded meshes.
+      /// \return Bitwise combination of MeshOptimizer::Passes
+      public: unsigned int LoadOptimization() const;
+
+      /// \brief Set the directory of the cache of loaded meshes. Meshes
+      /// loaded from files are written there in the MeshCache format, and
+      /// read from there by later loads, including in other processes,
+      /// while their source file and the load optimization passes are
+      /// unchanged. The cache is disabled by default.
+      /// \param[in] _path Path to the directory, which is created if
+      /// needed, or an empty string to disable the cache.
+      /// \sa MeshCache
+      public: void SetCachePath(const std::string &_path);
+
+      /// \brief Get the directory of the cache of loaded meshes.
+      /// \return Path to the directory, or an empty string if the cache
+      /// is disabled.
+      public: std::string CachePath() const;
+
+      /// \brief Generate simplified versions of a mesh, for levels of
+      /// detail and collision shapes. Level i + 1 keeps the fraction
+      /// _ratios[i] of the triangles of each submesh, or more if removing
+      /// more would exceed the error _maxErrors[i], in mesh units. Each
+      /// level is simplified from the mesh itself, so the errors are
+      /// relative to it. The levels replace the previous levels of the
+      /// mesh, and are owned by the mesh manager.
+      /// \param[in] _name Name of the mesh
+      /// \param[in] _ratios Fraction of the triangles of each level
+      /// \param[in] _maxErrors Largest error of each level. If empty, the
+      /// error is not limited.
+      /// \return False if the mesh does not exist, or if _maxErrors is not
+      /// empty and does not have the size of _ratios.
+      /// \sa MeshSimplifier
+      public: bool GenerateLevelsOfDetail(const std::string &_name,
+                  const std::vector<double> &_ratios,
+                  const std::vector<double> &_maxErrors = {});
+
+      /// \brief Get the number of levels of detail of a mesh.
+      /// \param[in] _name Name of the mesh
+      /// \return Number of levels, including the mesh itself, or 0 if the
+      /// mesh does not exist.
+      public: unsigned int LevelOfDetailCount(const std::string &_name) const;
+
+      /// \brief Get a level of detail of a mesh.
+      /// \param[in] _name Name of the mesh
+      /// \param[in] _level Level of detail, where 0 is the mesh itself
+      /// \return The mesh of the level, or nullptr if it does not exist.
+      public: const Mesh *LevelOfDetail(const std::string &_name,
+                  const unsigned int _level) const;
+
+      /// \brief Split a mesh into convex hulls, for physics engines that
+      /// collide convex shapes faster than triangle meshes. The hulls
+      /// replace the previous hulls of the mesh, and are owned by the mesh
+      /// manager.
+      /// \param[in] _name Name of the mesh
+      /// \param[in] _maxHulls Largest number of hulls per submesh
+      /// \param[in] _maxConcavity Concavity at which pieces are not split
+      /// any more, as a fraction of the diagonal of the bounding box of
+      /// each submesh.
+      /// \return False if the mesh does not exist.
+      /// \sa ConvexDecomposition
+      public: bool GenerateConvexHulls(const std::string &_name,
+                  const unsigned int _maxHulls =
+                    ConvexDecomposition::DefaultMaxHulls,
+                  const double _maxConcavity =
+                    ConvexDecomposition::DefaultMaxConcavity);
+
+      /// \brief Get the convex hulls of a mesh, generated by
+      /// GenerateConvexHulls.
+      /// \param[in] _name Name of the mesh
+      /// \return A mesh with one submesh per hull, or nullptr if the
+      /// hulls of the mesh were not generated.
+      public: const Mesh *ConvexHulls(const std::string &_name) const;
+
+      /// \brief Get the bounding volume hierarchy of a mesh, for ray casts
+      /// and closest point queries. The hierarchy is built on the first
+      /// call for the mesh, and owned by the mesh manager.
+      /// \param[in] _name Name of the mesh
+      /// \return The hierarchy, or nullptr if the mesh does not exist.
+      /// \sa MeshBVH
+      public: const MeshBVH *BVH(const std::string &_name) const;
+
       /// \brief Export a mesh to a file
       /// \param[in] _mesh Pointer to the mesh to be exported
       /// \param[in] _filename Exported file's path and name
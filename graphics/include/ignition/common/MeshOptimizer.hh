@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef IGNITION_COMMON_MESHOPTIMIZER_HH_
+#define IGNITION_COMMON_MESHOPTIMIZER_HH_
+
+#include <ignition/common/graphics/Export.hh>
+
+namespace ignition
+{
+  namespace common
+  {
+    class Mesh;
+    class SubMesh;
+
+    /// \class MeshOptimizer MeshOptimizer.hh ignition/common/MeshOptimizer.hh
+    /// \brief Reorders the triangles and vertices of meshes for faster
+    /// rendering. None of the passes changes the shape of a mesh.
+    ///
+    /// The passes apply to submeshes with the TRIANGLES primitive type,
+    /// and leave other submeshes as they are. The quality of the triangle
+    /// order is measured by the ACMR, the average number of vertices
+    /// transformed per triangle with a FIFO post-transform cache. It is
+    /// 3 without any reuse, and approaches 0.5 for large regular meshes.
+    ///
+    /// \code
+    ///   double before = MeshOptimizer::ACMR(mesh);
+    ///   MeshOptimizer::Optimize(mesh);
+    ///   double after = MeshOptimizer::ACMR(mesh);
+    /// \endcode
+    class IGNITION_COMMON_GRAPHICS_VISIBLE MeshOptimizer
+    {
+      /// \brief Optimization passes, which can be combined.
+      public: enum Passes
+      {
+        /// \brief No optimization
+        NONE = 0,
+
+        /// \brief Reorder the triangles for the post-transform vertex
+        /// cache, see OptimizeVertexCache.
+        VERTEX_CACHE = 1,
+
+        /// \brief Reorder the triangles for the vertex cache and to reduce
+        /// overdraw, see OptimizeOverdraw. It replaces VERTEX_CACHE.
+        OVERDRAW = 2,
+
+        /// \brief Reorder the vertices in the order the triangles use them,
+        /// see OptimizeVertexFetch.
+        VERTEX_FETCH = 4,
+
+        /// \brief The vertex cache and the vertex fetch passes
+        DEFAULT = VERTEX_CACHE | VERTEX_FETCH,
+
+        /// \brief All the passes
+        ALL = OVERDRAW | VERTEX_FETCH
+      };
+
+      /// \brief Default size of the post-transform cache
+      public: static const unsigned int DefaultCacheSize = 16;
+
+      /// \brief Compute the average cache miss ratio of a submesh.
+      /// \param[in] _submesh The submesh
+      /// \param[in] _cacheSize Number of entries of the simulated FIFO cache
+      /// \return Vertices transformed per triangle, or 0 if the submesh has
+      /// no triangles.
+      public: static double ACMR(const SubMesh &_submesh,
+                  const unsigned int _cacheSize = DefaultCacheSize);
+
+      /// \brief Compute the average cache miss ratio of all the triangles
+      /// of a mesh.
+      /// \param[in] _mesh The mesh
+      /// \param[in] _cacheSize Number of entries of the simulated FIFO cache
+      /// \return Vertices transformed per triangle, or 0 if the mesh has no
+      /// triangles.
+      public: static double ACMR(const Mesh &_mesh,
+                  const unsigned int _cacheSize = DefaultCacheSize);
+
+      /// \brief Reorder the triangles of a submesh so that consecutive
+      /// triangles share vertices, using the Tipsify algorithm from "Fast
+      /// Triangle Reordering for Vertex Locality and Reduced Overdraw" by
+      /// Sander, Nehab and Barczak. It runs in linear time.
+      /// \param[in,out] _submesh The submesh
+      /// \param[in] _cacheSize Size of the cache to optimize for
+      /// \return False if the submesh is not made of triangles or has
+      /// indices out of range, in which case it is not changed.
+      public: static bool OptimizeVertexCache(SubMesh &_submesh,
+                  const unsigned int _cacheSize = DefaultCacheSize);
+
+      /// \brief Reorder the triangles of a submesh for the vertex cache,
+      /// like OptimizeVertexCache, then reorder clusters of triangles so
+      /// that the ones facing outwards are drawn first, which reduces
+      /// overdraw from most points of view.
+      /// \param[in,out] _submesh The submesh
+      /// \param[in] _threshold Largest ACMR increase, as a ratio, allowed to
+      /// split the triangles into more clusters. Higher values reduce
+      /// overdraw more, and the vertex cache efficiency more.
+      /// \param[in] _cacheSize Size of the cache to optimize for
+      /// \return False if the submesh is not made of triangles or has
+      /// indices out of range, in which case it is not changed.
+      public: static bool OptimizeOverdraw(SubMesh &_submesh,
+                  const double _threshold = 1.05,
+                  const unsigned int _cacheSize = DefaultCacheSize);
+
+      /// \brief Reorder the vertices of a submesh in the order the
+      /// triangles first use them, which makes vertex fetches sequential.
+      /// Run it after the triangle order passes. Vertices that no triangle
+      /// uses are moved to the end.
+      /// \param[in,out] _submesh The submesh
+      /// \return False if the submesh is not made of triangles or has
+      /// indices out of range, in which case it is not changed.
+      /// \sa SubMesh::ReorderVertices
+      public: static bool OptimizeVertexFetch(SubMesh &_submesh);
+
+      /// \brief Apply optimization passes to all the submeshes of a mesh.
+      /// \param[in,out] _mesh The mesh
+      /// \param[in] _passes Bitwise combination of Passes
+      /// \param[in] _cacheSize Size of the cache to optimize for
+      public: static void Optimize(Mesh &_mesh,
+                  const unsigned int _passes = DEFAULT,
+                  const unsigned int _cacheSize = DefaultCacheSize);
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef IGNITION_COMMON_MESHSIMPLIFIER_HH_
+#define IGNITION_COMMON_MESHSIMPLIFIER_HH_
+
+#include <limits>
+#include <memory>
+
+#include <ignition/common/graphics/Export.hh>
+
+namespace ignition
+{
+  namespace common
+  {
+    class Mesh;
+    class SubMesh;
+
+    /// \class MeshSimplifier MeshSimplifier.hh
+    /// ignition/common/MeshSimplifier.hh
+    /// \brief Reduces the number of triangles of meshes, for levels of
+    /// detail and collision shapes.
+    ///
+    /// Vertices are removed by collapsing them into a neighbor, in the
+    /// order of the smallest quadric error metric, from "Surface
+    /// Simplification Using Quadric Error Metrics" by Garland and
+    /// Heckbert. Since the remaining vertices do not move, their normals,
+    /// texture coordinates and node assignments are kept as they are.
+    ///
+    /// Vertices at the same position with the same normal and texture
+    /// coordinates, as in meshes whose vertices are not welded, are
+    /// merged into one. Vertices on seams, where vertices at the same
+    /// position have different normals or texture coordinates, are never
+    /// removed, so seams keep their shape. Vertices on open borders only
+    /// collapse along the border. Collapses that would flip a triangle
+    /// are skipped.
+    ///
+    /// The error of a simplified mesh approximates the distance, in mesh
+    /// units, between the removed vertices and the surface around them.
+    class IGNITION_COMMON_GRAPHICS_VISIBLE MeshSimplifier
+    {
+      /// \brief Simplify a submesh. The submesh must use the TRIANGLES
+      /// primitive type.
+      /// \param[in] _submesh The submesh to simplify
+      /// \param[in] _targetTriangles Number of triangles at which to stop.
+      /// The result may have more if the error limit is reached, or if no
+      /// more vertex can be removed.
+      /// \param[in] _maxError Largest error allowed
+      /// \param[out] _error If not null, set to the error of the result.
+      /// \return The simplified submesh, with only the vertices still used
+      /// by triangles, or nullptr if the submesh is not made of triangles
+      /// or has indices out of range.
+      public: static std::unique_ptr<SubMesh> Simplify(
+                  const SubMesh &_submesh,
+                  const unsigned int _targetTriangles,
+                  const double _maxError =
+                    std::numeric_limits<double>::infinity(),
+                  double *_error = nullptr);
+
+      /// \brief Simplify all the submeshes of a mesh that are made of
+      /// triangles. Other submeshes are copied as they are. The new mesh
+      /// shares the materials and the skeleton of _mesh.
+      /// \param[in] _mesh The mesh to simplify
+      /// \param[in] _ratio Fraction of the triangles of each submesh to
+      /// keep, between 0 and 1.
+      /// \param[in] _maxError Largest error allowed
+      /// \param[out] _error If not null, set to the largest error of the
+      /// submeshes.
+      /// \return The simplified mesh, owned by the caller.
+      public: static Mesh *Simplify(const Mesh &_mesh, const double _ratio,
+                  const double _maxError =
+                    std::numeric_limits<double>::infinity(),
+                  double *_error = nullptr);
+    };
+  }
+}
+
+#endif
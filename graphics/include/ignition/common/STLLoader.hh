@@ -18,10 +18,13 @@
 #define IGNITION_COMMON_STLLOADER_HH_
 
 #include <stdint.h>
+#include <cstddef>
+#include <memory>
 #include <string>
 
 #include "ignition/common/MeshLoader.hh"
 #include "ignition/common/graphics/Export.hh"
+#include "ignition/common/SuppressWarning.hh"
 
 #define LINE_MAX_LEN 256
 #define COR3_MAX 200000
@@ -32,6 +35,8 @@ namespace ignition
 {
   namespace common
   {
+    class STLLoaderPrivate;
+
     /// \class STLLoader STLLoader.hh ignition/common/STLLoader.hh
     /// \brief Class used to load STL mesh files
     class IGNITION_COMMON_GRAPHICS_VISIBLE STLLoader : public MeshLoader
@@ -42,21 +47,46 @@ namespace ignition
       /// \brief Destructor
       public: virtual ~STLLoader();
 
-      /// \brief Creates a new mesh and loads the data from a file
+      /// \brief Creates a new mesh and loads the data from a file.
+      ///
+      /// Files are memory mapped. Binary files are decoded in bulk, and
+      /// ASCII files are split in chunks of lines, both in parallel for
+      /// large files, so that they load about as fast as they can be read
+      /// from disk.
       /// \param[in] _filename the mesh file
       public: virtual Mesh *Load(const std::string &_filename);
 
+      /// \brief Set whether to merge the corners of binary files that
+      /// have the same position and normal, bit for bit, while decoding
+      /// them. Binary files store three corners per triangle, so without
+      /// merging every triangle gets its own vertices. Merging keeps the
+      /// shading of the triangles, so only the corners of adjacent
+      /// triangles in the same plane are merged. Merging is disabled by
+      /// default. To merge corners by position only, use
+      /// SubMesh::WeldVertices after removing the normals.
+      /// \param[in] _weld True to merge corners
+      public: void SetWeldVertices(const bool _weld);
+
+      /// \brief Get whether the corners of binary files are merged.
+      /// \return True if corners are merged
+      /// \sa SetWeldVertices
+      public: bool WeldVertices() const;
+
       /// \brief Reads an ASCII STL (stereolithography) file.
-      /// \param[in] _filein the file pointer
+      /// \param[in] _data the content of the file
+      /// \param[in] _size the size of the file in bytes
       /// \param[out] _mesh the mesh where to load the data
       /// \return true if read was successful
-      private: bool ReadAscii(FILE *_filein, Mesh *_mesh);
+      private: bool ReadAscii(const char *_data, const std::size_t _size,
+                              Mesh *_mesh);
 
       /// \brief Reads a binary STL (stereolithography) file.
-      /// \param[in] _filein the file pointer
-      /// \param[out] the mesh where to load the data
+      /// \param[in] _data the content of the file
+      /// \param[in] _size the size of the file in bytes
+      /// \param[out] _mesh the mesh where to load the data
       /// \return true if read was successful
-      private: bool ReadBinary(FILE *_filein, Mesh *_mesh);
+      private: bool ReadBinary(const char *_data, const std::size_t _size,
+                               Mesh *_mesh);
 
       /// \brief Compares two strings for equality, disregarding case.
       /// \param[in] _string1 the first string
@@ -72,22 +102,11 @@ namespace ignition
       /// \return The column index of the vector
       private: int RcolFind(float _a[][COR3_MAX], int _m, int _n, float _r[]);
 
-      /// \brief Reads a long int from a binary file.
-      /// \param[in] _filein the file pointer
-      /// \return the value
-      private: uint32_t LongIntRead(FILE *_filein);
-
-      /// \brief Reads a short int from a binary file.
-      /// \param[in] _filein the file pointer
-      /// \param[out] _value the value read
-      /// \return true
-      private: bool ShortIntRead(FILE *_filein, uint16_t &_value);
-
-      /// \brief Read 1 double precision float from a binary file.
-      /// \param[in] _filein the file pointer
-      /// \param[out] the value
-      /// \return true
-      private: bool FloatRead(FILE *_filein, double &_value);
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \internal
+      /// \brief Pointer to private data.
+      private: std::unique_ptr<STLLoaderPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
     };
   }
 }
@@ -32,6 +32,7 @@ namespace ignition
   {
     /// Forward declare private data class
     class SkeletonAnimationPrivate;
+    class NodeAnimation;
 
     /// \class SkeletonAnimation SkeletonAnimation.hh
     /// ignition/common/SkeletonAnimation.hh
@@ -119,6 +120,11 @@ namespace ignition
       /// \return the duration in seconds
       public: double Length() const;
 
+      /// \brief Returns the animation of every node
+      /// \return a dictionary of node animations, indexed by node name
+      public: const std::map<std::string, NodeAnimation *> &NodeAnimations()
+                  const;
+
       /// \brief Private data pointer
       private: SkeletonAnimationPrivate *data;
     };
@@ -100,6 +100,10 @@ namespace ignition
       /// \param[in] _trans the transfromation matrix
       public: void SetInitialTransform(const math::Matrix4d &_trans);
 
+      /// \brief Get the initial transformation
+      /// \return the transformation matrix
+      public: math::Matrix4d InitialTransform() const;
+
       /// \brief Reset the transformation to the initial transformation
       /// \param[in] _resetChildren when true, performs the operation for every
       /// node in the tree
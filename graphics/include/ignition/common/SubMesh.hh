@@ -26,6 +26,7 @@
 
 #include <ignition/common/graphics/Types.hh>
 #include <ignition/common/graphics/Export.hh>
+#include <ignition/common/Span.hh>
 #include <ignition/common/SuppressWarning.hh>
 
 namespace ignition
@@ -61,6 +62,16 @@ namespace ignition
                 TRISTRIPS
               };
 
+      /// \brief Precision of the vertices, normals and texture coordinates
+      public: enum Precision
+              {
+                /// \brief Stored as arrays of double
+                DOUBLE_PRECISION,
+                /// \brief Stored as arrays of float, which halves the memory
+                /// used
+                SINGLE_PRECISION
+              };
+
       /// \brief Constructor
       public: SubMesh();
 
@@ -91,6 +102,18 @@ namespace ignition
       /// \return The primitive type
       public: PrimitiveType SubMeshPrimitiveType() const;
 
+      /// \brief Set the precision of the vertices, normals and texture
+      /// coordinates. The default is DOUBLE_PRECISION. Existing data is
+      /// converted, and spans returned by the bulk accessors are
+      /// invalidated.
+      /// \param[in] _precision The precision
+      public: void SetVertexPrecision(const Precision _precision);
+
+      /// \brief Get the precision of the vertices, normals and texture
+      /// coordinates.
+      /// \return The precision
+      public: Precision VertexPrecision() const;
+
       /// \brief Add an index to the mesh
       /// \param[in] _index The new vertex index
       public: void AddIndex(const unsigned int _index);
@@ -267,14 +290,159 @@ namespace ignition
 
       /// \brief Get the index of the vertex
       /// \param[in] _v Vertex to check
-      /// \return Index of the vertex that matches _v.
+      /// \return Index of the first vertex that matches _v, using
+      /// ignition::math::Vector3d::Equal, or -1 if there is none.
+      /// \sa SetVertexHashEnabled(const bool)
       public: int IndexOfVertex(const ignition::math::Vector3d &_v) const;
 
-      /// \brief Put all the data into flat arrays
+      /// \brief Set whether IndexOfVertex and HasVertex use a spatial hash
+      /// of the vertices, which answers them in constant expected time
+      /// instead of searching all the vertices. The hash is built by the
+      /// first lookup, extended by AddVertex, and rebuilt by the next lookup
+      /// after any other change made by the functions of SubMesh or a call
+      /// to MutableVertices(). It is enabled by default; disabling it
+      /// releases its memory.
+      /// \param[in] _enabled True to use the hash
+      public: void SetVertexHashEnabled(const bool _enabled);
+
+      /// \brief Get whether vertex lookups use a spatial hash.
+      /// \return True if the hash is enabled
+      /// \sa SetVertexHashEnabled(const bool)
+      public: bool VertexHashEnabled() const;
+
+      /// \brief Discard the spatial hash of the vertices, so that the next
+      /// lookup rebuilds it. Needed after writing through a span of
+      /// MutableVertices() that was kept across a lookup.
+      /// \sa SetVertexHashEnabled(const bool)
+      public: void InvalidateVertexHash();
+
+      /// \brief Merge duplicate vertices. A vertex is a duplicate of an
+      /// earlier vertex if their positions are within _tolerance, and so
+      /// are their normals and texture coordinates when there is one per
+      /// vertex. Indices are updated, and the node assignments of the
+      /// removed vertices are dropped. The order of the remaining vertices
+      /// is kept. To merge vertices by position only, remove the normals
+      /// first with SetNormalCount(0) and recalculate them afterwards.
+      /// \param[in] _tolerance Largest difference per component
+      /// \return The number of vertices removed.
+      public: unsigned int WeldVertices(const double _tolerance = 1e-6);
+
+      /// \brief Change the order of the vertices, without changing the
+      /// triangles. The normals and texture coordinates are reordered with
+      /// the vertices when there is one per vertex, and the indices and the
+      /// node assignments are updated.
+      /// \param[in] _order Permutation of the vertices: new vertex i is
+      /// old vertex _order[i]. It must have one entry per vertex.
+      /// \return False if _order is not a permutation of the vertices, in
+      /// which case nothing is changed.
+      public: bool ReorderVertices(Span<const unsigned int> _order);
+
+      /// \brief Get all the vertices. Each attribute is stored in its own
+      /// array of values, three per vertex: x, y and z. It can be used
+      /// directly, for example to upload it to a GPU buffer. T must match
+      /// VertexPrecision(): double for DOUBLE_PRECISION, float for
+      /// SINGLE_PRECISION.
+      ///
+      /// A span is valid until the number of vertices or the precision
+      /// changes.
+      /// \return The vertices, or an empty span if T does not match the
+      /// precision.
+      /// \sa SetVertexCount(const unsigned int)
+      public: template<typename T = double>
+              Span<const T> Vertices() const;
+
+      /// \brief Get all the vertices, for writing. The spatial hash of the
+      /// vertices is discarded by this call, but not by the writes: if the
+      /// span is kept across IndexOfVertex or HasVertex, call
+      /// InvalidateVertexHash() after writing through it again.
+      /// \return The vertices, or an empty span if T does not match the
+      /// precision.
+      /// \sa Vertices() const
+      public: template<typename T = double>
+              Span<T> MutableVertices();
+
+      /// \brief Get all the normals, three values per normal.
+      /// \return The normals, or an empty span if T does not match the
+      /// precision.
+      /// \sa Vertices() const
+      public: template<typename T = double>
+              Span<const T> Normals() const;
+
+      /// \brief Get all the normals, for writing.
+      /// \return The normals, or an empty span if T does not match the
+      /// precision.
+      /// \sa Vertices() const
+      public: template<typename T = double>
+              Span<T> MutableNormals();
+
+      /// \brief Get all the texture coordinates, two values per texture
+      /// coordinate: u and v.
+      /// \return The texture coordinates, or an empty span if T does not
+      /// match the precision.
+      /// \sa Vertices() const
+      public: template<typename T = double>
+              Span<const T> TexCoords() const;
+
+      /// \brief Get all the texture coordinates, for writing.
+      /// \return The texture coordinates, or an empty span if T does not
+      /// match the precision.
+      /// \sa Vertices() const
+      public: template<typename T = double>
+              Span<T> MutableTexCoords();
+
+      /// \brief Get the index array.
+      /// \return The indices.
+      public: Span<const unsigned int> Indices() const;
+
+      /// \brief Get the index array, for writing.
+      /// \return The indices.
+      public: Span<unsigned int> MutableIndices();
+
+      /// \brief Resize the vertex array. New vertices are zero. Use with
+      /// MutableVertices() to fill the vertices in bulk.
+      /// \param[in] _count The number of vertices
+      public: void SetVertexCount(const unsigned int _count);
+
+      /// \brief Resize the normal array. New normals are zero.
+      /// \param[in] _count The number of normals
+      public: void SetNormalCount(const unsigned int _count);
+
+      /// \brief Resize the texture coordinate array. New texture
+      /// coordinates are zero.
+      /// \param[in] _count The number of texture coordinates
+      public: void SetTexCoordCount(const unsigned int _count);
+
+      /// \brief Resize the index array. New indices are zero.
+      /// \param[in] _count The number of indices
+      public: void SetIndexCount(const unsigned int _count);
+
+      /// \brief Put all the data into flat arrays. The positions are
+      /// rounded to float precision, unlike FillBuffers with double values.
       /// \param[in] _verArr The vertex array to be filled.
-      /// \param[in] _indexndArr The index array to be filled.
+      /// \param[in] _indexndArr The index array to be filled. Both arrays
+      /// are set to nullptr if the indices do not fit in an int.
+      /// \sa FillBuffers
       public: void FillArrays(double **_vertArr, int **_indexndArr) const;
 
+      /// \brief Copy the vertex positions and the indices into buffers
+      /// allocated by the caller, converting them to the requested types.
+      /// Nothing is allocated, and nothing is written if the function
+      /// fails. To use the data without a copy, see Vertices() and
+      /// Indices().
+      ///
+      /// The vertex type V can be float or double, and the index type I
+      /// can be uint16_t, uint32_t or int.
+      /// \param[out] _vertices Buffer of at least 3 * VertexCount()
+      /// values, filled with x, y and z of each vertex.
+      /// \param[out] _indices Buffer of at least IndexCount() values.
+      /// \param[in] _indexOffset Value added to each index, for meshes
+      /// made of several submeshes.
+      /// \return False if a buffer is too small, or if an index does not
+      /// fit in I.
+      public: template<typename V, typename I>
+              bool FillBuffers(Span<V> _vertices, Span<I> _indices,
+                  const unsigned int _indexOffset = 0) const;
+
       /// \brief Recalculate all the normals.
       public: void RecalculateNormals();
 
@@ -321,6 +489,33 @@ namespace ignition
       IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
     };
 
+    /// \cond
+    template<>
+    Span<const double> SubMesh::Vertices<double>() const;
+    template<>
+    Span<const float> SubMesh::Vertices<float>() const;
+    template<>
+    Span<double> SubMesh::MutableVertices<double>();
+    template<>
+    Span<float> SubMesh::MutableVertices<float>();
+    template<>
+    Span<const double> SubMesh::Normals<double>() const;
+    template<>
+    Span<const float> SubMesh::Normals<float>() const;
+    template<>
+    Span<double> SubMesh::MutableNormals<double>();
+    template<>
+    Span<float> SubMesh::MutableNormals<float>();
+    template<>
+    Span<const double> SubMesh::TexCoords<double>() const;
+    template<>
+    Span<const float> SubMesh::TexCoords<float>() const;
+    template<>
+    Span<double> SubMesh::MutableTexCoords<double>();
+    template<>
+    Span<float> SubMesh::MutableTexCoords<float>();
+    /// \endcond
+
     /// \brief Vertex to node weighted assignement for skeleton animation
     /// visualization
     class IGNITION_COMMON_GRAPHICS_VISIBLE NodeAssignment
@@ -14,9 +14,15 @@
  * limitations under the License.
  *
  */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <sstream>
 #include <unordered_map>
 #include <map>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 #include <set>
 
@@ -36,8 +42,11 @@
 #include "ignition/common/SkeletonAnimation.hh"
 #include "ignition/common/SystemPaths.hh"
 #include "ignition/common/Util.hh"
+#include "ignition/common/WorkerPool.hh"
 #include "ignition/common/ColladaLoader.hh"
 
+#include "TextParser.hh"
+
 using namespace ignition;
 using namespace common;
 using RawNodeAnim = std::map<double, std::vector<NodeTransform> >;
@@ -47,6 +56,80 @@ namespace ignition
 {
   namespace common
   {
+    /// \brief Helper data structure for loading collada primitive lists,
+    /// <triangles>, <polylist> and <lines>. The inputs of a list are loaded
+    /// while the scene is walked, and its indices are decoded into a
+    /// submesh later, in parallel with the other lists of the scene.
+    class PrimitiveList
+    {
+      /// \brief Kinds of primitive lists
+      public: enum Type
+      {
+        /// \brief A <triangles> element
+        TRIANGLES,
+
+        /// \brief A <polylist> element
+        POLYLIST,
+
+        /// \brief A <lines> element
+        LINES
+      };
+
+      /// \brief Kind of the list
+      public: Type type = TRIANGLES;
+
+      /// \brief The submesh to fill, with its name and material
+      public: std::unique_ptr<SubMesh> subMesh;
+
+      /// \brief Text of the <p> element, the indices
+      public: const char *p = nullptr;
+
+      /// \brief Text of the <vcount> element of a polylist
+      public: const char *vcount = nullptr;
+
+      /// \brief Positions of the VERTEX input
+      public: std::vector<ignition::math::Vector3d> verts;
+
+      /// \brief Normals of the VERTEX or NORMAL input
+      public: std::vector<ignition::math::Vector3d> norms;
+
+      /// \brief Texture coordinates of the TEXCOORD input
+      public: std::vector<ignition::math::Vector2d> texcoords;
+
+      /// \brief Map of duplicate position indices
+      public: std::map<unsigned int, unsigned int> positionDupMap;
+
+      /// \brief Map of duplicate normal indices
+      public: std::map<unsigned int, unsigned int> normalDupMap;
+
+      /// \brief Map of duplicate texture coordinate indices
+      public: std::map<unsigned int, unsigned int> texDupMap;
+
+      /// \brief Offsets of the inputs, by semantic
+      public: std::map<const unsigned int, std::set<int>> inputs;
+
+      /// \brief True if the normals come with the positions of the VERTEX
+      /// input
+      public: bool combinedVertNorms = false;
+
+      /// \brief True if the mesh has a skeleton
+      public: bool hasSkeleton = false;
+
+      /// \brief Bind shape transform of the skeleton
+      public: ignition::math::Matrix4d bindShapeMat =
+          ignition::math::Matrix4d::Identity;
+
+      /// \brief Skeleton node handles and weights of each position, as
+      /// they were when the list was loaded. The weights of the skeleton
+      /// are replaced by each controller.
+      public: std::vector<std::vector<std::pair<unsigned int, double>>>
+          nodeWeights;
+
+      /// \brief Error found while decoding, printed once the lists are
+      /// decoded
+      public: std::string error;
+    };
+
     /// \brief Private data for the ColladaLoader class
     class  ColladaLoaderPrivate
     {
@@ -101,6 +184,15 @@ namespace ignition
       /// \brief Current scene being parsed
       public: tinyxml2::XMLElement *currentScene = nullptr;
 
+      /// \brief Primitive lists of the scene, in document order, waiting
+      /// to be decoded.
+      public: std::vector<PrimitiveList> primitives;
+
+      /// \brief Elements by id and sid, in document order. Sids are only
+      /// unique within their parent, so several elements may share one.
+      public: std::unordered_map<std::string,
+              std::vector<tinyxml2::XMLElement *>> elementIds;
+
       /// \brief Load a controller instance
       /// \param[in] _contrXml Pointer to the control XML instance
       /// \param[in] _skelXml Pointer the skeleton xml instance
@@ -149,6 +241,11 @@ namespace ignition
                                  const ignition::math::Matrix4d &_transform,
                                  Mesh *_mesh);
 
+      /// \brief Index the id and sid attributes of an element and its
+      /// descendants, so that ElementId does not search the document.
+      /// \param[in] _root The root element
+      public: void IndexElementIds(tinyxml2::XMLElement *_root);
+
       /// \brief Get an XML element by ID
       /// \param[in] _parent The parent element
       /// \param[in] _name String name of the element
@@ -263,10 +360,32 @@ namespace ignition
       /// \brief Load lines
       /// \param[in] _xml Pointer to the XML element
       /// \param[in] _transform Transform to apply
-      /// \param[out] _mesh Mesh that is currently being loaded
       public: void LoadLines(tinyxml2::XMLElement *_xml,
-                              const ignition::math::Matrix4d &_transform,
-                              Mesh *_mesh);
+                              const ignition::math::Matrix4d &_transform);
+
+      /// \brief Copy the skeleton weights of the positions of a primitive
+      /// list, since the decoding happens after other controllers replace
+      /// them.
+      /// \param[in] _mesh Mesh that is currently being loaded
+      /// \param[in,out] _list The primitive list
+      public: void LoadNodeWeights(const Mesh *_mesh, PrimitiveList &_list);
+
+      /// \brief Decode the primitive lists of the scene in parallel, then
+      /// add their submeshes to the mesh in document order.
+      /// \param[out] _mesh Mesh that is currently being loaded
+      public: void DecodePrimitives(Mesh *_mesh);
+
+      /// \brief Decode the indices of triangles into their submesh.
+      /// \param[in,out] _list The triangles
+      public: static void DecodeTriangles(PrimitiveList &_list);
+
+      /// \brief Decode the indices of a polygon list into its submesh.
+      /// \param[in,out] _list The polygon list
+      public: static void DecodePolylist(PrimitiveList &_list);
+
+      /// \brief Decode the indices of lines into their submesh.
+      /// \param[in,out] _list The lines
+      public: static void DecodeLines(PrimitiveList &_list);
 
       /// \brief Load an entire scene
       /// \param[out] _mesh Mesh that is currently being loaded
@@ -400,6 +519,7 @@ Mesh *ColladaLoader::Load(const std::string &_filename)
   this->dataPtr->colladaXml = xmlDoc.FirstChildElement("COLLADA");
   if (!this->dataPtr->colladaXml)
     ignerr << "Missing COLLADA tag\n";
+  this->dataPtr->IndexElementIds(this->dataPtr->colladaXml);
 
   if (std::string(this->dataPtr->colladaXml->Attribute("version")) != "1.4.0" &&
       std::string(this->dataPtr->colladaXml->Attribute("version")) != "1.4.1")
@@ -429,6 +549,9 @@ Mesh *ColladaLoader::Load(const std::string &_filename)
   if (mesh->HasSkeleton())
     mesh->MeshSkeleton()->Scale(this->dataPtr->meter);
 
+  // The elements are destroyed with the document
+  this->dataPtr->elementIds.clear();
+
   return mesh;
 }
 
@@ -454,6 +577,8 @@ void ColladaLoaderPrivate::LoadScene(Mesh *_mesh)
     this->LoadNode(nodeXml, _mesh, ignition::math::Matrix4d::Identity);
     nodeXml = nodeXml->NextSiblingElement("node");
   }
+
+  this->DecodePrimitives(_mesh);
 }
 
 /////////////////////////////////////////////////
@@ -1192,7 +1317,7 @@ void ColladaLoaderPrivate::LoadGeometry(tinyxml2::XMLElement *_xml,
   childXml = meshXml->FirstChildElement("lines");
   while (childXml)
   {
-    this->LoadLines(childXml, _transform, _mesh);
+    this->LoadLines(childXml, _transform);
     childXml = childXml->NextSiblingElement("lines");
   }
 }
@@ -1204,6 +1329,33 @@ tinyxml2::XMLElement *ColladaLoaderPrivate::ElementId(const std::string &_name,
   return this->ElementId(this->colladaXml, _name, _id);
 }
 
+/////////////////////////////////////////////////
+void ColladaLoaderPrivate::IndexElementIds(tinyxml2::XMLElement *_root)
+{
+  this->elementIds.clear();
+
+  // Visit the elements in document order, without recursion
+  tinyxml2::XMLElement *elem = _root;
+  while (elem)
+  {
+    const char *id = elem->Attribute("id");
+    if (id && *id)
+      this->elementIds[id].push_back(elem);
+    const char *sid = elem->Attribute("sid");
+    if (sid && *sid && (!id || std::strcmp(id, sid) != 0))
+      this->elementIds[sid].push_back(elem);
+
+    tinyxml2::XMLElement *next = elem->FirstChildElement();
+    while (!next && elem && elem != _root)
+    {
+      next = elem->NextSiblingElement();
+      if (!next)
+        elem = elem->Parent() ? elem->Parent()->ToElement() : nullptr;
+    }
+    elem = next;
+  }
+}
+
 /////////////////////////////////////////////////
 tinyxml2::XMLElement *ColladaLoaderPrivate::ElementId(
     tinyxml2::XMLElement *_parent,
@@ -1213,6 +1365,26 @@ tinyxml2::XMLElement *ColladaLoaderPrivate::ElementId(
   if (id.length() > 0 && id[0] == '#')
     id.erase(0, 1);
 
+  // The first element in document order with the id or sid, within the
+  // parent
+  if (!id.empty())
+  {
+    auto iter = this->elementIds.find(id);
+    if (iter == this->elementIds.end())
+      return nullptr;
+
+    for (tinyxml2::XMLElement *elem : iter->second)
+    {
+      for (tinyxml2::XMLNode *ancestor = elem; ancestor;
+           ancestor = ancestor->Parent())
+      {
+        if (ancestor == _parent)
+          return elem;
+      }
+    }
+    return nullptr;
+  }
+
   if ((id.empty() && _parent->Value() == _name) ||
       (_parent->Attribute("id") && _parent->Attribute("id") == id) ||
       (_parent->Attribute("sid") && _parent->Attribute("sid") == id))
@@ -1331,19 +1503,18 @@ void ColladaLoaderPrivate::LoadPositions(const std::string &_id,
 
     return;
   }
-  std::string valueStr = floatArrayXml->GetText();
+  const char *valueStr = floatArrayXml->GetText();
+  const char *valueEnd = valueStr + std::strlen(valueStr);
 
   std::unordered_map<ignition::math::Vector3d,
       unsigned int, Vector3Hash> unique;
 
-  std::vector<std::string>::iterator iter, end;
-  std::vector<std::string> strs = split(valueStr, " \t\r\n");
-  end = strs.end();
-  for (iter = strs.begin(); iter != end; iter += 3)
+  double x, y, z;
+  while (TextParser::NextDouble(valueStr, valueEnd, x) &&
+         TextParser::NextDouble(valueStr, valueEnd, y) &&
+         TextParser::NextDouble(valueStr, valueEnd, z))
   {
-    ignition::math::Vector3d vec(math::parseFloat(*iter),
-        ignition::math::parseFloat(*(iter+1)),
-        ignition::math::parseFloat(*(iter+2)));
+    ignition::math::Vector3d vec(x, y, z);
 
     vec = _transform * vec;
     _values.push_back(vec);
@@ -1416,25 +1587,25 @@ void ColladaLoaderPrivate::LoadNormals(const std::string &_id,
   std::unordered_map<ignition::math::Vector3d,
       unsigned int, Vector3Hash> unique;
 
-  std::string valueStr = floatArrayXml->GetText();
-  std::istringstream iss(valueStr);
-  do
-  {
-    ignition::math::Vector3d vec;
-    iss >> vec.X() >> vec.Y() >> vec.Z();
-    if (iss)
-    {
-      vec = rotMat * vec;
-      vec.Normalize();
-      _values.push_back(vec);
+  // Reading stops at the first value that is not a number
+  const char *valueStr = floatArrayXml->GetText();
+  const char *valueEnd = valueStr + std::strlen(valueStr);
+  double x, y, z;
+  while (TextParser::NextDouble(valueStr, valueEnd, x) && !std::isnan(x) &&
+         TextParser::NextDouble(valueStr, valueEnd, y) && !std::isnan(y) &&
+         TextParser::NextDouble(valueStr, valueEnd, z) && !std::isnan(z))
+  {
+    ignition::math::Vector3d vec(x, y, z);
+    vec = rotMat * vec;
+    vec.Normalize();
+    _values.push_back(vec);
 
-      // create a map of duplicate indices
-      if (unique.find(vec) != unique.end())
-        _duplicates[_values.size()-1] = unique[vec];
-      else
-        unique[vec] = _values.size()-1;
-    }
-  } while (iss);
+    // create a map of duplicate indices
+    if (unique.find(vec) != unique.end())
+      _duplicates[_values.size()-1] = unique[vec];
+    else
+      unique[vec] = _values.size()-1;
+  }
 
   this->normalDuplicateMap[_id] = _duplicates;
   this->normalIds[_id] = _values;
@@ -1566,16 +1737,32 @@ void ColladaLoaderPrivate::LoadTexCoords(const std::string &_id,
   std::unordered_map<ignition::math::Vector2d,
       unsigned int, Vector2dHash> unique;
 
-  // Read the raw texture values, and split them on spaces.
-  std::string valueStr = floatArrayXml->GetText();
-  std::vector<std::string> values = split(valueStr, " \t\r\n");
+  // Read the raw texture values, in place.
+  const char *valueStr = floatArrayXml->GetText();
+  const char *valueEnd = valueStr + std::strlen(valueStr);
 
   // Read in all the texture coordinates.
-  for (int i = 0; i < totCount; i += stride)
+  for (int i = 0; i < texCount; ++i)
   {
     // We only handle 2D texture coordinates right now.
-    ignition::math::Vector2d vec(std::stod(values[i]),
-          1.0 - std::stod(values[i+1]));
+    double coords[2] = {0.0, 0.0};
+    bool valid = true;
+    for (int k = 0; k < stride && valid; ++k)
+    {
+      double value;
+      valid = TextParser::NextDouble(valueStr, valueEnd, value);
+      if (k < 2)
+        coords[k] = value;
+    }
+    if (!valid)
+    {
+      ignerr << "Error reading texture coordinates. The float_array of "
+             << "element with id[" << _id << "] has fewer values than its "
+             << "count\n";
+      break;
+    }
+
+    ignition::math::Vector2d vec(coords[0], 1.0 - coords[1]);
     _values.push_back(vec);
 
     // create a map of duplicate indices
@@ -1863,14 +2050,9 @@ void ColladaLoaderPrivate::LoadPolylist(tinyxml2::XMLElement *_polylistXml,
   std::map<unsigned int, unsigned int> normalDupMap;
   std::map<unsigned int, unsigned int> positionDupMap;
 
-  ignition::math::Matrix4d bindShapeMat(ignition::math::Matrix4d::Identity);
-  if (_mesh->HasSkeleton())
-    bindShapeMat = _mesh->MeshSkeleton()->BindShapeTransform();
-
   // read input elements. A vector of int is used because there can be
   // multiple TEXCOORD inputs.
   std::map<const unsigned int, std::set<int>> inputs;
-  unsigned int inputSize = 0;
   while (polylistInputXml)
   {
     std::string semantic = polylistInputXml->Attribute("semantic");
@@ -1906,6 +2088,45 @@ void ColladaLoaderPrivate::LoadPolylist(tinyxml2::XMLElement *_polylistXml,
     polylistInputXml = polylistInputXml->NextSiblingElement("input");
   }
 
+  tinyxml2::XMLElement *vcountXml = _polylistXml->FirstChildElement("vcount");
+  tinyxml2::XMLElement *pXml = _polylistXml->FirstChildElement("p");
+
+  PrimitiveList list;
+  list.type = PrimitiveList::POLYLIST;
+  list.subMesh = std::move(subMesh);
+  list.vcount = vcountXml->GetText();
+  list.p = pXml->GetText();
+  list.verts = std::move(verts);
+  list.norms = std::move(norms);
+  list.texcoords = std::move(texcoords);
+  list.positionDupMap = std::move(positionDupMap);
+  list.normalDupMap = std::move(normalDupMap);
+  list.texDupMap = std::move(texDupMap);
+  list.inputs = std::move(inputs);
+  list.combinedVertNorms = combinedVertNorms;
+  this->LoadNodeWeights(_mesh, list);
+  this->primitives.push_back(std::move(list));
+}
+
+/////////////////////////////////////////////////
+void ColladaLoaderPrivate::DecodePolylist(PrimitiveList &_list)
+{
+  const unsigned int VERTEX = 0;
+  const unsigned int NORMAL = 1;
+  const unsigned int TEXCOORD = 2;
+
+  std::unique_ptr<SubMesh> &subMesh = _list.subMesh;
+  const std::vector<ignition::math::Vector3d> &verts = _list.verts;
+  const std::vector<ignition::math::Vector3d> &norms = _list.norms;
+  const std::vector<ignition::math::Vector2d> &texcoords = _list.texcoords;
+  std::map<unsigned int, unsigned int> &texDupMap = _list.texDupMap;
+  std::map<unsigned int, unsigned int> &normalDupMap = _list.normalDupMap;
+  std::map<unsigned int, unsigned int> &positionDupMap =
+      _list.positionDupMap;
+  std::map<const unsigned int, std::set<int>> &inputs = _list.inputs;
+  const bool combinedVertNorms = _list.combinedVertNorms;
+
+  unsigned int inputSize = 0;
   for (const auto &input : inputs)
     inputSize += input.second.size();
 
@@ -1913,16 +2134,15 @@ void ColladaLoaderPrivate::LoadPolylist(tinyxml2::XMLElement *_polylistXml,
   // break poly into triangles
   // if vcount >= 4, anchor around 0 (note this is bad for concave elements)
   //   e.g. if vcount = 4, break into triangle 1: [0,1,2], triangle 2: [0,2,3]
-  tinyxml2::XMLElement *vcountXml = _polylistXml->FirstChildElement("vcount");
-  std::string vcountStr = vcountXml->GetText();
-  std::vector<std::string> vcountStrs = split(vcountStr, " \t\r\n");
+  const char *vcountStr = _list.vcount;
+  const char *vcountEnd = vcountStr + std::strlen(vcountStr);
   std::vector<int> vcounts;
-  for (unsigned int j = 0; j < vcountStrs.size(); ++j)
-    vcounts.push_back(math::parseInt(vcountStrs[j]));
+  for (int vcount; TextParser::NextInt(vcountStr, vcountEnd, vcount);)
+    vcounts.push_back(vcount);
 
   // read p
-  tinyxml2::XMLElement *pXml = _polylistXml->FirstChildElement("p");
-  std::string pStr = pXml->GetText();
+  const char *pStr = _list.p;
+  const char *pEnd = pStr + std::strlen(pStr);
 
   // vertexIndexMap is a map of collada vertex index to Gazebo submesh vertex
   // indices, used for identifying vertices that can be shared.
@@ -1930,13 +2150,23 @@ void ColladaLoaderPrivate::LoadPolylist(tinyxml2::XMLElement *_polylistXml,
   unsigned int *values = new unsigned int[inputSize];
   memset(values, 0, inputSize);
 
-  std::vector<std::string> strs = split(pStr, " \t\r\n");
-  std::vector<std::string>::iterator strs_iter = strs.begin();
+  std::vector<int> indices;
+  for (int index; TextParser::NextInt(pStr, pEnd, index);)
+    indices.push_back(index);
+
+  std::size_t polygonStart = 0;
   for (unsigned int l = 0; l < vcounts.size(); ++l)
   {
     // put us at the beginning of the polygon list
     if (l > 0)
-      strs_iter += inputSize * vcounts[l-1];
+      polygonStart += inputSize * std::max(vcounts[l-1], 0);
+
+    // Stop at a polygon that has fewer indices than its count
+    if (polygonStart + inputSize * std::max(vcounts[l], 0) > indices.size())
+    {
+      _list.error = "has a polylist with fewer indices than its vcount";
+      break;
+    }
 
     for (unsigned int k = 2; k < static_cast<unsigned int>(vcounts[l]); ++k)
     {
@@ -1957,7 +2187,7 @@ void ColladaLoaderPrivate::LoadPolylist(tinyxml2::XMLElement *_polylistXml,
 
         for (unsigned int i = 0; i < inputSize; ++i)
         {
-          values[i] = ignition::math::parseInt(strs_iter[triangle_index+i]);
+          values[i] = indices[polygonStart + triangle_index + i];
         }
 
         unsigned int daeVertIndex = 0;
@@ -2051,20 +2281,18 @@ void ColladaLoaderPrivate::LoadPolylist(tinyxml2::XMLElement *_polylistXml,
             subMesh->AddIndex(newVertIndex);
             if (combinedVertNorms)
               subMesh->AddNormal(norms[daeVertIndex]);
-            if (_mesh->HasSkeleton())
+            if (_list.hasSkeleton)
             {
-              subMesh->SetVertex(newVertIndex, bindShapeMat *
+              subMesh->SetVertex(newVertIndex, _list.bindShapeMat *
                   subMesh->Vertex(newVertIndex));
-              SkeletonPtr skel = _mesh->MeshSkeleton();
-              for (unsigned int i = 0;
-                  i < skel->VertNodeWeightCount(daeVertIndex); ++i)
+              if (daeVertIndex < _list.nodeWeights.size())
               {
-                std::pair<std::string, double> node_weight =
-                  skel->VertNodeWeight(daeVertIndex, i);
-                SkeletonNode *node =
-                    _mesh->MeshSkeleton()->NodeByName(node_weight.first);
-                subMesh->AddNodeAssignment(subMesh->VertexCount()-1,
-                                node->Handle(), node_weight.second);
+                for (const auto &nodeWeight :
+                     _list.nodeWeights[daeVertIndex])
+                {
+                  subMesh->AddNodeAssignment(newVertIndex, nodeWeight.first,
+                      nodeWeight.second);
+                }
               }
             }
             input.vertexIndex = daeVertIndex;
@@ -2112,8 +2340,6 @@ void ColladaLoaderPrivate::LoadPolylist(tinyxml2::XMLElement *_polylistXml,
     }
   }
   delete [] values;
-
-  _mesh->AddSubMesh(std::move(subMesh));
 }
 
 /////////////////////////////////////////////////
@@ -2158,10 +2384,6 @@ void ColladaLoaderPrivate::LoadTriangles(tinyxml2::XMLElement *_trianglesXml,
   const unsigned int NORMAL = 1;
   const unsigned int TEXCOORD = 2;
   unsigned int otherSemantics = TEXCOORD + 1;
-  bool hasVertices = false;
-  bool hasNormals = false;
-  bool hasTexcoords = false;
-  unsigned int offsetSize = 0;
 
   // read input elements. A vector of int is used because there can be
   // multiple TEXCOORD inputs.
@@ -2185,21 +2407,18 @@ void ColladaLoaderPrivate::LoadTriangles(tinyxml2::XMLElement *_trianglesXml,
       if (norms.size() > count)
         combinedVertNorms = true;
       inputs[VERTEX].insert(ignition::math::parseInt(offset));
-      hasVertices = true;
     }
     else if (semantic == "NORMAL")
     {
       this->LoadNormals(source, _transform, norms, normalDupMap);
       combinedVertNorms = false;
       inputs[NORMAL].insert(ignition::math::parseInt(offset));
-      hasNormals = true;
     }
     else if (semantic == "TEXCOORD")
     {
       // we currently only support one set of UVs
       this->LoadTexCoords(source, texcoords, texDupMap);
       inputs[TEXCOORD].insert(ignition::math::parseInt(offset));
-      hasTexcoords = true;
     }
     else
     {
@@ -2210,9 +2429,6 @@ void ColladaLoaderPrivate::LoadTriangles(tinyxml2::XMLElement *_trianglesXml,
     trianglesInputXml = trianglesInputXml->NextSiblingElement("input");
   }
 
-  for (const auto &input : inputs)
-    offsetSize += input.second.size();
-
   tinyxml2::XMLElement *pXml = _trianglesXml->FirstChildElement("p");
   if (!pXml || !pXml->GetText())
   {
@@ -2244,7 +2460,49 @@ void ColladaLoaderPrivate::LoadTriangles(tinyxml2::XMLElement *_trianglesXml,
 
     return;
   }
-  std::string pStr = pXml->GetText();
+  PrimitiveList list;
+  list.type = PrimitiveList::TRIANGLES;
+  list.subMesh = std::move(subMesh);
+  list.p = pXml->GetText();
+  list.verts = std::move(verts);
+  list.norms = std::move(norms);
+  list.texcoords = std::move(texcoords);
+  list.positionDupMap = std::move(positionDupMap);
+  list.normalDupMap = std::move(normalDupMap);
+  list.texDupMap = std::move(texDupMap);
+  list.inputs = std::move(inputs);
+  list.combinedVertNorms = combinedVertNorms;
+  this->LoadNodeWeights(_mesh, list);
+  this->primitives.push_back(std::move(list));
+}
+
+/////////////////////////////////////////////////
+void ColladaLoaderPrivate::DecodeTriangles(PrimitiveList &_list)
+{
+  const unsigned int VERTEX = 0;
+  const unsigned int NORMAL = 1;
+  const unsigned int TEXCOORD = 2;
+
+  std::unique_ptr<SubMesh> &subMesh = _list.subMesh;
+  const std::vector<ignition::math::Vector3d> &verts = _list.verts;
+  const std::vector<ignition::math::Vector3d> &norms = _list.norms;
+  const std::vector<ignition::math::Vector2d> &texcoords = _list.texcoords;
+  std::map<unsigned int, unsigned int> &texDupMap = _list.texDupMap;
+  std::map<unsigned int, unsigned int> &normalDupMap = _list.normalDupMap;
+  std::map<unsigned int, unsigned int> &positionDupMap =
+      _list.positionDupMap;
+  std::map<const unsigned int, std::set<int>> &inputs = _list.inputs;
+  const bool combinedVertNorms = _list.combinedVertNorms;
+
+  const bool hasVertices = inputs.find(VERTEX) != inputs.end();
+  const bool hasNormals = inputs.find(NORMAL) != inputs.end();
+  const bool hasTexcoords = inputs.find(TEXCOORD) != inputs.end();
+  unsigned int offsetSize = 0;
+  for (const auto &input : inputs)
+    offsetSize += input.second.size();
+
+  const char *pStr = _list.p;
+  const char *pEnd = pStr + std::strlen(pStr);
 
   // Collada format allows normals and texcoords to have their own set of
   // indices for more efficient storage of data but opengl only supports one
@@ -2257,12 +2515,19 @@ void ColladaLoaderPrivate::LoadTriangles(tinyxml2::XMLElement *_trianglesXml,
   std::map<unsigned int, std::vector<GeometryIndices> > vertexIndexMap;
 
   std::vector<unsigned int> values(offsetSize);
-  std::vector<std::string> strs = split(pStr, " \t\r\n");
 
-  for (unsigned int j = 0; j < strs.size(); j += offsetSize)
+  // Read the indices of one vertex at a time, in place, up to the last
+  // complete vertex
+  while (pStr < pEnd)
   {
-    for (unsigned int i = 0; i < offsetSize; ++i)
-      values.at(i) = ignition::math::parseInt(strs[j+i]);
+    unsigned int read = 0;
+    for (int index; read < offsetSize &&
+         TextParser::NextInt(pStr, pEnd, index); ++read)
+    {
+      values[read] = static_cast<unsigned int>(index);
+    }
+    if (read < offsetSize || offsetSize == 0)
+      break;
 
     unsigned int daeVertIndex = 0;
     bool addIndex = !hasVertices;
@@ -2349,18 +2614,12 @@ void ColladaLoaderPrivate::LoadTriangles(tinyxml2::XMLElement *_trianglesXml,
 
         if (combinedVertNorms)
           subMesh->AddNormal(norms[daeVertIndex]);
-        if (_mesh->HasSkeleton())
+        if (daeVertIndex < _list.nodeWeights.size())
         {
-          SkeletonPtr skel = _mesh->MeshSkeleton();
-          for (unsigned int i = 0;
-              i < skel->VertNodeWeightCount(daeVertIndex); ++i)
+          for (const auto &nodeWeight : _list.nodeWeights[daeVertIndex])
           {
-            std::pair<std::string, double> node_weight =
-              skel->VertNodeWeight(daeVertIndex, i);
-            SkeletonNode *node =
-                _mesh->MeshSkeleton()->NodeByName(node_weight.first);
-            subMesh->AddNodeAssignment(subMesh->VertexCount()-1,
-                            node->Handle(), node_weight.second);
+            subMesh->AddNodeAssignment(newVertIndex, nodeWeight.first,
+                nodeWeight.second);
           }
         }
         input.vertexIndex = daeVertIndex;
@@ -2395,13 +2654,11 @@ void ColladaLoaderPrivate::LoadTriangles(tinyxml2::XMLElement *_trianglesXml,
       }
     }
   }
-
-  _mesh->AddSubMesh(std::move(subMesh));
 }
 
 /////////////////////////////////////////////////
 void ColladaLoaderPrivate::LoadLines(tinyxml2::XMLElement *_xml,
-    const ignition::math::Matrix4d &_transform, Mesh *_mesh)
+    const ignition::math::Matrix4d &_transform)
 {
   std::unique_ptr<SubMesh> subMesh(new SubMesh);
   subMesh->SetName(this->currentNodeName);
@@ -2416,8 +2673,22 @@ void ColladaLoaderPrivate::LoadLines(tinyxml2::XMLElement *_xml,
   this->LoadVertices(source, _transform, verts, norms);
 
   tinyxml2::XMLElement *pXml = _xml->FirstChildElement("p");
-  std::string pStr = pXml->GetText();
-  std::istringstream iss(pStr);
+
+  PrimitiveList list;
+  list.type = PrimitiveList::LINES;
+  list.subMesh = std::move(subMesh);
+  list.p = pXml->GetText();
+  list.verts = std::move(verts);
+  this->primitives.push_back(std::move(list));
+}
+
+/////////////////////////////////////////////////
+void ColladaLoaderPrivate::DecodeLines(PrimitiveList &_list)
+{
+  std::unique_ptr<SubMesh> &subMesh = _list.subMesh;
+  const std::vector<ignition::math::Vector3d> &verts = _list.verts;
+
+  std::istringstream iss(_list.p);
 
   do
   {
@@ -2431,8 +2702,72 @@ void ColladaLoaderPrivate::LoadLines(tinyxml2::XMLElement *_xml,
     subMesh->AddVertex(verts[b]);
     subMesh->AddIndex(subMesh->VertexCount() - 1);
   } while (iss);
+}
 
-  _mesh->AddSubMesh(std::move(subMesh));
+/////////////////////////////////////////////////
+void ColladaLoaderPrivate::LoadNodeWeights(const Mesh *_mesh,
+    PrimitiveList &_list)
+{
+  _list.hasSkeleton = _mesh->HasSkeleton();
+  if (!_list.hasSkeleton)
+    return;
+
+  SkeletonPtr skel = _mesh->MeshSkeleton();
+  _list.bindShapeMat = skel->BindShapeTransform();
+  _list.nodeWeights.resize(skel->NumVertAttached());
+  for (unsigned int v = 0; v < _list.nodeWeights.size(); ++v)
+  {
+    for (unsigned int i = 0; i < skel->VertNodeWeightCount(v); ++i)
+    {
+      std::pair<std::string, double> nodeWeight = skel->VertNodeWeight(v, i);
+      SkeletonNode *node = skel->NodeByName(nodeWeight.first);
+      if (node)
+      {
+        _list.nodeWeights[v].push_back(
+            std::make_pair(node->Handle(), nodeWeight.second));
+      }
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+void ColladaLoaderPrivate::DecodePrimitives(Mesh *_mesh)
+{
+  // Each list only reads its own inputs and writes its own submesh
+  WorkerPool::Shared().ParallelFor(0, this->primitives.size(), 1,
+      [this](const std::size_t _first, const std::size_t _last)
+  {
+    for (std::size_t i = _first; i < _last; ++i)
+    {
+      PrimitiveList &list = this->primitives[i];
+      switch (list.type)
+      {
+        case PrimitiveList::TRIANGLES:
+          DecodeTriangles(list);
+          break;
+        case PrimitiveList::POLYLIST:
+          DecodePolylist(list);
+          break;
+        case PrimitiveList::LINES:
+          DecodeLines(list);
+          break;
+        default:
+          list.error = "has a primitive list of unknown type";
+          break;
+      }
+    }
+  });
+
+  for (PrimitiveList &list : this->primitives)
+  {
+    if (!list.error.empty())
+    {
+      ignerr << "Collada file[" << this->filename << "] " << list.error
+             << ". Loading what we can...\n";
+    }
+    _mesh->AddSubMesh(std::move(list.subMesh));
+  }
+  this->primitives.clear();
 }
 
 /////////////////////////////////////////////////
@@ -16,7 +16,13 @@
 */
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
 #include "test_config.h"
+#include "ignition/common/Filesystem.hh"
 #include "ignition/common/Mesh.hh"
 #include "ignition/common/SubMesh.hh"
 #include "ignition/common/Material.hh"
@@ -347,6 +353,148 @@ TEST_F(ColladaLoader, MergeBoxWithDoubleSkeleton)
   EXPECT_EQ(skeleton_ptr->RootNode()->Name(), std::string("Armature"));
 }
 
+/////////////////////////////////////////////////
+TEST_F(ColladaLoader, ArrayWhitespace)
+{
+  // The box, with the numbers of its arrays separated by line ends, tabs
+  // and runs of spaces instead of single spaces
+  std::ifstream source(
+      std::string(PROJECT_SOURCE_PATH) + "/test/data/box.dae");
+  std::stringstream buffer;
+  buffer << source.rdbuf();
+  std::string content = buffer.str();
+  for (const std::string tag : {"<float_array", "<p>"})
+  {
+    std::size_t first = content.find(tag);
+    while (first != std::string::npos)
+    {
+      first = content.find('>', first) + 1;
+      const std::size_t last = content.find('<', first);
+      std::string text;
+      for (std::size_t i = first; i < last; ++i)
+      {
+        if (content[i] == ' ')
+          text += "\r\n\t  ";
+        else
+          text += content[i];
+      }
+      content.replace(first, last - first, "\n " + text + " \n");
+      first = content.find(tag, first);
+    }
+  }
+
+  const std::string path =
+    common::joinPaths(common::cwd(), "tmp", "collada_loader");
+  common::createDirectories(path);
+  const std::string filename = common::joinPaths(path, "box.dae");
+  std::ofstream(filename, std::ios::binary) << content;
+
+  common::ColladaLoader loader;
+  std::unique_ptr<common::Mesh> expected(loader.Load(
+      std::string(PROJECT_SOURCE_PATH) + "/test/data/box.dae"));
+  std::unique_ptr<common::Mesh> mesh(loader.Load(filename));
+  common::removeAll(path);
+  ASSERT_NE(nullptr, mesh);
+  ASSERT_EQ(1u, mesh->SubMeshCount());
+
+  auto subMesh = mesh->SubMeshByIndex(0).lock();
+  auto expectedSubMesh = expected->SubMeshByIndex(0).lock();
+  ASSERT_EQ(24u, subMesh->VertexCount());
+  ASSERT_EQ(24u, subMesh->NormalCount());
+  ASSERT_EQ(36u, subMesh->IndexCount());
+  for (unsigned int i = 0; i < subMesh->VertexCount(); ++i)
+  {
+    EXPECT_EQ(expectedSubMesh->Vertex(i), subMesh->Vertex(i));
+    EXPECT_EQ(expectedSubMesh->Normal(i), subMesh->Normal(i));
+  }
+  for (unsigned int i = 0; i < subMesh->IndexCount(); ++i)
+    EXPECT_EQ(expectedSubMesh->Index(i), subMesh->Index(i));
+}
+
+/////////////////////////////////////////////////
+TEST_F(ColladaLoader, ManyGeometries)
+{
+  // Geometries of triangles, polygons and lines, which are decoded in
+  // parallel, then added to the mesh in the order of the scene
+  const int count = 60;
+  std::ostringstream content;
+  content << "<?xml version=\"1.0\"?>\n"
+          << "<COLLADA xmlns=\"http://www.collada.org/2005/11/"
+          << "COLLADASchema\" version=\"1.4.1\">\n<library_geometries>\n";
+  for (int g = 0; g < count; ++g)
+  {
+    const std::string id = "geom" + std::to_string(g);
+    content << "<geometry id=\"" << id << "\"><mesh>"
+            << "<source id=\"" << id << "-positions\"><float_array id=\""
+            << id << "-array\" count=\"12\">0 0 " << g << " 1 0 " << g
+            << " 1 1 " << g << " 0 1 " << g << "</float_array></source>"
+            << "<vertices id=\"" << id << "-vertices\"><input semantic="
+            << "\"POSITION\" source=\"#" << id << "-positions\"/>"
+            << "</vertices>";
+    const std::string input = "<input semantic=\"VERTEX\" source=\"#" +
+      id + "-vertices\" offset=\"0\"/>";
+    if (g % 3 == 0)
+    {
+      content << "<triangles count=\"2\">" << input
+              << "<p>0 1 2 0 2 3</p></triangles>";
+    }
+    else if (g % 3 == 1)
+    {
+      content << "<polylist count=\"1\">" << input
+              << "<vcount>4</vcount><p>0 1 2 3</p></polylist>";
+    }
+    else
+    {
+      content << "<lines count=\"2\">" << input
+              << "<p>0 1 2 3</p></lines>";
+    }
+    content << "</mesh></geometry>\n";
+  }
+  content << "</library_geometries>\n<library_visual_scenes>"
+          << "<visual_scene id=\"scene\">\n";
+  for (int g = 0; g < count; ++g)
+  {
+    content << "<node id=\"node" << g << "\" name=\"node" << g << "\">"
+            << "<instance_geometry url=\"#geom" << g << "\"/></node>\n";
+  }
+  content << "</visual_scene></library_visual_scenes>\n"
+          << "<scene><instance_visual_scene url=\"#scene\"/></scene>\n"
+          << "</COLLADA>\n";
+
+  const std::string path =
+    common::joinPaths(common::cwd(), "tmp", "collada_loader");
+  common::createDirectories(path);
+  const std::string filename = common::joinPaths(path, "geometries.dae");
+  std::ofstream(filename, std::ios::binary) << content.str();
+
+  common::ColladaLoader loader;
+  std::unique_ptr<common::Mesh> mesh(loader.Load(filename));
+  common::removeAll(path);
+  ASSERT_NE(nullptr, mesh);
+  ASSERT_EQ(static_cast<unsigned int>(count), mesh->SubMeshCount());
+
+  for (int g = 0; g < count; ++g)
+  {
+    auto subMesh = mesh->SubMeshByIndex(g).lock();
+    ASSERT_NE(nullptr, subMesh);
+    EXPECT_EQ("node" + std::to_string(g), subMesh->Name());
+    if (g % 3 == 2)
+    {
+      EXPECT_EQ(common::SubMesh::LINES, subMesh->SubMeshPrimitiveType());
+      EXPECT_EQ(4u, subMesh->VertexCount());
+    }
+    else
+    {
+      EXPECT_EQ(common::SubMesh::TRIANGLES,
+          subMesh->SubMeshPrimitiveType());
+      EXPECT_EQ(4u, subMesh->VertexCount());
+      EXPECT_EQ(6u, subMesh->IndexCount());
+    }
+    for (unsigned int v = 0; v < subMesh->VertexCount(); ++v)
+      EXPECT_DOUBLE_EQ(g, subMesh->Vertex(v).Z());
+  }
+}
+
 /////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
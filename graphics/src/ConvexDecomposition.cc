@@ -0,0 +1,688 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ignition/common/Console.hh"
+#include "ignition/common/ConvexDecomposition.hh"
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/SubMesh.hh"
+#include "ignition/common/WorkerPool.hh"
+
+using namespace ignition;
+using namespace common;
+
+/// \brief Number of split planes tried along each axis when splitting a
+/// piece.
+static const unsigned int SplitCandidates = 7;
+
+/// \brief A triangle of a convex hull
+struct HullFace
+{
+  /// \brief Corners, as indices in the points of the hull, in counter
+  /// clockwise order seen from outside.
+  std::array<unsigned int, 3> v;
+
+  /// \brief Unit normal, pointing outside
+  math::Vector3d normal;
+
+  /// \brief Offset of the plane of the face, such that the signed distance
+  /// of a point p is normal.Dot(p) - offset.
+  double offset;
+
+  /// \brief Points outside of this face that are not in the hull yet
+  std::vector<unsigned int> outside;
+
+  /// \brief False once the face was replaced
+  bool alive;
+};
+
+/// \brief Key of a directed edge between two points
+/// \param[in] _a Start of the edge
+/// \param[in] _b End of the edge
+/// \return The key
+static uint64_t EdgeKey(const unsigned int _a, const unsigned int _b)
+{
+  return (static_cast<uint64_t>(_a) << 32) | _b;
+}
+
+/// \brief Create a face of a hull
+/// \param[in] _points Points of the hull
+/// \param[in] _a First corner
+/// \param[in] _b Second corner
+/// \param[in] _c Third corner
+/// \return The face
+static HullFace MakeFace(const std::vector<math::Vector3d> &_points,
+    const unsigned int _a, const unsigned int _b, const unsigned int _c)
+{
+  HullFace face;
+  face.v = {{_a, _b, _c}};
+  face.normal = (_points[_b] - _points[_a]).Cross(_points[_c] - _points[_a]);
+  const double length = face.normal.Length();
+  if (length > 0.0)
+    face.normal /= length;
+  face.offset = face.normal.Dot(_points[_a]);
+  face.alive = true;
+  return face;
+}
+
+/// \brief Compute the convex hull of points with the quickhull algorithm,
+/// from "The Quickhull Algorithm for Convex Hulls" by Barber, Dobkin and
+/// Huhdanpaa.
+/// \param[in] _points The points
+/// \param[out] _faces The faces of the hull
+/// \return False if the points are all in one plane, or are not finite.
+static bool QuickHull(const std::vector<math::Vector3d> &_points,
+    std::vector<HullFace> &_faces)
+{
+  _faces.clear();
+  if (_points.size() < 4)
+    return false;
+
+  // Points closer than this to a plane are considered in the plane
+  math::Vector3d min = _points[0];
+  math::Vector3d max = _points[0];
+  for (const math::Vector3d &point : _points)
+  {
+    if (!point.IsFinite())
+      return false;
+    min.Min(point);
+    max.Max(point);
+  }
+  const double epsilon = 1e-9 * std::max((max - min).Length(),
+      std::max(min.Abs().Max(), max.Abs().Max()));
+
+  // First simplex, from the two extreme points farthest from each other,
+  // the point farthest from their line and the point farthest from the
+  // plane of the three.
+  std::array<unsigned int, 6> extremes = {{0, 0, 0, 0, 0, 0}};
+  for (unsigned int i = 0; i < _points.size(); ++i)
+  {
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+      if (_points[i][axis] < _points[extremes[2 * axis]][axis])
+        extremes[2 * axis] = i;
+      if (_points[i][axis] > _points[extremes[2 * axis + 1]][axis])
+        extremes[2 * axis + 1] = i;
+    }
+  }
+
+  unsigned int i0 = 0;
+  unsigned int i1 = 0;
+  double best = 0.0;
+  for (const unsigned int a : extremes)
+  {
+    for (const unsigned int b : extremes)
+    {
+      const double distance = _points[a].Distance(_points[b]);
+      if (distance > best)
+      {
+        best = distance;
+        i0 = a;
+        i1 = b;
+      }
+    }
+  }
+  if (best <= epsilon)
+    return false;
+
+  const math::Vector3d direction = (_points[i1] - _points[i0]).Normalized();
+  unsigned int i2 = 0;
+  best = 0.0;
+  for (unsigned int i = 0; i < _points.size(); ++i)
+  {
+    const double distance =
+      (_points[i] - _points[i0]).Cross(direction).Length();
+    if (distance > best)
+    {
+      best = distance;
+      i2 = i;
+    }
+  }
+  if (best <= epsilon)
+    return false;
+
+  const math::Vector3d normal = (_points[i1] - _points[i0]).Cross(
+      _points[i2] - _points[i0]).Normalized();
+  unsigned int i3 = 0;
+  best = 0.0;
+  for (unsigned int i = 0; i < _points.size(); ++i)
+  {
+    const double distance = std::abs(normal.Dot(_points[i] - _points[i0]));
+    if (distance > best)
+    {
+      best = distance;
+      i3 = i;
+    }
+  }
+  if (best <= epsilon)
+    return false;
+
+  // Faces of the simplex, facing away from the opposite corner
+  const std::array<std::array<unsigned int, 4>, 4> simplex = {{
+    {{i0, i1, i2, i3}}, {{i0, i1, i3, i2}},
+    {{i0, i2, i3, i1}}, {{i1, i2, i3, i0}}}};
+  std::unordered_map<uint64_t, unsigned int> edges;
+  for (const auto &corners : simplex)
+  {
+    HullFace face = MakeFace(_points, corners[0], corners[1], corners[2]);
+    if (face.normal.Dot(_points[corners[3]]) - face.offset > 0.0)
+      face = MakeFace(_points, corners[0], corners[2], corners[1]);
+    for (unsigned int e = 0; e < 3; ++e)
+    {
+      edges[EdgeKey(face.v[e], face.v[(e + 1) % 3])] =
+        static_cast<unsigned int>(_faces.size());
+    }
+    _faces.push_back(std::move(face));
+  }
+
+  // Give every point to the face it is the farthest outside of
+  auto assign = [&](const unsigned int _point, const std::size_t _first)
+  {
+    double farthest = epsilon;
+    std::size_t owner = _faces.size();
+    for (std::size_t f = _first; f < _faces.size(); ++f)
+    {
+      const double distance =
+        _faces[f].normal.Dot(_points[_point]) - _faces[f].offset;
+      if (_faces[f].alive && distance > farthest)
+      {
+        farthest = distance;
+        owner = f;
+      }
+    }
+    if (owner < _faces.size())
+      _faces[owner].outside.push_back(_point);
+  };
+
+  for (unsigned int i = 0; i < _points.size(); ++i)
+  {
+    if (i != i0 && i != i1 && i != i2 && i != i3)
+      assign(i, 0);
+  }
+
+  std::vector<unsigned int> visible;
+  std::vector<std::pair<unsigned int, unsigned int>> horizon;
+  std::vector<unsigned int> orphans;
+  std::vector<char> isVisible;
+  for (std::size_t f = 0; f < _faces.size(); ++f)
+  {
+    if (!_faces[f].alive || _faces[f].outside.empty())
+      continue;
+
+    // The point farthest outside of the face is added to the hull
+    unsigned int eye = _faces[f].outside[0];
+    best = -1.0;
+    for (const unsigned int point : _faces[f].outside)
+    {
+      const double distance =
+        _faces[f].normal.Dot(_points[point]) - _faces[f].offset;
+      if (distance > best)
+      {
+        best = distance;
+        eye = point;
+      }
+    }
+
+    // Find the faces that the eye sees, and the edges around them
+    isVisible.assign(_faces.size(), 0);
+    visible.assign(1, static_cast<unsigned int>(f));
+    isVisible[f] = 1;
+    horizon.clear();
+    for (std::size_t i = 0; i < visible.size(); ++i)
+    {
+      const HullFace &face = _faces[visible[i]];
+      for (unsigned int e = 0; e < 3; ++e)
+      {
+        const unsigned int a = face.v[e];
+        const unsigned int b = face.v[(e + 1) % 3];
+        auto twin = edges.find(EdgeKey(b, a));
+        if (twin == edges.end())
+        {
+          ignerr << "Convex hull is not closed\n";
+          _faces.clear();
+          return false;
+        }
+        const unsigned int neighbor = twin->second;
+        if (isVisible[neighbor])
+          continue;
+
+        const HullFace &other = _faces[neighbor];
+        if (other.normal.Dot(_points[eye]) - other.offset > epsilon)
+        {
+          isVisible[neighbor] = 1;
+          visible.push_back(neighbor);
+        }
+        else
+        {
+          horizon.push_back(std::make_pair(a, b));
+        }
+      }
+    }
+
+    // Remove the visible faces, and connect the horizon to the eye
+    orphans.clear();
+    for (const unsigned int v : visible)
+    {
+      HullFace &face = _faces[v];
+      for (const unsigned int point : face.outside)
+      {
+        if (point != eye)
+          orphans.push_back(point);
+      }
+      face.outside.clear();
+      face.outside.shrink_to_fit();
+      face.alive = false;
+      for (unsigned int e = 0; e < 3; ++e)
+        edges.erase(EdgeKey(face.v[e], face.v[(e + 1) % 3]));
+    }
+
+    const std::size_t first = _faces.size();
+    for (const auto &edge : horizon)
+    {
+      HullFace face = MakeFace(_points, edge.first, edge.second, eye);
+      for (unsigned int e = 0; e < 3; ++e)
+      {
+        const bool added = edges.emplace(
+            EdgeKey(face.v[e], face.v[(e + 1) % 3]),
+            static_cast<unsigned int>(_faces.size())).second;
+        if (!added)
+        {
+          ignerr << "Convex hull has a non-manifold edge\n";
+          _faces.clear();
+          return false;
+        }
+      }
+      _faces.push_back(std::move(face));
+    }
+
+    for (const unsigned int point : orphans)
+      assign(point, first);
+  }
+
+  _faces.erase(std::remove_if(_faces.begin(), _faces.end(),
+        [](const HullFace &_face) {return !_face.alive;}), _faces.end());
+  return true;
+}
+
+/// \brief Create a submesh from a convex hull
+/// \param[in] _points Points of the hull
+/// \param[in] _faces Faces of the hull
+/// \param[in] _name Name of the submesh
+/// \param[in] _materialIndex Material index of the submesh
+/// \return The submesh, with only the points on the hull.
+static std::unique_ptr<SubMesh> HullSubMesh(
+    const std::vector<math::Vector3d> &_points,
+    const std::vector<HullFace> &_faces, const std::string &_name,
+    const unsigned int _materialIndex)
+{
+  std::unique_ptr<SubMesh> submesh(new SubMesh(_name));
+  submesh->SetPrimitiveType(SubMesh::TRIANGLES);
+  submesh->SetMaterialIndex(_materialIndex);
+
+  const unsigned int none = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> newIndex(_points.size(), none);
+  for (const HullFace &face : _faces)
+  {
+    for (const unsigned int point : face.v)
+    {
+      if (newIndex[point] == none)
+      {
+        newIndex[point] = submesh->VertexCount();
+        submesh->AddVertex(_points[point]);
+      }
+      submesh->AddIndex(newIndex[point]);
+    }
+  }
+  return submesh;
+}
+
+/// \brief Get the distinct positions of vertices.
+/// \param[in] _submesh Submesh of the vertices
+/// \param[in] _indices Indices of the vertices in _submesh
+/// \param[out] _points Positions, appended to the vector
+static void AddPoints(const SubMesh &_submesh,
+    const std::vector<unsigned int> &_indices,
+    std::vector<math::Vector3d> &_points)
+{
+  for (const unsigned int index : _indices)
+    _points.push_back(_submesh.Vertex(index));
+}
+
+/// \brief Sort positions and remove duplicates
+/// \param[in,out] _points The positions
+static void UniquePoints(std::vector<math::Vector3d> &_points)
+{
+  auto key = [](const math::Vector3d &_p)
+  {
+    return std::make_tuple(_p.X(), _p.Y(), _p.Z());
+  };
+  std::sort(_points.begin(), _points.end(),
+      [&](const math::Vector3d &_a, const math::Vector3d &_b)
+      {
+        return key(_a) < key(_b);
+      });
+  _points.erase(std::unique(_points.begin(), _points.end(),
+        [&](const math::Vector3d &_a, const math::Vector3d &_b)
+        {
+          return key(_a) == key(_b);
+        }), _points.end());
+}
+
+/// \brief Get the indices of the vertices that a submesh uses
+/// \param[in] _submesh The submesh
+/// \return Indices of the vertices used by indices, or of all the vertices
+/// if the submesh has no index. Indices out of range are skipped.
+static std::vector<unsigned int> UsedVertices(const SubMesh &_submesh)
+{
+  std::vector<unsigned int> used;
+  if (_submesh.IndexCount() == 0)
+  {
+    for (unsigned int v = 0; v < _submesh.VertexCount(); ++v)
+      used.push_back(v);
+    return used;
+  }
+
+  for (const unsigned int index : _submesh.Indices())
+  {
+    if (index < _submesh.VertexCount())
+      used.push_back(index);
+  }
+  std::sort(used.begin(), used.end());
+  used.erase(std::unique(used.begin(), used.end()), used.end());
+  return used;
+}
+
+/// \brief A set of triangles of a submesh, with its convex hull
+struct Piece
+{
+  /// \brief Index of the first corner of each triangle
+  std::vector<unsigned int> triangles;
+
+  /// \brief Distinct corner positions
+  std::vector<math::Vector3d> points;
+
+  /// \brief Faces of the hull of the points
+  std::vector<HullFace> hull;
+
+  /// \brief Largest distance between the triangles and the hull surface
+  double concavity = 0.0;
+
+  /// \brief Volume of the hull
+  double volume = 0.0;
+
+  /// \brief True if the piece could not be split
+  bool final = false;
+};
+
+/// \brief Compute the hull, the concavity and the hull volume of a piece.
+/// \param[in] _positions Positions of the vertices of the submesh
+/// \param[in] _indices Indices of the submesh
+/// \param[in,out] _piece The piece, with its triangles set
+/// \return False if the hull of the piece has no volume.
+static bool Evaluate(const std::vector<math::Vector3d> &_positions,
+    const std::vector<unsigned int> &_indices, Piece &_piece)
+{
+  _piece.points.clear();
+  for (const unsigned int t : _piece.triangles)
+  {
+    for (unsigned int c = 0; c < 3; ++c)
+      _piece.points.push_back(_positions[_indices[t + c]]);
+  }
+  UniquePoints(_piece.points);
+  if (!QuickHull(_piece.points, _piece.hull))
+    return false;
+
+  // Distance of a point inside the hull to the surface of the hull
+  auto depth = [&](const math::Vector3d &_point)
+  {
+    double nearest = std::numeric_limits<double>::max();
+    for (const HullFace &face : _piece.hull)
+      nearest = std::min(nearest, face.offset - face.normal.Dot(_point));
+    return std::max(0.0, nearest);
+  };
+
+  math::Vector3d inside;
+  for (const math::Vector3d &point : _piece.points)
+    inside += point;
+  inside /= static_cast<double>(_piece.points.size());
+
+  _piece.volume = 0.0;
+  for (const HullFace &face : _piece.hull)
+  {
+    const double area = 0.5 * (_piece.points[face.v[1]] -
+        _piece.points[face.v[0]]).Cross(_piece.points[face.v[2]] -
+        _piece.points[face.v[0]]).Length();
+    _piece.volume += area * (face.offset - face.normal.Dot(inside)) / 3.0;
+  }
+
+  _piece.concavity = 0.0;
+  for (const math::Vector3d &point : _piece.points)
+    _piece.concavity = std::max(_piece.concavity, depth(point));
+  for (const unsigned int t : _piece.triangles)
+  {
+    const math::Vector3d center = (_positions[_indices[t]] +
+        _positions[_indices[t + 1]] + _positions[_indices[t + 2]]) / 3.0;
+    _piece.concavity = std::max(_piece.concavity, depth(center));
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+std::unique_ptr<SubMesh> ConvexDecomposition::ConvexHull(
+    const SubMesh &_submesh)
+{
+  std::vector<math::Vector3d> points;
+  AddPoints(_submesh, UsedVertices(_submesh), points);
+  UniquePoints(points);
+
+  std::vector<HullFace> faces;
+  if (!QuickHull(points, faces))
+    return nullptr;
+  return HullSubMesh(points, faces, _submesh.Name(),
+      _submesh.MaterialIndex());
+}
+
+/////////////////////////////////////////////////
+std::unique_ptr<SubMesh> ConvexDecomposition::ConvexHull(const Mesh &_mesh)
+{
+  std::vector<math::Vector3d> points;
+  for (unsigned int i = 0; i < _mesh.SubMeshCount(); ++i)
+  {
+    auto submesh = _mesh.SubMeshByIndex(i).lock();
+    if (submesh)
+      AddPoints(*submesh, UsedVertices(*submesh), points);
+  }
+  UniquePoints(points);
+
+  std::vector<HullFace> faces;
+  if (!QuickHull(points, faces))
+    return nullptr;
+  return HullSubMesh(points, faces, _mesh.Name(), 0);
+}
+
+/////////////////////////////////////////////////
+std::vector<std::unique_ptr<SubMesh>> ConvexDecomposition::Decompose(
+    const SubMesh &_submesh, const unsigned int _maxHulls,
+    const double _maxConcavity)
+{
+  std::vector<std::unique_ptr<SubMesh>> hulls;
+  if (_submesh.SubMeshPrimitiveType() != SubMesh::TRIANGLES ||
+      _submesh.IndexCount() % 3 != 0)
+  {
+    ignerr << "Only submeshes of triangles can be decomposed\n";
+    return hulls;
+  }
+
+  const unsigned int vertexCount = _submesh.VertexCount();
+  const std::vector<unsigned int> indices(_submesh.Indices().begin(),
+      _submesh.Indices().end());
+  for (const unsigned int index : indices)
+  {
+    if (index >= vertexCount)
+    {
+      ignerr << "Index [" << index << "] is out of range of ["
+        << vertexCount << "] vertices\n";
+      return hulls;
+    }
+  }
+
+  std::vector<math::Vector3d> positions(vertexCount);
+  for (unsigned int v = 0; v < vertexCount; ++v)
+    positions[v] = _submesh.Vertex(v);
+
+  std::vector<Piece> pieces(1);
+  for (unsigned int t = 0; t < indices.size(); t += 3)
+    pieces[0].triangles.push_back(t);
+  if (!Evaluate(positions, indices, pieces[0]))
+  {
+    ignerr << "Submesh [" << _submesh.Name() << "] has no volume\n";
+    return hulls;
+  }
+
+  math::Vector3d min = pieces[0].points.front();
+  math::Vector3d max = min;
+  for (const math::Vector3d &point : pieces[0].points)
+  {
+    min.Min(point);
+    max.Max(point);
+  }
+  const double maxConcavity = _maxConcavity * (max - min).Length();
+
+  while (pieces.size() < _maxHulls)
+  {
+    // Split the piece with the largest concavity
+    std::size_t worst = pieces.size();
+    for (std::size_t p = 0; p < pieces.size(); ++p)
+    {
+      if (!pieces[p].final && pieces[p].concavity > maxConcavity &&
+          (worst == pieces.size() ||
+           pieces[p].concavity > pieces[worst].concavity))
+      {
+        worst = p;
+      }
+    }
+    if (worst == pieces.size())
+      break;
+
+    const Piece &piece = pieces[worst];
+    math::Vector3d low(std::numeric_limits<double>::max(),
+        std::numeric_limits<double>::max(),
+        std::numeric_limits<double>::max());
+    math::Vector3d high = -low;
+    std::vector<math::Vector3d> centers(piece.triangles.size());
+    for (std::size_t i = 0; i < piece.triangles.size(); ++i)
+    {
+      const unsigned int t = piece.triangles[i];
+      centers[i] = (positions[indices[t]] + positions[indices[t + 1]] +
+          positions[indices[t + 2]]) / 3.0;
+      low.Min(centers[i]);
+      high.Max(centers[i]);
+    }
+
+    // Try planes along each axis, splitting triangles by their centers,
+    // and keep the split with the smallest total hull volume
+    std::vector<std::pair<Piece, Piece>> splits(3 * SplitCandidates);
+    std::vector<double> costs(splits.size(),
+        std::numeric_limits<double>::infinity());
+    WorkerPool::Shared().ParallelFor(0, splits.size(), 1,
+        [&](const std::size_t _first, const std::size_t _last)
+        {
+          for (std::size_t s = _first; s < _last; ++s)
+          {
+            const unsigned int axis = s / SplitCandidates;
+            const double plane = low[axis] + (high[axis] - low[axis]) *
+              (s % SplitCandidates + 1) / (SplitCandidates + 1);
+            Piece &below = splits[s].first;
+            Piece &above = splits[s].second;
+            for (std::size_t i = 0; i < piece.triangles.size(); ++i)
+            {
+              (centers[i][axis] < plane ? below : above).triangles.push_back(
+                  piece.triangles[i]);
+            }
+            if (!below.triangles.empty() && !above.triangles.empty() &&
+                Evaluate(positions, indices, below) &&
+                Evaluate(positions, indices, above))
+            {
+              costs[s] = below.volume + above.volume;
+            }
+          }
+        });
+
+    const std::size_t best = std::min_element(costs.begin(), costs.end()) -
+      costs.begin();
+    if (std::isinf(costs[best]))
+    {
+      pieces[worst].final = true;
+      continue;
+    }
+    pieces[worst] = std::move(splits[best].first);
+    pieces.push_back(std::move(splits[best].second));
+  }
+
+  for (std::size_t p = 0; p < pieces.size(); ++p)
+  {
+    hulls.push_back(HullSubMesh(pieces[p].points, pieces[p].hull,
+          _submesh.Name() + "_" + std::to_string(p),
+          _submesh.MaterialIndex()));
+  }
+  return hulls;
+}
+
+/////////////////////////////////////////////////
+Mesh *ConvexDecomposition::Decompose(const Mesh &_mesh,
+    const unsigned int _maxHulls, const double _maxConcavity)
+{
+  Mesh *result = new Mesh();
+  result->SetName(_mesh.Name());
+  result->SetPath(_mesh.Path());
+  for (unsigned int i = 0; i < _mesh.MaterialCount(); ++i)
+    result->AddMaterial(_mesh.MaterialByIndex(i));
+
+  std::vector<std::shared_ptr<SubMesh>> submeshes;
+  for (unsigned int i = 0; i < _mesh.SubMeshCount(); ++i)
+  {
+    auto submesh = _mesh.SubMeshByIndex(i).lock();
+    if (submesh && submesh->SubMeshPrimitiveType() == SubMesh::TRIANGLES)
+      submeshes.push_back(submesh);
+  }
+
+  std::vector<std::vector<std::unique_ptr<SubMesh>>> hulls(submeshes.size());
+  WorkerPool::Shared().ParallelFor(0, submeshes.size(), 1,
+      [&](const std::size_t _first, const std::size_t _last)
+      {
+        for (std::size_t i = _first; i < _last; ++i)
+          hulls[i] = Decompose(*submeshes[i], _maxHulls, _maxConcavity);
+      });
+
+  for (auto &submeshHulls : hulls)
+  {
+    for (auto &hull : submeshHulls)
+      result->AddSubMesh(std::move(hull));
+  }
+  return result;
+}
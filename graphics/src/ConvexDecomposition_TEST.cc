@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "ignition/common/ConvexDecomposition.hh"
+#include "ignition/common/Material.hh"
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/SubMesh.hh"
+#include "test/util.hh"
+
+using namespace ignition;
+
+class ConvexDecompositionTest : public ignition::testing::AutoLogFixture { };
+
+/////////////////////////////////////////////////
+/// \brief Add a closed box to a submesh, with triangles facing outward.
+/// \param[in] _min Corner of the box with the smallest coordinates
+/// \param[in] _max Corner of the box with the largest coordinates
+/// \param[out] _submesh Submesh to add the box to
+void AddBox(const math::Vector3d &_min, const math::Vector3d &_max,
+    common::SubMesh &_submesh)
+{
+  const unsigned int first = _submesh.VertexCount();
+  for (int i = 0; i < 8; ++i)
+  {
+    _submesh.AddVertex((i & 1) ? _max.X() : _min.X(),
+        (i & 2) ? _max.Y() : _min.Y(), (i & 4) ? _max.Z() : _min.Z());
+  }
+
+  const unsigned int faces[6][4] = {
+    {0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4},
+    {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+  for (const auto &face : faces)
+  {
+    for (const unsigned int corner : {0, 1, 2, 0, 2, 3})
+      _submesh.AddIndex(first + face[corner]);
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Check that a point is inside a closed convex submesh, by
+/// comparing it with the planes of the triangles.
+/// \param[in] _hull The submesh
+/// \param[in] _point The point
+/// \return True if the point is inside the submesh or on its surface.
+bool Inside(const common::SubMesh &_hull, const math::Vector3d &_point)
+{
+  for (unsigned int i = 0; i < _hull.IndexCount(); i += 3)
+  {
+    const math::Vector3d p0 = _hull.Vertex(_hull.Index(i));
+    const math::Vector3d p1 = _hull.Vertex(_hull.Index(i + 1));
+    const math::Vector3d p2 = _hull.Vertex(_hull.Index(i + 2));
+    const math::Vector3d normal = (p1 - p0).Cross(p2 - p0).Normalized();
+    if (normal.Dot(_point - p0) > 1e-9)
+      return false;
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+/// \brief Get the signed volume of a closed submesh, which is positive if
+/// its triangles face outward.
+/// \param[in] _submesh The submesh
+/// \return The volume
+double Volume(const common::SubMesh &_submesh)
+{
+  double volume = 0.0;
+  for (unsigned int i = 0; i < _submesh.IndexCount(); i += 3)
+  {
+    const math::Vector3d p0 = _submesh.Vertex(_submesh.Index(i));
+    const math::Vector3d p1 = _submesh.Vertex(_submesh.Index(i + 1));
+    const math::Vector3d p2 = _submesh.Vertex(_submesh.Index(i + 2));
+    volume += p0.Dot(p1.Cross(p2)) / 6.0;
+  }
+  return volume;
+}
+
+/////////////////////////////////////////////////
+TEST_F(ConvexDecompositionTest, ConvexHull)
+{
+  // A box with points inside and on its faces
+  common::SubMesh box("box");
+  box.SetMaterialIndex(3);
+  AddBox(math::Vector3d(-1, -2, -3), math::Vector3d(1, 2, 3), box);
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<double> unit(-1.0, 1.0);
+  for (int i = 0; i < 100; ++i)
+  {
+    box.AddVertex(unit(random), 2.0 * unit(random), 3.0 * unit(random));
+    box.AddVertex(1.0, 2.0 * unit(random), 3.0 * unit(random));
+  }
+  // Without indices, all the vertices are used
+  auto hull = common::ConvexDecomposition::ConvexHull(box);
+  ASSERT_NE(nullptr, hull);
+  EXPECT_EQ("box", hull->Name());
+  EXPECT_EQ(3u, hull->MaterialIndex());
+  EXPECT_NEAR(48.0, Volume(*hull), 1e-9);
+  for (unsigned int v = 0; v < hull->VertexCount(); ++v)
+  {
+    EXPECT_DOUBLE_EQ(1.0, std::abs(hull->Vertex(v).X()));
+    EXPECT_DOUBLE_EQ(2.0, std::abs(hull->Vertex(v).Y()));
+    EXPECT_DOUBLE_EQ(3.0, std::abs(hull->Vertex(v).Z()));
+  }
+
+  // Points on a sphere are all on the hull
+  common::SubMesh sphere;
+  for (int i = 0; i < 500; ++i)
+  {
+    math::Vector3d point;
+    do
+    {
+      point.Set(unit(random), unit(random), unit(random));
+    } while (point.Length() < 0.1 || point.Length() > 1.0);
+    sphere.AddVertex(point.Normalized());
+  }
+  hull = common::ConvexDecomposition::ConvexHull(sphere);
+  ASSERT_NE(nullptr, hull);
+  EXPECT_EQ(500u, hull->VertexCount());
+  EXPECT_EQ(2u * 500u - 4u, hull->IndexCount() / 3);
+  EXPECT_GT(Volume(*hull), 0.0);
+  EXPECT_LT(Volume(*hull), 4.0 / 3.0 * IGN_PI);
+  for (unsigned int v = 0; v < sphere.VertexCount(); ++v)
+    EXPECT_TRUE(Inside(*hull, sphere.Vertex(v)));
+}
+
+/////////////////////////////////////////////////
+TEST_F(ConvexDecompositionTest, ConvexHullInvalid)
+{
+  common::SubMesh flat;
+  for (int i = 0; i < 10; ++i)
+    flat.AddVertex(i, i * i, 0);
+  EXPECT_EQ(nullptr, common::ConvexDecomposition::ConvexHull(flat));
+
+  common::SubMesh tooFew;
+  for (int i = 0; i < 3; ++i)
+    tooFew.AddVertex(i, i * i, i * i * i);
+  EXPECT_EQ(nullptr, common::ConvexDecomposition::ConvexHull(tooFew));
+
+  common::SubMesh notFinite;
+  AddBox(math::Vector3d::Zero, math::Vector3d::One, notFinite);
+  notFinite.SetVertex(0, math::Vector3d(std::nan(""), 0, 0));
+  EXPECT_EQ(nullptr, common::ConvexDecomposition::ConvexHull(notFinite));
+
+  // Vertices that are not used by indices are not part of the hull
+  common::SubMesh unused;
+  AddBox(math::Vector3d::Zero, math::Vector3d::One, unused);
+  unused.AddVertex(10, 10, 10);
+  auto hull = common::ConvexDecomposition::ConvexHull(unused);
+  ASSERT_NE(nullptr, hull);
+  EXPECT_EQ(8u, hull->VertexCount());
+}
+
+/////////////////////////////////////////////////
+TEST_F(ConvexDecompositionTest, Decompose)
+{
+  // Three boxes in a row, in one submesh
+  common::SubMesh boxes("boxes");
+  boxes.SetMaterialIndex(1);
+  for (int i = 0; i < 3; ++i)
+  {
+    AddBox(math::Vector3d(2 * i, 0, 0), math::Vector3d(2 * i + 1, 1, 1),
+        boxes);
+  }
+
+  auto hulls = common::ConvexDecomposition::Decompose(boxes);
+  ASSERT_EQ(3u, hulls.size());
+  double volume = 0.0;
+  for (const auto &hull : hulls)
+  {
+    EXPECT_EQ(1u, hull->MaterialIndex());
+    EXPECT_EQ(8u, hull->VertexCount());
+    EXPECT_NEAR(1.0, Volume(*hull), 1e-9);
+    volume += Volume(*hull);
+  }
+  EXPECT_NEAR(3.0, volume, 1e-9);
+  EXPECT_EQ("boxes_0", hulls[0]->Name());
+
+  // Every vertex is in one of the hulls
+  for (unsigned int v = 0; v < boxes.VertexCount(); ++v)
+  {
+    bool inside = false;
+    for (const auto &hull : hulls)
+      inside = inside || Inside(*hull, boxes.Vertex(v));
+    EXPECT_TRUE(inside);
+  }
+
+  // With one hull, the result is the convex hull
+  hulls = common::ConvexDecomposition::Decompose(boxes, 1);
+  ASSERT_EQ(1u, hulls.size());
+  EXPECT_NEAR(5.0, Volume(*hulls[0]), 1e-9);
+
+  // A large concavity allowed keeps the boxes together
+  hulls = common::ConvexDecomposition::Decompose(boxes, 16, 1.0);
+  EXPECT_EQ(1u, hulls.size());
+
+  // A convex submesh is not split
+  common::SubMesh box;
+  AddBox(math::Vector3d::Zero, math::Vector3d::One, box);
+  EXPECT_EQ(1u, common::ConvexDecomposition::Decompose(box).size());
+}
+
+/////////////////////////////////////////////////
+TEST_F(ConvexDecompositionTest, DecomposeInvalid)
+{
+  common::SubMesh lines;
+  lines.SetPrimitiveType(common::SubMesh::LINES);
+  AddBox(math::Vector3d::Zero, math::Vector3d::One, lines);
+  EXPECT_TRUE(common::ConvexDecomposition::Decompose(lines).empty());
+
+  common::SubMesh outOfRange;
+  AddBox(math::Vector3d::Zero, math::Vector3d::One, outOfRange);
+  outOfRange.AddIndex(0);
+  outOfRange.AddIndex(1);
+  outOfRange.AddIndex(100);
+  EXPECT_TRUE(common::ConvexDecomposition::Decompose(outOfRange).empty());
+
+  common::SubMesh flat;
+  flat.AddVertex(0, 0, 0);
+  flat.AddVertex(1, 0, 0);
+  flat.AddVertex(0, 1, 0);
+  for (unsigned int i : {0u, 1u, 2u})
+    flat.AddIndex(i);
+  EXPECT_TRUE(common::ConvexDecomposition::Decompose(flat).empty());
+}
+
+/////////////////////////////////////////////////
+TEST_F(ConvexDecompositionTest, Mesh)
+{
+  common::Mesh mesh;
+  mesh.SetName("shapes");
+  common::MaterialPtr material(new common::Material());
+  mesh.AddMaterial(material);
+
+  common::SubMesh first;
+  AddBox(math::Vector3d::Zero, math::Vector3d::One, first);
+  AddBox(math::Vector3d(2, 0, 0), math::Vector3d(3, 1, 1), first);
+  mesh.AddSubMesh(first);
+
+  common::SubMesh lines;
+  lines.SetPrimitiveType(common::SubMesh::LINES);
+  lines.AddVertex(0, 0, 0);
+  lines.AddVertex(10, 0, 0);
+  lines.AddIndex(0);
+  lines.AddIndex(1);
+  mesh.AddSubMesh(lines);
+
+  common::SubMesh second;
+  AddBox(math::Vector3d(0, 0, 5), math::Vector3d(1, 1, 6), second);
+  mesh.AddSubMesh(second);
+
+  auto hull = common::ConvexDecomposition::ConvexHull(mesh);
+  ASSERT_NE(nullptr, hull);
+  EXPECT_EQ("shapes", hull->Name());
+  EXPECT_TRUE(Inside(*hull, math::Vector3d(10, 0, 0)));
+  EXPECT_TRUE(Inside(*hull, math::Vector3d(0, 0, 6)));
+
+  std::unique_ptr<common::Mesh> hulls(
+      common::ConvexDecomposition::Decompose(mesh));
+  ASSERT_NE(nullptr, hulls);
+  EXPECT_EQ("shapes", hulls->Name());
+  EXPECT_EQ(material, hulls->MaterialByIndex(0));
+  ASSERT_EQ(3u, hulls->SubMeshCount());
+  for (unsigned int i = 0; i < hulls->SubMeshCount(); ++i)
+    EXPECT_NEAR(1.0, Volume(*hulls->SubMeshByIndex(i).lock()), 1e-9);
+  EXPECT_DOUBLE_EQ(5.0, hulls->SubMeshByIndex(2).lock()->Min().Z());
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
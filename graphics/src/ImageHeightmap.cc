@@ -16,6 +16,7 @@
  */
 #include "ignition/common/Console.hh"
 #include "ignition/common/ImageHeightmap.hh"
+#include "ignition/common/WorkerPool.hh"
 
 using namespace ignition;
 using namespace common;
@@ -61,49 +62,56 @@ void ImageHeightmap::FillHeightMap(int _subSampling,
   unsigned int count;
   this->img.Data(&data, count);
 
-  // Iterate over all the vertices
-  for (unsigned int y = 0; y < _vertSize; ++y)
-  {
-    // yf ranges between 0 and 4
-    double yf = y / static_cast<double>(_subSampling);
-    int y1 = static_cast<int>(std::floor(yf));
-    int y2 = static_cast<int>(std::ceil(yf));
-    if (y2 >= imgHeight)
-      y2 = imgHeight-1;
-    double dy = yf - y1;
-
-    for (unsigned int x = 0; x < _vertSize; ++x)
-    {
-      double xf = x / static_cast<double>(_subSampling);
-      int x1 = static_cast<int>(std::floor(xf));
-      int x2 = static_cast<int>(std::ceil(xf));
-      if (x2 >= imgWidth)
-        x2 = imgWidth-1;
-      double dx = xf - x1;
-
-      double px1 = static_cast<int>(data[y1 * pitch + x1 * bpp]) / 255.0;
-      double px2 = static_cast<int>(data[y1 * pitch + x2 * bpp]) / 255.0;
-      float h1 = (px1 - ((px1 - px2) * dx));
-
-      double px3 = static_cast<int>(data[y2 * pitch + x1 * bpp]) / 255.0;
-      double px4 = static_cast<int>(data[y2 * pitch + x2 * bpp]) / 255.0;
-      float h2 = (px3 - ((px3 - px4) * dx));
-
-      float h = (h1 - ((h1 - h2) * dy)) * _scale.Z();
-
-      // invert pixel definition so 1=ground, 0=full height,
-      //   if the terrain size has a negative z component
-      //   this is mainly for backward compatibility
-      if (_size.Z() < 0)
-        h = 1.0 - h;
-
-      // Store the height for future use
-      if (!_flipY)
-        _heights[y * _vertSize + x] = h;
-      else
-        _heights[(_vertSize - y - 1) * _vertSize + x] = h;
-    }
-  }
+  // Iterate over all the vertices, one row per index. Rows are
+  // independent, so they are filled in parallel.
+  WorkerPool::Shared().ParallelFor(0, _vertSize, 0,
+      [&] (const std::size_t _firstRow, const std::size_t _lastRow)
+      {
+        // Rows are below _vertSize, so they fit in an unsigned int
+        for (unsigned int y = static_cast<unsigned int>(_firstRow);
+             y < _lastRow; ++y)
+        {
+          // yf ranges between 0 and 4
+          double yf = y / static_cast<double>(_subSampling);
+          int y1 = static_cast<int>(std::floor(yf));
+          int y2 = static_cast<int>(std::ceil(yf));
+          if (y2 >= imgHeight)
+            y2 = imgHeight-1;
+          double dy = yf - y1;
+
+          for (unsigned int x = 0; x < _vertSize; ++x)
+          {
+            double xf = x / static_cast<double>(_subSampling);
+            int x1 = static_cast<int>(std::floor(xf));
+            int x2 = static_cast<int>(std::ceil(xf));
+            if (x2 >= imgWidth)
+              x2 = imgWidth-1;
+            double dx = xf - x1;
+
+            double px1 = static_cast<int>(data[y1 * pitch + x1 * bpp]) / 255.0;
+            double px2 = static_cast<int>(data[y1 * pitch + x2 * bpp]) / 255.0;
+            float h1 = (px1 - ((px1 - px2) * dx));
+
+            double px3 = static_cast<int>(data[y2 * pitch + x1 * bpp]) / 255.0;
+            double px4 = static_cast<int>(data[y2 * pitch + x2 * bpp]) / 255.0;
+            float h2 = (px3 - ((px3 - px4) * dx));
+
+            float h = (h1 - ((h1 - h2) * dy)) * _scale.Z();
+
+            // invert pixel definition so 1=ground, 0=full height,
+            //   if the terrain size has a negative z component
+            //   this is mainly for backward compatibility
+            if (_size.Z() < 0)
+              h = 1.0 - h;
+
+            // Store the height for future use
+            if (!_flipY)
+              _heights[y * _vertSize + x] = h;
+            else
+              _heights[(_vertSize - y - 1) * _vertSize + x] = h;
+          }
+        }
+      });
 
   delete [] data;
 }
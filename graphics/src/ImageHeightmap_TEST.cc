@@ -102,6 +102,39 @@ TEST_F(ImageHeightmapTest, FillHeightmap)
   EXPECT_NEAR(5.0, elevations.at(elevations.size() / 2), ELEVATION_TOL);
 }
 
+/////////////////////////////////////////////////
+TEST_F(ImageHeightmapTest, FillHeightmapFlipY)
+{
+  common::ImageHeightmap img;
+  std::string path("file://");
+
+  path += std::string(TEST_PATH) + "/data/heightmap_bowl.png";
+  EXPECT_EQ(0, img.Load(path));
+
+  // Rows are filled in parallel, so check that each one lands in its place
+  const int subsampling = 3;
+  const unsigned int vertSize = (img.Width() * subsampling) - 2;
+  ignition::math::Vector3d size(129, 129, 10);
+  ignition::math::Vector3d scale(size.X() / vertSize, size.Y() / vertSize,
+      size.Z() / img.MaxElevation());
+
+  std::vector<float> elevations;
+  img.FillHeightMap(subsampling, vertSize, size, scale, false, elevations);
+  std::vector<float> flipped;
+  img.FillHeightMap(subsampling, vertSize, size, scale, true, flipped);
+
+  ASSERT_EQ(vertSize * vertSize, elevations.size());
+  ASSERT_EQ(elevations.size(), flipped.size());
+  for (unsigned int y = 0; y < vertSize; ++y)
+  {
+    for (unsigned int x = 0; x < vertSize; ++x)
+    {
+      EXPECT_FLOAT_EQ(elevations[y * vertSize + x],
+          flipped[(vertSize - y - 1) * vertSize + x]);
+    }
+  }
+}
+
 /////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef IGNITION_COMMON_MAPPEDFILE_HH_
+#define IGNITION_COMMON_MAPPEDFILE_HH_
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace ignition
+{
+  namespace common
+  {
+    /// \brief Read only view of the content of a file. The file is mapped
+    /// in memory where mmap is available, so that only the pages that are
+    /// read are loaded, and the page cache is shared between processes.
+    /// Elsewhere, the file is read into a buffer.
+    class MappedFile
+    {
+      /// \brief Open a file. Check Valid() for errors.
+      /// \param[in] _filename Path to the file
+      public: explicit MappedFile(const std::string &_filename)
+      {
+#ifndef _WIN32
+        const int fd = open(_filename.c_str(), O_RDONLY);
+        if (fd < 0)
+          return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+        {
+          this->size = static_cast<std::size_t>(info.st_size);
+          this->valid = true;
+          if (this->size > 0)
+          {
+            void *address =
+              mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED)
+              this->data = static_cast<const char *>(address);
+            else
+              this->valid = false;
+          }
+        }
+        close(fd);
+#else
+        std::ifstream file(_filename, std::ios::binary | std::ios::ate);
+        if (!file)
+          return;
+        const std::streamoff end = file.tellg();
+        if (end < 0)
+          return;
+        this->buffer.resize(static_cast<std::size_t>(end));
+        file.seekg(0);
+        if (!this->buffer.empty() &&
+            !file.read(this->buffer.data(), this->buffer.size()))
+        {
+          return;
+        }
+        this->data = this->buffer.data();
+        this->size = this->buffer.size();
+        this->valid = true;
+#endif
+      }
+
+      /// \brief Unmap the file.
+      public: ~MappedFile()
+      {
+#ifndef _WIN32
+        if (this->data)
+          munmap(const_cast<char *>(this->data), this->size);
+#endif
+      }
+
+      /// \brief Not copyable
+      public: MappedFile(const MappedFile &) = delete;
+
+      /// \brief Not copyable
+      public: MappedFile &operator=(const MappedFile &) = delete;
+
+      /// \brief Get whether the file could be opened and read.
+      /// \return True if the file is readable
+      public: bool Valid() const
+      {
+        return this->valid;
+      }
+
+      /// \brief Get the content of the file.
+      /// \return Pointer to the first byte, or nullptr if the file is empty
+      /// or could not be read.
+      public: const char *Data() const
+      {
+        return this->data;
+      }
+
+      /// \brief Get the size of the file.
+      /// \return Number of bytes
+      public: std::size_t Size() const
+      {
+        return this->size;
+      }
+
+      /// \brief Content of the file
+      private: const char *data = nullptr;
+
+      /// \brief Size of the file in bytes
+      private: std::size_t size = 0;
+
+      /// \brief True if the file was read
+      private: bool valid = false;
+
+#ifdef _WIN32
+      /// \brief Copy of the file where it can not be mapped
+      private: std::vector<char> buffer;
+#endif
+    };
+  }
+}
+
+#endif
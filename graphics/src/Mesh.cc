@@ -17,6 +17,8 @@
 
 #include <string>
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 
 #include "ignition/math/Helpers.hh"
 
@@ -289,31 +291,96 @@ void Mesh::FillArrays(double **_vertArr, int **_indArr) const
   *_indArr = new int[indCount];
 
   double *vPtr = *_vertArr;
-  unsigned int index = 0;
+  int *iPtr = *_indArr;
   unsigned int offset = 0;
 
   for (const auto &submesh : this->dataPtr->submeshes)
   {
-    double *vertTmp = NULL;
-    int *indTmp = NULL;
-    submesh->FillArrays(&vertTmp, &indTmp);
-
-    memcpy(vPtr, vertTmp, sizeof(vertTmp[0])*submesh->VertexCount()*3);
-
-    for (unsigned int i = 0; i < submesh->IndexCount(); ++i)
+    if (!submesh->FillBuffers(Span<double>(vPtr, submesh->VertexCount() * 3),
+        Span<int>(iPtr, submesh->IndexCount()), offset))
     {
-      (*_indArr)[index++] = submesh->Index(i) + offset;
+      ignerr << "Unable to fill the arrays of submesh ["
+        << submesh->Name() << "]\n";
+      delete [] *_vertArr;
+      delete [] *_indArr;
+      *_vertArr = nullptr;
+      *_indArr = nullptr;
+      return;
     }
 
     offset = offset + submesh->MaxIndex() + 1;
 
     vPtr += submesh->VertexCount()*3;
-
-    delete [] vertTmp;
-    delete [] indTmp;
+    iPtr += submesh->IndexCount();
   }
+
+  // The positions have always been rounded to float precision here
+  for (unsigned int i = 0; i < vertCount * 3; ++i)
+    (*_vertArr)[i] = static_cast<float>((*_vertArr)[i]);
 }
 
+//////////////////////////////////////////////////
+template<typename V, typename I>
+bool Mesh::FillBuffers(Span<V> _vertices, Span<I> _indices) const
+{
+  const std::size_t vertexCount = this->VertexCount();
+  const std::size_t indexCount = this->IndexCount();
+  if (_vertices.size() < vertexCount * 3 || _indices.size() < indexCount)
+  {
+    ignerr << "Buffers of [" << _vertices.size() << "] values and ["
+      << _indices.size() << "] indices are too small for [" << vertexCount
+      << "] vertices and [" << indexCount << "] indices\n";
+    return false;
+  }
+
+  // Check that all the indices fit before writing anything
+  uint64_t offset = 0;
+  for (const auto &submesh : this->dataPtr->submeshes)
+  {
+    if (submesh->IndexCount() > 0 &&
+        offset + submesh->MaxIndex() >
+        static_cast<uint64_t>(std::numeric_limits<I>::max()))
+    {
+      ignerr << "Index [" << offset + submesh->MaxIndex()
+        << "] does not fit in the index type\n";
+      return false;
+    }
+    offset += submesh->VertexCount();
+  }
+
+  std::size_t vertexStart = 0;
+  std::size_t indexStart = 0;
+  for (const auto &submesh : this->dataPtr->submeshes)
+  {
+    if (!submesh->FillBuffers(
+        _vertices.subspan(vertexStart * 3, submesh->VertexCount() * 3),
+        _indices.subspan(indexStart, submesh->IndexCount()),
+        static_cast<unsigned int>(vertexStart)))
+    {
+      return false;
+    }
+    vertexStart += submesh->VertexCount();
+    indexStart += submesh->IndexCount();
+  }
+
+  return true;
+}
+
+/// \cond
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool Mesh::FillBuffers(Span<double>, Span<int>) const;
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool Mesh::FillBuffers(Span<double>, Span<uint32_t>) const;
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool Mesh::FillBuffers(Span<double>, Span<uint16_t>) const;
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool Mesh::FillBuffers(Span<float>, Span<int>) const;
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool Mesh::FillBuffers(Span<float>, Span<uint32_t>) const;
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool Mesh::FillBuffers(Span<float>, Span<uint16_t>) const;
+/// \endcond
+
 //////////////////////////////////////////////////
 void Mesh::RecalculateNormals()
 {
@@ -0,0 +1,722 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshBVH.hh"
+#include "ignition/common/SubMesh.hh"
+
+using namespace ignition;
+using namespace common;
+
+/// \brief Number of triangles tested together in a leaf block
+static const unsigned int BlockSize = 4;
+
+/// \brief Number of bins along each axis when looking for the best split
+static const unsigned int SahBins = 16;
+
+/// \brief Cost of visiting a node, relative to the cost of testing a block
+/// of triangles, for the surface area heuristic.
+static const double TraversalCost = 1.0;
+
+/// \brief Depth at which nodes are always leaves, which bounds the stack
+/// used by queries.
+static const unsigned int MaxDepth = 64;
+
+/// \brief Determinant below which a ray is taken as parallel to a
+/// triangle, and misses it.
+static const double ParallelTolerance = 1e-12;
+
+/// \brief A node of the hierarchy. Bounds are rounded outward to float so
+/// that a node fits in 32 bytes.
+struct Node
+{
+  /// \brief Corner of the bounds with the smallest coordinates
+  float min[3];
+
+  /// \brief Corner of the bounds with the largest coordinates
+  float max[3];
+
+  /// \brief Index of the first block of a leaf, or of the second child of
+  /// an inner node. The first child of an inner node follows it.
+  uint32_t offset;
+
+  /// \brief Number of triangles of a leaf, 0 for inner nodes
+  uint32_t count;
+};
+
+static_assert(sizeof(Node) == 32, "Nodes must fit in 32 bytes");
+
+/// \brief Triangles of a leaf, as structures of arrays. Lanes past the
+/// triangle count of the leaf have no area, so rays never hit them.
+struct alignas(32) TriangleBlock
+{
+  /// \brief First corners
+  double v0[3][BlockSize];
+
+  /// \brief Second corners minus the first corners
+  double e1[3][BlockSize];
+
+  /// \brief Third corners minus the first corners
+  double e2[3][BlockSize];
+
+  /// \brief Submesh index of each triangle
+  uint32_t subMesh[BlockSize];
+
+  /// \brief Index of each triangle in its submesh
+  uint32_t triangle[BlockSize];
+};
+
+/// \brief Triangle being inserted in the hierarchy
+struct Reference
+{
+  /// \brief Corners
+  std::array<math::Vector3d, 3> corners;
+
+  /// \brief Center of the bounds
+  math::Vector3d center;
+
+  /// \brief Submesh index
+  unsigned int subMesh;
+
+  /// \brief Index in the submesh
+  unsigned int triangle;
+};
+
+/// \brief Axis aligned bounds being built
+struct Bounds
+{
+  /// \brief Smallest coordinates
+  math::Vector3d min = math::Vector3d(
+      std::numeric_limits<double>::max(),
+      std::numeric_limits<double>::max(),
+      std::numeric_limits<double>::max());
+
+  /// \brief Largest coordinates
+  math::Vector3d max = -min;
+
+  /// \brief Grow to include a point
+  /// \param[in] _point The point
+  void Add(const math::Vector3d &_point)
+  {
+    this->min.Min(_point);
+    this->max.Max(_point);
+  }
+
+  /// \brief Grow to include other bounds
+  /// \param[in] _other The other bounds
+  void Add(const Bounds &_other)
+  {
+    this->min.Min(_other.min);
+    this->max.Max(_other.max);
+  }
+
+  /// \brief Get the surface area
+  /// \return The area, 0 for empty bounds
+  double Area() const
+  {
+    if (this->min.X() > this->max.X())
+      return 0.0;
+    const math::Vector3d size = this->max - this->min;
+    return 2.0 * (size.X() * size.Y() + size.Y() * size.Z() +
+        size.Z() * size.X());
+  }
+};
+
+/// \brief Entry of the stack of a query
+struct StackEntry
+{
+  /// \brief Index of the node
+  uint32_t node;
+
+  /// \brief Distance to the bounds of the node, or its square for closest
+  /// point queries.
+  double distance;
+};
+
+/// \brief Private data for MeshBVH
+class ignition::common::MeshBVHPrivate
+{
+  /// \brief Build a subtree and its descendants
+  /// \param[in,out] _refs Triangles, reordered by the build
+  /// \param[in] _begin First triangle of the subtree
+  /// \param[in] _end One past the last triangle of the subtree
+  /// \param[in] _depth Depth of the subtree
+  public: void Build(std::vector<Reference> &_refs, const std::size_t _begin,
+              const std::size_t _end, const unsigned int _depth);
+
+  /// \brief Turn a node into a leaf
+  /// \param[in] _node Index of the node
+  /// \param[in] _refs Triangles
+  /// \param[in] _begin First triangle of the leaf
+  /// \param[in] _end One past the last triangle of the leaf
+  public: void MakeLeaf(const uint32_t _node,
+              const std::vector<Reference> &_refs, const std::size_t _begin,
+              const std::size_t _end);
+
+  /// \brief Nodes, depth first
+  public: std::vector<Node> nodes;
+
+  /// \brief Triangles of the leaves
+  public: std::vector<TriangleBlock> blocks;
+
+  /// \brief Number of triangles
+  public: unsigned int triangleCount = 0;
+};
+
+/// \brief Get the number of blocks needed for triangles
+/// \param[in] _count Number of triangles
+/// \return Number of blocks
+static double Blocks(const std::size_t _count)
+{
+  return static_cast<double>((_count + BlockSize - 1) / BlockSize);
+}
+
+/// \brief Convert to float, rounding down
+/// \param[in] _value Value to convert
+/// \return The largest float not above _value
+static float RoundDown(const double _value)
+{
+  float result = static_cast<float>(_value);
+  if (static_cast<double>(result) > _value)
+    result = std::nextafter(result, -std::numeric_limits<float>::infinity());
+  return result;
+}
+
+/// \brief Convert to float, rounding up
+/// \param[in] _value Value to convert
+/// \return The smallest float not below _value
+static float RoundUp(const double _value)
+{
+  float result = static_cast<float>(_value);
+  if (static_cast<double>(result) < _value)
+    result = std::nextafter(result, std::numeric_limits<float>::infinity());
+  return result;
+}
+
+/////////////////////////////////////////////////
+void MeshBVHPrivate::MakeLeaf(const uint32_t _node,
+    const std::vector<Reference> &_refs, const std::size_t _begin,
+    const std::size_t _end)
+{
+  this->nodes[_node].offset = static_cast<uint32_t>(this->blocks.size());
+  this->nodes[_node].count = static_cast<uint32_t>(_end - _begin);
+
+  for (std::size_t first = _begin; first < _end; first += BlockSize)
+  {
+    TriangleBlock block;
+    for (unsigned int lane = 0; lane < BlockSize; ++lane)
+    {
+      const bool used = first + lane < _end;
+      const Reference *ref = used ? &_refs[first + lane] : nullptr;
+      for (unsigned int axis = 0; axis < 3; ++axis)
+      {
+        const double p0 = used ? ref->corners[0][axis] : 0.0;
+        block.v0[axis][lane] = p0;
+        block.e1[axis][lane] = used ? ref->corners[1][axis] - p0 : 0.0;
+        block.e2[axis][lane] = used ? ref->corners[2][axis] - p0 : 0.0;
+      }
+      block.subMesh[lane] = used ? ref->subMesh : 0;
+      block.triangle[lane] = used ? ref->triangle : 0;
+    }
+    this->blocks.push_back(block);
+  }
+}
+
+/////////////////////////////////////////////////
+void MeshBVHPrivate::Build(std::vector<Reference> &_refs,
+    const std::size_t _begin, const std::size_t _end,
+    const unsigned int _depth)
+{
+  const uint32_t index = static_cast<uint32_t>(this->nodes.size());
+  this->nodes.emplace_back();
+
+  Bounds bounds;
+  Bounds centers;
+  for (std::size_t i = _begin; i < _end; ++i)
+  {
+    for (const math::Vector3d &corner : _refs[i].corners)
+      bounds.Add(corner);
+    centers.Add(_refs[i].center);
+  }
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    this->nodes[index].min[axis] = RoundDown(bounds.min[axis]);
+    this->nodes[index].max[axis] = RoundUp(bounds.max[axis]);
+  }
+
+  const std::size_t count = _end - _begin;
+  if (count <= 1 || _depth + 1 >= MaxDepth)
+  {
+    this->MakeLeaf(index, _refs, _begin, _end);
+    return;
+  }
+
+  // Find the split between bins with the smallest surface area heuristic
+  double bestCost = std::numeric_limits<double>::infinity();
+  unsigned int bestAxis = 3;
+  unsigned int bestBin = 0;
+  const double area = bounds.Area();
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    const double low = centers.min[axis];
+    const double extent = centers.max[axis] - low;
+    if (!(extent > 0.0))
+      continue;
+
+    std::array<Bounds, SahBins> binBounds;
+    std::array<std::size_t, SahBins> binCounts = {};
+    for (std::size_t i = _begin; i < _end; ++i)
+    {
+      const unsigned int bin = std::min(SahBins - 1, static_cast<unsigned int>(
+            (_refs[i].center[axis] - low) * SahBins / extent));
+      ++binCounts[bin];
+      for (const math::Vector3d &corner : _refs[i].corners)
+        binBounds[bin].Add(corner);
+    }
+
+    // Area times block count of the bins right of each split
+    std::array<double, SahBins> rightCost;
+    Bounds right;
+    std::size_t rightCount = 0;
+    for (unsigned int bin = SahBins - 1; bin > 0; --bin)
+    {
+      right.Add(binBounds[bin]);
+      rightCount += binCounts[bin];
+      rightCost[bin] = right.Area() * Blocks(rightCount);
+    }
+
+    Bounds left;
+    std::size_t leftCount = 0;
+    for (unsigned int bin = 1; bin < SahBins; ++bin)
+    {
+      left.Add(binBounds[bin - 1]);
+      leftCount += binCounts[bin - 1];
+      if (leftCount == 0 || leftCount == count)
+        continue;
+      const double cost = TraversalCost +
+        (left.Area() * Blocks(leftCount) + rightCost[bin]) / area;
+      if (cost < bestCost)
+      {
+        bestCost = cost;
+        bestAxis = axis;
+        bestBin = bin;
+      }
+    }
+  }
+
+  const double leafCost = Blocks(count);
+  if (count <= BlockSize && leafCost <= bestCost)
+  {
+    this->MakeLeaf(index, _refs, _begin, _end);
+    return;
+  }
+
+  std::size_t middle;
+  if (bestAxis < 3)
+  {
+    const double low = centers.min[bestAxis];
+    const double extent = centers.max[bestAxis] - low;
+    middle = std::partition(_refs.begin() + _begin, _refs.begin() + _end,
+        [&](const Reference &_ref)
+        {
+          return std::min(SahBins - 1, static_cast<unsigned int>(
+                (_ref.center[bestAxis] - low) * SahBins / extent)) < bestBin;
+        }) - _refs.begin();
+  }
+  else
+  {
+    // All the centers are at the same place, split in the middle
+    middle = _begin + count / 2;
+  }
+
+  this->Build(_refs, _begin, middle, _depth + 1);
+  this->nodes[index].offset = static_cast<uint32_t>(this->nodes.size());
+  this->nodes[index].count = 0;
+  this->Build(_refs, middle, _end, _depth + 1);
+}
+
+/// \brief Distance along a ray to the bounds of a node
+/// \param[in] _node The node
+/// \param[in] _origin Origin of the ray
+/// \param[in] _inverse Inverse of the direction of the ray
+/// \param[in] _maxDistance Length of the ray
+/// \return Distance at which the ray enters the bounds, or infinity if it
+/// misses them.
+static double RayDistance(const Node &_node, const double _origin[3],
+    const double _inverse[3], const double _maxDistance)
+{
+  double enter = 0.0;
+  double exit = _maxDistance;
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    double near = (_node.min[axis] - _origin[axis]) * _inverse[axis];
+    double far = (_node.max[axis] - _origin[axis]) * _inverse[axis];
+    if (near > far)
+      std::swap(near, far);
+    // NaN, from a ray along a face of the bounds, leaves enter and exit
+    // unchanged.
+    enter = std::max(enter, near);
+    exit = std::min(exit, far);
+  }
+  return enter <= exit ? enter : std::numeric_limits<double>::infinity();
+}
+
+/// \brief Squared distance from a point to the bounds of a node
+/// \param[in] _node The node
+/// \param[in] _point The point
+/// \return The squared distance, 0 if the point is inside
+static double SquaredDistance(const Node &_node, const math::Vector3d &_point)
+{
+  double result = 0.0;
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    const double p = _point[axis];
+    const double d = std::max({0.0, _node.min[axis] - p, p - _node.max[axis]});
+    result += d * d;
+  }
+  return result;
+}
+
+/// \brief Closest point of a triangle, from "Real-Time Collision
+/// Detection" by Christer Ericson, section 5.1.5.
+/// \param[in] _p The point
+/// \param[in] _a First corner
+/// \param[in] _b Second corner
+/// \param[in] _c Third corner
+/// \return The point of the triangle closest to _p
+static math::Vector3d ClosestOnTriangle(const math::Vector3d &_p,
+    const math::Vector3d &_a, const math::Vector3d &_b,
+    const math::Vector3d &_c)
+{
+  const math::Vector3d ab = _b - _a;
+  const math::Vector3d ac = _c - _a;
+  const math::Vector3d ap = _p - _a;
+  const double d1 = ab.Dot(ap);
+  const double d2 = ac.Dot(ap);
+  if (d1 <= 0.0 && d2 <= 0.0)
+    return _a;
+
+  const math::Vector3d bp = _p - _b;
+  const double d3 = ab.Dot(bp);
+  const double d4 = ac.Dot(bp);
+  if (d3 >= 0.0 && d4 <= d3)
+    return _b;
+
+  const double vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+    return _a + ab * (d1 / (d1 - d3));
+
+  const math::Vector3d cp = _p - _c;
+  const double d5 = ab.Dot(cp);
+  const double d6 = ac.Dot(cp);
+  if (d6 >= 0.0 && d5 <= d6)
+    return _c;
+
+  const double vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+    return _a + ac * (d2 / (d2 - d6));
+
+  const double va = d3 * d6 - d5 * d4;
+  if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+    return _b + (_c - _b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+  const double denominator = 1.0 / (va + vb + vc);
+  return _a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+/// \brief Fill a hit from a triangle of a block
+/// \param[in] _block The block
+/// \param[in] _lane Lane of the triangle
+/// \param[in] _point Point of the hit
+/// \param[in] _distance Distance of the hit
+/// \param[out] _hit The hit
+static void SetHit(const TriangleBlock &_block, const unsigned int _lane,
+    const math::Vector3d &_point, const double _distance, MeshBVHHit &_hit)
+{
+  const math::Vector3d e1(_block.e1[0][_lane], _block.e1[1][_lane],
+      _block.e1[2][_lane]);
+  const math::Vector3d e2(_block.e2[0][_lane], _block.e2[1][_lane],
+      _block.e2[2][_lane]);
+  _hit.distance = _distance;
+  _hit.point = _point;
+  _hit.normal = e1.Cross(e2).Normalized();
+  _hit.subMeshIndex = _block.subMesh[_lane];
+  _hit.triangleIndex = _block.triangle[_lane];
+}
+
+/////////////////////////////////////////////////
+MeshBVHHit::MeshBVHHit()
+  : distance(0.0), subMeshIndex(0), triangleIndex(0)
+{
+}
+
+/////////////////////////////////////////////////
+MeshBVH::MeshBVH(const Mesh &_mesh)
+  : dataPtr(new MeshBVHPrivate)
+{
+  std::vector<Reference> refs;
+  for (unsigned int s = 0; s < _mesh.SubMeshCount(); ++s)
+  {
+    auto submesh = _mesh.SubMeshByIndex(s).lock();
+    if (!submesh || submesh->SubMeshPrimitiveType() != SubMesh::TRIANGLES)
+      continue;
+
+    const unsigned int vertexCount = submesh->VertexCount();
+    auto indices = submesh->Indices();
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+      if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount ||
+          indices[i + 2] >= vertexCount)
+      {
+        continue;
+      }
+
+      Reference ref;
+      ref.corners = {{submesh->Vertex(indices[i]),
+        submesh->Vertex(indices[i + 1]), submesh->Vertex(indices[i + 2])}};
+      const double area = (ref.corners[1] - ref.corners[0]).Cross(
+          ref.corners[2] - ref.corners[0]).Length();
+      if (!(area > 0.0) || std::isinf(area))
+        continue;
+
+      Bounds bounds;
+      for (const math::Vector3d &corner : ref.corners)
+        bounds.Add(corner);
+      ref.center = (bounds.min + bounds.max) * 0.5;
+      ref.subMesh = s;
+      ref.triangle = static_cast<unsigned int>(i / 3);
+      refs.push_back(ref);
+    }
+  }
+
+  this->dataPtr->triangleCount = static_cast<unsigned int>(refs.size());
+  if (!refs.empty())
+    this->dataPtr->Build(refs, 0, refs.size(), 0);
+}
+
+/////////////////////////////////////////////////
+MeshBVH::~MeshBVH()
+{
+}
+
+/////////////////////////////////////////////////
+unsigned int MeshBVH::TriangleCount() const
+{
+  return this->dataPtr->triangleCount;
+}
+
+/////////////////////////////////////////////////
+unsigned int MeshBVH::NodeCount() const
+{
+  return static_cast<unsigned int>(this->dataPtr->nodes.size());
+}
+
+/////////////////////////////////////////////////
+bool MeshBVH::Intersect(const math::Vector3d &_origin,
+    const math::Vector3d &_direction, MeshBVHHit &_hit,
+    const double _maxDistance) const
+{
+  const double length = _direction.Length();
+  if (this->dataPtr->nodes.empty() || !(length > 0.0))
+    return false;
+
+  const math::Vector3d direction = _direction / length;
+  const double origin[3] = {_origin.X(), _origin.Y(), _origin.Z()};
+  const double dir[3] = {direction.X(), direction.Y(), direction.Z()};
+  const double inverse[3] = {1.0 / dir[0], 1.0 / dir[1], 1.0 / dir[2]};
+
+  const auto &nodes = this->dataPtr->nodes;
+  double best = _maxDistance;
+  const TriangleBlock *bestBlock = nullptr;
+  unsigned int bestLane = 0;
+
+  std::array<StackEntry, 2 * MaxDepth> stack;
+  std::size_t size = 0;
+  const double rootDistance = RayDistance(nodes[0], origin, inverse, best);
+  if (std::isinf(rootDistance))
+    return false;
+  stack[size++] = {0, rootDistance};
+
+  while (size > 0)
+  {
+    const StackEntry entry = stack[--size];
+    if (entry.distance > best)
+      continue;
+
+    const Node &node = nodes[entry.node];
+    if (node.count > 0)
+    {
+      const uint32_t blockCount = (node.count + BlockSize - 1) / BlockSize;
+      for (uint32_t b = 0; b < blockCount; ++b)
+      {
+        const TriangleBlock &block = this->dataPtr->blocks[node.offset + b];
+
+        // Moller-Trumbore on all the lanes, without branches so that the
+        // loop is vectorized
+        double t[BlockSize];
+        for (unsigned int lane = 0; lane < BlockSize; ++lane)
+        {
+          const double e1x = block.e1[0][lane];
+          const double e1y = block.e1[1][lane];
+          const double e1z = block.e1[2][lane];
+          const double e2x = block.e2[0][lane];
+          const double e2y = block.e2[1][lane];
+          const double e2z = block.e2[2][lane];
+
+          const double px = dir[1] * e2z - dir[2] * e2y;
+          const double py = dir[2] * e2x - dir[0] * e2z;
+          const double pz = dir[0] * e2y - dir[1] * e2x;
+          const double det = e1x * px + e1y * py + e1z * pz;
+          const double inv = 1.0 / det;
+
+          const double tx = origin[0] - block.v0[0][lane];
+          const double ty = origin[1] - block.v0[1][lane];
+          const double tz = origin[2] - block.v0[2][lane];
+          const double u = (tx * px + ty * py + tz * pz) * inv;
+
+          const double qx = ty * e1z - tz * e1y;
+          const double qy = tz * e1x - tx * e1z;
+          const double qz = tx * e1y - ty * e1x;
+          const double v = (dir[0] * qx + dir[1] * qy + dir[2] * qz) * inv;
+          const double distance = (e2x * qx + e2y * qy + e2z * qz) * inv;
+
+          const bool hit = std::abs(det) > ParallelTolerance &&
+            u >= 0.0 && v >= 0.0 && u + v <= 1.0 &&
+            distance >= 0.0 && distance <= best;
+          t[lane] = hit ? distance : std::numeric_limits<double>::infinity();
+        }
+
+        for (unsigned int lane = 0; lane < BlockSize; ++lane)
+        {
+          if (t[lane] <= best && !std::isinf(t[lane]))
+          {
+            best = t[lane];
+            bestBlock = &block;
+            bestLane = lane;
+          }
+        }
+      }
+      continue;
+    }
+
+    // Visit the nearest child first
+    const uint32_t first = entry.node + 1;
+    const uint32_t second = node.offset;
+    const double firstDistance =
+      RayDistance(nodes[first], origin, inverse, best);
+    const double secondDistance =
+      RayDistance(nodes[second], origin, inverse, best);
+    const bool firstNearest = firstDistance <= secondDistance;
+    const StackEntry nearEntry = firstNearest ?
+      StackEntry{first, firstDistance} : StackEntry{second, secondDistance};
+    const StackEntry farEntry = firstNearest ?
+      StackEntry{second, secondDistance} : StackEntry{first, firstDistance};
+    if (!std::isinf(farEntry.distance))
+      stack[size++] = farEntry;
+    if (!std::isinf(nearEntry.distance))
+      stack[size++] = nearEntry;
+  }
+
+  if (!bestBlock)
+    return false;
+
+  SetHit(*bestBlock, bestLane, _origin + direction * best, best, _hit);
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool MeshBVH::ClosestPoint(const math::Vector3d &_point, MeshBVHHit &_hit,
+    const double _maxDistance) const
+{
+  if (this->dataPtr->nodes.empty() || !_point.IsFinite() ||
+      _maxDistance < 0.0)
+  {
+    return false;
+  }
+
+  const auto &nodes = this->dataPtr->nodes;
+  double best = _maxDistance * _maxDistance;
+  const TriangleBlock *bestBlock = nullptr;
+  unsigned int bestLane = 0;
+  math::Vector3d bestPoint;
+
+  std::array<StackEntry, 2 * MaxDepth> stack;
+  std::size_t size = 0;
+  stack[size++] = {0, SquaredDistance(nodes[0], _point)};
+
+  while (size > 0)
+  {
+    const StackEntry entry = stack[--size];
+    if (entry.distance > best)
+      continue;
+
+    const Node &node = nodes[entry.node];
+    if (node.count > 0)
+    {
+      for (uint32_t i = 0; i < node.count; ++i)
+      {
+        const TriangleBlock &block =
+          this->dataPtr->blocks[node.offset + i / BlockSize];
+        const unsigned int lane = i % BlockSize;
+        const math::Vector3d a(block.v0[0][lane], block.v0[1][lane],
+            block.v0[2][lane]);
+        const math::Vector3d b = a + math::Vector3d(block.e1[0][lane],
+            block.e1[1][lane], block.e1[2][lane]);
+        const math::Vector3d c = a + math::Vector3d(block.e2[0][lane],
+            block.e2[1][lane], block.e2[2][lane]);
+        const math::Vector3d closest = ClosestOnTriangle(_point, a, b, c);
+        const double distance = (closest - _point).SquaredLength();
+        if (distance < best || (!bestBlock && distance <= best))
+        {
+          best = distance;
+          bestBlock = &block;
+          bestLane = lane;
+          bestPoint = closest;
+        }
+      }
+      continue;
+    }
+
+    const uint32_t first = entry.node + 1;
+    const uint32_t second = node.offset;
+    const double firstDistance = SquaredDistance(nodes[first], _point);
+    const double secondDistance = SquaredDistance(nodes[second], _point);
+    const bool firstNearest = firstDistance <= secondDistance;
+    const StackEntry nearEntry = firstNearest ?
+      StackEntry{first, firstDistance} : StackEntry{second, secondDistance};
+    const StackEntry farEntry = firstNearest ?
+      StackEntry{second, secondDistance} : StackEntry{first, firstDistance};
+    if (farEntry.distance <= best)
+      stack[size++] = farEntry;
+    if (nearEntry.distance <= best)
+      stack[size++] = nearEntry;
+  }
+
+  if (!bestBlock)
+    return false;
+
+  SetHit(*bestBlock, bestLane, bestPoint, std::sqrt(best), _hit);
+  return true;
+}
@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshBVH.hh"
+#include "ignition/common/SubMesh.hh"
+#include "ignition/common/WorkerPool.hh"
+#include "test/util.hh"
+
+using namespace ignition;
+
+class MeshBVHTest : public ignition::testing::AutoLogFixture { };
+
+/////////////////////////////////////////////////
+/// \brief Create a mesh with a bumpy grid in its first submesh, a line in
+/// its second submesh and random triangles in its third submesh.
+/// \param[out] _mesh Mesh to fill
+void CreateMesh(common::Mesh &_mesh)
+{
+  common::SubMesh grid;
+  const int size = 30;
+  for (int x = 0; x <= size; ++x)
+  {
+    for (int y = 0; y <= size; ++y)
+      grid.AddVertex(x * 0.1, y * 0.1, 0.2 * std::sin(x * 0.3 + y * 0.2));
+  }
+  for (int x = 0; x < size; ++x)
+  {
+    for (int y = 0; y < size; ++y)
+    {
+      const unsigned int v = x * (size + 1) + y;
+      for (unsigned int index : {v, v + size + 1, v + size + 2,
+                                 v, v + size + 2, v + 1})
+      {
+        grid.AddIndex(index);
+      }
+    }
+  }
+  _mesh.AddSubMesh(grid);
+
+  common::SubMesh line;
+  line.SetPrimitiveType(common::SubMesh::LINES);
+  line.AddVertex(0, 0, 0);
+  line.AddVertex(3, 3, 0);
+  line.AddIndex(0);
+  line.AddIndex(1);
+  _mesh.AddSubMesh(line);
+
+  common::SubMesh soup;
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<double> position(-1.0, 4.0);
+  std::uniform_real_distribution<double> offset(-0.3, 0.3);
+  for (int t = 0; t < 300; ++t)
+  {
+    const math::Vector3d center(position(random), position(random),
+        position(random));
+    for (int c = 0; c < 3; ++c)
+    {
+      soup.AddIndex(soup.VertexCount());
+      soup.AddVertex(center + math::Vector3d(offset(random), offset(random),
+            offset(random)));
+    }
+  }
+  _mesh.AddSubMesh(soup);
+}
+
+/////////////////////////////////////////////////
+/// \brief Get the corners of a triangle of a mesh.
+/// \param[in] _mesh The mesh
+/// \param[in] _subMesh Index of the submesh
+/// \param[in] _triangle Index of the triangle in the submesh
+/// \param[out] _corners The corners
+void Corners(const common::Mesh &_mesh, const unsigned int _subMesh,
+    const unsigned int _triangle, math::Vector3d _corners[3])
+{
+  auto submesh = _mesh.SubMeshByIndex(_subMesh).lock();
+  for (unsigned int c = 0; c < 3; ++c)
+    _corners[c] = submesh->Vertex(submesh->Index(3 * _triangle + c));
+}
+
+/////////////////////////////////////////////////
+/// \brief Intersect a ray with every triangle of a mesh, through the
+/// planes of the triangles.
+/// \param[in] _mesh The mesh
+/// \param[in] _origin Origin of the ray
+/// \param[in] _direction Unit direction of the ray
+/// \return Distance to the first hit, or infinity.
+double ReferenceIntersect(const common::Mesh &_mesh,
+    const math::Vector3d &_origin, const math::Vector3d &_direction)
+{
+  double best = std::numeric_limits<double>::infinity();
+  for (unsigned int s = 0; s < _mesh.SubMeshCount(); ++s)
+  {
+    auto submesh = _mesh.SubMeshByIndex(s).lock();
+    if (submesh->SubMeshPrimitiveType() != common::SubMesh::TRIANGLES)
+      continue;
+    for (unsigned int t = 0; t < submesh->IndexCount() / 3; ++t)
+    {
+      math::Vector3d p[3];
+      Corners(_mesh, s, t, p);
+      const math::Vector3d normal = (p[1] - p[0]).Cross(p[2] - p[0]);
+      const double distance =
+        normal.Dot(p[0] - _origin) / normal.Dot(_direction);
+      if (!(distance >= 0.0) || distance >= best)
+        continue;
+      const math::Vector3d point = _origin + _direction * distance;
+      bool inside = true;
+      for (unsigned int e = 0; e < 3; ++e)
+      {
+        inside = inside && (p[(e + 1) % 3] - p[e]).Cross(
+            point - p[e]).Dot(normal) >= -1e-12;
+      }
+      if (inside)
+        best = distance;
+    }
+  }
+  return best;
+}
+
+/////////////////////////////////////////////////
+/// \brief Get the point of a segment closest to a point.
+/// \param[in] _p The point
+/// \param[in] _a Start of the segment
+/// \param[in] _b End of the segment
+/// \return The closest point
+math::Vector3d ClosestOnSegment(const math::Vector3d &_p,
+    const math::Vector3d &_a, const math::Vector3d &_b)
+{
+  const math::Vector3d ab = _b - _a;
+  const double t = std::max(0.0, std::min(1.0,
+        (_p - _a).Dot(ab) / ab.SquaredLength()));
+  return _a + ab * t;
+}
+
+/////////////////////////////////////////////////
+/// \brief Find the distance from a point to every triangle of a mesh, by
+/// projecting the point on the planes and the edges of the triangles.
+/// \param[in] _mesh The mesh
+/// \param[in] _point The point
+/// \return Distance to the closest triangle
+double ReferenceDistance(const common::Mesh &_mesh,
+    const math::Vector3d &_point)
+{
+  double best = std::numeric_limits<double>::infinity();
+  for (unsigned int s = 0; s < _mesh.SubMeshCount(); ++s)
+  {
+    auto submesh = _mesh.SubMeshByIndex(s).lock();
+    if (submesh->SubMeshPrimitiveType() != common::SubMesh::TRIANGLES)
+      continue;
+    for (unsigned int t = 0; t < submesh->IndexCount() / 3; ++t)
+    {
+      math::Vector3d p[3];
+      Corners(_mesh, s, t, p);
+      const math::Vector3d normal =
+        (p[1] - p[0]).Cross(p[2] - p[0]).Normalized();
+      const math::Vector3d projected =
+        _point - normal * normal.Dot(_point - p[0]);
+      bool inside = true;
+      for (unsigned int e = 0; e < 3; ++e)
+      {
+        inside = inside && (p[(e + 1) % 3] - p[e]).Cross(
+            projected - p[e]).Dot(normal) >= 0.0;
+      }
+      if (inside)
+      {
+        best = std::min(best, projected.Distance(_point));
+        continue;
+      }
+      for (unsigned int e = 0; e < 3; ++e)
+      {
+        best = std::min(best, _point.Distance(
+              ClosestOnSegment(_point, p[e], p[(e + 1) % 3])));
+      }
+    }
+  }
+  return best;
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshBVHTest, Empty)
+{
+  common::Mesh mesh;
+  common::MeshBVH bvh(mesh);
+  EXPECT_EQ(0u, bvh.TriangleCount());
+  EXPECT_EQ(0u, bvh.NodeCount());
+
+  common::MeshBVHHit hit;
+  EXPECT_FALSE(bvh.Intersect(math::Vector3d::Zero, math::Vector3d::UnitX,
+        hit));
+  EXPECT_FALSE(bvh.ClosestPoint(math::Vector3d::Zero, hit));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshBVHTest, Triangle)
+{
+  common::Mesh mesh;
+  common::SubMesh submesh;
+  submesh.AddVertex(0, 0, 0);
+  submesh.AddVertex(1, 0, 0);
+  submesh.AddVertex(0, 1, 0);
+  submesh.AddVertex(2, 2, 2);
+  for (unsigned int index : {0u, 1u, 2u})
+    submesh.AddIndex(index);
+  // Triangles without area or with indices out of range are skipped
+  for (unsigned int index : {0u, 1u, 1u, 0u, 1u, 10u})
+    submesh.AddIndex(index);
+  for (unsigned int index : {3u, 0u, 1u})
+    submesh.AddIndex(index);
+  mesh.AddSubMesh(submesh);
+
+  common::MeshBVH bvh(mesh);
+  EXPECT_EQ(2u, bvh.TriangleCount());
+  EXPECT_GT(bvh.NodeCount(), 0u);
+
+  // Both sides are hit, and the direction does not need to be normalized
+  common::MeshBVHHit hit;
+  ASSERT_TRUE(bvh.Intersect(math::Vector3d(0.2, 0.3, 2),
+        math::Vector3d(0, 0, -5), hit));
+  EXPECT_DOUBLE_EQ(2.0, hit.distance);
+  EXPECT_EQ(math::Vector3d(0.2, 0.3, 0), hit.point);
+  EXPECT_EQ(math::Vector3d::UnitZ, hit.normal);
+  EXPECT_EQ(0u, hit.subMeshIndex);
+  EXPECT_EQ(0u, hit.triangleIndex);
+
+  ASSERT_TRUE(bvh.Intersect(math::Vector3d(0.2, 0.3, -1),
+        math::Vector3d::UnitZ, hit));
+  EXPECT_DOUBLE_EQ(1.0, hit.distance);
+
+  EXPECT_FALSE(bvh.Intersect(math::Vector3d(0.2, 0.3, 2),
+        -math::Vector3d::UnitZ, hit, 1.5));
+  EXPECT_FALSE(bvh.Intersect(math::Vector3d(0.2, 0.3, 2),
+        math::Vector3d::UnitZ, hit));
+  EXPECT_FALSE(bvh.Intersect(math::Vector3d(0.5, 0.9, 2),
+        -math::Vector3d::UnitZ, hit));
+  EXPECT_FALSE(bvh.Intersect(math::Vector3d(0.2, 0.3, 2),
+        math::Vector3d::Zero, hit));
+
+  ASSERT_TRUE(bvh.ClosestPoint(math::Vector3d(-1, -1, 0), hit));
+  EXPECT_EQ(math::Vector3d::Zero, hit.point);
+  EXPECT_DOUBLE_EQ(std::sqrt(2.0), hit.distance);
+  EXPECT_FALSE(bvh.ClosestPoint(math::Vector3d(-1, -1, 0), hit, 1.0));
+
+  ASSERT_TRUE(bvh.ClosestPoint(math::Vector3d(0.2, 0.3, -0.5), hit));
+  EXPECT_EQ(math::Vector3d(0.2, 0.3, 0), hit.point);
+  EXPECT_DOUBLE_EQ(0.5, hit.distance);
+  EXPECT_EQ(0u, hit.triangleIndex);
+
+  ASSERT_TRUE(bvh.ClosestPoint(math::Vector3d(2, 2, 3), hit));
+  EXPECT_EQ(math::Vector3d(2, 2, 2), hit.point);
+  EXPECT_EQ(3u, hit.triangleIndex);
+
+  // The hierarchy keeps its own copy of the triangles
+  mesh.SubMeshByIndex(0).lock()->Translate(math::Vector3d(10, 0, 0));
+  EXPECT_TRUE(bvh.Intersect(math::Vector3d(0.2, 0.3, 2),
+        -math::Vector3d::UnitZ, hit));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshBVHTest, Reference)
+{
+  common::Mesh mesh;
+  CreateMesh(mesh);
+  common::MeshBVH bvh(mesh);
+  EXPECT_EQ(1800u + 300u, bvh.TriangleCount());
+  EXPECT_LT(bvh.NodeCount(), bvh.TriangleCount());
+
+  std::mt19937 random(5678);
+  std::uniform_real_distribution<double> position(-2.0, 5.0);
+  std::normal_distribution<double> normal;
+  unsigned int hits = 0;
+  for (int i = 0; i < 500; ++i)
+  {
+    const math::Vector3d origin(position(random), position(random),
+        position(random));
+    const math::Vector3d direction = math::Vector3d(normal(random),
+        normal(random), normal(random)).Normalize();
+
+    const double expected = ReferenceIntersect(mesh, origin, direction);
+    common::MeshBVHHit hit;
+    const bool found = bvh.Intersect(origin, direction, hit);
+    EXPECT_EQ(!std::isinf(expected), found);
+    if (found)
+    {
+      ++hits;
+      EXPECT_NEAR(expected, hit.distance, 1e-9);
+      EXPECT_NEAR(0.0, hit.point.Distance(origin + direction * hit.distance),
+          1e-9);
+
+      math::Vector3d p[3];
+      Corners(mesh, hit.subMeshIndex, hit.triangleIndex, p);
+      EXPECT_NEAR(0.0, hit.normal.Dot(hit.point - p[0]), 1e-9);
+      EXPECT_NEAR(1.0, hit.normal.Length(), 1e-9);
+    }
+
+    const math::Vector3d point(position(random), position(random),
+        position(random));
+    ASSERT_TRUE(bvh.ClosestPoint(point, hit));
+    EXPECT_NEAR(ReferenceDistance(mesh, point), hit.distance, 1e-9);
+    EXPECT_NEAR(hit.distance, hit.point.Distance(point), 1e-9);
+  }
+  EXPECT_GT(hits, 20u);
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshBVHTest, Threads)
+{
+  common::Mesh mesh;
+  CreateMesh(mesh);
+  const common::MeshBVH bvh(mesh);
+
+  const std::size_t count = 2000;
+  std::vector<double> serial(count);
+  std::vector<double> parallel(count);
+  auto ray = [&](const std::size_t _i, std::vector<double> &_distances)
+  {
+    common::MeshBVHHit hit;
+    const math::Vector3d origin(1.5, 1.5, 3);
+    const double angle = 2.0 * IGN_PI * _i / count;
+    _distances[_i] = bvh.Intersect(origin,
+        math::Vector3d(std::cos(angle), std::sin(angle), -1), hit) ?
+      hit.distance : -1.0;
+  };
+
+  for (std::size_t i = 0; i < count; ++i)
+    ray(i, serial);
+  common::WorkerPool::Shared().ParallelFor(0, count, 64,
+      [&](const std::size_t _first, const std::size_t _last)
+      {
+        for (std::size_t i = _first; i < _last; ++i)
+          ray(i, parallel);
+      });
+  EXPECT_EQ(serial, parallel);
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,789 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <ignition/math/Color.hh>
+#include <ignition/math/Matrix4.hh>
+
+#include "ignition/common/Console.hh"
+#include "ignition/common/Filesystem.hh"
+#include "ignition/common/Material.hh"
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshCache.hh"
+#include "ignition/common/NodeAnimation.hh"
+#include "ignition/common/NodeTransform.hh"
+#include "ignition/common/Skeleton.hh"
+#include "ignition/common/SkeletonAnimation.hh"
+#include "ignition/common/SkeletonNode.hh"
+#include "ignition/common/SubMesh.hh"
+#include "ignition/common/Util.hh"
+
+#include "MappedFile.hh"
+
+using namespace ignition;
+using namespace common;
+
+namespace
+{
+  /// \brief First bytes of a cache file
+  const char Magic[8] = {'I', 'G', 'N', 'M', 'E', 'S', 'H', '\0'};
+
+  /// \brief Written in the byte order of the machine, to detect files
+  /// written on a machine with another byte order.
+  const uint32_t ByteOrder = 0x01020304;
+
+  /// \brief Alignment of the arrays in a cache file
+  const std::size_t Alignment = 8;
+
+  /// \brief Serializes values into a buffer.
+  class Writer
+  {
+    /// \brief Append a value.
+    /// \param[in] _value The value
+    public: template<typename T>
+            void Write(const T &_value)
+    {
+      static_assert(std::is_trivially_copyable<T>::value,
+          "Only trivially copyable values are written as they are");
+      const char *bytes = reinterpret_cast<const char *>(&_value);
+      this->buffer.insert(this->buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    /// \brief Append a string, as its length followed by its characters.
+    /// \param[in] _value The string
+    public: void WriteString(const std::string &_value)
+    {
+      this->Write(static_cast<uint32_t>(_value.size()));
+      this->buffer.insert(this->buffer.end(), _value.begin(), _value.end());
+    }
+
+    /// \brief Append a matrix, row by row.
+    /// \param[in] _value The matrix
+    public: void WriteMatrix(const math::Matrix4d &_value)
+    {
+      for (unsigned int r = 0; r < 4; ++r)
+      {
+        for (unsigned int c = 0; c < 4; ++c)
+          this->Write(_value(r, c));
+      }
+    }
+
+    /// \brief Append a color.
+    /// \param[in] _value The color
+    public: void WriteColor(const math::Color &_value)
+    {
+      this->Write(_value.R());
+      this->Write(_value.G());
+      this->Write(_value.B());
+      this->Write(_value.A());
+    }
+
+    /// \brief Append an array of bytes, aligned to Alignment.
+    /// \param[in] _data First byte
+    /// \param[in] _size Number of bytes
+    public: void WriteArray(const void *_data, const std::size_t _size)
+    {
+      this->buffer.resize((this->buffer.size() + Alignment - 1) /
+          Alignment * Alignment, 0);
+      const char *bytes = static_cast<const char *>(_data);
+      this->buffer.insert(this->buffer.end(), bytes, bytes + _size);
+    }
+
+    /// \brief The serialized values
+    public: std::vector<char> buffer;
+  };
+
+  /// \brief Deserializes values written by Writer. Every function returns
+  /// false if the data ends before the value.
+  class Reader
+  {
+    /// \brief Constructor
+    /// \param[in] _data First byte
+    /// \param[in] _size Number of bytes
+    public: Reader(const char *_data, const std::size_t _size)
+      : data(_data), size(_size)
+    {
+    }
+
+    /// \brief Read a value.
+    /// \param[out] _value The value
+    /// \return True if the value was read.
+    public: template<typename T>
+            bool Read(T &_value)
+    {
+      if (this->size - this->offset < sizeof(T))
+        return false;
+      std::memcpy(&_value, this->data + this->offset, sizeof(T));
+      this->offset += sizeof(T);
+      return true;
+    }
+
+    /// \brief Read a string.
+    /// \param[out] _value The string
+    /// \return True if the string was read.
+    public: bool ReadString(std::string &_value)
+    {
+      uint32_t length;
+      if (!this->Read(length) || this->size - this->offset < length)
+        return false;
+      _value.assign(this->data + this->offset, length);
+      this->offset += length;
+      return true;
+    }
+
+    /// \brief Read a matrix.
+    /// \param[out] _value The matrix
+    /// \return True if the matrix was read.
+    public: bool ReadMatrix(math::Matrix4d &_value)
+    {
+      for (unsigned int r = 0; r < 4; ++r)
+      {
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+          if (!this->Read(_value(r, c)))
+            return false;
+        }
+      }
+      return true;
+    }
+
+    /// \brief Read a color.
+    /// \param[out] _value The color
+    /// \return True if the color was read.
+    public: bool ReadColor(math::Color &_value)
+    {
+      float rgba[4];
+      for (float &channel : rgba)
+      {
+        if (!this->Read(channel))
+          return false;
+      }
+      _value.Set(rgba[0], rgba[1], rgba[2], rgba[3]);
+      return true;
+    }
+
+    /// \brief Check that an array fits in the rest of the data, before
+    /// allocating memory for it.
+    /// \param[in] _count Number of elements
+    /// \param[in] _elementSize Size of an element in bytes
+    /// \return True if the array fits.
+    public: bool Fits(const uint64_t _count, const std::size_t _elementSize)
+    {
+      const std::size_t aligned = std::min(this->size,
+          (this->offset + Alignment - 1) / Alignment * Alignment);
+      return _count <= (this->size - aligned) / _elementSize;
+    }
+
+    /// \brief Read an array of bytes written by Writer::WriteArray.
+    /// \param[out] _data Destination
+    /// \param[in] _size Number of bytes
+    /// \return True if the array was read.
+    public: bool ReadArray(void *_data, const std::size_t _size)
+    {
+      const std::size_t aligned =
+        (this->offset + Alignment - 1) / Alignment * Alignment;
+      if (aligned > this->size || this->size - aligned < _size)
+        return false;
+      if (_size > 0)
+        std::memcpy(_data, this->data + aligned, _size);
+      this->offset = aligned + _size;
+      return true;
+    }
+
+    /// \brief Get whether all the data was read.
+    /// \return True at the end of the data
+    public: bool End() const
+    {
+      return this->offset == this->size;
+    }
+
+    /// \brief The data
+    private: const char *data;
+
+    /// \brief Number of bytes of the data
+    private: std::size_t size;
+
+    /// \brief Number of bytes read
+    private: std::size_t offset = 0;
+  };
+
+  /////////////////////////////////////////////////
+  /// \brief Write the vertices, normals and texture coordinates of a
+  /// submesh, as arrays of scalars: x, y and z of each vertex and normal,
+  /// then u and v of each texture coordinate.
+  /// \param[in] _submesh The submesh
+  /// \param[in,out] _writer The writer
+  template<typename T>
+  void WriteAttributes(const SubMesh &_submesh, Writer &_writer)
+  {
+    auto vertices = _submesh.Vertices<T>();
+    auto normals = _submesh.Normals<T>();
+    auto texCoords = _submesh.TexCoords<T>();
+    _writer.WriteArray(vertices.data(), vertices.size_bytes());
+    _writer.WriteArray(normals.data(), normals.size_bytes());
+    _writer.WriteArray(texCoords.data(), texCoords.size_bytes());
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Read the vertices, normals and texture coordinates of a
+  /// submesh, whose counts are already set. The arrays of scalars are read
+  /// in the order WriteAttributes writes them.
+  /// \param[in,out] _submesh The submesh
+  /// \param[in,out] _reader The reader
+  /// \return True if the arrays were read.
+  template<typename T>
+  bool ReadAttributes(SubMesh &_submesh, Reader &_reader)
+  {
+    auto vertices = _submesh.MutableVertices<T>();
+    auto normals = _submesh.MutableNormals<T>();
+    auto texCoords = _submesh.MutableTexCoords<T>();
+    return _reader.ReadArray(vertices.data(), vertices.size_bytes()) &&
+      _reader.ReadArray(normals.data(), normals.size_bytes()) &&
+      _reader.ReadArray(texCoords.data(), texCoords.size_bytes());
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Write a submesh.
+  /// \param[in] _submesh The submesh
+  /// \param[in,out] _writer The writer
+  void WriteSubMesh(const SubMesh &_submesh, Writer &_writer)
+  {
+    _writer.WriteString(_submesh.Name());
+    _writer.Write(static_cast<uint32_t>(_submesh.SubMeshPrimitiveType()));
+    _writer.Write(static_cast<uint32_t>(_submesh.VertexPrecision()));
+    _writer.Write(static_cast<int32_t>(_submesh.MaterialIndex()));
+    _writer.Write(static_cast<uint32_t>(_submesh.VertexCount()));
+    _writer.Write(static_cast<uint32_t>(_submesh.NormalCount()));
+    _writer.Write(static_cast<uint32_t>(_submesh.TexCoordCount()));
+    _writer.Write(static_cast<uint32_t>(_submesh.IndexCount()));
+    _writer.Write(static_cast<uint32_t>(_submesh.NodeAssignmentsCount()));
+
+    if (_submesh.VertexPrecision() == SubMesh::SINGLE_PRECISION)
+      WriteAttributes<float>(_submesh, _writer);
+    else
+      WriteAttributes<double>(_submesh, _writer);
+
+    auto indices = _submesh.Indices();
+    _writer.WriteArray(indices.data(), indices.size_bytes());
+
+    for (unsigned int i = 0; i < _submesh.NodeAssignmentsCount(); ++i)
+    {
+      const NodeAssignment assignment = _submesh.NodeAssignmentByIndex(i);
+      _writer.Write(static_cast<uint32_t>(assignment.vertexIndex));
+      _writer.Write(static_cast<uint32_t>(assignment.nodeIndex));
+      _writer.Write(assignment.weight);
+    }
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Read a submesh.
+  /// \param[in,out] _reader The reader
+  /// \return The submesh, or nullptr if the data is corrupt.
+  std::unique_ptr<SubMesh> ReadSubMesh(Reader &_reader)
+  {
+    std::string name;
+    uint32_t primitive, precision;
+    int32_t material;
+    uint32_t vertexCount, normalCount, texCoordCount, indexCount;
+    uint32_t assignmentCount;
+    if (!_reader.ReadString(name) || !_reader.Read(primitive) ||
+        !_reader.Read(precision) || !_reader.Read(material) ||
+        !_reader.Read(vertexCount) || !_reader.Read(normalCount) ||
+        !_reader.Read(texCoordCount) || !_reader.Read(indexCount) ||
+        !_reader.Read(assignmentCount) || primitive > SubMesh::TRISTRIPS ||
+        precision > SubMesh::SINGLE_PRECISION)
+    {
+      return nullptr;
+    }
+
+    const std::size_t scalar =
+      precision == SubMesh::SINGLE_PRECISION ? sizeof(float) : sizeof(double);
+    if (!_reader.Fits(vertexCount, 3 * scalar) ||
+        !_reader.Fits(normalCount, 3 * scalar) ||
+        !_reader.Fits(texCoordCount, 2 * scalar) ||
+        !_reader.Fits(indexCount, sizeof(uint32_t)) ||
+        !_reader.Fits(assignmentCount, 3 * sizeof(uint32_t)))
+    {
+      return nullptr;
+    }
+
+    std::unique_ptr<SubMesh> submesh(new SubMesh(name));
+    submesh->SetPrimitiveType(static_cast<SubMesh::PrimitiveType>(primitive));
+    submesh->SetVertexPrecision(static_cast<SubMesh::Precision>(precision));
+    if (material >= 0)
+      submesh->SetMaterialIndex(static_cast<unsigned int>(material));
+    submesh->SetVertexCount(vertexCount);
+    submesh->SetNormalCount(normalCount);
+    submesh->SetTexCoordCount(texCoordCount);
+    submesh->SetIndexCount(indexCount);
+
+    const bool read = precision == SubMesh::SINGLE_PRECISION ?
+      ReadAttributes<float>(*submesh, _reader) :
+      ReadAttributes<double>(*submesh, _reader);
+    auto indices = submesh->MutableIndices();
+    if (!read || !_reader.ReadArray(indices.data(), indices.size_bytes()))
+      return nullptr;
+
+    for (uint32_t i = 0; i < assignmentCount; ++i)
+    {
+      uint32_t vertex, node;
+      float weight;
+      if (!_reader.Read(vertex) || !_reader.Read(node) ||
+          !_reader.Read(weight))
+      {
+        return nullptr;
+      }
+      submesh->AddNodeAssignment(vertex, node, weight);
+    }
+    return submesh;
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Write a material.
+  /// \param[in] _material The material
+  /// \param[in,out] _writer The writer
+  void WriteMaterial(const Material &_material, Writer &_writer)
+  {
+    _writer.WriteString(_material.TextureImage());
+    _writer.WriteColor(_material.Ambient());
+    _writer.WriteColor(_material.Diffuse());
+    _writer.WriteColor(_material.Specular());
+    _writer.WriteColor(_material.Emissive());
+    _writer.Write(_material.Transparency());
+    _writer.Write(_material.Shininess());
+    _writer.Write(_material.PointSize());
+    double srcFactor, dstFactor;
+    _material.BlendFactors(srcFactor, dstFactor);
+    _writer.Write(srcFactor);
+    _writer.Write(dstFactor);
+    _writer.Write(static_cast<uint32_t>(_material.Blend()));
+    _writer.Write(static_cast<uint32_t>(_material.Shade()));
+    _writer.Write(static_cast<uint8_t>(_material.DepthWrite()));
+    _writer.Write(static_cast<uint8_t>(_material.Lighting()));
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Read a material.
+  /// \param[in,out] _reader The reader
+  /// \return The material, or nullptr if the data is corrupt.
+  MaterialPtr ReadMaterial(Reader &_reader)
+  {
+    std::string texture;
+    math::Color ambient, diffuse, specular, emissive;
+    double transparency, shininess, pointSize, srcFactor, dstFactor;
+    uint32_t blend, shade;
+    uint8_t depthWrite, lighting;
+    if (!_reader.ReadString(texture) || !_reader.ReadColor(ambient) ||
+        !_reader.ReadColor(diffuse) || !_reader.ReadColor(specular) ||
+        !_reader.ReadColor(emissive) || !_reader.Read(transparency) ||
+        !_reader.Read(shininess) || !_reader.Read(pointSize) ||
+        !_reader.Read(srcFactor) || !_reader.Read(dstFactor) ||
+        !_reader.Read(blend) || !_reader.Read(shade) ||
+        !_reader.Read(depthWrite) || !_reader.Read(lighting) ||
+        blend >= Material::BLEND_MODE_END ||
+        shade >= Material::SHADE_MODE_END)
+    {
+      return nullptr;
+    }
+
+    MaterialPtr material(new Material());
+    material->SetTextureImage(texture);
+    material->SetAmbient(ambient);
+    material->SetDiffuse(diffuse);
+    material->SetSpecular(specular);
+    material->SetEmissive(emissive);
+    material->SetTransparency(transparency);
+    material->SetShininess(shininess);
+    material->SetPointSize(pointSize);
+    material->SetBlendFactors(srcFactor, dstFactor);
+    material->SetBlend(static_cast<Material::BlendMode>(blend));
+    material->SetShade(static_cast<Material::ShadeMode>(shade));
+    material->SetDepthWrite(depthWrite != 0);
+    material->SetLighting(lighting != 0);
+    return material;
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Write a skeleton. The nodes are written depth first, in the
+  /// order of their handles, each with the index of its parent.
+  /// \param[in] _skeleton The skeleton
+  /// \param[in,out] _writer The writer
+  void WriteSkeleton(const Skeleton &_skeleton, Writer &_writer)
+  {
+    _writer.WriteMatrix(_skeleton.BindShapeTransform());
+
+    std::vector<const SkeletonNode *> nodes;
+    std::vector<int32_t> parents;
+    std::vector<std::pair<const SkeletonNode *, int32_t>> toVisit;
+    if (_skeleton.RootNode())
+      toVisit.push_back(std::make_pair(_skeleton.RootNode(), -1));
+    while (!toVisit.empty())
+    {
+      const SkeletonNode *node = toVisit.back().first;
+      parents.push_back(toVisit.back().second);
+      toVisit.pop_back();
+      const int32_t index = static_cast<int32_t>(nodes.size());
+      nodes.push_back(node);
+      for (int i = static_cast<int>(node->ChildCount()) - 1; i >= 0; --i)
+        toVisit.push_back(std::make_pair(node->Child(i), index));
+    }
+
+    _writer.Write(static_cast<uint32_t>(nodes.size()));
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+      const SkeletonNode *node = nodes[i];
+      _writer.Write(parents[i]);
+      _writer.WriteString(node->Name());
+      _writer.WriteString(node->Id());
+      _writer.Write(static_cast<uint8_t>(node->IsJoint()));
+      _writer.WriteMatrix(node->InitialTransform());
+      _writer.WriteMatrix(node->Transform());
+      _writer.WriteMatrix(node->ModelTransform());
+      _writer.WriteMatrix(node->InverseBindTransform());
+
+      const std::vector<NodeTransform> raw = node->RawTransforms();
+      _writer.Write(static_cast<uint32_t>(raw.size()));
+      for (const NodeTransform &transform : raw)
+      {
+        _writer.Write(static_cast<uint32_t>(transform.Type()));
+        _writer.WriteString(transform.SID());
+        _writer.WriteMatrix(transform.Get());
+      }
+    }
+
+    _writer.Write(static_cast<uint32_t>(_skeleton.NumVertAttached()));
+    for (unsigned int v = 0; v < _skeleton.NumVertAttached(); ++v)
+    {
+      _writer.Write(static_cast<uint32_t>(_skeleton.VertNodeWeightCount(v)));
+      for (unsigned int i = 0; i < _skeleton.VertNodeWeightCount(v); ++i)
+      {
+        auto weight = _skeleton.VertNodeWeight(v, i);
+        _writer.WriteString(weight.first);
+        _writer.Write(weight.second);
+      }
+    }
+
+    _writer.Write(static_cast<uint32_t>(_skeleton.AnimationCount()));
+    for (unsigned int a = 0; a < _skeleton.AnimationCount(); ++a)
+    {
+      const SkeletonAnimation *animation = _skeleton.Animation(a);
+      _writer.WriteString(animation->Name());
+      _writer.Write(static_cast<uint32_t>(animation->NodeCount()));
+      for (const auto &node : animation->NodeAnimations())
+      {
+        _writer.WriteString(node.first);
+        _writer.Write(static_cast<uint32_t>(node.second->FrameCount()));
+        for (unsigned int f = 0; f < node.second->FrameCount(); ++f)
+        {
+          auto frame = node.second->KeyFrame(f);
+          _writer.Write(frame.first);
+          _writer.WriteMatrix(frame.second);
+        }
+      }
+    }
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Read a skeleton.
+  /// \param[in,out] _reader The reader
+  /// \return The skeleton, or nullptr if the data is corrupt.
+  SkeletonPtr ReadSkeleton(Reader &_reader)
+  {
+    math::Matrix4d bindShape;
+    uint32_t nodeCount;
+    // Every node stores at least its four matrices, as 16 doubles each
+    if (!_reader.ReadMatrix(bindShape) || !_reader.Read(nodeCount) ||
+        !_reader.Fits(nodeCount, 4 * 16 * sizeof(double)))
+    {
+      return nullptr;
+    }
+
+    // The nodes are owned by their root, through the skeleton
+    SkeletonPtr skeleton(new Skeleton());
+    std::vector<SkeletonNode *> nodes;
+    for (uint32_t i = 0; i < nodeCount; ++i)
+    {
+      int32_t parent;
+      std::string name, id;
+      uint8_t joint;
+      math::Matrix4d initial, transform, model, invBind;
+      uint32_t rawCount;
+      if (!_reader.Read(parent) || parent >= static_cast<int32_t>(i) ||
+          (parent < 0) != (i == 0) || !_reader.ReadString(name) ||
+          !_reader.ReadString(id) || !_reader.Read(joint) ||
+          !_reader.ReadMatrix(initial) || !_reader.ReadMatrix(transform) ||
+          !_reader.ReadMatrix(model) || !_reader.ReadMatrix(invBind) ||
+          !_reader.Read(rawCount))
+      {
+        if (!nodes.empty())
+          skeleton->RootNode(nodes[0]);
+        return nullptr;
+      }
+
+      SkeletonNode *node = new SkeletonNode(
+          parent < 0 ? nullptr : nodes[parent], name, id,
+          joint ? SkeletonNode::JOINT : SkeletonNode::NODE);
+      nodes.push_back(node);
+
+      // Parents come first, so their model transform is already set
+      node->SetInitialTransform(initial);
+      node->SetTransform(transform, false);
+      if (node->ModelTransform() != model)
+        node->SetModelTransform(model, false);
+      node->SetInverseBindTransform(invBind);
+
+      for (uint32_t r = 0; r < rawCount; ++r)
+      {
+        uint32_t type;
+        std::string sid;
+        math::Matrix4d matrix;
+        if (!_reader.Read(type) || !_reader.ReadString(sid) ||
+            !_reader.ReadMatrix(matrix) || type > MATRIX)
+        {
+          skeleton->RootNode(nodes[0]);
+          return nullptr;
+        }
+        node->AddRawTransform(NodeTransform(matrix, sid,
+              static_cast<NodeTransformType>(type)));
+      }
+    }
+    if (!nodes.empty())
+      skeleton->RootNode(nodes[0]);
+    skeleton->SetBindShapeTransform(bindShape);
+
+    uint32_t vertexCount;
+    if (!_reader.Read(vertexCount) ||
+        !_reader.Fits(vertexCount, sizeof(uint32_t)))
+    {
+      return nullptr;
+    }
+    skeleton->SetNumVertAttached(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+      uint32_t weightCount;
+      if (!_reader.Read(weightCount))
+        return nullptr;
+      for (uint32_t i = 0; i < weightCount; ++i)
+      {
+        std::string node;
+        double weight;
+        if (!_reader.ReadString(node) || !_reader.Read(weight))
+          return nullptr;
+        skeleton->AddVertNodeWeight(v, node, weight);
+      }
+    }
+
+    uint32_t animationCount;
+    if (!_reader.Read(animationCount))
+      return nullptr;
+    for (uint32_t a = 0; a < animationCount; ++a)
+    {
+      std::string name;
+      uint32_t animationNodeCount;
+      if (!_reader.ReadString(name) || !_reader.Read(animationNodeCount))
+        return nullptr;
+      SkeletonAnimation *animation = new SkeletonAnimation(name);
+      skeleton->AddAnimation(animation);
+      for (uint32_t n = 0; n < animationNodeCount; ++n)
+      {
+        std::string node;
+        uint32_t frameCount;
+        if (!_reader.ReadString(node) || !_reader.Read(frameCount))
+          return nullptr;
+        for (uint32_t f = 0; f < frameCount; ++f)
+        {
+          double time;
+          math::Matrix4d matrix;
+          if (!_reader.Read(time) || !_reader.ReadMatrix(matrix))
+            return nullptr;
+          animation->AddKeyFrame(node, time, matrix);
+        }
+      }
+    }
+    return skeleton;
+  }
+}
+
+//////////////////////////////////////////////////
+std::string MeshCache::Key(const std::string &_filename)
+{
+  const std::string path = absPath(_filename);
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0)
+    return "";
+
+  MappedFile file(path);
+  if (!file.Valid())
+    return "";
+
+  return path + "\n" + std::to_string(static_cast<int64_t>(info.st_mtime)) +
+    "\n" + std::to_string(file.Size()) + "\n" +
+    sha1(file.Data(), file.Size());
+}
+
+//////////////////////////////////////////////////
+bool MeshCache::Write(const Mesh &_mesh, const std::string &_filename,
+    const std::string &_key)
+{
+  Writer writer;
+  writer.buffer.insert(writer.buffer.end(), Magic, Magic + sizeof(Magic));
+  writer.Write(static_cast<uint32_t>(Version));
+  writer.Write(ByteOrder);
+  writer.WriteString(_key);
+  writer.WriteString(_mesh.Name());
+  writer.WriteString(_mesh.Path());
+
+  writer.Write(static_cast<uint32_t>(_mesh.MaterialCount()));
+  for (unsigned int i = 0; i < _mesh.MaterialCount(); ++i)
+  {
+    MaterialPtr material = _mesh.MaterialByIndex(i);
+    if (!material)
+      material.reset(new Material());
+    WriteMaterial(*material, writer);
+  }
+
+  writer.Write(static_cast<uint32_t>(_mesh.SubMeshCount()));
+  for (unsigned int i = 0; i < _mesh.SubMeshCount(); ++i)
+    WriteSubMesh(*_mesh.SubMeshByIndex(i).lock(), writer);
+
+  SkeletonPtr skeleton = _mesh.MeshSkeleton();
+  writer.Write(static_cast<uint8_t>(skeleton != nullptr));
+  if (skeleton)
+    WriteSkeleton(*skeleton, writer);
+
+  // Write next to the destination, then rename, so that readers never see
+  // a partial file.
+  const std::string temporary = _filename + ".tmp" + std::to_string(
+      std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+      static_cast<std::size_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count()));
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(writer.buffer.data(), writer.buffer.size()))
+    {
+      ignerr << "Unable to write mesh cache[" << temporary << "]\n";
+      file.close();
+      removeFile(temporary, FSWO_SUPPRESS_WARNINGS);
+      return false;
+    }
+  }
+
+  if (!moveFile(temporary, _filename))
+  {
+    removeFile(temporary, FSWO_SUPPRESS_WARNINGS);
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+Mesh *MeshCache::Read(const std::string &_filename, const std::string &_key)
+{
+  MappedFile file(_filename);
+  if (!file.Valid())
+    return nullptr;
+
+  Reader reader(file.Data(), file.Size());
+  char magic[sizeof(Magic)];
+  uint32_t version, byteOrder;
+  std::string key;
+  if (!reader.ReadArray(magic, sizeof(magic)) ||
+      std::memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+      !reader.Read(version) || !reader.Read(byteOrder))
+  {
+    ignerr << "File[" << _filename << "] is not a mesh cache\n";
+    return nullptr;
+  }
+
+  if (version != Version || byteOrder != ByteOrder)
+  {
+    igndbg << "Mesh cache[" << _filename << "] has version[" << version
+      << "], expected[" << Version << "], or another byte order\n";
+    return nullptr;
+  }
+
+  if (!reader.ReadString(key))
+  {
+    ignerr << "Mesh cache[" << _filename << "] is corrupt\n";
+    return nullptr;
+  }
+
+  if (!_key.empty() && key != _key)
+  {
+    igndbg << "Mesh cache[" << _filename << "] is out of date\n";
+    return nullptr;
+  }
+
+  std::unique_ptr<Mesh> mesh(new Mesh());
+  std::string name, path;
+  uint32_t materialCount;
+  bool valid = reader.ReadString(name) && reader.ReadString(path) &&
+    reader.Read(materialCount);
+  if (valid)
+  {
+    mesh->SetName(name);
+    mesh->SetPath(path);
+  }
+
+  for (uint32_t i = 0; valid && i < materialCount; ++i)
+  {
+    MaterialPtr material = ReadMaterial(reader);
+    valid = material != nullptr;
+    if (valid)
+      mesh->AddMaterial(material);
+  }
+
+  uint32_t subMeshCount;
+  valid = valid && reader.Read(subMeshCount);
+  for (uint32_t i = 0; valid && i < subMeshCount; ++i)
+  {
+    std::unique_ptr<SubMesh> submesh = ReadSubMesh(reader);
+    valid = submesh != nullptr;
+    if (valid)
+      mesh->AddSubMesh(std::move(submesh));
+  }
+
+  uint8_t hasSkeleton;
+  valid = valid && reader.Read(hasSkeleton);
+  if (valid && hasSkeleton)
+  {
+    SkeletonPtr skeleton = ReadSkeleton(reader);
+    valid = skeleton != nullptr;
+    mesh->SetSkeleton(skeleton);
+  }
+
+  if (!valid || !reader.End())
+  {
+    ignerr << "Mesh cache[" << _filename << "] is corrupt\n";
+    return nullptr;
+  }
+
+  return mesh.release();
+}
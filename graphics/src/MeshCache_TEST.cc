@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "test_config.h"
+#include "ignition/common/ColladaLoader.hh"
+#include "ignition/common/Filesystem.hh"
+#include "ignition/common/Material.hh"
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshCache.hh"
+#include "ignition/common/NodeAnimation.hh"
+#include "ignition/common/Skeleton.hh"
+#include "ignition/common/SkeletonAnimation.hh"
+#include "ignition/common/SkeletonNode.hh"
+#include "ignition/common/SubMesh.hh"
+#include "test/util.hh"
+
+using namespace ignition;
+
+class MeshCache : public ignition::testing::AutoLogFixture
+{
+  /// \brief Create the output directory
+  public: void SetUp() override
+  {
+    ignition::testing::AutoLogFixture::SetUp();
+    this->path = common::joinPaths(common::cwd(), "tmp", "mesh_cache");
+    common::createDirectories(this->path);
+  }
+
+  /// \brief Remove the output directory
+  public: void TearDown() override
+  {
+    common::removeAll(this->path);
+    ignition::testing::AutoLogFixture::TearDown();
+  }
+
+  /// \brief Output directory
+  public: std::string path;
+};
+
+/////////////////////////////////////////////////
+/// \brief Expect two skeletons to have the same nodes and animations.
+/// \param[in] _expected The reference skeleton
+/// \param[in] _actual The skeleton to check
+void ExpectSkeleton(const common::Skeleton &_expected,
+    const common::Skeleton &_actual)
+{
+  EXPECT_EQ(_expected.BindShapeTransform(), _actual.BindShapeTransform());
+  ASSERT_EQ(_expected.NodeCount(), _actual.NodeCount());
+  EXPECT_EQ(_expected.JointCount(), _actual.JointCount());
+  for (unsigned int i = 0; i < _expected.NodeCount(); ++i)
+  {
+    const common::SkeletonNode *expected = _expected.NodeByHandle(i);
+    const common::SkeletonNode *actual = _actual.NodeByHandle(i);
+    ASSERT_NE(nullptr, actual);
+    EXPECT_EQ(expected->Name(), actual->Name());
+    EXPECT_EQ(expected->Id(), actual->Id());
+    EXPECT_EQ(expected->IsJoint(), actual->IsJoint());
+    EXPECT_EQ(expected->ChildCount(), actual->ChildCount());
+    EXPECT_EQ(expected->IsRootNode(), actual->IsRootNode());
+    EXPECT_EQ(expected->InitialTransform(), actual->InitialTransform());
+    EXPECT_EQ(expected->Transform(), actual->Transform());
+    EXPECT_EQ(expected->ModelTransform(), actual->ModelTransform());
+    EXPECT_EQ(expected->InverseBindTransform(),
+        actual->InverseBindTransform());
+    ASSERT_EQ(expected->RawTransformCount(), actual->RawTransformCount());
+    for (unsigned int r = 0; r < expected->RawTransformCount(); ++r)
+    {
+      EXPECT_EQ(expected->RawTransform(r).Type(),
+          actual->RawTransform(r).Type());
+      EXPECT_EQ(expected->RawTransform(r).SID(),
+          actual->RawTransform(r).SID());
+      EXPECT_EQ(expected->RawTransform(r)(), actual->RawTransform(r)());
+    }
+  }
+
+  ASSERT_EQ(_expected.NumVertAttached(), _actual.NumVertAttached());
+  for (unsigned int v = 0; v < _expected.NumVertAttached(); ++v)
+  {
+    ASSERT_EQ(_expected.VertNodeWeightCount(v),
+        _actual.VertNodeWeightCount(v));
+    for (unsigned int i = 0; i < _expected.VertNodeWeightCount(v); ++i)
+      EXPECT_EQ(_expected.VertNodeWeight(v, i), _actual.VertNodeWeight(v, i));
+  }
+
+  ASSERT_EQ(_expected.AnimationCount(), _actual.AnimationCount());
+  for (unsigned int a = 0; a < _expected.AnimationCount(); ++a)
+  {
+    const common::SkeletonAnimation *expected = _expected.Animation(a);
+    const common::SkeletonAnimation *actual = _actual.Animation(a);
+    EXPECT_EQ(expected->Name(), actual->Name());
+    EXPECT_DOUBLE_EQ(expected->Length(), actual->Length());
+    ASSERT_EQ(expected->NodeCount(), actual->NodeCount());
+    for (const auto &node : expected->NodeAnimations())
+    {
+      auto other = actual->NodeAnimations().find(node.first);
+      ASSERT_NE(actual->NodeAnimations().end(), other);
+      ASSERT_EQ(node.second->FrameCount(), other->second->FrameCount());
+      for (unsigned int f = 0; f < node.second->FrameCount(); ++f)
+        EXPECT_EQ(node.second->KeyFrame(f), other->second->KeyFrame(f));
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Expect two meshes to be identical.
+/// \param[in] _expected The reference mesh
+/// \param[in] _actual The mesh to check
+void ExpectMesh(const common::Mesh &_expected, const common::Mesh &_actual)
+{
+  EXPECT_EQ(_expected.Name(), _actual.Name());
+  EXPECT_EQ(_expected.Path(), _actual.Path());
+
+  ASSERT_EQ(_expected.MaterialCount(), _actual.MaterialCount());
+  for (unsigned int i = 0; i < _expected.MaterialCount(); ++i)
+  {
+    common::MaterialPtr expected = _expected.MaterialByIndex(i);
+    common::MaterialPtr actual = _actual.MaterialByIndex(i);
+    EXPECT_EQ(expected->TextureImage(), actual->TextureImage());
+    EXPECT_EQ(expected->Ambient(), actual->Ambient());
+    EXPECT_EQ(expected->Diffuse(), actual->Diffuse());
+    EXPECT_EQ(expected->Specular(), actual->Specular());
+    EXPECT_EQ(expected->Emissive(), actual->Emissive());
+    EXPECT_DOUBLE_EQ(expected->Transparency(), actual->Transparency());
+    EXPECT_DOUBLE_EQ(expected->Shininess(), actual->Shininess());
+    EXPECT_EQ(expected->Blend(), actual->Blend());
+    EXPECT_EQ(expected->Shade(), actual->Shade());
+    EXPECT_EQ(expected->DepthWrite(), actual->DepthWrite());
+    EXPECT_EQ(expected->Lighting(), actual->Lighting());
+  }
+
+  ASSERT_EQ(_expected.SubMeshCount(), _actual.SubMeshCount());
+  for (unsigned int i = 0; i < _expected.SubMeshCount(); ++i)
+  {
+    auto expected = _expected.SubMeshByIndex(i).lock();
+    auto actual = _actual.SubMeshByIndex(i).lock();
+    EXPECT_EQ(expected->Name(), actual->Name());
+    EXPECT_EQ(expected->SubMeshPrimitiveType(),
+        actual->SubMeshPrimitiveType());
+    EXPECT_EQ(expected->VertexPrecision(), actual->VertexPrecision());
+    EXPECT_EQ(expected->MaterialIndex(), actual->MaterialIndex());
+    ASSERT_EQ(expected->VertexCount(), actual->VertexCount());
+    ASSERT_EQ(expected->NormalCount(), actual->NormalCount());
+    ASSERT_EQ(expected->TexCoordCount(), actual->TexCoordCount());
+    ASSERT_EQ(expected->IndexCount(), actual->IndexCount());
+    ASSERT_EQ(expected->NodeAssignmentsCount(),
+        actual->NodeAssignmentsCount());
+    for (unsigned int v = 0; v < expected->VertexCount(); ++v)
+      EXPECT_EQ(expected->Vertex(v), actual->Vertex(v));
+    for (unsigned int n = 0; n < expected->NormalCount(); ++n)
+      EXPECT_EQ(expected->Normal(n), actual->Normal(n));
+    for (unsigned int t = 0; t < expected->TexCoordCount(); ++t)
+      EXPECT_EQ(expected->TexCoord(t), actual->TexCoord(t));
+    for (unsigned int j = 0; j < expected->IndexCount(); ++j)
+      EXPECT_EQ(expected->Index(j), actual->Index(j));
+    for (unsigned int a = 0; a < expected->NodeAssignmentsCount(); ++a)
+    {
+      auto first = expected->NodeAssignmentByIndex(a);
+      auto second = actual->NodeAssignmentByIndex(a);
+      EXPECT_EQ(first.vertexIndex, second.vertexIndex);
+      EXPECT_EQ(first.nodeIndex, second.nodeIndex);
+      EXPECT_FLOAT_EQ(first.weight, second.weight);
+    }
+  }
+
+  ASSERT_EQ(_expected.HasSkeleton(), _actual.HasSkeleton());
+  if (_expected.HasSkeleton())
+    ExpectSkeleton(*_expected.MeshSkeleton(), *_actual.MeshSkeleton());
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshCache, RoundTrip)
+{
+  common::Mesh mesh;
+  mesh.SetName("cached");
+  mesh.SetPath("/some/path");
+
+  common::MaterialPtr material(new common::Material());
+  material->SetTextureImage("/some/path/texture.png");
+  material->SetDiffuse(math::Color(0.1f, 0.2f, 0.3f, 0.4f));
+  material->SetTransparency(0.5);
+  material->SetShininess(8.0);
+  material->SetBlend(common::Material::MODULATE);
+  material->SetShade(common::Material::PHONG);
+  material->SetLighting(false);
+  mesh.AddMaterial(material);
+
+  common::SubMesh submesh("double");
+  submesh.AddVertex(0, 0, 0);
+  submesh.AddVertex(1, 0, 0);
+  submesh.AddVertex(0, 1, 0.5);
+  submesh.AddNormal(0, 0, 1);
+  submesh.AddNormal(0, 0, 1);
+  submesh.AddNormal(0, 0.5, 1);
+  submesh.AddTexCoord(0, 0);
+  submesh.AddTexCoord(1, 0);
+  submesh.AddTexCoord(0.25, 1);
+  submesh.AddIndex(0);
+  submesh.AddIndex(1);
+  submesh.AddIndex(2);
+  submesh.AddNodeAssignment(0, 1, 0.75f);
+  submesh.AddNodeAssignment(2, 0, 1.0f);
+  submesh.SetMaterialIndex(0);
+  mesh.AddSubMesh(submesh);
+
+  common::SubMesh lines("float");
+  lines.SetVertexPrecision(common::SubMesh::SINGLE_PRECISION);
+  lines.SetPrimitiveType(common::SubMesh::LINES);
+  lines.AddVertex(0.1, 0.2, 0.3);
+  lines.AddVertex(-1, 2, -3);
+  lines.AddIndex(1);
+  lines.AddIndex(0);
+  mesh.AddSubMesh(lines);
+
+  common::SkeletonNode *root = new common::SkeletonNode(nullptr, "root",
+      "root_id", common::SkeletonNode::NODE);
+  math::Matrix4d transform(math::Matrix4d::Identity);
+  transform.SetTranslation(math::Vector3d(1, 2, 3));
+  root->SetInitialTransform(transform);
+  common::SkeletonNode *joint = new common::SkeletonNode(root, "joint",
+      "joint_id", common::SkeletonNode::JOINT);
+  transform.SetTranslation(math::Vector3d(0, 0, 1));
+  joint->SetInitialTransform(transform);
+  transform.SetTranslation(math::Vector3d(0, 0.5, 1));
+  joint->SetTransform(transform);
+  joint->SetInverseBindTransform(transform.Inverse());
+  joint->AddRawTransform(common::NodeTransform(transform, "translate",
+        common::TRANSLATE));
+  common::SkeletonPtr skeleton(new common::Skeleton(root));
+  skeleton->SetNumVertAttached(3);
+  skeleton->AddVertNodeWeight(0, "joint", 0.75);
+  skeleton->AddVertNodeWeight(0, "root", 0.25);
+  skeleton->AddVertNodeWeight(2, "root", 1.0);
+  common::SkeletonAnimation *animation =
+    new common::SkeletonAnimation("wave");
+  animation->AddKeyFrame("joint", 0.0, transform);
+  animation->AddKeyFrame("joint", 1.5, math::Matrix4d::Identity);
+  skeleton->AddAnimation(animation);
+  mesh.SetSkeleton(skeleton);
+
+  const std::string filename = common::joinPaths(this->path, "a.mesh");
+  EXPECT_TRUE(common::MeshCache::Write(mesh, filename, "key"));
+
+  std::unique_ptr<common::Mesh> read(common::MeshCache::Read(filename));
+  ASSERT_NE(nullptr, read);
+  ExpectMesh(mesh, *read);
+
+  read.reset(common::MeshCache::Read(filename, "key"));
+  ASSERT_NE(nullptr, read);
+  ExpectMesh(mesh, *read);
+
+  EXPECT_EQ(nullptr, common::MeshCache::Read(filename, "other key"));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshCache, Collada)
+{
+  for (const std::string name : {"box.dae", "box_nested_animation.dae",
+      "box_with_double_skeleton.dae", "box_with_multiple_geoms.dae"})
+  {
+    const std::string source =
+      common::joinPaths(PROJECT_SOURCE_PATH, "test", "data", name);
+    common::ColladaLoader loader;
+    std::unique_ptr<common::Mesh> mesh(loader.Load(source));
+    ASSERT_NE(nullptr, mesh);
+
+    const std::string key = common::MeshCache::Key(source);
+    const std::string filename =
+      common::joinPaths(this->path, name + ".mesh");
+    EXPECT_TRUE(common::MeshCache::Write(*mesh, filename, key));
+
+    std::unique_ptr<common::Mesh> read(
+        common::MeshCache::Read(filename, key));
+    ASSERT_NE(nullptr, read) << name;
+    ExpectMesh(*mesh, *read);
+  }
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshCache, Key)
+{
+  const std::string source = common::joinPaths(this->path, "source.txt");
+  EXPECT_EQ("", common::MeshCache::Key(source));
+
+  {
+    std::ofstream file(source);
+    file << "first";
+  }
+  const std::string first = common::MeshCache::Key(source);
+  EXPECT_NE(std::string::npos, first.find(common::absPath(source)));
+  EXPECT_EQ(first, common::MeshCache::Key(source));
+
+  {
+    std::ofstream file(source);
+    file << "other";
+  }
+  const std::string second = common::MeshCache::Key(source);
+  EXPECT_FALSE(second.empty());
+  EXPECT_NE(first, second);
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshCache, Invalid)
+{
+  EXPECT_EQ(nullptr, common::MeshCache::Read(
+        common::joinPaths(this->path, "missing.mesh")));
+
+  const std::string text = common::joinPaths(this->path, "text.mesh");
+  {
+    std::ofstream file(text);
+    file << "not a mesh cache";
+  }
+  EXPECT_EQ(nullptr, common::MeshCache::Read(text));
+
+  common::Mesh mesh;
+  common::SubMesh submesh;
+  for (int i = 0; i < 100; ++i)
+  {
+    submesh.AddVertex(i, 0, 0);
+    submesh.AddIndex(i);
+  }
+  mesh.AddSubMesh(submesh);
+  const std::string filename = common::joinPaths(this->path, "b.mesh");
+  ASSERT_TRUE(common::MeshCache::Write(mesh, filename));
+
+  std::string content;
+  {
+    std::ifstream file(filename, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>());
+  }
+
+  // Every truncation is detected
+  const std::string truncated = common::joinPaths(this->path, "c.mesh");
+  for (std::size_t size = 0; size < content.size(); size += 7)
+  {
+    {
+      std::ofstream file(truncated, std::ios::binary | std::ios::trunc);
+      file.write(content.data(), size);
+    }
+    EXPECT_EQ(nullptr, common::MeshCache::Read(truncated)) << size;
+  }
+
+  // Another version
+  std::string version = content;
+  version[8] = static_cast<char>(common::MeshCache::Version + 1);
+  {
+    std::ofstream file(truncated, std::ios::binary | std::ios::trunc);
+    file.write(version.data(), version.size());
+  }
+  EXPECT_EQ(nullptr, common::MeshCache::Read(truncated));
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -19,7 +19,11 @@
 #include <string>
 #include <mutex>
 #include <map>
+#include <memory>
 #include <cctype>
+#include <future>
+#include <limits>
+#include <vector>
 
 #ifndef _WIN32
   #include "ignition/common/GTSMeshUtils.hh"
@@ -27,12 +31,19 @@
 #endif
 
 #include "ignition/common/Console.hh"
+#include "ignition/common/Filesystem.hh"
 #include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshBVH.hh"
+#include "ignition/common/MeshCache.hh"
+#include "ignition/common/MeshOptimizer.hh"
+#include "ignition/common/MeshSimplifier.hh"
 #include "ignition/common/SubMesh.hh"
 #include "ignition/common/ColladaLoader.hh"
 #include "ignition/common/ColladaExporter.hh"
 #include "ignition/common/OBJLoader.hh"
 #include "ignition/common/STLLoader.hh"
+#include "ignition/common/WorkerPool.hh"
+#include "ignition/common/Util.hh"
 #include "ignition/common/config.hh"
 
 #include "ignition/common/MeshManager.hh"
@@ -46,31 +57,76 @@ class ignition::common::MeshManagerPrivate
 #pragma warning(push)
 #pragma warning(disable: 4251)
 #endif
-  /// \brief 3D mesh loader for COLLADA files
-  public: ColladaLoader colladaLoader;
-
   /// \brief 3D mesh exporter for COLLADA files
   public: ColladaExporter colladaExporter;
 
-  /// \brief 3D mesh loader for STL files
-  public: STLLoader stlLoader;
-
-  /// \brief 3D mesh loader for OBJ files
-  public: OBJLoader objLoader;
-
   /// \brief Dictionary of meshes, indexed by name
   public: std::map<std::string, Mesh*> meshes;
 
+  /// \brief Meshes being loaded from files, indexed by file name. Other
+  /// requests for the same file wait for these.
+  public: std::map<std::string, std::shared_future<Mesh*>> loading;
+
+  /// \brief Levels of detail of meshes, indexed by the name of the mesh,
+  /// from level 1.
+  public: std::map<std::string, std::vector<Mesh*>> levelsOfDetail;
+
+  /// \brief Convex hulls of meshes, indexed by the name of the mesh
+  public: std::map<std::string, Mesh*> convexHulls;
+
+  /// \brief Bounding volume hierarchies of meshes, indexed by the name of
+  /// the mesh, built on demand.
+  public: std::map<std::string, std::unique_ptr<MeshBVH>> bvhs;
+
+  /// \brief Bounding volume hierarchies being built, indexed by the name
+  /// of the mesh. Other requests for the same mesh wait for these.
+  public: std::map<std::string, std::shared_future<const MeshBVH *>>
+          building;
+
   /// \brief supported file extensions for meshes
   public: std::vector<std::string> fileExtensions;
 
-  /// \brief Mutex to protect the mesh map
+  /// \brief Mutex to protect the mesh maps and the meshes, which
+  /// GenSphericalTexCoord modifies. It is not held while loading files,
+  /// nor while generating levels of detail, convex hulls or bounding
+  /// volume hierarchies, which work on a copy of the mesh.
   public: std::mutex mutex;
+
+  /// \brief Optimization passes applied to loaded meshes
+  public: unsigned int loadOptimization = MeshOptimizer::NONE;
+
+  /// \brief Directory of the cache of loaded meshes, empty when disabled
+  public: std::string cachePath;
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
+
+  /// \brief Copy the geometry of a mesh, to work on it without the lock.
+  /// The materials and the skeleton are shared. Must be called with the
+  /// mutex locked.
+  /// \param[in] _mesh Mesh to copy
+  /// \return The copy
+  public: static std::unique_ptr<Mesh> Copy(const Mesh &_mesh);
 };
 
+//////////////////////////////////////////////////
+std::unique_ptr<Mesh> MeshManagerPrivate::Copy(const Mesh &_mesh)
+{
+  std::unique_ptr<Mesh> copy(new Mesh());
+  copy->SetName(_mesh.Name());
+  copy->SetPath(_mesh.Path());
+  for (unsigned int i = 0; i < _mesh.MaterialCount(); ++i)
+    copy->AddMaterial(_mesh.MaterialByIndex(i));
+  copy->SetSkeleton(_mesh.MeshSkeleton());
+  for (unsigned int i = 0; i < _mesh.SubMeshCount(); ++i)
+  {
+    auto submesh = _mesh.SubMeshByIndex(i).lock();
+    if (submesh)
+      copy->AddSubMesh(*submesh);
+  }
+  return copy;
+}
+
 //////////////////////////////////////////////////
 MeshManager::MeshManager()
     : dataPtr(new MeshManagerPrivate)
@@ -109,6 +165,17 @@ MeshManager::~MeshManager()
       iter != this->dataPtr->meshes.end(); ++iter)
     delete iter->second;
   this->dataPtr->meshes.clear();
+
+  for (auto &levels : this->dataPtr->levelsOfDetail)
+  {
+    for (auto *level : levels.second)
+      delete level;
+  }
+  this->dataPtr->levelsOfDetail.clear();
+
+  for (auto &hulls : this->dataPtr->convexHulls)
+    delete hulls.second;
+  this->dataPtr->convexHulls.clear();
 }
 
 //////////////////////////////////////////////////
@@ -120,60 +187,337 @@ const Mesh *MeshManager::Load(const std::string &_filename)
     return nullptr;
   }
 
-  Mesh *mesh = nullptr;
+  // Only the first request for a file loads it. The mutex is released
+  // while loading, so that different files load in parallel, and later
+  // requests for the same file wait for the first one to finish.
+  std::promise<Mesh *> promise;
+  unsigned int loadOptimization;
+  std::string cachePath;
+  {
+    std::unique_lock<std::mutex> lock(this->dataPtr->mutex);
+    auto iter = this->dataPtr->meshes.find(_filename);
+    if (iter != this->dataPtr->meshes.end())
+      return iter->second;
 
-  std::string extension;
+    auto loading = this->dataPtr->loading.find(_filename);
+    if (loading != this->dataPtr->loading.end())
+    {
+      std::shared_future<Mesh *> future = loading->second;
+      lock.unlock();
+      return future.get();
+    }
 
-  if (this->HasMesh(_filename))
-  {
-    return this->dataPtr->meshes[_filename];
+    this->dataPtr->loading[_filename] = promise.get_future().share();
+    loadOptimization = this->dataPtr->loadOptimization;
+    cachePath = this->dataPtr->cachePath;
   }
 
+  Mesh *mesh = nullptr;
   std::string fullname = common::findFile(_filename);
 
   if (!fullname.empty())
   {
-    extension = fullname.substr(fullname.rfind(".")+1, fullname.size());
+    std::string extension =
+      fullname.substr(fullname.rfind(".")+1, fullname.size());
     std::transform(extension.begin(), extension.end(),
         extension.begin(), ::tolower);
-    MeshLoader *loader = nullptr;
 
+    // The loaders keep the state of the file being loaded, so each load
+    // gets its own.
+    std::unique_ptr<MeshLoader> loader;
     if (extension == "stl" || extension == "stlb" || extension == "stla")
-      loader = &this->dataPtr->stlLoader;
+      loader.reset(new STLLoader());
     else if (extension == "dae")
-      loader = &this->dataPtr->colladaLoader;
+      loader.reset(new ColladaLoader());
     else if (extension == "obj")
-      loader = &this->dataPtr->objLoader;
+      loader.reset(new OBJLoader());
     else
-    {
       ignerr << "Unsupported mesh format for file[" << _filename << "]\n";
-      return nullptr;
-    }
 
-    // This mutex prevents two threads from loading the same mesh at the
-    // same time.
-    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
-    if (!this->HasMesh(_filename))
+    // Cache files are named after the path of the source, and are only
+    // used while the source and the optimization passes are unchanged.
+    std::string cacheFile;
+    std::string cacheKey;
+    if (loader && !cachePath.empty())
     {
-      if ((mesh = loader->Load(fullname)) != nullptr)
+      cacheKey = MeshCache::Key(fullname);
+      if (!cacheKey.empty())
       {
-        mesh->SetName(_filename);
-        this->dataPtr->meshes.insert(std::make_pair(_filename, mesh));
+        cacheKey += "\n" + std::to_string(loadOptimization);
+        cacheFile = joinPaths(cachePath, sha1(absPath(fullname)) + ".mesh");
+        mesh = MeshCache::Read(cacheFile, cacheKey);
+        if (mesh)
+        {
+          igndbg << "Loaded mesh[" << _filename << "] from cache["
+            << cacheFile << "]\n";
+        }
       }
-      else
-        ignerr << "Unable to load mesh[" << fullname << "]\n";
     }
-    else
+
+    if (mesh == nullptr && loader &&
+        (mesh = loader->Load(fullname)) != nullptr)
     {
-      mesh = this->dataPtr->meshes[_filename];
+      if (loadOptimization != MeshOptimizer::NONE)
+      {
+        const double before = MeshOptimizer::ACMR(*mesh);
+        MeshOptimizer::Optimize(*mesh, loadOptimization);
+        igndbg << "Optimized mesh[" << _filename << "], ACMR from "
+          << before << " to " << MeshOptimizer::ACMR(*mesh) << "\n";
+      }
+      if (!cacheFile.empty())
+        MeshCache::Write(*mesh, cacheFile, cacheKey);
     }
+    else if (mesh == nullptr && loader)
+      ignerr << "Unable to load mesh[" << fullname << "]\n";
+
+    if (mesh)
+      mesh->SetName(_filename);
   }
   else
     ignerr << "Unable to find file[" << _filename << "]\n";
 
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    if (mesh)
+    {
+      // A mesh with the same name may have been added in the meantime
+      auto inserted = this->dataPtr->meshes.insert(
+          std::make_pair(_filename, mesh));
+      if (!inserted.second)
+      {
+        delete mesh;
+        mesh = inserted.first->second;
+      }
+    }
+    this->dataPtr->loading.erase(_filename);
+  }
+  promise.set_value(mesh);
+
   return mesh;
 }
 
+//////////////////////////////////////////////////
+std::vector<std::future<const Mesh *>> MeshManager::LoadAsync(
+    const std::vector<std::string> &_filenames)
+{
+  std::vector<std::future<const Mesh *>> futures;
+  futures.reserve(_filenames.size());
+  for (const std::string &filename : _filenames)
+  {
+    std::promise<const Mesh *> promise;
+    futures.push_back(promise.get_future());
+    WorkerPool::Shared().AddWork(
+        [this, filename, promise = std::move(promise)]() mutable
+        {
+          promise.set_value(this->Load(filename));
+        });
+  }
+  return futures;
+}
+
+//////////////////////////////////////////////////
+void MeshManager::SetLoadOptimization(const unsigned int _passes)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->loadOptimization = _passes;
+}
+
+//////////////////////////////////////////////////
+unsigned int MeshManager::LoadOptimization() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->loadOptimization;
+}
+
+//////////////////////////////////////////////////
+void MeshManager::SetCachePath(const std::string &_path)
+{
+  if (!_path.empty() && !createDirectories(_path))
+  {
+    ignerr << "Unable to create mesh cache directory[" << _path << "]\n";
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->cachePath = _path;
+}
+
+//////////////////////////////////////////////////
+std::string MeshManager::CachePath() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->cachePath;
+}
+
+//////////////////////////////////////////////////
+bool MeshManager::GenerateLevelsOfDetail(const std::string &_name,
+    const std::vector<double> &_ratios, const std::vector<double> &_maxErrors)
+{
+  if (!_maxErrors.empty() && _maxErrors.size() != _ratios.size())
+  {
+    ignerr << "Got [" << _maxErrors.size() << "] errors for ["
+      << _ratios.size() << "] levels of detail\n";
+    return false;
+  }
+
+  // Simplify a copy of the mesh without the lock, since
+  // GenSphericalTexCoord may modify the mesh meanwhile.
+  std::unique_ptr<Mesh> mesh;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    auto iter = this->dataPtr->meshes.find(_name);
+    if (iter == this->dataPtr->meshes.end())
+    {
+      ignerr << "Unable to find mesh[" << _name << "]\n";
+      return false;
+    }
+    mesh = MeshManagerPrivate::Copy(*iter->second);
+  }
+
+  std::vector<Mesh *> levels;
+  for (std::size_t i = 0; i < _ratios.size(); ++i)
+  {
+    const double maxError = _maxErrors.empty() ?
+      std::numeric_limits<double>::infinity() : _maxErrors[i];
+    double error = 0.0;
+    Mesh *level = MeshSimplifier::Simplify(*mesh, _ratios[i],
+        maxError, &error);
+    level->SetName(_name + "_lod" + std::to_string(i + 1));
+    igndbg << "Level of detail [" << i + 1 << "] of mesh[" << _name
+      << "] has [" << level->IndexCount() / 3 << "] triangles, error ["
+      << error << "]\n";
+    levels.push_back(level);
+  }
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  auto &current = this->dataPtr->levelsOfDetail[_name];
+  for (auto *level : current)
+    delete level;
+  current = levels;
+  return true;
+}
+
+//////////////////////////////////////////////////
+unsigned int MeshManager::LevelOfDetailCount(const std::string &_name) const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  if (this->dataPtr->meshes.find(_name) == this->dataPtr->meshes.end())
+    return 0;
+
+  auto iter = this->dataPtr->levelsOfDetail.find(_name);
+  if (iter == this->dataPtr->levelsOfDetail.end())
+    return 1;
+  return static_cast<unsigned int>(iter->second.size()) + 1;
+}
+
+//////////////////////////////////////////////////
+const Mesh *MeshManager::LevelOfDetail(const std::string &_name,
+    const unsigned int _level) const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  auto mesh = this->dataPtr->meshes.find(_name);
+  if (mesh == this->dataPtr->meshes.end())
+    return nullptr;
+  if (_level == 0)
+    return mesh->second;
+
+  auto iter = this->dataPtr->levelsOfDetail.find(_name);
+  if (iter == this->dataPtr->levelsOfDetail.end() ||
+      _level > iter->second.size())
+  {
+    return nullptr;
+  }
+  return iter->second[_level - 1];
+}
+
+//////////////////////////////////////////////////
+bool MeshManager::GenerateConvexHulls(const std::string &_name,
+    const unsigned int _maxHulls, const double _maxConcavity)
+{
+  std::unique_ptr<Mesh> mesh;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    auto iter = this->dataPtr->meshes.find(_name);
+    if (iter == this->dataPtr->meshes.end())
+    {
+      ignerr << "Unable to find mesh[" << _name << "]\n";
+      return false;
+    }
+    mesh = MeshManagerPrivate::Copy(*iter->second);
+  }
+
+  Mesh *hulls = ConvexDecomposition::Decompose(*mesh, _maxHulls,
+      _maxConcavity);
+  hulls->SetName(_name + "_hulls");
+  igndbg << "Mesh[" << _name << "] has [" << hulls->SubMeshCount()
+    << "] convex hulls\n";
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  auto &current = this->dataPtr->convexHulls[_name];
+  delete current;
+  current = hulls;
+  return true;
+}
+
+//////////////////////////////////////////////////
+const Mesh *MeshManager::ConvexHulls(const std::string &_name) const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  if (this->dataPtr->meshes.find(_name) == this->dataPtr->meshes.end())
+    return nullptr;
+
+  auto iter = this->dataPtr->convexHulls.find(_name);
+  if (iter == this->dataPtr->convexHulls.end())
+    return nullptr;
+  return iter->second;
+}
+
+//////////////////////////////////////////////////
+const MeshBVH *MeshManager::BVH(const std::string &_name) const
+{
+  // As in Load, only the first request for a mesh builds its hierarchy,
+  // from a copy of the mesh without the lock, and later requests wait
+  // for it.
+  std::promise<const MeshBVH *> promise;
+  std::unique_ptr<Mesh> mesh;
+  {
+    std::unique_lock<std::mutex> lock(this->dataPtr->mutex);
+    auto iter = this->dataPtr->meshes.find(_name);
+    if (iter == this->dataPtr->meshes.end())
+      return nullptr;
+
+    auto built = this->dataPtr->bvhs.find(_name);
+    if (built != this->dataPtr->bvhs.end())
+      return built->second.get();
+
+    auto building = this->dataPtr->building.find(_name);
+    if (building != this->dataPtr->building.end())
+    {
+      std::shared_future<const MeshBVH *> future = building->second;
+      lock.unlock();
+      return future.get();
+    }
+
+    this->dataPtr->building[_name] = promise.get_future().share();
+    mesh = MeshManagerPrivate::Copy(*iter->second);
+  }
+
+  std::unique_ptr<MeshBVH> bvh(new MeshBVH(*mesh));
+  igndbg << "Built bounding volume hierarchy of mesh[" << _name
+    << "] with [" << bvh->NodeCount() << "] nodes for ["
+    << bvh->TriangleCount() << "] triangles\n";
+  const MeshBVH *result = bvh.get();
+
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    this->dataPtr->bvhs[_name] = std::move(bvh);
+    this->dataPtr->building.erase(_name);
+  }
+  promise.set_value(result);
+
+  return result;
+}
+
 //////////////////////////////////////////////////
 void MeshManager::Export(const Mesh *_mesh, const std::string &_filename,
     const std::string &_extension, bool _exportTextures)
@@ -209,28 +553,33 @@ void MeshManager::MeshAABB(const Mesh *_mesh,
     ignition::math::Vector3d &_center,
     ignition::math::Vector3d &_minXYZ, ignition::math::Vector3d &_maxXYZ)
 {
-  if (this->HasMesh(_mesh->Name()))
-    this->dataPtr->meshes[_mesh->Name()]->AABB(_center, _minXYZ, _maxXYZ);
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  auto iter = this->dataPtr->meshes.find(_mesh->Name());
+  if (iter != this->dataPtr->meshes.end())
+    iter->second->AABB(_center, _minXYZ, _maxXYZ);
 }
 
 //////////////////////////////////////////////////
 void MeshManager::GenSphericalTexCoord(const Mesh *_mesh,
     const ignition::math::Vector3d &_center)
 {
-  if (this->HasMesh(_mesh->Name()))
-    this->dataPtr->meshes[_mesh->Name()]->GenSphericalTexCoord(_center);
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  auto iter = this->dataPtr->meshes.find(_mesh->Name());
+  if (iter != this->dataPtr->meshes.end())
+    iter->second->GenSphericalTexCoord(_center);
 }
 
 //////////////////////////////////////////////////
 void MeshManager::AddMesh(Mesh *_mesh)
 {
-  if (!this->HasMesh(_mesh->Name()))
-    this->dataPtr->meshes[_mesh->Name()] = _mesh;
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->meshes.insert(std::make_pair(_mesh->Name(), _mesh));
 }
 
 //////////////////////////////////////////////////
 const Mesh *MeshManager::MeshByName(const std::string &_name) const
 {
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
   std::map<std::string, Mesh*>::const_iterator iter;
 
   iter = this->dataPtr->meshes.find(_name);
@@ -247,6 +596,7 @@ bool MeshManager::HasMesh(const std::string &_name) const
   if (_name.empty())
     return false;
 
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
   std::map<std::string, Mesh*>::const_iterator iter;
   iter = this->dataPtr->meshes.find(_name);
 
@@ -270,7 +620,7 @@ void MeshManager::CreateSphere(const std::string &name, float radius,
 
   Mesh *mesh = new Mesh();
   mesh->SetName(name);
-  this->dataPtr->meshes.insert(std::make_pair(name, mesh));
+  this->AddMesh(mesh);
 
   SubMesh subMesh;
 
@@ -338,7 +688,7 @@ void MeshManager::CreatePlane(const std::string &_name,
 
   Mesh *mesh = new Mesh();
   mesh->SetName(_name);
-  this->dataPtr->meshes.insert(std::make_pair(_name, mesh));
+  this->AddMesh(mesh);
 
   SubMesh subMesh;
 
@@ -424,7 +774,7 @@ void MeshManager::CreateBox(const std::string &_name,
 
   Mesh *mesh = new Mesh();
   mesh->SetName(_name);
-  this->dataPtr->meshes.insert(std::make_pair(_name, mesh));
+  this->AddMesh(mesh);
 
   SubMesh subMesh;
 
@@ -720,7 +1070,7 @@ void MeshManager::CreateExtrudedPolyline(const std::string &_name,
   }
 
   mesh->AddSubMesh(subMesh);
-  this->dataPtr->meshes.insert(std::make_pair(_name, mesh));
+  this->AddMesh(mesh);
 #endif
   return;
 }
@@ -737,7 +1087,7 @@ void MeshManager::CreateCamera(const std::string &_name, float _scale)
 
   Mesh *mesh = new Mesh();
   mesh->SetName(_name);
-  this->dataPtr->meshes.insert(std::make_pair(_name, mesh));
+  this->AddMesh(mesh);
 
   SubMesh subMesh;
 
@@ -838,7 +1188,7 @@ void MeshManager::CreateCylinder(const std::string &name, float radius,
 
   Mesh *mesh = new Mesh();
   mesh->SetName(name);
-  this->dataPtr->meshes.insert(std::make_pair(name, mesh));
+  this->AddMesh(mesh);
 
   SubMesh subMesh;
 
@@ -955,7 +1305,7 @@ void MeshManager::CreateCone(const std::string &name, float radius,
 
   Mesh *mesh = new Mesh();
   mesh->SetName(name);
-  this->dataPtr->meshes.insert(std::make_pair(name, mesh));
+  this->AddMesh(mesh);
 
   SubMesh subMesh;
 
@@ -1072,7 +1422,7 @@ void MeshManager::CreateTube(const std::string &_name, float _innerRadius,
 
   Mesh *mesh = new Mesh();
   mesh->SetName(_name);
-  this->dataPtr->meshes.insert(std::make_pair(_name, mesh));
+  this->AddMesh(mesh);
   SubMesh subMesh;
 
   // Generate the group of rings for the outsides of the cylinder
@@ -1293,7 +1643,7 @@ void MeshManager::CreateBoolean(const std::string &_name, const Mesh *_m1,
   MeshCSG csg;
   Mesh *mesh = csg.CreateBoolean(_m1, _m2, _operation, _offset);
   mesh->SetName(_name);
-  this->dataPtr->meshes.insert(std::make_pair(_name, mesh));
+  this->AddMesh(mesh);
 #endif
 }
 
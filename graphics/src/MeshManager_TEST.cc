@@ -17,8 +17,19 @@
 
 #include <gtest/gtest.h>
 
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "test_config.h"
+#include "ignition/common/ColladaLoader.hh"
+#include "ignition/common/Filesystem.hh"
 #include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshBVH.hh"
+#include "ignition/common/MeshCache.hh"
+#include "ignition/common/MeshOptimizer.hh"
+#include "ignition/common/Skeleton.hh"
 #include "ignition/common/SubMesh.hh"
 #include "ignition/common/MeshManager.hh"
 #include "ignition/common/config.hh"
@@ -268,6 +279,225 @@ TEST_F(MeshManager, CreateExtrudedPolylineInvalid)
   EXPECT_TRUE(!common::MeshManager::Instance()->HasMesh(meshName));
 }
 
+/////////////////////////////////////////////////
+TEST_F(MeshManager, LoadOptimization)
+{
+  auto meshManager = common::MeshManager::Instance();
+  EXPECT_EQ(static_cast<unsigned int>(common::MeshOptimizer::NONE),
+      meshManager->LoadOptimization());
+
+  common::ColladaLoader loader;
+  std::unique_ptr<common::Mesh> reference(loader.Load(
+      std::string(PROJECT_SOURCE_PATH) + "/test/data/box.dae"));
+  ASSERT_NE(nullptr, reference);
+
+  meshManager->SetLoadOptimization(common::MeshOptimizer::ALL);
+  EXPECT_EQ(static_cast<unsigned int>(common::MeshOptimizer::ALL),
+      meshManager->LoadOptimization());
+  const common::Mesh *mesh = meshManager->Load(
+      std::string(PROJECT_SOURCE_PATH) + "/test/data/box.dae");
+  meshManager->SetLoadOptimization(common::MeshOptimizer::NONE);
+
+  ASSERT_NE(nullptr, mesh);
+  EXPECT_EQ(reference->VertexCount(), mesh->VertexCount());
+  EXPECT_EQ(reference->IndexCount(), mesh->IndexCount());
+  EXPECT_LE(common::MeshOptimizer::ACMR(*mesh),
+      common::MeshOptimizer::ACMR(*reference));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshManager, LevelsOfDetail)
+{
+  auto meshManager = common::MeshManager::Instance();
+  EXPECT_EQ(0u, meshManager->LevelOfDetailCount("lod_sphere"));
+  EXPECT_FALSE(meshManager->GenerateLevelsOfDetail("lod_sphere", {0.5}));
+
+  meshManager->CreateSphere("lod_sphere", 1.0f, 32, 32);
+  const common::Mesh *sphere = meshManager->MeshByName("lod_sphere");
+  ASSERT_NE(nullptr, sphere);
+  EXPECT_EQ(1u, meshManager->LevelOfDetailCount("lod_sphere"));
+  EXPECT_EQ(sphere, meshManager->LevelOfDetail("lod_sphere", 0));
+  EXPECT_EQ(nullptr, meshManager->LevelOfDetail("lod_sphere", 1));
+
+  EXPECT_FALSE(meshManager->GenerateLevelsOfDetail("lod_sphere",
+        {0.5, 0.25}, {0.1}));
+  EXPECT_TRUE(meshManager->GenerateLevelsOfDetail("lod_sphere",
+        {0.5, 0.25}));
+  ASSERT_EQ(3u, meshManager->LevelOfDetailCount("lod_sphere"));
+
+  unsigned int triangles = sphere->IndexCount() / 3;
+  for (unsigned int i = 1; i < 3; ++i)
+  {
+    const common::Mesh *level = meshManager->LevelOfDetail("lod_sphere", i);
+    ASSERT_NE(nullptr, level);
+    EXPECT_EQ("lod_sphere_lod" + std::to_string(i), level->Name());
+    EXPECT_LT(level->IndexCount() / 3, triangles);
+    triangles = level->IndexCount() / 3;
+  }
+  EXPECT_EQ(nullptr, meshManager->LevelOfDetail("lod_sphere", 3));
+
+  // New levels replace the previous ones
+  EXPECT_TRUE(meshManager->GenerateLevelsOfDetail("lod_sphere", {0.1}));
+  EXPECT_EQ(2u, meshManager->LevelOfDetailCount("lod_sphere"));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshManager, ConvexHulls)
+{
+  auto meshManager = common::MeshManager::Instance();
+  EXPECT_EQ(nullptr, meshManager->ConvexHulls("hull_box"));
+  EXPECT_FALSE(meshManager->GenerateConvexHulls("hull_box"));
+
+  meshManager->CreateBox("hull_box", math::Vector3d(1, 2, 3),
+      math::Vector2d(1, 1));
+  ASSERT_TRUE(meshManager->HasMesh("hull_box"));
+  EXPECT_EQ(nullptr, meshManager->ConvexHulls("hull_box"));
+
+  EXPECT_TRUE(meshManager->GenerateConvexHulls("hull_box"));
+  const common::Mesh *hulls = meshManager->ConvexHulls("hull_box");
+  ASSERT_NE(nullptr, hulls);
+  EXPECT_EQ("hull_box_hulls", hulls->Name());
+  ASSERT_EQ(1u, hulls->SubMeshCount());
+  EXPECT_EQ(8u, hulls->VertexCount());
+  EXPECT_EQ(math::Vector3d(-0.5, -1, -1.5), hulls->Min());
+  EXPECT_EQ(math::Vector3d(0.5, 1, 1.5), hulls->Max());
+
+  // New hulls replace the previous ones
+  EXPECT_TRUE(meshManager->GenerateConvexHulls("hull_box", 1));
+  EXPECT_NE(nullptr, meshManager->ConvexHulls("hull_box"));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshManager, BVH)
+{
+  auto meshManager = common::MeshManager::Instance();
+  EXPECT_EQ(nullptr, meshManager->BVH("bvh_box"));
+
+  meshManager->CreateBox("bvh_box", math::Vector3d(1, 2, 3),
+      math::Vector2d(1, 1));
+  const common::MeshBVH *bvh = meshManager->BVH("bvh_box");
+  ASSERT_NE(nullptr, bvh);
+  EXPECT_EQ(12u, bvh->TriangleCount());
+
+  // The hierarchy is built once
+  EXPECT_EQ(bvh, meshManager->BVH("bvh_box"));
+
+  common::MeshBVHHit hit;
+  ASSERT_TRUE(bvh->Intersect(math::Vector3d(0, 0, 5),
+        -math::Vector3d::UnitZ, hit));
+  EXPECT_DOUBLE_EQ(3.5, hit.distance);
+  EXPECT_EQ(math::Vector3d(0, 0, 1.5), hit.point);
+
+  ASSERT_TRUE(bvh->ClosestPoint(math::Vector3d(0, 3, 0), hit));
+  EXPECT_DOUBLE_EQ(2.0, hit.distance);
+  EXPECT_EQ(math::Vector3d(0, 1, 0), hit.point);
+
+  // Concurrent requests for the same mesh get the same hierarchy, while
+  // the manager stays usable
+  meshManager->CreateSphere("bvh_sphere", 1.0f, 64, 64);
+  std::vector<const common::MeshBVH *> results(8, nullptr);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < results.size(); ++i)
+  {
+    threads.emplace_back([&, i]()
+        {
+          results[i] = meshManager->BVH("bvh_sphere");
+          EXPECT_TRUE(meshManager->HasMesh("bvh_box"));
+        });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  ASSERT_NE(nullptr, results[0]);
+  for (const common::MeshBVH *result : results)
+    EXPECT_EQ(results[0], result);
+  EXPECT_EQ(results[0], meshManager->BVH("bvh_sphere"));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshManager, LoadAsync)
+{
+  auto meshManager = common::MeshManager::Instance();
+  const std::string path = std::string(PROJECT_SOURCE_PATH) + "/test/data/";
+  const std::vector<std::string> filenames = {
+    path + "box_with_multiple_geoms.dae", path + "box.obj",
+    path + "box_with_default_stride.dae", path + "box.obj",
+    path + "missing.dae", path + "box.txt"};
+
+  auto futures = meshManager->LoadAsync(filenames);
+  ASSERT_EQ(filenames.size(), futures.size());
+  std::vector<const common::Mesh *> meshes;
+  for (auto &future : futures)
+    meshes.push_back(future.get());
+
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    ASSERT_NE(nullptr, meshes[i]);
+    EXPECT_EQ(filenames[i], meshes[i]->Name());
+    EXPECT_EQ(meshes[i], meshManager->MeshByName(filenames[i]));
+    EXPECT_GT(meshes[i]->IndexCount(), 0u);
+  }
+  EXPECT_EQ(meshes[1], meshes[3]);
+  EXPECT_EQ(nullptr, meshes[4]);
+  EXPECT_EQ(nullptr, meshes[5]);
+  EXPECT_FALSE(meshManager->HasMesh(filenames[4]));
+
+  // Concurrent requests for the same file get the same mesh
+  const std::string filename = path + "box_nested_animation.dae";
+  std::vector<const common::Mesh *> results(8, nullptr);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < results.size(); ++i)
+  {
+    threads.emplace_back([&, i]()
+        {
+          results[i] = meshManager->Load(filename);
+        });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  ASSERT_NE(nullptr, results[0]);
+  for (const common::Mesh *mesh : results)
+    EXPECT_EQ(results[0], mesh);
+  EXPECT_EQ(results[0], meshManager->MeshByName(filename));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshManager, Cache)
+{
+  auto meshManager = common::MeshManager::Instance();
+  EXPECT_TRUE(meshManager->CachePath().empty());
+
+  const std::string cachePath =
+    common::joinPaths(common::cwd(), "tmp", "mesh_manager_cache");
+  meshManager->SetCachePath(cachePath);
+  EXPECT_EQ(cachePath, meshManager->CachePath());
+  EXPECT_TRUE(common::isDirectory(cachePath));
+
+  const std::string filename = std::string(PROJECT_SOURCE_PATH) +
+    "/test/data/box_with_double_skeleton.dae";
+  const common::Mesh *mesh = meshManager->Load(filename);
+  meshManager->SetCachePath("");
+  ASSERT_NE(nullptr, mesh);
+
+  // The mesh was written to the cache, with the key of its source
+  std::vector<std::string> files;
+  for (common::DirIter file(cachePath); file != common::DirIter(); ++file)
+    files.push_back(*file);
+  ASSERT_EQ(1u, files.size());
+  EXPECT_EQ(nullptr, common::MeshCache::Read(files[0], "other key"));
+  std::unique_ptr<common::Mesh> cached(common::MeshCache::Read(files[0],
+        common::MeshCache::Key(filename) + "\n0"));
+  ASSERT_NE(nullptr, cached);
+  EXPECT_EQ(mesh->SubMeshCount(), cached->SubMeshCount());
+  EXPECT_EQ(mesh->VertexCount(), cached->VertexCount());
+  EXPECT_EQ(mesh->IndexCount(), cached->IndexCount());
+  EXPECT_EQ(mesh->MaterialCount(), cached->MaterialCount());
+  ASSERT_TRUE(cached->HasSkeleton());
+  EXPECT_EQ(mesh->MeshSkeleton()->NodeCount(),
+      cached->MeshSkeleton()->NodeCount());
+
+  common::removeAll(cachePath);
+}
+
 /////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,450 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "ignition/common/Console.hh"
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshOptimizer.hh"
+#include "ignition/common/SubMesh.hh"
+
+using namespace ignition;
+using namespace common;
+
+/// \brief Simulation of a FIFO post-transform cache. A vertex is in the
+/// cache if fewer than the cache size vertices were added after it.
+class FifoCache
+{
+  /// \brief Constructor
+  /// \param[in] _vertexCount Number of vertices
+  /// \param[in] _size Number of entries
+  public: FifoCache(const std::size_t _vertexCount, const unsigned int _size)
+    : size(_size), time(_size + 1), stamps(_vertexCount, 0)
+  {
+  }
+
+  /// \brief Use a vertex, adding it to the cache if it is not there.
+  /// \param[in] _vertex The vertex
+  /// \return True if the vertex was not in the cache.
+  public: bool Use(const unsigned int _vertex)
+  {
+    if (this->time - this->stamps[_vertex] <= this->size)
+      return false;
+    this->stamps[_vertex] = this->time++;
+    return true;
+  }
+
+  /// \brief Get the age of a vertex in the cache.
+  /// \param[in] _vertex The vertex
+  /// \return Number of vertices added since the vertex.
+  public: uint64_t Age(const unsigned int _vertex) const
+  {
+    return this->time - this->stamps[_vertex];
+  }
+
+  /// \brief Remove all the vertices from the cache.
+  public: void Clear()
+  {
+    this->time += this->size + 1;
+  }
+
+  /// \brief Number of entries
+  private: uint64_t size;
+
+  /// \brief Number of vertices added, plus the size
+  private: uint64_t time;
+
+  /// \brief Time at which each vertex was added
+  private: std::vector<uint64_t> stamps;
+};
+
+/////////////////////////////////////////////////
+/// \brief Check that a submesh can be optimized.
+/// \param[in] _submesh The submesh
+/// \return True if the submesh is made of triangles with valid indices.
+static bool ValidTriangles(const SubMesh &_submesh)
+{
+  if (_submesh.SubMeshPrimitiveType() != SubMesh::TRIANGLES ||
+      _submesh.IndexCount() % 3 != 0)
+  {
+    ignerr << "Only submeshes of triangles can be optimized\n";
+    return false;
+  }
+
+  const unsigned int vertexCount = _submesh.VertexCount();
+  for (const unsigned int index : _submesh.Indices())
+  {
+    if (index >= vertexCount)
+    {
+      ignerr << "Index [" << index << "] is out of range of ["
+        << vertexCount << "] vertices\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+/// \brief Count the cache misses of triangles.
+/// \param[in] _submesh The submesh
+/// \param[in] _cacheSize Number of entries of the cache
+/// \return Number of cache misses. Indices out of range are not counted.
+static std::size_t CacheMisses(const SubMesh &_submesh,
+    const unsigned int _cacheSize)
+{
+  const std::size_t vertexCount = _submesh.VertexCount();
+  FifoCache cache(vertexCount, _cacheSize);
+  std::size_t misses = 0;
+  for (const unsigned int index : _submesh.Indices())
+  {
+    if (index < vertexCount && cache.Use(index))
+      ++misses;
+  }
+  return misses;
+}
+
+/////////////////////////////////////////////////
+/// \brief Reorder triangles with Tipsify. The indices must be valid.
+/// \param[in] _indices Indices of the triangles
+/// \param[in] _vertexCount Number of vertices
+/// \param[in] _cacheSize Size of the cache to optimize for
+/// \param[out] _clusters If not null, filled with the first triangle of
+/// each run of triangles that starts from a vertex outside the cache.
+/// \return The reordered indices.
+static std::vector<unsigned int> Tipsify(
+    Span<const unsigned int> _indices, const std::size_t _vertexCount,
+    const unsigned int _cacheSize, std::vector<std::size_t> *_clusters)
+{
+  const std::size_t triangleCount = _indices.size() / 3;
+
+  // Triangles around each vertex, once per corner, and the number of
+  // corners not emitted yet
+  std::vector<unsigned int> live(_vertexCount, 0);
+  for (const unsigned int index : _indices)
+    ++live[index];
+
+  std::vector<std::size_t> offsets(_vertexCount + 1, 0);
+  for (std::size_t v = 0; v < _vertexCount; ++v)
+    offsets[v + 1] = offsets[v] + live[v];
+
+  std::vector<unsigned int> triangles(_indices.size());
+  {
+    std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < _indices.size(); ++i)
+      triangles[fill[_indices[i]]++] = static_cast<unsigned int>(i / 3);
+  }
+
+  FifoCache cache(_vertexCount, _cacheSize);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<unsigned int> deadEnds;
+  std::vector<unsigned int> candidates;
+  std::vector<unsigned int> output;
+  output.reserve(_indices.size());
+  std::size_t cursor = 0;
+
+  // Next vertex with triangles left, when the candidates have none
+  auto skipDeadEnd = [&]() -> int64_t
+  {
+    while (!deadEnds.empty())
+    {
+      const unsigned int v = deadEnds.back();
+      deadEnds.pop_back();
+      if (live[v] > 0)
+        return v;
+    }
+    for (; cursor < _vertexCount; ++cursor)
+    {
+      if (live[cursor] > 0)
+        return static_cast<int64_t>(cursor);
+    }
+    return -1;
+  };
+
+  if (_clusters)
+    _clusters->assign(triangleCount > 0 ? 1 : 0, 0);
+
+  int64_t fanning = skipDeadEnd();
+  while (fanning >= 0)
+  {
+    candidates.clear();
+    for (std::size_t i = offsets[fanning]; i < offsets[fanning + 1]; ++i)
+    {
+      const unsigned int t = triangles[i];
+      if (emitted[t])
+        continue;
+      emitted[t] = true;
+
+      for (int c = 0; c < 3; ++c)
+      {
+        const unsigned int v = _indices[t * 3 + c];
+        output.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        cache.Use(v);
+      }
+    }
+
+    // The candidate that will still be in the cache after its remaining
+    // triangles are emitted, and that has been in it the longest
+    int64_t next = -1;
+    int64_t best = -1;
+    for (const unsigned int v : candidates)
+    {
+      if (live[v] == 0)
+        continue;
+
+      const int64_t age = static_cast<int64_t>(cache.Age(v));
+      int64_t priority = 0;
+      if (age + 2 * static_cast<int64_t>(live[v]) <= _cacheSize)
+        priority = age;
+      if (priority > best)
+      {
+        best = priority;
+        next = v;
+      }
+    }
+
+    if (next < 0)
+    {
+      next = skipDeadEnd();
+      const std::size_t emittedCount = output.size() / 3;
+      if (_clusters && next >= 0 && emittedCount > _clusters->back())
+        _clusters->push_back(emittedCount);
+    }
+    fanning = next;
+  }
+
+  return output;
+}
+
+/////////////////////////////////////////////////
+double MeshOptimizer::ACMR(const SubMesh &_submesh,
+    const unsigned int _cacheSize)
+{
+  const std::size_t triangleCount = _submesh.IndexCount() / 3;
+  if (_submesh.SubMeshPrimitiveType() != SubMesh::TRIANGLES ||
+      triangleCount == 0)
+  {
+    return 0.0;
+  }
+  return static_cast<double>(CacheMisses(_submesh, _cacheSize)) /
+    static_cast<double>(triangleCount);
+}
+
+/////////////////////////////////////////////////
+double MeshOptimizer::ACMR(const Mesh &_mesh, const unsigned int _cacheSize)
+{
+  std::size_t misses = 0;
+  std::size_t triangleCount = 0;
+  for (unsigned int i = 0; i < _mesh.SubMeshCount(); ++i)
+  {
+    auto submesh = _mesh.SubMeshByIndex(i).lock();
+    if (!submesh || submesh->SubMeshPrimitiveType() != SubMesh::TRIANGLES)
+      continue;
+    misses += CacheMisses(*submesh, _cacheSize);
+    triangleCount += submesh->IndexCount() / 3;
+  }
+
+  if (triangleCount == 0)
+    return 0.0;
+  return static_cast<double>(misses) / static_cast<double>(triangleCount);
+}
+
+/////////////////////////////////////////////////
+bool MeshOptimizer::OptimizeVertexCache(SubMesh &_submesh,
+    const unsigned int _cacheSize)
+{
+  if (!ValidTriangles(_submesh))
+    return false;
+
+  auto output = Tipsify(_submesh.Indices(), _submesh.VertexCount(),
+      _cacheSize, nullptr);
+  std::copy(output.begin(), output.end(), _submesh.MutableIndices().begin());
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool MeshOptimizer::OptimizeOverdraw(SubMesh &_submesh,
+    const double _threshold, const unsigned int _cacheSize)
+{
+  if (!ValidTriangles(_submesh))
+    return false;
+
+  const std::size_t vertexCount = _submesh.VertexCount();
+  std::vector<std::size_t> hardBoundaries;
+  const auto ordered = Tipsify(_submesh.Indices(), vertexCount, _cacheSize,
+      &hardBoundaries);
+  const std::size_t triangleCount = ordered.size() / 3;
+  if (triangleCount == 0)
+    return true;
+  hardBoundaries.push_back(triangleCount);
+
+  // Split the clusters further where the triangles so far already reuse
+  // the cache about as well as the whole cluster
+  FifoCache cache(vertexCount, _cacheSize);
+  auto triangleMisses = [&](const std::size_t _t)
+  {
+    std::size_t misses = 0;
+    for (int c = 0; c < 3; ++c)
+      misses += cache.Use(ordered[_t * 3 + c]) ? 1 : 0;
+    return misses;
+  };
+
+  std::vector<std::size_t> boundaries;
+  for (std::size_t c = 0; c + 1 < hardBoundaries.size(); ++c)
+  {
+    const std::size_t first = hardBoundaries[c];
+    const std::size_t last = hardBoundaries[c + 1];
+
+    cache.Clear();
+    std::size_t clusterMisses = 0;
+    for (std::size_t t = first; t < last; ++t)
+      clusterMisses += triangleMisses(t);
+    const double limit = _threshold * static_cast<double>(clusterMisses) /
+      static_cast<double>(last - first);
+
+    cache.Clear();
+    boundaries.push_back(first);
+    std::size_t misses = 0;
+    for (std::size_t t = first; t < last; ++t)
+    {
+      misses += triangleMisses(t);
+      const std::size_t count = t + 1 - boundaries.back();
+      if (t + 1 < last &&
+          static_cast<double>(misses) <= limit * static_cast<double>(count))
+      {
+        boundaries.push_back(t + 1);
+        cache.Clear();
+        misses = 0;
+      }
+    }
+  }
+  boundaries.push_back(triangleCount);
+
+  std::vector<math::Vector3d> positions(vertexCount);
+  for (std::size_t v = 0; v < vertexCount; ++v)
+    positions[v] = _submesh.Vertex(static_cast<unsigned int>(v));
+
+  // Area weighted centroid and normal of each cluster
+  const std::size_t clusterCount = boundaries.size() - 1;
+  std::vector<math::Vector3d> centroids(clusterCount);
+  std::vector<math::Vector3d> normals(clusterCount);
+  std::vector<double> areas(clusterCount, 0.0);
+  math::Vector3d meshCentroid;
+  double meshArea = 0.0;
+  for (std::size_t c = 0; c < clusterCount; ++c)
+  {
+    for (std::size_t t = boundaries[c]; t < boundaries[c + 1]; ++t)
+    {
+      const math::Vector3d &p0 = positions[ordered[t * 3]];
+      const math::Vector3d &p1 = positions[ordered[t * 3 + 1]];
+      const math::Vector3d &p2 = positions[ordered[t * 3 + 2]];
+      const math::Vector3d cross = (p1 - p0).Cross(p2 - p0);
+      const double area = cross.Length();
+      centroids[c] += (p0 + p1 + p2) * (area / 3.0);
+      normals[c] += cross;
+      areas[c] += area;
+    }
+    meshCentroid += centroids[c];
+    meshArea += areas[c];
+    if (areas[c] > 0.0)
+      centroids[c] /= areas[c];
+  }
+  if (meshArea > 0.0)
+    meshCentroid /= meshArea;
+
+  // Clusters facing away from the center of the mesh are more likely to
+  // occlude the others
+  std::vector<double> keys(clusterCount);
+  for (std::size_t c = 0; c < clusterCount; ++c)
+  {
+    const double length = normals[c].Length();
+    keys[c] = length > 0.0 ?
+      (centroids[c] - meshCentroid).Dot(normals[c]) / length : 0.0;
+  }
+
+  std::vector<std::size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+      [&](const std::size_t _a, const std::size_t _b)
+      {
+        return keys[_a] > keys[_b];
+      });
+
+  auto indices = _submesh.MutableIndices();
+  std::size_t i = 0;
+  for (const std::size_t c : order)
+  {
+    for (std::size_t j = boundaries[c] * 3; j < boundaries[c + 1] * 3; ++j)
+      indices[i++] = ordered[j];
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool MeshOptimizer::OptimizeVertexFetch(SubMesh &_submesh)
+{
+  if (!ValidTriangles(_submesh))
+    return false;
+
+  const std::size_t vertexCount = _submesh.VertexCount();
+  const unsigned int unset = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> remap(vertexCount, unset);
+  std::vector<unsigned int> order;
+  order.reserve(vertexCount);
+  for (const unsigned int index : _submesh.Indices())
+  {
+    if (remap[index] == unset)
+    {
+      remap[index] = static_cast<unsigned int>(order.size());
+      order.push_back(index);
+    }
+  }
+  for (std::size_t v = 0; v < vertexCount; ++v)
+  {
+    if (remap[v] == unset)
+      order.push_back(static_cast<unsigned int>(v));
+  }
+
+  return _submesh.ReorderVertices(order);
+}
+
+/////////////////////////////////////////////////
+void MeshOptimizer::Optimize(Mesh &_mesh, const unsigned int _passes,
+    const unsigned int _cacheSize)
+{
+  for (unsigned int i = 0; i < _mesh.SubMeshCount(); ++i)
+  {
+    auto submesh = _mesh.SubMeshByIndex(i).lock();
+    if (!submesh || submesh->SubMeshPrimitiveType() != SubMesh::TRIANGLES)
+      continue;
+
+    bool valid = true;
+    if (_passes & OVERDRAW)
+      valid = OptimizeOverdraw(*submesh, 1.05, _cacheSize);
+    else if (_passes & VERTEX_CACHE)
+      valid = OptimizeVertexCache(*submesh, _cacheSize);
+
+    if (valid && (_passes & VERTEX_FETCH))
+      OptimizeVertexFetch(*submesh);
+  }
+}
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshOptimizer.hh"
+#include "ignition/common/SubMesh.hh"
+#include "test/util.hh"
+
+using namespace ignition;
+
+class MeshOptimizerTest : public ignition::testing::AutoLogFixture { };
+
+/////////////////////////////////////////////////
+/// \brief Create a grid of _size x _size quads with shared vertices, with
+/// the triangles in a random order.
+/// \param[in] _size Number of quads along each side
+/// \param[out] _submesh Submesh to fill
+void CreateShuffledGrid(const int _size, common::SubMesh &_submesh)
+{
+  for (int y = 0; y <= _size; ++y)
+  {
+    for (int x = 0; x <= _size; ++x)
+    {
+      _submesh.AddVertex(x, y, 0);
+      _submesh.AddNormal(0, 0, 1);
+      _submesh.AddTexCoord(x, y);
+    }
+  }
+
+  std::vector<std::array<unsigned int, 3>> triangles;
+  for (int y = 0; y < _size; ++y)
+  {
+    for (int x = 0; x < _size; ++x)
+    {
+      const unsigned int v = y * (_size + 1) + x;
+      triangles.push_back({{v, v + 1, v + _size + 2}});
+      triangles.push_back({{v, v + _size + 2, v + _size + 1}});
+    }
+  }
+
+  std::mt19937 random(1234);
+  std::shuffle(triangles.begin(), triangles.end(), random);
+  for (const auto &triangle : triangles)
+  {
+    for (const unsigned int index : triangle)
+      _submesh.AddIndex(index);
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Get the triangles of a submesh as sorted lists of corner
+/// positions, starting from their smallest corner to keep the winding.
+/// \param[in] _submesh The submesh
+/// \return The triangles
+std::vector<std::array<math::Vector3d, 3>> Triangles(
+    const common::SubMesh &_submesh)
+{
+  auto less = [](const math::Vector3d &_a, const math::Vector3d &_b)
+  {
+    return std::make_tuple(_a.X(), _a.Y(), _a.Z()) <
+      std::make_tuple(_b.X(), _b.Y(), _b.Z());
+  };
+
+  std::vector<std::array<math::Vector3d, 3>> triangles;
+  for (unsigned int i = 0; i + 2 < _submesh.IndexCount(); i += 3)
+  {
+    std::array<math::Vector3d, 3> triangle = {{
+      _submesh.Vertex(_submesh.Index(i)),
+      _submesh.Vertex(_submesh.Index(i + 1)),
+      _submesh.Vertex(_submesh.Index(i + 2))}};
+    std::rotate(triangle.begin(),
+        std::min_element(triangle.begin(), triangle.end(), less),
+        triangle.end());
+    triangles.push_back(triangle);
+  }
+
+  std::sort(triangles.begin(), triangles.end(),
+      [&](const std::array<math::Vector3d, 3> &_a,
+          const std::array<math::Vector3d, 3> &_b)
+      {
+        return std::lexicographical_compare(_a.begin(), _a.end(),
+            _b.begin(), _b.end(), less);
+      });
+  return triangles;
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshOptimizerTest, ACMR)
+{
+  common::SubMesh submesh;
+  EXPECT_DOUBLE_EQ(0.0, common::MeshOptimizer::ACMR(submesh));
+
+  for (int i = 0; i < 4; ++i)
+    submesh.AddVertex(i, i * i, 0);
+  for (unsigned int i : {0u, 1u, 2u})
+    submesh.AddIndex(i);
+  EXPECT_DOUBLE_EQ(3.0, common::MeshOptimizer::ACMR(submesh));
+
+  for (unsigned int i : {2u, 1u, 3u})
+    submesh.AddIndex(i);
+  EXPECT_DOUBLE_EQ(2.0, common::MeshOptimizer::ACMR(submesh));
+
+  // With a cache of one vertex, only consecutive indices are reused
+  EXPECT_DOUBLE_EQ(2.5, common::MeshOptimizer::ACMR(submesh, 1));
+
+  submesh.SetPrimitiveType(common::SubMesh::LINES);
+  EXPECT_DOUBLE_EQ(0.0, common::MeshOptimizer::ACMR(submesh));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshOptimizerTest, VertexCache)
+{
+  common::SubMesh submesh;
+  CreateShuffledGrid(40, submesh);
+  const auto triangles = Triangles(submesh);
+
+  const double before = common::MeshOptimizer::ACMR(submesh);
+  EXPECT_GT(before, 2.0);
+
+  EXPECT_TRUE(common::MeshOptimizer::OptimizeVertexCache(submesh));
+  const double after = common::MeshOptimizer::ACMR(submesh);
+  EXPECT_LT(after, 1.0);
+  EXPECT_EQ(triangles, Triangles(submesh));
+
+  // Optimizing again does not make it worse
+  EXPECT_TRUE(common::MeshOptimizer::OptimizeVertexCache(submesh));
+  EXPECT_LE(common::MeshOptimizer::ACMR(submesh), after);
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshOptimizerTest, Overdraw)
+{
+  // Two parallel grids facing away from each other
+  common::SubMesh submesh;
+  CreateShuffledGrid(20, submesh);
+  const unsigned int vertexCount = submesh.VertexCount();
+  const unsigned int indexCount = submesh.IndexCount();
+  for (unsigned int v = 0; v < vertexCount; ++v)
+    submesh.AddVertex(submesh.Vertex(v) + math::Vector3d(0, 0, -1));
+  for (unsigned int i = 0; i < indexCount; i += 3)
+  {
+    submesh.AddIndex(submesh.Index(i) + vertexCount);
+    submesh.AddIndex(submesh.Index(i + 2) + vertexCount);
+    submesh.AddIndex(submesh.Index(i + 1) + vertexCount);
+  }
+  const auto triangles = Triangles(submesh);
+  const double before = common::MeshOptimizer::ACMR(submesh);
+
+  EXPECT_TRUE(common::MeshOptimizer::OptimizeOverdraw(submesh));
+  EXPECT_EQ(triangles, Triangles(submesh));
+  EXPECT_LT(common::MeshOptimizer::ACMR(submesh), 0.5 * before);
+
+  common::SubMesh cacheOnly(submesh);
+  EXPECT_TRUE(common::MeshOptimizer::OptimizeVertexCache(cacheOnly));
+  EXPECT_LE(common::MeshOptimizer::ACMR(submesh),
+      1.5 * common::MeshOptimizer::ACMR(cacheOnly));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshOptimizerTest, VertexFetch)
+{
+  common::SubMesh submesh;
+  CreateShuffledGrid(10, submesh);
+  // A vertex that no triangle uses
+  submesh.AddVertex(-1, -1, -1);
+  submesh.AddNormal(1, 0, 0);
+  submesh.AddTexCoord(-1, -1);
+  submesh.AddNodeAssignment(0, 2, 1.0f);
+
+  EXPECT_TRUE(common::MeshOptimizer::OptimizeVertexCache(submesh));
+  const auto triangles = Triangles(submesh);
+
+  EXPECT_TRUE(common::MeshOptimizer::OptimizeVertexFetch(submesh));
+  EXPECT_EQ(triangles, Triangles(submesh));
+
+  // Indices appear in increasing order the first time they are used
+  unsigned int next = 0;
+  for (unsigned int i = 0; i < submesh.IndexCount(); ++i)
+  {
+    const unsigned int index = static_cast<unsigned int>(submesh.Index(i));
+    ASSERT_LE(index, next);
+    if (index == next)
+      ++next;
+  }
+  EXPECT_EQ(submesh.VertexCount() - 1, next);
+  EXPECT_EQ(math::Vector3d(-1, -1, -1), submesh.Vertex(next));
+  EXPECT_EQ(math::Vector3d::UnitX, submesh.Normal(next));
+
+  // The other attributes follow the vertices
+  for (unsigned int v = 0; v < next; ++v)
+  {
+    EXPECT_EQ(math::Vector2d(submesh.Vertex(v).X(), submesh.Vertex(v).Y()),
+        submesh.TexCoord(v));
+  }
+  ASSERT_EQ(1u, submesh.NodeAssignmentsCount());
+  EXPECT_EQ(math::Vector3d::Zero, submesh.Vertex(
+        submesh.NodeAssignmentByIndex(0).vertexIndex));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshOptimizerTest, Invalid)
+{
+  common::SubMesh submesh;
+  CreateShuffledGrid(2, submesh);
+  submesh.AddIndex(100);
+  submesh.AddIndex(0);
+  submesh.AddIndex(1);
+  const auto indices = std::vector<unsigned int>(submesh.Indices().begin(),
+      submesh.Indices().end());
+
+  EXPECT_FALSE(common::MeshOptimizer::OptimizeVertexCache(submesh));
+  EXPECT_FALSE(common::MeshOptimizer::OptimizeOverdraw(submesh));
+  EXPECT_FALSE(common::MeshOptimizer::OptimizeVertexFetch(submesh));
+  EXPECT_TRUE(std::equal(indices.begin(), indices.end(),
+        submesh.Indices().begin()));
+
+  common::SubMesh lines;
+  lines.SetPrimitiveType(common::SubMesh::LINES);
+  lines.AddVertex(0, 0, 0);
+  lines.AddVertex(1, 0, 0);
+  lines.AddIndex(0);
+  lines.AddIndex(1);
+  EXPECT_FALSE(common::MeshOptimizer::OptimizeVertexCache(lines));
+
+  common::SubMesh empty;
+  EXPECT_TRUE(common::MeshOptimizer::OptimizeOverdraw(empty));
+  EXPECT_TRUE(common::MeshOptimizer::OptimizeVertexFetch(empty));
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshOptimizerTest, Mesh)
+{
+  common::Mesh mesh;
+  common::SubMesh grid;
+  CreateShuffledGrid(20, grid);
+  mesh.AddSubMesh(grid);
+
+  common::SubMesh lines;
+  lines.SetPrimitiveType(common::SubMesh::LINES);
+  lines.AddVertex(0, 0, 0);
+  lines.AddVertex(1, 0, 0);
+  lines.AddIndex(1);
+  lines.AddIndex(0);
+  mesh.AddSubMesh(lines);
+
+  const double before = common::MeshOptimizer::ACMR(mesh);
+  EXPECT_DOUBLE_EQ(common::MeshOptimizer::ACMR(grid), before);
+
+  common::MeshOptimizer::Optimize(mesh, common::MeshOptimizer::ALL);
+  EXPECT_LT(common::MeshOptimizer::ACMR(mesh), 0.5 * before);
+  EXPECT_EQ(Triangles(grid),
+      Triangles(*mesh.SubMeshByIndex(0).lock()));
+
+  // Other primitives are left as they are
+  EXPECT_EQ(1u, mesh.SubMeshByIndex(1).lock()->Index(0));
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
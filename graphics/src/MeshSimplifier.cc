@@ -0,0 +1,664 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+#include "ignition/common/Console.hh"
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshSimplifier.hh"
+#include "ignition/common/SubMesh.hh"
+
+using namespace ignition;
+using namespace common;
+
+/// \brief Weight of the planes that keep open borders in place, relative
+/// to the planes of the triangles.
+static const double BorderWeight = 10.0;
+
+/// \brief How a vertex can be collapsed
+enum class VertexKind
+{
+  /// \brief Inside a surface, it can collapse into any neighbor
+  MANIFOLD,
+
+  /// \brief On an open border, it can only collapse along the border
+  BORDER,
+
+  /// \brief On a seam or a non-manifold edge, it never collapses
+  LOCKED
+};
+
+/// \brief Sum of squared distances to planes, with weights.
+class Quadric
+{
+  /// \brief Add a plane.
+  /// \param[in] _normal Unit normal of the plane
+  /// \param[in] _offset Offset of the plane, such that the plane is the
+  /// points p with _normal.Dot(p) + _offset = 0
+  /// \param[in] _weight Weight of the plane
+  public: void AddPlane(const math::Vector3d &_normal, const double _offset,
+              const double _weight)
+  {
+    const double x = _normal.X();
+    const double y = _normal.Y();
+    const double z = _normal.Z();
+    this->a00 += _weight * x * x;
+    this->a11 += _weight * y * y;
+    this->a22 += _weight * z * z;
+    this->a01 += _weight * x * y;
+    this->a02 += _weight * x * z;
+    this->a12 += _weight * y * z;
+    this->b0 += _weight * x * _offset;
+    this->b1 += _weight * y * _offset;
+    this->b2 += _weight * z * _offset;
+    this->c += _weight * _offset * _offset;
+    this->weight += _weight;
+  }
+
+  /// \brief Add the planes of another quadric.
+  /// \param[in] _other The other quadric
+  public: void Add(const Quadric &_other)
+  {
+    this->a00 += _other.a00;
+    this->a11 += _other.a11;
+    this->a22 += _other.a22;
+    this->a01 += _other.a01;
+    this->a02 += _other.a02;
+    this->a12 += _other.a12;
+    this->b0 += _other.b0;
+    this->b1 += _other.b1;
+    this->b2 += _other.b2;
+    this->c += _other.c;
+    this->weight += _other.weight;
+  }
+
+  /// \brief Get the root mean square distance of a point to the planes.
+  /// \param[in] _p The point
+  /// \return The distance.
+  public: double Error(const math::Vector3d &_p) const
+  {
+    if (this->weight <= 0.0)
+      return 0.0;
+
+    const double x = _p.X();
+    const double y = _p.Y();
+    const double z = _p.Z();
+    const double value =
+      x * (this->a00 * x + this->a01 * y + this->a02 * z) +
+      y * (this->a01 * x + this->a11 * y + this->a12 * z) +
+      z * (this->a02 * x + this->a12 * y + this->a22 * z) +
+      2.0 * (this->b0 * x + this->b1 * y + this->b2 * z) + this->c;
+    return std::sqrt(std::max(0.0, value) / this->weight);
+  }
+
+  /// \brief Coefficients of the quadratic terms
+  private: double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+
+  /// \brief Coefficients of the linear terms
+  private: double b0 = 0, b1 = 0, b2 = 0;
+
+  /// \brief Constant term
+  private: double c = 0;
+
+  /// \brief Sum of the weights of the planes
+  private: double weight = 0;
+};
+
+/// \brief Sorted half-edges of a mesh, between vertex positions.
+class HalfEdges
+{
+  /// \brief Collect the half-edges of triangles. Triangles with two
+  /// corners at the same position are skipped.
+  /// \param[in] _indices Indices of the triangles
+  /// \param[in] _canon First vertex at the position of each vertex
+  public: HalfEdges(const std::vector<unsigned int> &_indices,
+              const std::vector<unsigned int> &_canon)
+  {
+    this->edges.reserve(_indices.size());
+    for (std::size_t i = 0; i + 2 < _indices.size(); i += 3)
+    {
+      const unsigned int c[3] = {_canon[_indices[i]],
+        _canon[_indices[i + 1]], _canon[_indices[i + 2]]};
+      if (c[0] == c[1] || c[1] == c[2] || c[2] == c[0])
+        continue;
+      for (int e = 0; e < 3; ++e)
+        this->edges.push_back(Key(c[e], c[(e + 1) % 3]));
+    }
+    std::sort(this->edges.begin(), this->edges.end());
+  }
+
+  /// \brief Count the half-edges from one position to another.
+  /// \param[in] _from Canonical vertex of the start
+  /// \param[in] _to Canonical vertex of the end
+  /// \return Number of half-edges.
+  public: std::size_t Count(const unsigned int _from,
+              const unsigned int _to) const
+  {
+    const auto range = std::equal_range(this->edges.begin(),
+        this->edges.end(), Key(_from, _to));
+    return static_cast<std::size_t>(range.second - range.first);
+  }
+
+  /// \brief Get whether the edge between two positions is on a border,
+  /// with a triangle on only one side.
+  /// \param[in] _a Canonical vertex of one end
+  /// \param[in] _b Canonical vertex of the other end
+  /// \return True if the edge is on a border.
+  public: bool Border(const unsigned int _a, const unsigned int _b) const
+  {
+    return (this->Count(_a, _b) == 0) != (this->Count(_b, _a) == 0);
+  }
+
+  /// \brief Get the key of a half-edge.
+  /// \param[in] _from Canonical vertex of the start
+  /// \param[in] _to Canonical vertex of the end
+  /// \return The key
+  public: static uint64_t Key(const unsigned int _from,
+              const unsigned int _to)
+  {
+    return (static_cast<uint64_t>(_from) << 32) | _to;
+  }
+
+  /// \brief Sorted keys of the half-edges
+  public: std::vector<uint64_t> edges;
+};
+
+/// \brief Compares the attributes other than the position of two
+/// vertices.
+using SameAttributes = std::function<bool(unsigned int, unsigned int)>;
+
+/////////////////////////////////////////////////
+/// \brief Find the vertices at the same position, and classify them.
+/// Vertices at the same position with the same attributes are merged into
+/// the first of them, and the others form seams, which are locked.
+/// \param[in] _positions Positions of the vertices
+/// \param[in] _same Whether two vertices have the same attributes
+/// \param[in,out] _indices Indices of the triangles, updated to use the
+/// merged vertices
+/// \param[out] _canon First vertex at the position of each vertex
+/// \param[out] _kinds Kind of each vertex
+static void Classify(const std::vector<math::Vector3d> &_positions,
+    const SameAttributes &_same, std::vector<unsigned int> &_indices,
+    std::vector<unsigned int> &_canon, std::vector<VertexKind> &_kinds)
+{
+  const std::size_t vertexCount = _positions.size();
+  _canon.resize(vertexCount);
+  _kinds.assign(vertexCount, VertexKind::MANIFOLD);
+
+  // Sort the vertices by position to find the seams. Vertices that are not
+  // finite stay where they are.
+  std::vector<unsigned int> sorted;
+  sorted.reserve(vertexCount);
+  for (unsigned int v = 0; v < vertexCount; ++v)
+  {
+    _canon[v] = v;
+    const math::Vector3d &p = _positions[v];
+    if (std::isfinite(p.X()) && std::isfinite(p.Y()) && std::isfinite(p.Z()))
+      sorted.push_back(v);
+    else
+      _kinds[v] = VertexKind::LOCKED;
+  }
+
+  auto key = [&](const unsigned int _v)
+  {
+    return std::make_tuple(_positions[_v].X(), _positions[_v].Y(),
+        _positions[_v].Z());
+  };
+  std::sort(sorted.begin(), sorted.end(),
+      [&](const unsigned int _a, const unsigned int _b)
+      {
+        const auto ka = key(_a);
+        const auto kb = key(_b);
+        return ka < kb || (ka == kb && _a < _b);
+      });
+
+  bool merged = false;
+  for (std::size_t i = 0; i < sorted.size();)
+  {
+    std::size_t j = i + 1;
+    bool seam = false;
+    while (j < sorted.size() && key(sorted[j]) == key(sorted[i]))
+    {
+      if (!_same(sorted[i], sorted[j]))
+        seam = true;
+      ++j;
+    }
+    merged = merged || (j - i > 1 && !seam);
+    for (std::size_t k = i; k < j; ++k)
+    {
+      _canon[sorted[k]] = sorted[i];
+      if (seam)
+        _kinds[sorted[k]] = VertexKind::LOCKED;
+    }
+    i = j;
+  }
+
+  // Identical vertices, such as the corners of the triangles of an STL
+  // file, are collapsed as a single one
+  if (merged)
+  {
+    for (unsigned int &index : _indices)
+    {
+      if (_kinds[_canon[index]] != VertexKind::LOCKED)
+        index = _canon[index];
+    }
+  }
+
+  // Borders and non-manifold edges
+  const HalfEdges halfEdges(_indices, _canon);
+  std::vector<unsigned int> borderEdges(vertexCount, 0);
+  const auto &edges = halfEdges.edges;
+  for (std::size_t i = 0; i < edges.size();)
+  {
+    std::size_t j = i + 1;
+    while (j < edges.size() && edges[j] == edges[i])
+      ++j;
+
+    const unsigned int a = static_cast<unsigned int>(edges[i] >> 32);
+    const unsigned int b = static_cast<unsigned int>(edges[i] & 0xFFFFFFFF);
+    const std::size_t twins = halfEdges.Count(b, a);
+    if (j - i > 1 || twins > 1)
+    {
+      _kinds[a] = VertexKind::LOCKED;
+      _kinds[b] = VertexKind::LOCKED;
+    }
+    else if (twins == 0)
+    {
+      ++borderEdges[a];
+      ++borderEdges[b];
+    }
+    i = j;
+  }
+
+  for (std::size_t v = 0; v < vertexCount; ++v)
+  {
+    if (_canon[v] != v || _kinds[v] == VertexKind::LOCKED)
+      continue;
+    // A vertex shared by several borders is a pinch point
+    if (borderEdges[v] > 2)
+      _kinds[v] = VertexKind::LOCKED;
+    else if (borderEdges[v] > 0)
+      _kinds[v] = VertexKind::BORDER;
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Remove triangles by collapsing vertices into their neighbors.
+///
+/// Each pass finds the cheapest collapse of every vertex, and applies them
+/// in order of error, skipping the ones next to a vertex already collapsed
+/// in the pass, so that the flip checks stay valid.
+/// \param[in] _positions Positions of the vertices
+/// \param[in] _same Whether two vertices have the same attributes
+/// \param[in,out] _indices Indices of the triangles
+/// \param[in] _targetTriangles Number of triangles at which to stop
+/// \param[in] _maxError Largest error allowed
+/// \return The largest error of the collapses done.
+static double Decimate(const std::vector<math::Vector3d> &_positions,
+    const SameAttributes &_same, std::vector<unsigned int> &_indices,
+    const std::size_t _targetTriangles, const double _maxError)
+{
+  const std::size_t vertexCount = _positions.size();
+  std::vector<unsigned int> canon;
+  std::vector<VertexKind> kinds;
+  Classify(_positions, _same, _indices, canon, kinds);
+
+  // Quadrics of the canonical vertices
+  std::vector<Quadric> quadrics(vertexCount);
+  {
+    const HalfEdges halfEdges(_indices, canon);
+    for (std::size_t i = 0; i + 2 < _indices.size(); i += 3)
+    {
+      const unsigned int c[3] = {canon[_indices[i]],
+        canon[_indices[i + 1]], canon[_indices[i + 2]]};
+      const math::Vector3d &p0 = _positions[c[0]];
+      math::Vector3d normal = (_positions[c[1]] - p0).Cross(
+          _positions[c[2]] - p0);
+      const double length = normal.Length();
+      if (!(length > 0.0) || !std::isfinite(length))
+        continue;
+      normal /= length;
+
+      for (int e = 0; e < 3; ++e)
+        quadrics[c[e]].AddPlane(normal, -normal.Dot(p0), 0.5 * length);
+
+      // Planes through the open borders, perpendicular to the triangle
+      for (int e = 0; e < 3; ++e)
+      {
+        const unsigned int a = c[e];
+        const unsigned int b = c[(e + 1) % 3];
+        if (halfEdges.Count(b, a) > 0)
+          continue;
+        const math::Vector3d edge = _positions[b] - _positions[a];
+        math::Vector3d side = edge.Cross(normal);
+        const double sideLength = side.Length();
+        if (!(sideLength > 0.0))
+          continue;
+        side /= sideLength;
+        const double weight = edge.SquaredLength() * BorderWeight;
+        quadrics[a].AddPlane(side, -side.Dot(_positions[a]), weight);
+        quadrics[b].AddPlane(side, -side.Dot(_positions[a]), weight);
+      }
+    }
+  }
+
+  const unsigned int none = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> remap(vertexCount);
+  std::vector<char> moved(vertexCount);
+  std::vector<unsigned int> bestTarget(vertexCount);
+  std::vector<double> bestCost(vertexCount);
+  std::vector<std::size_t> offsets(vertexCount + 1);
+  std::vector<unsigned int> adjacency;
+  std::vector<unsigned int> candidates;
+  double error = 0.0;
+
+  std::size_t triangleCount = _indices.size() / 3;
+  while (triangleCount > _targetTriangles)
+  {
+    const HalfEdges halfEdges(_indices, canon);
+
+    // Triangles around each vertex
+    std::fill(offsets.begin(), offsets.end(), 0);
+    for (const unsigned int index : _indices)
+      ++offsets[index + 1];
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    adjacency.resize(_indices.size());
+    {
+      std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+      for (std::size_t i = 0; i < _indices.size(); ++i)
+        adjacency[fill[_indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    // Cheapest collapse of each vertex
+    std::fill(bestTarget.begin(), bestTarget.end(), none);
+    std::fill(bestCost.begin(), bestCost.end(),
+        std::numeric_limits<double>::infinity());
+    auto consider = [&](const unsigned int _from, const unsigned int _to)
+    {
+      const VertexKind kind = kinds[_from];
+      const unsigned int to = canon[_to];
+      if (kind == VertexKind::LOCKED || to == _from)
+        return;
+      if (kind == VertexKind::BORDER &&
+          (kinds[to] == VertexKind::MANIFOLD ||
+           !halfEdges.Border(_from, to)))
+      {
+        return;
+      }
+
+      const double cost = quadrics[_from].Error(_positions[to]);
+      if (cost < bestCost[_from])
+      {
+        bestCost[_from] = cost;
+        bestTarget[_from] = _to;
+      }
+    };
+    for (std::size_t i = 0; i < _indices.size(); i += 3)
+    {
+      for (std::size_t e = 0; e < 3; ++e)
+      {
+        const unsigned int a = _indices[i + e];
+        const unsigned int b = _indices[i + (e + 1) % 3];
+        consider(a, b);
+        consider(b, a);
+      }
+    }
+
+    candidates.clear();
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+      if (bestTarget[v] != none && bestCost[v] <= _maxError)
+        candidates.push_back(v);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [&](const unsigned int _a, const unsigned int _b)
+        {
+          return bestCost[_a] < bestCost[_b] ||
+            (!(bestCost[_b] < bestCost[_a]) && _a < _b);
+        });
+
+    std::iota(remap.begin(), remap.end(), 0);
+    std::fill(moved.begin(), moved.end(), 0);
+    std::size_t removed = 0;
+    for (const unsigned int from : candidates)
+    {
+      if (triangleCount - removed <= _targetTriangles)
+        break;
+
+      const unsigned int target = bestTarget[from];
+      const unsigned int to = canon[target];
+      if (moved[to])
+        continue;
+
+      // The triangles around the vertex must not have changed in this
+      // pass, and must not flip
+      bool valid = true;
+      std::size_t collapsed = 0;
+      for (std::size_t a = offsets[from]; a < offsets[from + 1] && valid;
+           ++a)
+      {
+        const std::size_t t = adjacency[a] * 3;
+        math::Vector3d before[3];
+        math::Vector3d after[3];
+        bool degenerate = false;
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+          const unsigned int v = canon[_indices[t + c]];
+          if (moved[v])
+            valid = false;
+          if (v == to)
+            degenerate = true;
+          before[c] = _positions[v];
+          after[c] = v == from ? _positions[to] : before[c];
+        }
+
+        if (degenerate)
+        {
+          ++collapsed;
+          continue;
+        }
+
+        const math::Vector3d normalBefore =
+          (before[1] - before[0]).Cross(before[2] - before[0]);
+        const math::Vector3d normalAfter =
+          (after[1] - after[0]).Cross(after[2] - after[0]);
+        if (normalBefore.Dot(normalAfter) <= 0.0)
+          valid = false;
+      }
+
+      if (!valid || collapsed == 0)
+        continue;
+
+      remap[from] = target;
+      moved[from] = 1;
+      quadrics[to].Add(quadrics[from]);
+      removed += collapsed;
+      error = std::max(error, bestCost[from]);
+    }
+
+    if (removed == 0)
+      break;
+
+    // Apply the collapses, and remove the degenerate triangles
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < _indices.size(); i += 3)
+    {
+      const unsigned int a = remap[_indices[i]];
+      const unsigned int b = remap[_indices[i + 1]];
+      const unsigned int c = remap[_indices[i + 2]];
+      if (canon[a] == canon[b] || canon[b] == canon[c] ||
+          canon[c] == canon[a])
+      {
+        continue;
+      }
+      _indices[kept++] = a;
+      _indices[kept++] = b;
+      _indices[kept++] = c;
+    }
+    _indices.resize(kept);
+    triangleCount = kept / 3;
+  }
+
+  return error;
+}
+
+/////////////////////////////////////////////////
+std::unique_ptr<SubMesh> MeshSimplifier::Simplify(const SubMesh &_submesh,
+    const unsigned int _targetTriangles, const double _maxError,
+    double *_error)
+{
+  if (_submesh.SubMeshPrimitiveType() != SubMesh::TRIANGLES ||
+      _submesh.IndexCount() % 3 != 0)
+  {
+    ignerr << "Only submeshes of triangles can be simplified\n";
+    return nullptr;
+  }
+
+  const unsigned int vertexCount = _submesh.VertexCount();
+  std::vector<unsigned int> indices(_submesh.Indices().begin(),
+      _submesh.Indices().end());
+  for (const unsigned int index : indices)
+  {
+    if (index >= vertexCount)
+    {
+      ignerr << "Index [" << index << "] is out of range of ["
+        << vertexCount << "] vertices\n";
+      return nullptr;
+    }
+  }
+
+  std::vector<math::Vector3d> positions(vertexCount);
+  for (unsigned int v = 0; v < vertexCount; ++v)
+    positions[v] = _submesh.Vertex(v);
+
+  const bool vertexNormals = _submesh.NormalCount() == vertexCount;
+  const bool vertexTexCoords = _submesh.TexCoordCount() == vertexCount;
+  auto same = [&](const unsigned int _a, const unsigned int _b)
+  {
+    return (!vertexNormals || _submesh.Normal(_a) == _submesh.Normal(_b)) &&
+      (!vertexTexCoords || _submesh.TexCoord(_a) == _submesh.TexCoord(_b));
+  };
+
+  const double error = Decimate(positions, same, indices, _targetTriangles,
+      _maxError);
+  if (_error)
+    *_error = error;
+
+  // Keep the vertices still in use, in their order
+  const unsigned int none = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> newIndex(vertexCount, none);
+  for (const unsigned int index : indices)
+    newIndex[index] = 0;
+
+  std::unique_ptr<SubMesh> result(new SubMesh(_submesh.Name()));
+  result->SetPrimitiveType(SubMesh::TRIANGLES);
+  result->SetMaterialIndex(_submesh.MaterialIndex());
+  result->SetVertexPrecision(_submesh.VertexPrecision());
+  result->SetVertexHashEnabled(_submesh.VertexHashEnabled());
+
+  unsigned int next = 0;
+  for (unsigned int v = 0; v < vertexCount; ++v)
+  {
+    if (newIndex[v] == none)
+      continue;
+    newIndex[v] = next++;
+    result->AddVertex(_submesh.Vertex(v));
+    if (vertexNormals)
+      result->AddNormal(_submesh.Normal(v));
+    if (vertexTexCoords)
+      result->AddTexCoord(_submesh.TexCoord(v));
+  }
+
+  // Attributes that are not per vertex are kept as they are
+  if (!vertexNormals)
+  {
+    for (unsigned int i = 0; i < _submesh.NormalCount(); ++i)
+      result->AddNormal(_submesh.Normal(i));
+  }
+  if (!vertexTexCoords)
+  {
+    for (unsigned int i = 0; i < _submesh.TexCoordCount(); ++i)
+      result->AddTexCoord(_submesh.TexCoord(i));
+  }
+
+  result->SetIndexCount(static_cast<unsigned int>(indices.size()));
+  auto resultIndices = result->MutableIndices();
+  for (std::size_t i = 0; i < indices.size(); ++i)
+    resultIndices[i] = newIndex[indices[i]];
+
+  for (unsigned int i = 0; i < _submesh.NodeAssignmentsCount(); ++i)
+  {
+    const NodeAssignment assignment = _submesh.NodeAssignmentByIndex(i);
+    if (assignment.vertexIndex < vertexCount &&
+        newIndex[assignment.vertexIndex] != none)
+    {
+      result->AddNodeAssignment(newIndex[assignment.vertexIndex],
+          assignment.nodeIndex, assignment.weight);
+    }
+  }
+
+  return result;
+}
+
+/////////////////////////////////////////////////
+Mesh *MeshSimplifier::Simplify(const Mesh &_mesh, const double _ratio,
+    const double _maxError, double *_error)
+{
+  const double ratio = std::max(0.0, std::min(1.0, _ratio));
+
+  Mesh *result = new Mesh();
+  result->SetName(_mesh.Name());
+  result->SetPath(_mesh.Path());
+  for (unsigned int i = 0; i < _mesh.MaterialCount(); ++i)
+    result->AddMaterial(_mesh.MaterialByIndex(i));
+  result->SetSkeleton(_mesh.MeshSkeleton());
+
+  double largest = 0.0;
+  for (unsigned int i = 0; i < _mesh.SubMeshCount(); ++i)
+  {
+    auto submesh = _mesh.SubMeshByIndex(i).lock();
+    if (!submesh)
+      continue;
+
+    if (submesh->SubMeshPrimitiveType() == SubMesh::TRIANGLES)
+    {
+      const unsigned int target = static_cast<unsigned int>(
+          std::ceil(ratio * (submesh->IndexCount() / 3)));
+      double error = 0.0;
+      auto simplified = Simplify(*submesh, target, _maxError, &error);
+      if (simplified)
+      {
+        largest = std::max(largest, error);
+        result->AddSubMesh(std::move(simplified));
+        continue;
+      }
+    }
+    result->AddSubMesh(*submesh);
+  }
+
+  if (_error)
+    *_error = largest;
+  return result;
+}
@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ignition/common/Material.hh"
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshSimplifier.hh"
+#include "ignition/common/Skeleton.hh"
+#include "ignition/common/SubMesh.hh"
+#include "test/util.hh"
+
+using namespace ignition;
+
+class MeshSimplifierTest : public ignition::testing::AutoLogFixture { };
+
+/////////////////////////////////////////////////
+/// \brief Create a closed torus with shared vertices.
+/// \param[in] _rings Number of vertices around the main axis
+/// \param[in] _sides Number of vertices around the tube
+/// \param[out] _submesh Submesh to fill
+void CreateTorus(const int _rings, const int _sides, common::SubMesh &_submesh)
+{
+  for (int i = 0; i < _rings; ++i)
+  {
+    const double u = 2.0 * IGN_PI * i / _rings;
+    for (int j = 0; j < _sides; ++j)
+    {
+      const double v = 2.0 * IGN_PI * j / _sides;
+      _submesh.AddVertex((2.0 + 0.5 * std::cos(v)) * std::cos(u),
+          (2.0 + 0.5 * std::cos(v)) * std::sin(u), 0.5 * std::sin(v));
+      _submesh.AddNormal(std::cos(v) * std::cos(u),
+          std::cos(v) * std::sin(u), std::sin(v));
+    }
+  }
+
+  for (int i = 0; i < _rings; ++i)
+  {
+    for (int j = 0; j < _sides; ++j)
+    {
+      const unsigned int a = i * _sides + j;
+      const unsigned int b = ((i + 1) % _rings) * _sides + j;
+      const unsigned int c = ((i + 1) % _rings) * _sides + (j + 1) % _sides;
+      const unsigned int d = i * _sides + (j + 1) % _sides;
+      for (unsigned int index : {a, b, c, a, c, d})
+        _submesh.AddIndex(index);
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Create a grid of _size x _size quads in the XY plane, with
+/// texture coordinates matching the positions.
+/// \param[in] _size Number of quads along each side
+/// \param[in] _seam Column of vertices that is duplicated, with other
+/// texture coordinates for the columns after it, or -1 for none.
+/// \param[out] _submesh Submesh to fill
+void CreateGrid(const int _size, const int _seam, common::SubMesh &_submesh)
+{
+  auto vertex = [&](const int _x, const int _y, const bool _second)
+  {
+    _submesh.AddVertex(_x, _y, 0);
+    _submesh.AddNormal(0, 0, 1);
+    _submesh.AddTexCoord(_x + (_second ? 100.0 : 0.0), _y);
+  };
+
+  // Index of each vertex, by column and chart
+  std::vector<std::vector<unsigned int>> first(_size + 1);
+  std::vector<std::vector<unsigned int>> second(_size + 1);
+  for (int x = 0; x <= _size; ++x)
+  {
+    for (int y = 0; y <= _size; ++y)
+    {
+      first[x].push_back(_submesh.VertexCount());
+      vertex(x, y, x > _seam && _seam >= 0);
+      if (x == _seam)
+      {
+        second[x].push_back(_submesh.VertexCount());
+        vertex(x, y, true);
+      }
+      else
+      {
+        second[x].push_back(first[x].back());
+      }
+    }
+  }
+
+  for (int x = 0; x < _size; ++x)
+  {
+    for (int y = 0; y < _size; ++y)
+    {
+      const auto &left = second[x];
+      const auto &right = first[x + 1];
+      for (unsigned int index : {left[y], right[y], right[y + 1],
+                                 left[y], right[y + 1], left[y + 1]})
+      {
+        _submesh.AddIndex(index);
+      }
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Copy a submesh without sharing vertices between triangles, as
+/// loaded from an STL file without welding.
+/// \param[in] _submesh The submesh to copy
+/// \param[in] _facetNormals True to set the normals of each triangle to
+/// its facet normal, like STL files do, instead of copying them.
+/// \return The copy
+common::SubMesh Unweld(const common::SubMesh &_submesh,
+    const bool _facetNormals)
+{
+  common::SubMesh result;
+  for (unsigned int i = 0; i < _submesh.IndexCount(); i += 3)
+  {
+    const unsigned int v[3] = {
+      static_cast<unsigned int>(_submesh.Index(i)),
+      static_cast<unsigned int>(_submesh.Index(i + 1)),
+      static_cast<unsigned int>(_submesh.Index(i + 2))};
+    const math::Vector3d facet =
+      (_submesh.Vertex(v[1]) - _submesh.Vertex(v[0])).Cross(
+          _submesh.Vertex(v[2]) - _submesh.Vertex(v[0])).Normalize();
+    for (const unsigned int index : v)
+    {
+      result.AddIndex(result.VertexCount());
+      result.AddVertex(_submesh.Vertex(index));
+      result.AddNormal(_facetNormals ? facet : _submesh.Normal(index));
+    }
+  }
+  return result;
+}
+
+/////////////////////////////////////////////////
+/// \brief Check that every edge of a submesh has a triangle on each side,
+/// comparing positions.
+/// \param[in] _submesh The submesh
+/// \return True if the submesh is closed.
+bool Closed(const common::SubMesh &_submesh)
+{
+  std::map<std::pair<int, int>, int> edges;
+  for (unsigned int i = 0; i < _submesh.IndexCount(); i += 3)
+  {
+    for (unsigned int e = 0; e < 3; ++e)
+    {
+      const int a = _submesh.IndexOfVertex(
+          _submesh.Vertex(_submesh.Index(i + e)));
+      const int b = _submesh.IndexOfVertex(
+          _submesh.Vertex(_submesh.Index(i + (e + 1) % 3)));
+      ++edges[std::make_pair(a, b)];
+    }
+  }
+  for (const auto &edge : edges)
+  {
+    auto twin = edges.find(std::make_pair(edge.first.second,
+          edge.first.first));
+    if (edge.second != 1 || twin == edges.end() || twin->second != 1)
+      return false;
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+/// \brief Get the area of the triangles of a submesh.
+/// \param[in] _submesh The submesh
+/// \return The area
+double Area(const common::SubMesh &_submesh)
+{
+  double area = 0.0;
+  for (unsigned int i = 0; i < _submesh.IndexCount(); i += 3)
+  {
+    const math::Vector3d p0 = _submesh.Vertex(_submesh.Index(i));
+    const math::Vector3d p1 = _submesh.Vertex(_submesh.Index(i + 1));
+    const math::Vector3d p2 = _submesh.Vertex(_submesh.Index(i + 2));
+    area += 0.5 * (p1 - p0).Cross(p2 - p0).Length();
+  }
+  return area;
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshSimplifierTest, ClosedSurface)
+{
+  common::SubMesh torus("torus");
+  CreateTorus(64, 32, torus);
+  torus.SetMaterialIndex(2);
+  torus.AddNodeAssignment(5, 1, 0.5f);
+  ASSERT_EQ(4096u, torus.IndexCount() / 3);
+  ASSERT_TRUE(Closed(torus));
+
+  double error = -1.0;
+  auto simplified = common::MeshSimplifier::Simplify(torus, 1000,
+      std::numeric_limits<double>::infinity(), &error);
+  ASSERT_NE(nullptr, simplified);
+
+  const unsigned int triangles = simplified->IndexCount() / 3;
+  EXPECT_LE(triangles, 1000u);
+  EXPECT_GE(triangles, 990u);
+  EXPECT_GT(error, 0.0);
+  EXPECT_LT(error, 0.1);
+  EXPECT_TRUE(Closed(*simplified));
+  EXPECT_NEAR(torus.Volume(), simplified->Volume(), 0.05 * torus.Volume());
+
+  // Only the vertices in use are kept, with their attributes
+  EXPECT_LT(simplified->VertexCount(), torus.VertexCount());
+  EXPECT_EQ(simplified->VertexCount(), simplified->NormalCount());
+  for (unsigned int v = 0; v < simplified->VertexCount(); ++v)
+  {
+    const int original = torus.IndexOfVertex(simplified->Vertex(v));
+    ASSERT_GE(original, 0);
+    EXPECT_EQ(torus.Normal(original), simplified->Normal(v));
+  }
+  EXPECT_EQ("torus", simplified->Name());
+  EXPECT_EQ(2u, simplified->MaterialIndex());
+  EXPECT_LE(simplified->NodeAssignmentsCount(), 1u);
+
+  // The error is smaller with more triangles
+  double largerError = -1.0;
+  auto larger = common::MeshSimplifier::Simplify(torus, 3000,
+      std::numeric_limits<double>::infinity(), &largerError);
+  ASSERT_NE(nullptr, larger);
+  EXPECT_LT(largerError, error);
+
+  // A target above the triangle count keeps the submesh as it is
+  auto same = common::MeshSimplifier::Simplify(torus, 5000,
+      std::numeric_limits<double>::infinity(), &error);
+  ASSERT_NE(nullptr, same);
+  EXPECT_EQ(torus.IndexCount(), same->IndexCount());
+  EXPECT_EQ(torus.VertexCount(), same->VertexCount());
+  EXPECT_DOUBLE_EQ(0.0, error);
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshSimplifierTest, Border)
+{
+  common::SubMesh grid;
+  CreateGrid(20, -1, grid);
+
+  double error = -1.0;
+  auto simplified = common::MeshSimplifier::Simplify(grid, 0, 1e-6, &error);
+  ASSERT_NE(nullptr, simplified);
+
+  // A flat square only needs its corners
+  EXPECT_EQ(2u, simplified->IndexCount() / 3);
+  EXPECT_EQ(4u, simplified->VertexCount());
+  EXPECT_NEAR(0.0, error, 1e-9);
+  EXPECT_NEAR(400.0, Area(*simplified), 1e-9);
+  EXPECT_EQ(math::Vector3d::Zero, simplified->Min());
+  EXPECT_EQ(math::Vector3d(20, 20, 0), simplified->Max());
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshSimplifierTest, Unwelded)
+{
+  // A flat square with the facet normals of an STL file
+  common::SubMesh grid;
+  CreateGrid(20, -1, grid);
+  const common::SubMesh flat = Unweld(grid, true);
+  ASSERT_EQ(800u, flat.IndexCount() / 3);
+  ASSERT_EQ(2400u, flat.VertexCount());
+
+  auto simplified = common::MeshSimplifier::Simplify(flat, 0, 1e-6);
+  ASSERT_NE(nullptr, simplified);
+  EXPECT_EQ(2u, simplified->IndexCount() / 3);
+  EXPECT_EQ(4u, simplified->VertexCount());
+  EXPECT_NEAR(400.0, Area(*simplified), 1e-9);
+
+  // A smooth closed surface simplifies as if it were welded
+  common::SubMesh torus;
+  CreateTorus(32, 16, torus);
+  const common::SubMesh smooth = Unweld(torus, false);
+  auto simplifiedTorus = common::MeshSimplifier::Simplify(smooth, 300);
+  ASSERT_NE(nullptr, simplifiedTorus);
+  EXPECT_LE(simplifiedTorus->IndexCount() / 3, 300u);
+  EXPECT_TRUE(Closed(*simplifiedTorus));
+  EXPECT_NEAR(torus.Volume(), simplifiedTorus->Volume(),
+      0.05 * torus.Volume());
+
+  // Facet normals that differ between triangles are seams, which are
+  // kept
+  const common::SubMesh faceted = Unweld(torus, true);
+  auto kept = common::MeshSimplifier::Simplify(faceted, 300);
+  ASSERT_NE(nullptr, kept);
+  EXPECT_EQ(faceted.IndexCount(), kept->IndexCount());
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshSimplifierTest, Seam)
+{
+  common::SubMesh grid;
+  CreateGrid(20, 8, grid);
+  ASSERT_EQ(21u * 22u, grid.VertexCount());
+
+  auto simplified = common::MeshSimplifier::Simplify(grid, 0, 1e-6);
+  ASSERT_NE(nullptr, simplified);
+  EXPECT_LT(simplified->IndexCount(), grid.IndexCount() / 4);
+  EXPECT_NEAR(400.0, Area(*simplified), 1e-9);
+
+  // Both sides of the seam keep all their vertices
+  unsigned int seamVertices = 0;
+  for (unsigned int v = 0; v < simplified->VertexCount(); ++v)
+  {
+    if (math::equal(simplified->Vertex(v).X(), 8.0))
+      ++seamVertices;
+  }
+  EXPECT_EQ(42u, seamVertices);
+
+  // Triangles do not cross the seam, and keep their texture coordinates
+  for (unsigned int i = 0; i < simplified->IndexCount(); i += 3)
+  {
+    bool secondChart[3];
+    for (unsigned int c = 0; c < 3; ++c)
+    {
+      const unsigned int v = simplified->Index(i + c);
+      const math::Vector2d uv = simplified->TexCoord(v);
+      secondChart[c] = uv.X() >= 100.0;
+      EXPECT_DOUBLE_EQ(simplified->Vertex(v).X(),
+          secondChart[c] ? uv.X() - 100.0 : uv.X());
+      EXPECT_DOUBLE_EQ(simplified->Vertex(v).Y(), uv.Y());
+    }
+    EXPECT_EQ(secondChart[0], secondChart[1]);
+    EXPECT_EQ(secondChart[0], secondChart[2]);
+  }
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshSimplifierTest, MaxError)
+{
+  common::SubMesh torus;
+  CreateTorus(64, 32, torus);
+
+  double error = -1.0;
+  auto bounded = common::MeshSimplifier::Simplify(torus, 0, 0.01, &error);
+  ASSERT_NE(nullptr, bounded);
+  EXPECT_LE(error, 0.01);
+  EXPECT_LT(bounded->IndexCount(), torus.IndexCount());
+
+  auto unbounded = common::MeshSimplifier::Simplify(torus, 0);
+  ASSERT_NE(nullptr, unbounded);
+  EXPECT_LT(unbounded->IndexCount(), bounded->IndexCount());
+
+  // With no error allowed, only flat areas are simplified
+  auto exact = common::MeshSimplifier::Simplify(torus, 0, 0.0);
+  ASSERT_NE(nullptr, exact);
+  EXPECT_EQ(torus.IndexCount(), exact->IndexCount());
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshSimplifierTest, Invalid)
+{
+  common::SubMesh lines;
+  lines.SetPrimitiveType(common::SubMesh::LINES);
+  lines.AddVertex(0, 0, 0);
+  lines.AddVertex(1, 0, 0);
+  lines.AddIndex(0);
+  lines.AddIndex(1);
+  EXPECT_EQ(nullptr, common::MeshSimplifier::Simplify(lines, 0));
+
+  common::SubMesh outOfRange;
+  CreateGrid(2, -1, outOfRange);
+  outOfRange.AddIndex(0);
+  outOfRange.AddIndex(1);
+  outOfRange.AddIndex(100);
+  EXPECT_EQ(nullptr, common::MeshSimplifier::Simplify(outOfRange, 0));
+
+  // Vertices that are not finite stay in place
+  common::SubMesh nan;
+  CreateGrid(4, -1, nan);
+  nan.SetVertex(12, math::Vector3d(std::nan(""), 0, 0));
+  auto simplified = common::MeshSimplifier::Simplify(nan, 0);
+  ASSERT_NE(nullptr, simplified);
+  EXPECT_LT(simplified->IndexCount(), nan.IndexCount());
+
+  common::SubMesh empty;
+  simplified = common::MeshSimplifier::Simplify(empty, 0);
+  ASSERT_NE(nullptr, simplified);
+  EXPECT_EQ(0u, simplified->IndexCount());
+}
+
+/////////////////////////////////////////////////
+TEST_F(MeshSimplifierTest, Mesh)
+{
+  common::Mesh mesh;
+  mesh.SetName("shapes");
+  common::MaterialPtr material(new common::Material());
+  mesh.AddMaterial(material);
+  common::SkeletonPtr skeleton(new common::Skeleton());
+  mesh.SetSkeleton(skeleton);
+
+  common::SubMesh torus;
+  CreateTorus(32, 16, torus);
+  mesh.AddSubMesh(torus);
+
+  common::SubMesh lines;
+  lines.SetPrimitiveType(common::SubMesh::LINES);
+  lines.AddVertex(0, 0, 0);
+  lines.AddVertex(1, 0, 0);
+  lines.AddIndex(0);
+  lines.AddIndex(1);
+  mesh.AddSubMesh(lines);
+
+  double error = -1.0;
+  std::unique_ptr<common::Mesh> simplified(
+      common::MeshSimplifier::Simplify(mesh, 0.25,
+        std::numeric_limits<double>::infinity(), &error));
+  ASSERT_NE(nullptr, simplified);
+  EXPECT_EQ("shapes", simplified->Name());
+  EXPECT_EQ(material, simplified->MaterialByIndex(0));
+  EXPECT_EQ(skeleton, simplified->MeshSkeleton());
+  EXPECT_GT(error, 0.0);
+
+  ASSERT_EQ(2u, simplified->SubMeshCount());
+  EXPECT_EQ(256u, simplified->SubMeshByIndex(0).lock()->IndexCount() / 3);
+  EXPECT_EQ(2u, simplified->SubMeshByIndex(1).lock()->IndexCount());
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -153,6 +153,88 @@ TEST_F(MeshTest, Mesh)
   EXPECT_EQ(indices[0], submesh.lock()->Index(0));
 }
 
+/////////////////////////////////////////////////
+TEST_F(MeshTest, FillBuffers)
+{
+  common::Mesh mesh;
+  common::SubMesh submesh;
+  submesh.AddVertex(0, 0, 0);
+  submesh.AddVertex(1, 0, 0);
+  submesh.AddVertex(0, 1, 0);
+  submesh.AddIndex(0);
+  submesh.AddIndex(1);
+  submesh.AddIndex(2);
+  mesh.AddSubMesh(submesh);
+
+  submesh.Translate(math::Vector3d(0, 0, 1));
+  submesh.AddIndex(0);
+  submesh.AddIndex(2);
+  submesh.AddIndex(1);
+  mesh.AddSubMesh(submesh);
+
+  // A submesh without vertices adds nothing
+  mesh.AddSubMesh(common::SubMesh());
+
+  ASSERT_EQ(6u, mesh.VertexCount());
+  ASSERT_EQ(9u, mesh.IndexCount());
+
+  std::vector<float> vertices(18);
+  std::vector<uint16_t> indices(9);
+  EXPECT_TRUE(mesh.FillBuffers(common::Span<float>(vertices),
+        common::Span<uint16_t>(indices)));
+  EXPECT_EQ(std::vector<uint16_t>({0, 1, 2, 3, 4, 5, 3, 5, 4}), indices);
+  EXPECT_FLOAT_EQ(1.0f, vertices[3]);
+  EXPECT_FLOAT_EQ(0.0f, vertices[8]);
+  EXPECT_FLOAT_EQ(1.0f, vertices[17]);
+
+  // The same as FillArrays
+  double *arrVertices = nullptr;
+  int *arrIndices = nullptr;
+  mesh.FillArrays(&arrVertices, &arrIndices);
+  for (unsigned int i = 0; i < 18; ++i)
+    EXPECT_FLOAT_EQ(static_cast<float>(arrVertices[i]), vertices[i]);
+  for (unsigned int i = 0; i < 9; ++i)
+    EXPECT_EQ(arrIndices[i], indices[i]);
+  delete [] arrVertices;
+  delete [] arrIndices;
+
+  // FillArrays rounds the positions to float, FillBuffers keeps doubles
+  common::Mesh precise;
+  common::SubMesh third;
+  third.AddVertex(0.1, 0.2, 0.3);
+  third.AddIndex(0);
+  precise.AddSubMesh(third);
+  std::vector<double> doubles(3);
+  std::vector<int> ints(1);
+  EXPECT_TRUE(precise.FillBuffers(common::Span<double>(doubles),
+        common::Span<int>(ints)));
+  EXPECT_EQ(0.1, doubles[0]);
+  arrVertices = nullptr;
+  arrIndices = nullptr;
+  precise.FillArrays(&arrVertices, &arrIndices);
+  ASSERT_NE(nullptr, arrVertices);
+  EXPECT_EQ(static_cast<double>(0.1f), arrVertices[0]);
+  EXPECT_EQ(static_cast<double>(0.3f), arrVertices[2]);
+  delete [] arrVertices;
+  delete [] arrIndices;
+
+  EXPECT_FALSE(mesh.FillBuffers(common::Span<float>(vertices.data(), 17),
+        common::Span<uint16_t>(indices)));
+  EXPECT_FALSE(mesh.FillBuffers(common::Span<float>(vertices),
+        common::Span<uint16_t>(indices.data(), 8)));
+
+  // Indices that do not fit in an int
+  common::SubMesh large;
+  large.AddVertex(0, 0, 0);
+  large.AddIndex(3000000000u);
+  mesh.AddSubMesh(large);
+  arrVertices = new double[3];
+  arrIndices = new int[1];
+  mesh.FillArrays(&arrVertices, &arrIndices);
+  EXPECT_EQ(nullptr, arrVertices);
+  EXPECT_EQ(nullptr, arrIndices);
+}
+
 /////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
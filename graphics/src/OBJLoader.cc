@@ -15,17 +15,28 @@
  *
  */
 
+#include <algorithm>
+#include <array>
+#include <map>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "ignition/common/Console.hh"
 #include "ignition/common/Material.hh"
 #include "ignition/common/Mesh.hh"
 #include "ignition/common/SubMesh.hh"
 #include "ignition/common/OBJLoader.hh"
+#include "ignition/common/WorkerPool.hh"
 
 #define IGNITION_COMMON_TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
+#include "MappedFile.hh"
+#include "TextParser.hh"
+
 namespace ignition
 {
   namespace common
@@ -41,6 +52,545 @@ namespace ignition
 using namespace ignition;
 using namespace common;
 
+namespace
+{
+  /// \brief Size of the chunks of lines parsed per task
+  const std::size_t ChunkSize = 1 << 20;
+
+  /// \brief Kinds of OBJ lines
+  enum class Line
+  {
+    /// \brief A vertex position, "v"
+    VERTEX,
+
+    /// \brief A vertex normal, "vn"
+    NORMAL,
+
+    /// \brief A texture coordinate, "vt"
+    TEXCOORD,
+
+    /// \brief A face, "f"
+    FACE,
+
+    /// \brief A material, "usemtl"
+    USEMTL,
+
+    /// \brief A material library, "mtllib"
+    MTLLIB,
+
+    /// \brief A group, "g"
+    GROUP,
+
+    /// \brief An object, "o"
+    OBJECT,
+
+    /// \brief Anything else, including the lines, tags and smoothing
+    /// groups that OBJLoader does not use
+    OTHER
+  };
+
+  /// \brief A line that changes the state of the parser, which is applied
+  /// in order after the chunks are parsed.
+  struct Statement
+  {
+    /// \brief Kind of line: USEMTL, MTLLIB, GROUP or OBJECT
+    Line type;
+
+    /// \brief Number of faces of the chunk before the line
+    std::size_t faces;
+
+    /// \brief Line number, from 1
+    std::size_t line;
+
+    /// \brief Text after the keyword
+    std::string text;
+  };
+
+  /// \brief Result of parsing a chunk of lines
+  struct Chunk
+  {
+    /// \brief Lines of the chunk
+    TextParser::Range range;
+
+    /// \brief Number of lines of the chunk
+    std::size_t lines = 0;
+
+    /// \brief Number of vertices, normals and texture coordinates
+    std::size_t counts[3] = {0, 0, 0};
+
+    /// \brief Faces, with zero based indices
+    std::vector<tinyobj::face_t> faces;
+
+    /// \brief Lines that change the state of the parser
+    std::vector<Statement> statements;
+
+    /// \brief Greatest vertex, normal and texture coordinate indices
+    int greatest[3] = {-1, -1, -1};
+
+    /// \brief Line of the first invalid face, or 0
+    std::size_t error = 0;
+  };
+
+  /////////////////////////////////////////////////
+  /// \brief Classify a line, like tinyobj::LoadObj does.
+  /// \param[in,out] _p Start of the line, moved after the keyword and
+  /// leading spaces
+  /// \param[in] _end End of the line
+  /// \return Kind of the line
+  Line Classify(const char *&_p, const char *_end)
+  {
+    while (_p < _end && (*_p == ' ' || *_p == '\t'))
+      ++_p;
+
+    // The keyword must be followed by a space or a tab
+    auto keyword = [&](const char *_word, const std::size_t _length)
+    {
+      return static_cast<std::size_t>(_end - _p) > _length &&
+        std::equal(_word, _word + _length, _p) &&
+        (_p[_length] == ' ' || _p[_length] == '\t');
+    };
+
+    Line type = Line::OTHER;
+    std::size_t length = 0;
+    if (keyword("v", 1))
+    {
+      type = Line::VERTEX;
+      length = 1;
+    }
+    else if (keyword("vn", 2))
+    {
+      type = Line::NORMAL;
+      length = 2;
+    }
+    else if (keyword("vt", 2))
+    {
+      type = Line::TEXCOORD;
+      length = 2;
+    }
+    else if (keyword("f", 1))
+    {
+      type = Line::FACE;
+      length = 1;
+    }
+    else if (keyword("usemtl", 6))
+    {
+      type = Line::USEMTL;
+      length = 6;
+    }
+    else if (keyword("mtllib", 6))
+    {
+      type = Line::MTLLIB;
+      length = 6;
+    }
+    else if (keyword("g", 1))
+    {
+      type = Line::GROUP;
+      length = 1;
+    }
+    else if (keyword("o", 1))
+    {
+      type = Line::OBJECT;
+      length = 1;
+    }
+    _p += length + (type == Line::OTHER ? 0 : 1);
+    return type;
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Parse the next field of a line as a number, like tinyobj's
+  /// parseReal.
+  /// \param[in,out] _p Current position, moved after the field
+  /// \param[in] _end End of the line
+  /// \param[in] _default Value of missing or invalid fields
+  /// \return The number
+  tinyobj::real_t ParseReal(const char *&_p, const char *_end,
+      const double _default)
+  {
+    const char *number = _p;
+    double value;
+    if (!TextParser::ParseDouble(number, _end, value))
+      value = _default;
+    TextParser::Word(_p, _end);
+    return static_cast<tinyobj::real_t>(value);
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Parse an index of a face and make it zero based, like
+  /// tinyobj's fixIndex.
+  /// \param[in,out] _p Current position, moved after the index
+  /// \param[in] _end End of the line
+  /// \param[in] _count Number of elements before the face, for negative
+  /// indices which are relative to the end
+  /// \param[out] _index The zero based index
+  /// \return False if the index is missing or zero
+  bool ParseIndex(const char *&_p, const char *_end,
+      const std::size_t _count, int &_index)
+  {
+    int value;
+    if (!TextParser::ParseInt(_p, _end, value) || value == 0)
+      return false;
+    _index = value > 0 ? value - 1 : static_cast<int>(_count) + value;
+
+    // Skip what follows the digits, up to the next separator
+    while (_p < _end && *_p != '/' && *_p != ' ' && *_p != '\t' &&
+           *_p != '\r')
+    {
+      ++_p;
+    }
+    return true;
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Parse a corner of a face: "v", "v/vt", "v//vn" or "v/vt/vn".
+  /// \param[in,out] _p Current position, moved after the corner
+  /// \param[in] _end End of the line
+  /// \param[in] _counts Number of vertices, normals and texture
+  /// coordinates before the face
+  /// \param[out] _corner The zero based indices
+  /// \return False if an index is invalid
+  bool ParseCorner(const char *&_p, const char *_end,
+      const std::size_t _counts[3], tinyobj::vertex_index_t &_corner)
+  {
+    _corner = tinyobj::vertex_index_t(-1);
+    if (!ParseIndex(_p, _end, _counts[0], _corner.v_idx))
+      return false;
+    if (_p == _end || *_p != '/')
+      return true;
+
+    ++_p;
+    if (_p < _end && *_p == '/')
+    {
+      ++_p;
+      return ParseIndex(_p, _end, _counts[1], _corner.vn_idx);
+    }
+
+    if (!ParseIndex(_p, _end, _counts[2], _corner.vt_idx))
+      return false;
+    if (_p == _end || *_p != '/')
+      return true;
+
+    ++_p;
+    return ParseIndex(_p, _end, _counts[1], _corner.vn_idx);
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Get the text after a keyword, without the end of line.
+  /// \param[in] _p Start of the text
+  /// \param[in] _end End of the line
+  /// \return The text
+  std::string Rest(const char *_p, const char *_end)
+  {
+    while (_end > _p && (_end[-1] == '\r' || _end[-1] == '\n'))
+      --_end;
+    return std::string(_p, _end);
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Load an OBJ file into the structures of tinyobj, with the same
+  /// result as tinyobj::LoadObj with triangulation, except that lines,
+  /// tags, smoothing groups and vertex colors, which OBJLoader does not
+  /// use, are ignored.
+  ///
+  /// The file is split into chunks of lines. A first parallel pass counts
+  /// the vertices, normals and texture coordinates of each chunk, so that
+  /// a second parallel pass parses them straight into their arrays, and
+  /// resolves the relative indices of faces. The faces are then grouped
+  /// into shapes in order, on one thread, which is cheap since they are
+  /// already parsed.
+  /// \param[in] _data Content of the file
+  /// \param[in] _size Size of the file
+  /// \param[in] _path Directory of the material files
+  /// \param[out] _attrib Vertices, normals and texture coordinates
+  /// \param[out] _shapes Shapes
+  /// \param[out] _materials Materials
+  /// \param[out] _warn Warnings
+  /// \param[out] _err Errors
+  /// \return False on error
+  bool LoadObj(const char *_data, const std::size_t _size,
+      const std::string &_path, tinyobj::attrib_t &_attrib,
+      std::vector<tinyobj::shape_t> &_shapes,
+      std::vector<tinyobj::material_t> &_materials, std::string &_warn,
+      std::string &_err)
+  {
+    std::vector<Chunk> chunks;
+    for (const auto &range : TextParser::SplitLines(_data, _size, ChunkSize))
+    {
+      chunks.emplace_back();
+      chunks.back().range = range;
+    }
+
+    // Count the lines of each kind
+    WorkerPool::Shared().ParallelFor(0, chunks.size(), 1,
+        [&](const std::size_t _first, const std::size_t _last)
+    {
+      for (std::size_t c = _first; c < _last; ++c)
+      {
+        Chunk &chunk = chunks[c];
+        const char *end = chunk.range.second;
+        for (const char *line = chunk.range.first; line < end;)
+        {
+          const char *lineEnd = TextParser::LineEnd(line, end);
+          const Line type = Classify(line, lineEnd);
+          if (type <= Line::TEXCOORD)
+            ++chunk.counts[static_cast<int>(type)];
+          ++chunk.lines;
+          line = TextParser::NextLine(lineEnd, end);
+        }
+      }
+    });
+
+    std::vector<std::size_t> firstLines(chunks.size());
+    std::vector<std::array<std::size_t, 3>> offsets(chunks.size());
+    std::size_t lines = 0;
+    std::size_t totals[3] = {0, 0, 0};
+    for (std::size_t c = 0; c < chunks.size(); ++c)
+    {
+      firstLines[c] = lines;
+      lines += chunks[c].lines;
+      for (int k = 0; k < 3; ++k)
+      {
+        offsets[c][k] = totals[k];
+        totals[k] += chunks[c].counts[k];
+      }
+    }
+    _attrib.vertices.resize(totals[0] * 3);
+    _attrib.normals.resize(totals[1] * 3);
+    _attrib.texcoords.resize(totals[2] * 2);
+
+    // Parse the lines
+    WorkerPool::Shared().ParallelFor(0, chunks.size(), 1,
+        [&](const std::size_t _first, const std::size_t _last)
+    {
+      for (std::size_t c = _first; c < _last; ++c)
+      {
+        Chunk &chunk = chunks[c];
+        std::size_t counts[3] = {offsets[c][0], offsets[c][1], offsets[c][2]};
+        std::size_t lineNumber = firstLines[c];
+        const char *end = chunk.range.second;
+        for (const char *line = chunk.range.first; line < end;)
+        {
+          const char *lineEnd = TextParser::LineEnd(line, end);
+          const char *p = line;
+          line = TextParser::NextLine(lineEnd, end);
+          ++lineNumber;
+
+          const Line type = Classify(p, lineEnd);
+          switch (type)
+          {
+            case Line::VERTEX:
+            case Line::NORMAL:
+            {
+              auto &values = type == Line::VERTEX ?
+                _attrib.vertices : _attrib.normals;
+              std::size_t &count = counts[static_cast<int>(type)];
+              for (int i = 0; i < 3; ++i)
+                values[count * 3 + i] = ParseReal(p, lineEnd, 0.0);
+              ++count;
+              break;
+            }
+            case Line::TEXCOORD:
+            {
+              for (int i = 0; i < 2; ++i)
+                _attrib.texcoords[counts[2] * 2 + i] =
+                  ParseReal(p, lineEnd, 0.0);
+              ++counts[2];
+              break;
+            }
+            case Line::FACE:
+            {
+              chunk.faces.emplace_back();
+              auto &corners = chunk.faces.back().vertex_indices;
+              corners.reserve(3);
+              TextParser::SkipSpaces(p, lineEnd);
+              while (p < lineEnd)
+              {
+                tinyobj::vertex_index_t corner;
+                if (!ParseCorner(p, lineEnd, counts, corner))
+                {
+                  if (chunk.error == 0)
+                    chunk.error = lineNumber;
+                  break;
+                }
+                chunk.greatest[0] = std::max(chunk.greatest[0], corner.v_idx);
+                chunk.greatest[1] =
+                  std::max(chunk.greatest[1], corner.vn_idx);
+                chunk.greatest[2] =
+                  std::max(chunk.greatest[2], corner.vt_idx);
+                corners.push_back(corner);
+                TextParser::SkipSpaces(p, lineEnd);
+              }
+              break;
+            }
+            case Line::USEMTL:
+            case Line::MTLLIB:
+            case Line::GROUP:
+            case Line::OBJECT:
+            {
+              chunk.statements.push_back(
+                  {type, chunk.faces.size(), lineNumber, Rest(p, lineEnd)});
+              break;
+            }
+            case Line::OTHER:
+            default:
+              break;
+          }
+        }
+      }
+    });
+
+    for (const Chunk &chunk : chunks)
+    {
+      if (chunk.error != 0)
+      {
+        std::stringstream ss;
+        ss << "Failed parse `f' line(e.g. zero value for face index. line "
+           << chunk.error << ".)\n";
+        _err += ss.str();
+        return false;
+      }
+    }
+
+    // Group the faces into shapes, in order, as tinyobj::LoadObj does
+    std::string baseDir = _path;
+    if (!baseDir.empty())
+    {
+#ifndef _WIN32
+      const char dirsep = '/';
+#else
+      const char dirsep = '\\';
+#endif
+      if (baseDir.back() != dirsep)
+        baseDir += dirsep;
+    }
+    tinyobj::MaterialFileReader readMaterials(baseDir);
+    std::map<std::string, int> materialMap;
+    int material = -1;
+    std::string name;
+    std::vector<tinyobj::face_t> faceGroup;
+    std::vector<int> lineGroup;
+    const std::vector<tinyobj::tag_t> tags;
+    tinyobj::shape_t shape;
+    int greatest[3] = {-1, -1, -1};
+
+    for (Chunk &chunk : chunks)
+    {
+      for (int k = 0; k < 3; ++k)
+        greatest[k] = std::max(greatest[k], chunk.greatest[k]);
+
+      std::size_t face = 0;
+      auto addFaces = [&](const std::size_t _last)
+      {
+        for (; face < _last; ++face)
+          faceGroup.push_back(std::move(chunk.faces[face]));
+      };
+
+      for (const Statement &statement : chunk.statements)
+      {
+        addFaces(statement.faces);
+        if (statement.type == Line::USEMTL)
+        {
+          auto iter = materialMap.find(statement.text);
+          const int newMaterial =
+            iter != materialMap.end() ? iter->second : -1;
+          if (newMaterial != material)
+          {
+            tinyobj::exportGroupsToShape(&shape, faceGroup, lineGroup, tags,
+                material, name, true, _attrib.vertices);
+            faceGroup.clear();
+            material = newMaterial;
+          }
+        }
+        else if (statement.type == Line::MTLLIB)
+        {
+          std::vector<std::string> filenames;
+          tinyobj::SplitString(statement.text, ' ', filenames);
+          bool found = false;
+          for (const std::string &filename : filenames)
+          {
+            std::string warnMtl;
+            std::string errMtl;
+            found = readMaterials(filename.c_str(), &_materials,
+                &materialMap, &warnMtl, &errMtl);
+            _warn += warnMtl;
+            _err += errMtl;
+            if (found)
+              break;
+          }
+          if (filenames.empty())
+          {
+            std::stringstream ss;
+            ss << "Looks like empty filename for mtllib. Use default "
+                  "material (line " << statement.line << ".)\n";
+            _warn += ss.str();
+          }
+          else if (!found)
+          {
+            _warn += "Failed to load material file(s). Use default "
+                     "material.\n";
+          }
+        }
+        else if (statement.type == Line::GROUP)
+        {
+          tinyobj::exportGroupsToShape(&shape, faceGroup, lineGroup, tags,
+              material, name, true, _attrib.vertices);
+          if (!shape.mesh.indices.empty())
+            _shapes.push_back(shape);
+          shape = tinyobj::shape_t();
+          faceGroup.clear();
+
+          std::vector<std::string> names;
+          std::istringstream stream(statement.text);
+          for (std::string word; stream >> word;)
+            names.push_back(word);
+          if (names.empty())
+          {
+            std::stringstream ss;
+            ss << "Empty group name. line: " << statement.line << "\n";
+            _warn += ss.str();
+          }
+          name.clear();
+          for (std::size_t i = 0; i < names.size(); ++i)
+            name += (i > 0 ? " " : "") + names[i];
+        }
+        else if (statement.type == Line::OBJECT)
+        {
+          if (tinyobj::exportGroupsToShape(&shape, faceGroup, lineGroup,
+                tags, material, name, true, _attrib.vertices))
+          {
+            _shapes.push_back(shape);
+          }
+          faceGroup.clear();
+          shape = tinyobj::shape_t();
+          name = statement.text;
+        }
+      }
+      addFaces(chunk.faces.size());
+      chunk.faces.clear();
+    }
+
+    const char *kinds[3] = {"Vertex", "Vertex normal", "Vertex texcoord"};
+    for (int k = 0; k < 3; ++k)
+    {
+      if (greatest[k] >= static_cast<int>(totals[k]))
+      {
+        std::stringstream ss;
+        ss << kinds[k] << " indices out of bounds (line " << lines
+           << ".)\n" << std::endl;
+        _warn += ss.str();
+      }
+    }
+
+    if (tinyobj::exportGroupsToShape(&shape, faceGroup, lineGroup, tags,
+          material, name, true, _attrib.vertices) ||
+        !shape.mesh.indices.empty())
+    {
+      _shapes.push_back(shape);
+    }
+
+    return true;
+  }
+}
+
 //////////////////////////////////////////////////
 OBJLoader::OBJLoader()
 : MeshLoader(), dataPtr(new OBJLoaderPrivate)
@@ -66,13 +616,17 @@ Mesh *OBJLoader::Load(const std::string &_filename)
   std::vector<tinyobj::shape_t> shapes;
   std::vector<tinyobj::material_t> materials;
 
-  // convert polygons to triangles
-  bool triangulate = true;
-
   std::string warn;
   std::string err;
-  bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err,
-      _filename.c_str(), path.c_str(), triangulate);
+  bool ret = false;
+  MappedFile file(_filename);
+  if (!file.Valid())
+    err = "Cannot open file [" + _filename + "]\n";
+  else
+  {
+    ret = LoadObj(file.Data(), file.Size(), path, attrib, shapes,
+        materials, warn, err);
+  }
 
   if (!warn.empty())
   {
@@ -16,7 +16,15 @@
 */
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <ignition/math/Helpers.hh>
+
 #include "test_config.h"
+#include "ignition/common/Filesystem.hh"
 #include "ignition/common/Mesh.hh"
 #include "ignition/common/SubMesh.hh"
 #include "ignition/common/Material.hh"
@@ -60,6 +68,119 @@ TEST_F(OBJLoaderTest, LoadObjBox)
   EXPECT_DOUBLE_EQ(mat->Transparency(), 0.0);
 }
 
+/////////////////////////////////////////////////
+TEST_F(OBJLoaderTest, LoadObjChunks)
+{
+  const std::string path =
+    common::joinPaths(common::cwd(), "tmp", "obj_loader");
+  common::createDirectories(path);
+  common::copyFile(
+      std::string(PROJECT_SOURCE_PATH) + "/test/data/box.mtl",
+      common::joinPaths(path, "box.mtl"));
+
+  // Two objects of strips of quads, large enough to be parsed in several
+  // chunks, with relative indices and a locale independent format.
+  const int size = 20000;
+  std::string content = "mtllib box.mtl\n";
+  for (int o = 0; o < 2; ++o)
+  {
+    content += "o strip" + std::to_string(o) + "\n";
+    for (int i = 0; i <= size; ++i)
+    {
+      content += "v " + std::to_string(i) + ".25 " + std::to_string(o) +
+        " -1.5e-1\n";
+      content += "v " + std::to_string(i) + ".25 " + std::to_string(o) +
+        " 0.5\r\n";
+      content += "vt 0.25 .5\n";
+    }
+    content += "usemtl Material-material\n";
+    for (int i = 0; i < size; ++i)
+    {
+      const int first = -2 * (size + 1) + 2 * i;
+      content += "f " + std::to_string(first) + "/1 " +
+        std::to_string(first + 2) + "/1 " + std::to_string(first + 3) +
+        "/1 " + std::to_string(first + 1) + "/1\n";
+    }
+  }
+  ASSERT_GT(content.size(), 2u << 20);
+  const std::string filename = common::joinPaths(path, "strips.obj");
+  std::ofstream(filename, std::ios::binary) << content;
+
+  common::OBJLoader loader;
+  std::unique_ptr<common::Mesh> mesh(loader.Load(filename));
+  ASSERT_NE(nullptr, mesh);
+  ASSERT_EQ(2u, mesh->SubMeshCount());
+  EXPECT_EQ(1u, mesh->MaterialCount());
+  for (unsigned int o = 0; o < 2; ++o)
+  {
+    auto subMesh = mesh->SubMeshByIndex(o).lock();
+    EXPECT_EQ("strip" + std::to_string(o), subMesh->Name());
+    ASSERT_EQ(6u * size, subMesh->VertexCount());
+    ASSERT_EQ(6u * size, subMesh->TexCoordCount());
+    EXPECT_EQ(0u, subMesh->NormalCount());
+    for (unsigned int v = 0; v < subMesh->VertexCount(); ++v)
+    {
+      const math::Vector3d vertex = subMesh->Vertex(v);
+      EXPECT_DOUBLE_EQ(0.25, vertex.X() - std::floor(vertex.X()));
+      EXPECT_DOUBLE_EQ(o, vertex.Y());
+      EXPECT_TRUE(math::equal(-0.15, vertex.Z(), 1e-6) ||
+          math::equal(0.5, vertex.Z(), 1e-6));
+      EXPECT_EQ(math::Vector2d(0.25, 0.5), subMesh->TexCoord(v));
+    }
+    EXPECT_DOUBLE_EQ(size + 0.25, subMesh->Max().X());
+  }
+
+  common::removeAll(path);
+}
+
+/////////////////////////////////////////////////
+TEST_F(OBJLoaderTest, LineEndings)
+{
+  const std::string path =
+    common::joinPaths(common::cwd(), "tmp", "obj_loader");
+  common::createDirectories(path);
+  common::copyFile(
+      std::string(PROJECT_SOURCE_PATH) + "/test/data/box.mtl",
+      common::joinPaths(path, "box.mtl"));
+  const std::string filename = common::joinPaths(path, "endings.obj");
+
+  // Lines end with "\n", "\r\n" or a lone "\r", as in old Mac files
+  std::ofstream(filename, std::ios::binary)
+    << "mtllib box.mtl\ro tri\rv 0 0 0\rv 1 0 0\r\nv 0 1 0\n\r\nvt 0.5 0.25\r"
+    << "usemtl Material-material\rf 1/1 2/1 3/1\r";
+
+  common::OBJLoader loader;
+  std::unique_ptr<common::Mesh> mesh(loader.Load(filename));
+  ASSERT_NE(nullptr, mesh);
+  ASSERT_EQ(1u, mesh->SubMeshCount());
+  auto subMesh = mesh->SubMeshByIndex(0).lock();
+  EXPECT_EQ("tri", subMesh->Name());
+  ASSERT_EQ(3u, subMesh->VertexCount());
+  EXPECT_EQ(math::Vector3d(1, 0, 0), subMesh->Vertex(1));
+  EXPECT_EQ(math::Vector3d(0, 1, 0), subMesh->Vertex(2));
+  ASSERT_EQ(3u, subMesh->TexCoordCount());
+  EXPECT_EQ(math::Vector2d(0.5, 0.75), subMesh->TexCoord(2));
+  EXPECT_EQ(1u, mesh->MaterialCount());
+
+  common::removeAll(path);
+}
+
+/////////////////////////////////////////////////
+TEST_F(OBJLoaderTest, InvalidFace)
+{
+  const std::string path =
+    common::joinPaths(common::cwd(), "tmp", "obj_loader");
+  common::createDirectories(path);
+  const std::string filename = common::joinPaths(path, "invalid.obj");
+  std::ofstream(filename) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 0 3\n";
+
+  // Index 0 is not allowed
+  common::OBJLoader loader;
+  EXPECT_EQ(nullptr, loader.Load(filename));
+
+  common::removeAll(path);
+}
+
 /////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -17,20 +17,150 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "ignition/math/Helpers.hh"
 #include "ignition/common/Console.hh"
 #include "ignition/common/Mesh.hh"
 #include "ignition/common/SubMesh.hh"
 #include "ignition/common/STLLoader.hh"
+#include "ignition/common/WorkerPool.hh"
+
+#include "MappedFile.hh"
+#include "TextParser.hh"
+#include "VertexHash.hh"
 
 using namespace ignition;
 using namespace common;
 
+/// \brief Private data for STLLoader
+class ignition::common::STLLoaderPrivate
+{
+  /// \brief True to merge identical corners of binary files
+  public: bool weld = false;
+};
+
+namespace
+{
+  /// \brief Size of the header of binary files: 80 bytes of text followed
+  /// by the number of triangles.
+  const std::size_t HeaderSize = 84;
+
+  /// \brief Size of a triangle record of binary files: the normal, the
+  /// three corners, and a 2 byte attribute.
+  const std::size_t RecordSize = 50;
+
+  /// \brief Number of triangles decoded per task
+  const std::size_t TrianglesPerTask = 16384;
+
+  /// \brief Size of the chunks of lines of ASCII files parsed per task
+  const std::size_t AsciiChunkSize = 1 << 20;
+
+  /// \brief Largest difference per component between the corners of ASCII
+  /// files that share an index, as in SubMesh::IndexOfVertex.
+  const double VertexTolerance = 1e-6;
+
+  /////////////////////////////////////////////////
+  /// \brief Get the number of triangles announced by a binary file.
+  /// \param[in] _data Content of the file, at least HeaderSize bytes
+  /// \return The number of triangles
+  uint32_t TriangleCount(const char *_data)
+  {
+    uint32_t count;
+    std::memcpy(&count, _data + 80, sizeof(count));
+    return count;
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Get the position of a corner of a binary file.
+  /// \param[in] _records First triangle record
+  /// \param[in] _corner Index of the corner, three per triangle
+  /// \return Pointer to the three floats of the position
+  const char *CornerPosition(const char *_records, const std::size_t _corner)
+  {
+    return _records + (_corner / 3) * RecordSize + 12 + (_corner % 3) * 12;
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Get the normal of a corner of a binary file.
+  /// \param[in] _records First triangle record
+  /// \param[in] _corner Index of the corner, three per triangle
+  /// \return Pointer to the three floats of the normal
+  const char *CornerNormal(const char *_records, const std::size_t _corner)
+  {
+    return _records + (_corner / 3) * RecordSize;
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Get whether two corners have the same position and normal,
+  /// bit for bit.
+  /// \param[in] _records First triangle record
+  /// \param[in] _a Index of the first corner
+  /// \param[in] _b Index of the second corner
+  /// \return True if the corners are identical
+  bool SameCorner(const char *_records, const std::size_t _a,
+      const std::size_t _b)
+  {
+    return std::memcmp(CornerPosition(_records, _a),
+        CornerPosition(_records, _b), 12) == 0 &&
+      std::memcmp(CornerNormal(_records, _a),
+        CornerNormal(_records, _b), 12) == 0;
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Hash the position and normal of a corner.
+  /// \param[in] _records First triangle record
+  /// \param[in] _corner Index of the corner
+  /// \return The hash
+  uint64_t HashCorner(const char *_records, const std::size_t _corner)
+  {
+    uint32_t words[6];
+    std::memcpy(words, CornerPosition(_records, _corner), 12);
+    std::memcpy(words + 3, CornerNormal(_records, _corner), 12);
+    uint64_t hash = 14695981039346656037ULL;
+    for (const uint32_t word : words)
+      hash = (hash ^ word) * 1099511628211ULL;
+    return hash ^ (hash >> 32);
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Convert three floats of a binary file to doubles.
+  /// \param[in] _data Pointer to the floats
+  /// \param[out] _values The three values
+  void ReadVector(const char *_data, double *_values)
+  {
+    float values[3];
+    std::memcpy(values, _data, sizeof(values));
+    _values[0] = values[0];
+    _values[1] = values[1];
+    _values[2] = values[2];
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Copy vectors to an array of values, three per vector.
+  /// \param[in] _vectors The vectors
+  /// \param[out] _values The first value to write
+  void WriteVectors(const std::vector<math::Vector3d> &_vectors,
+      double *_values)
+  {
+    for (const auto &v : _vectors)
+    {
+      *_values++ = v.X();
+      *_values++ = v.Y();
+      *_values++ = v.Z();
+    }
+  }
+}
+
 //////////////////////////////////////////////////
 STLLoader::STLLoader()
-: MeshLoader()
+: MeshLoader(), dataPtr(new STLLoaderPrivate)
 {
 }
 
@@ -42,9 +172,9 @@ STLLoader::~STLLoader()
 //////////////////////////////////////////////////
 Mesh *STLLoader::Load(const std::string &_filename)
 {
-  FILE *file = fopen(_filename.c_str(), "r");
+  MappedFile file(_filename);
 
-  if (!file)
+  if (!file.Valid())
   {
     ignerr << "Unable to open file[" << _filename << "]\n";
     return nullptr;
@@ -52,203 +182,306 @@ Mesh *STLLoader::Load(const std::string &_filename)
 
   Mesh *mesh = new Mesh();
 
-  // Try to read ASCII first. If that fails, try binary
-  if (!this->ReadAscii(file, mesh))
+  // A binary file holds exactly one record per triangle after its header.
+  // Checking the size tells it apart from an ASCII file without parsing
+  // it, even if its header starts with "solid" like ASCII files do.
+  if (file.Size() >= HeaderSize &&
+      (file.Size() - HeaderSize) / RecordSize == TriangleCount(file.Data()) &&
+      (file.Size() - HeaderSize) % RecordSize == 0)
   {
-    fclose(file);
-    file = fopen(_filename.c_str(), "rb");
-    if (!this->ReadBinary(file, mesh))
+    if (!this->ReadBinary(file.Data(), file.Size(), mesh))
       ignerr << "Unable to read STL[" << _filename << "]\n";
+    return mesh;
+  }
+
+  // Try to read ASCII first. If that fails, try binary
+  if (!this->ReadAscii(file.Data(), file.Size(), mesh) &&
+      !this->ReadBinary(file.Data(), file.Size(), mesh))
+  {
+    ignerr << "Unable to read STL[" << _filename << "]\n";
   }
 
-  fclose(file);
   return mesh;
 }
 
 //////////////////////////////////////////////////
-bool STLLoader::ReadAscii(FILE *_filein, Mesh *_mesh)
+void STLLoader::SetWeldVertices(const bool _weld)
 {
-  int count;
-  char *next;
-  float r1;
-  float r2;
-  float r3;
-  float r4;
-  char token[LINE_MAX_LEN];
-  int width;
-  char input[LINE_MAX_LEN];
-  bool result = true;
-
-  SubMesh subMesh;
-
-  // Read the next line of the file into INPUT.
-  while (fgets (input, LINE_MAX_LEN, _filein) != nullptr)
-  {
-    // Advance to the first nonspace character in INPUT.
-    for (next = input; *next != '\0' && iswspace(*next); ++next)
-    {
-    }
+  this->dataPtr->weld = _weld;
+}
 
-    // Skip blank lines and comments.
-    if (*next == '\0' || *next == '#' || *next == '!' || *next == '$')
-      continue;
+//////////////////////////////////////////////////
+bool STLLoader::WeldVertices() const
+{
+  return this->dataPtr->weld;
+}
 
-    // Extract the first word in this line.
-    // cppcheck-suppress invalidscanf
-    sscanf(next, "%s%n", token, &width);
+//////////////////////////////////////////////////
+bool STLLoader::ReadAscii(const char *_data, const std::size_t _size,
+    Mesh *_mesh)
+{
+  // Corners parsed from a chunk of lines
+  struct Chunk
+  {
+    // Positions of the corners
+    std::vector<math::Vector3d> vertices;
 
-    // Set NEXT to point to just after this token.
-    next = next + width;
+    // Normals of the corners
+    std::vector<math::Vector3d> normals;
 
-    // FACET
-    if (this->Leqi(token, const_cast<char*>("facet")))
-    {
-      ignition::math::Vector3d normal;
+    // Number of corners before the first facet of the chunk, whose normal
+    // comes from an earlier chunk
+    std::size_t leading = 0;
 
-      // Get the XYZ coordinates of the normal vector to the face.
-      sscanf(next, "%*s %e %e %e", &r1, &r2, &r3);
+    // True if the chunk has a facet
+    bool facet = false;
 
-      normal.X(r1);
-      normal.Y(r2);
-      normal.Z(r3);
+    // Normal of the last facet of the chunk
+    math::Vector3d normal;
 
-      if (fgets (input, LINE_MAX_LEN, _filein) == nullptr)
-      {
-        result = false;
-        break;
-      }
+    // True if the chunk has an unrecognized line, where parsing stops
+    bool stop = false;
+  };
 
-      for (; result; )
+  std::vector<TextParser::Range> ranges =
+    TextParser::SplitLines(_data, _size, AsciiChunkSize);
+  std::vector<Chunk> chunks(ranges.size());
+
+  WorkerPool::Shared().ParallelFor(0, chunks.size(), 1,
+      [&](const std::size_t _first, const std::size_t _last)
+  {
+    for (std::size_t c = _first; c < _last; ++c)
+    {
+      Chunk &chunk = chunks[c];
+      const char *end = ranges[c].second;
+      for (const char *line = ranges[c].first; line < end && !chunk.stop;)
       {
-        ignition::math::Vector3d vertex;
-        if (fgets (input, LINE_MAX_LEN, _filein) == nullptr)
+        const char *lineEnd = TextParser::LineEnd(line, end);
+        const char *next = line;
+        line = TextParser::NextLine(lineEnd, end);
+
+        // Skip blank lines and comments.
+        TextParser::Range word = TextParser::Word(next, lineEnd);
+        if (word.first == word.second || *word.first == '#' ||
+            *word.first == '!' || *word.first == '$')
         {
-          result = false;
-          break;
+          continue;
         }
 
-        count = sscanf(input, "%*s %e %e %e", &r1, &r2, &r3);
-
-        if (count != 3)
-          break;
+        // Extract the first word in this line.
+        char token[16] = {0};
+        if (word.second - word.first < 16)
+          std::copy(word.first, word.second, token);
 
-        vertex.X(r1);
-        vertex.Y(r2);
-        vertex.Z(r3);
-
-        subMesh.AddVertex(vertex);
-        subMesh.AddNormal(normal);
-        subMesh.AddIndex(subMesh.IndexOfVertex(vertex));
-      }
-
-      if (fgets (input, LINE_MAX_LEN, _filein) == nullptr)
-      {
-        result = false;
-        break;
+        // FACET
+        if (this->Leqi(token, const_cast<char*>("facet")))
+        {
+          // Skip "normal", then get the XYZ coordinates of the normal. A
+          // malformed component is 0.
+          TextParser::Word(next, lineEnd);
+          float values[3] = {0, 0, 0};
+          for (float &value : values)
+          {
+            double number;
+            if (TextParser::ParseDouble(next, lineEnd, number))
+              value = static_cast<float>(number);
+          }
+          chunk.facet = true;
+          chunk.normal.Set(values[0], values[1], values[2]);
+        }
+        // VERTEX
+        else if (this->Leqi(token, const_cast<char*>("vertex")))
+        {
+          // Coordinates are read in single precision, as stored in binary
+          // files.
+          float values[3];
+          bool valid = true;
+          for (float &value : values)
+          {
+            double number = 0;
+            valid = valid && TextParser::ParseDouble(next, lineEnd, number);
+            value = static_cast<float>(number);
+          }
+          if (!valid)
+            continue;
+
+          chunk.vertices.push_back(
+              math::Vector3d(values[0], values[1], values[2]));
+          chunk.normals.push_back(chunk.normal);
+          if (!chunk.facet)
+            ++chunk.leading;
+        }
+        // Lines around the corners, and colors, which are ignored.
+        else if (!this->Leqi(token, const_cast<char*>("outer")) &&
+                 !this->Leqi(token, const_cast<char*>("endloop")) &&
+                 !this->Leqi(token, const_cast<char*>("endfacet")) &&
+                 !this->Leqi(token, const_cast<char*>("color")) &&
+                 !this->Leqi(token, const_cast<char*>("solid")) &&
+                 !this->Leqi(token, const_cast<char*>("endsolid")))
+        {
+          // Unexpected or unrecognized.
+          chunk.stop = true;
+        }
       }
     }
-    // COLOR
-    else if (this->Leqi (token, const_cast<char*>("color")))
-    {
-      sscanf(next, "%*s %f %f %f %f", &r1, &r2, &r3, &r4);
-    }
-    // SOLID
-    else if (this->Leqi (token, const_cast<char*>("solid")))
-    {
-    }
-    // ENDSOLID
-    else if (this->Leqi (token, const_cast<char*>("endsolid")))
-    {
-    }
-    // Unexpected or unrecognized.
-    else
+  });
+
+  // Merge the chunks up to the first unrecognized line. The corners at the
+  // start of a chunk get the normal of the last facet of earlier chunks.
+  std::size_t count = 0;
+  std::size_t used = 0;
+  math::Vector3d normal;
+  std::vector<std::size_t> offsets(chunks.size());
+  for (; used < chunks.size(); ++used)
+  {
+    Chunk &chunk = chunks[used];
+    std::fill(chunk.normals.begin(), chunk.normals.begin() + chunk.leading,
+        normal);
+    if (chunk.facet)
+      normal = chunk.normal;
+    offsets[used] = count;
+    count += chunk.vertices.size();
+    if (chunk.stop)
     {
-      /*printf("\n");
-      printf("stl - Fatal error!\n");
-      printf(" Unrecognized first word on line.\n");
-      */
-      result = false;
+      ++used;
       break;
     }
   }
 
-  result = subMesh.VertexCount() > 0;
+  if (count == 0)
+    return false;
+
+  std::unique_ptr<SubMesh> subMesh(new SubMesh());
+  subMesh->SetVertexCount(static_cast<unsigned int>(count));
+  subMesh->SetNormalCount(static_cast<unsigned int>(count));
+  subMesh->SetIndexCount(static_cast<unsigned int>(count));
+  auto positions = subMesh->MutableVertices();
+  auto normals = subMesh->MutableNormals();
+  auto indices = subMesh->MutableIndices();
 
-  if (result)
-    _mesh->AddSubMesh(subMesh);
+  WorkerPool::Shared().ParallelFor(0, used, 1,
+      [&](const std::size_t _first, const std::size_t _last)
+  {
+    for (std::size_t c = _first; c < _last; ++c)
+    {
+      WriteVectors(chunks[c].vertices, positions.data() + 3 * offsets[c]);
+      WriteVectors(chunks[c].normals, normals.data() + 3 * offsets[c]);
+    }
+  });
 
-  return result;
+  // Each corner keeps its own vertex, and is indexed to the first vertex
+  // at the same position, like SubMesh::IndexOfVertex does.
+  VertexHash<double> hash(VertexTolerance);
+  hash.Build(positions.data(), count);
+  auto position = [&](const std::size_t _v)
+  {
+    return math::Vector3d(positions[3 * _v], positions[3 * _v + 1],
+        positions[3 * _v + 2]);
+  };
+  WorkerPool::Shared().ParallelFor(0, count, TrianglesPerTask * 3,
+      [&](const std::size_t _first, const std::size_t _last)
+  {
+    for (std::size_t v = _first; v < _last; ++v)
+    {
+      uint32_t index = static_cast<uint32_t>(v);
+      const math::Vector3d vertex = position(v);
+      hash.ForEachNear(vertex, [&](const uint32_t _candidate)
+      {
+        if (_candidate < index && vertex.Equal(position(_candidate)))
+          index = _candidate;
+        return true;
+      });
+      indices[v] = index;
+    }
+  });
+
+  _mesh->AddSubMesh(std::move(subMesh));
+  return true;
 }
 
 //////////////////////////////////////////////////
-bool STLLoader::ReadBinary(FILE *_filein, Mesh *_mesh)
+bool STLLoader::ReadBinary(const char *_data, const std::size_t _size,
+    Mesh *_mesh)
 {
-  int i;
-  int iface;
-  int face_num;
-
-  SubMesh subMesh;
-
-  // 80 byte Header.
-  for (i = 0; i < 80; ++i)
-    fgetc(_filein);
-
-  // Number of faces.
-  face_num = this->LongIntRead(_filein);
-
-  ignition::math::Vector3d normal;
-  ignition::math::Vector3d vertex;
+  if (_size < HeaderSize)
+    return false;
 
-  // For each (triangular) face,
-  // components of normal vector,
-  // coordinates of three vertices,
-  // 2 byte "attribute".
-  for (iface = 0; iface < face_num; iface++)
+  const std::size_t triangles = TriangleCount(_data);
+  if ((_size - HeaderSize) / RecordSize < triangles ||
+      triangles > std::numeric_limits<unsigned int>::max() / 3)
   {
-    if (!this->FloatRead(_filein, normal.X()))
-      return false;
-    if (!this->FloatRead(_filein, normal.Y()))
-      return false;
-    if (!this->FloatRead(_filein, normal.Z()))
-      return false;
-
-    if (!this->FloatRead(_filein, vertex.X()))
-      return false;
-    if (!this->FloatRead(_filein, vertex.Y()))
-      return false;
-    if (!this->FloatRead(_filein, vertex.Z()))
-      return false;
+    return false;
+  }
 
-    subMesh.AddVertex(vertex);
-    subMesh.AddNormal(normal);
-    subMesh.AddIndex(subMesh.VertexCount()-1);
+  const char *records = _data + HeaderSize;
+  const std::size_t corners = triangles * 3;
+  std::unique_ptr<SubMesh> subMesh(new SubMesh());
 
-    if (!this->FloatRead(_filein, vertex.X()))
-      return false;
-    if (!this->FloatRead(_filein, vertex.Y()))
-      return false;
-    if (!this->FloatRead(_filein, vertex.Z()))
-      return false;
-    subMesh.AddVertex(vertex);
-    subMesh.AddNormal(normal);
-    subMesh.AddIndex(subMesh.VertexCount()-1);
+  // Vertex of each corner, and corner of each vertex. Without merging,
+  // each corner is its own vertex.
+  std::vector<unsigned int> cornerVertex;
+  std::vector<unsigned int> vertexCorner;
+  if (this->dataPtr->weld && corners > 0)
+  {
+    // Open addressing hash table of the first corner of each vertex
+    std::size_t tableSize = 1;
+    while (tableSize < 2 * corners)
+      tableSize *= 2;
+    const unsigned int empty = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> table(tableSize, empty);
+
+    cornerVertex.resize(corners);
+    vertexCorner.reserve(corners);
+    for (std::size_t c = 0; c < corners; ++c)
+    {
+      std::size_t slot = HashCorner(records, c) & (tableSize - 1);
+      while (table[slot] != empty &&
+             !SameCorner(records, vertexCorner[table[slot]], c))
+      {
+        slot = (slot + 1) & (tableSize - 1);
+      }
+      if (table[slot] == empty)
+      {
+        table[slot] = static_cast<unsigned int>(vertexCorner.size());
+        vertexCorner.push_back(static_cast<unsigned int>(c));
+      }
+      cornerVertex[c] = table[slot];
+    }
+  }
 
-    if (!this->FloatRead(_filein, vertex.X()))
-      return false;
-    if (!this->FloatRead(_filein, vertex.Y()))
-      return false;
-    if (!this->FloatRead(_filein, vertex.Z()))
-      return false;
-    subMesh.AddVertex(vertex);
-    subMesh.AddNormal(normal);
-    subMesh.AddIndex(subMesh.VertexCount()-1);
+  const std::size_t vertices =
+    vertexCorner.empty() ? corners : vertexCorner.size();
+  subMesh->SetVertexCount(static_cast<unsigned int>(vertices));
+  subMesh->SetNormalCount(static_cast<unsigned int>(vertices));
+  subMesh->SetIndexCount(static_cast<unsigned int>(corners));
+  auto positions = subMesh->MutableVertices();
+  auto normals = subMesh->MutableNormals();
+  auto indices = subMesh->MutableIndices();
+
+  // The records are decoded in parallel, straight into the arrays of the
+  // submesh.
+  WorkerPool::Shared().ParallelFor(0, vertices, TrianglesPerTask * 3,
+      [&](const std::size_t _first, const std::size_t _last)
+      {
+        for (std::size_t v = _first; v < _last; ++v)
+        {
+          const std::size_t c = vertexCorner.empty() ? v : vertexCorner[v];
+          ReadVector(CornerPosition(records, c), &positions[3 * v]);
+          ReadVector(CornerNormal(records, c), &normals[3 * v]);
+        }
+      });
 
-    uint16_t shortTmp;
-    if (!ShortIntRead(_filein, shortTmp))
-      return false;
+  if (cornerVertex.empty())
+  {
+    for (std::size_t c = 0; c < corners; ++c)
+      indices[c] = static_cast<unsigned int>(c);
+  }
+  else
+  {
+    std::copy(cornerVertex.begin(), cornerVertex.end(), indices.begin());
   }
 
-  _mesh->AddSubMesh(subMesh);
+  _mesh->AddSubMesh(std::move(subMesh));
   return true;
 }
 
@@ -312,47 +545,3 @@ int STLLoader::RcolFind(float _a[][COR3_MAX], int _m, int _n, float _r[])
 
   return icol;
 }
-
-//////////////////////////////////////////////////
-bool STLLoader::FloatRead(FILE *_filein, double &_value)
-{
-  float v;
-  if (fread (&v, sizeof(v), 1, _filein) == 0)
-    return false;
-
-  _value = v;
-  return true;
-}
-
-//////////////////////////////////////////////////
-uint32_t STLLoader::LongIntRead(FILE *_filein)
-{
-  union
-  {
-    uint32_t yint;
-    char ychar[4];
-  } y;
-
-  y.ychar[0] = fgetc(_filein);
-  y.ychar[1] = fgetc(_filein);
-  y.ychar[2] = fgetc(_filein);
-  y.ychar[3] = fgetc(_filein);
-
-  return y.yint;
-}
-
-//////////////////////////////////////////////////
-bool STLLoader::ShortIntRead(FILE *_filein, uint16_t &_value)
-{
-  uint8_t c1;
-  uint8_t c2;
-
-  c1 = fgetc(_filein);
-  c2 = fgetc(_filein);
-
-  _value = c1 | (c2 << 8);
-
-  return true;
-}
-
-
@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/common/Filesystem.hh"
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/STLLoader.hh"
+#include "ignition/common/SubMesh.hh"
+#include "test/util.hh"
+
+using namespace ignition;
+
+class STLLoader : public ignition::testing::AutoLogFixture
+{
+  /// \brief Create the output directory
+  public: void SetUp() override
+  {
+    ignition::testing::AutoLogFixture::SetUp();
+    this->path = common::joinPaths(common::cwd(), "tmp", "stl_loader");
+    common::createDirectories(this->path);
+  }
+
+  /// \brief Remove the output directory
+  public: void TearDown() override
+  {
+    common::removeAll(this->path);
+    ignition::testing::AutoLogFixture::TearDown();
+  }
+
+  /// \brief Write a file in the output directory.
+  /// \param[in] _name Name of the file
+  /// \param[in] _content Content of the file
+  /// \return Path to the file
+  public: std::string WriteFile(const std::string &_name,
+              const std::string &_content)
+  {
+    const std::string filename = common::joinPaths(this->path, _name);
+    std::ofstream file(filename, std::ios::binary);
+    file.write(_content.data(), _content.size());
+    return filename;
+  }
+
+  /// \brief Output directory
+  public: std::string path;
+};
+
+/////////////////////////////////////////////////
+/// \brief Append the bytes of a value to a string.
+/// \param[in] _value The value
+/// \param[out] _content The string
+template<typename T>
+void Append(const T _value, std::string &_content)
+{
+  char bytes[sizeof(T)];
+  std::memcpy(bytes, &_value, sizeof(T));
+  _content.append(bytes, sizeof(T));
+}
+
+/////////////////////////////////////////////////
+/// \brief Create the content of a binary file.
+/// \param[in] _header First bytes of the header
+/// \param[in] _triangles Normal then corners of each triangle
+/// \return The content of the file
+std::string Binary(const std::string &_header,
+    const std::vector<std::vector<math::Vector3f>> &_triangles)
+{
+  std::string content = _header;
+  content.resize(80, ' ');
+  Append(static_cast<uint32_t>(_triangles.size()), content);
+  for (const auto &triangle : _triangles)
+  {
+    for (const auto &v : triangle)
+    {
+      Append(v.X(), content);
+      Append(v.Y(), content);
+      Append(v.Z(), content);
+    }
+    Append(static_cast<uint16_t>(0), content);
+  }
+  return content;
+}
+
+/////////////////////////////////////////////////
+/// \brief Two triangles of a square, sharing two corners.
+const std::vector<std::vector<math::Vector3f>> kSquare =
+{
+  {{0, 0, 1}, {0, 0, 0}, {1, 0, 0}, {1, 1, 0}},
+  {{0, 0, 1}, {0, 0, 0}, {1, 1, 0}, {0, 1, 0}},
+};
+
+/////////////////////////////////////////////////
+TEST_F(STLLoader, Binary)
+{
+  const std::string filename =
+    this->WriteFile("square.stl", Binary("binary", kSquare));
+
+  common::STLLoader loader;
+  EXPECT_FALSE(loader.WeldVertices());
+  std::unique_ptr<common::Mesh> mesh(loader.Load(filename));
+  ASSERT_NE(nullptr, mesh);
+  ASSERT_EQ(1u, mesh->SubMeshCount());
+
+  auto subMesh = mesh->SubMeshByIndex(0).lock();
+  ASSERT_NE(nullptr, subMesh);
+  ASSERT_EQ(6u, subMesh->VertexCount());
+  ASSERT_EQ(6u, subMesh->NormalCount());
+  ASSERT_EQ(6u, subMesh->IndexCount());
+  for (unsigned int c = 0; c < 6; ++c)
+  {
+    const auto &triangle = kSquare[c / 3];
+    EXPECT_EQ(math::Vector3d(triangle[1 + c % 3].X(),
+          triangle[1 + c % 3].Y(), triangle[1 + c % 3].Z()),
+        subMesh->Vertex(c));
+    EXPECT_EQ(math::Vector3d::UnitZ, subMesh->Normal(c));
+    EXPECT_EQ(static_cast<int>(c), subMesh->Index(c));
+  }
+
+  // A binary file may start with "solid", like ASCII files
+  std::unique_ptr<common::Mesh> solid(loader.Load(
+        this->WriteFile("solid.stl", Binary("solid binary", kSquare))));
+  ASSERT_NE(nullptr, solid);
+  ASSERT_EQ(1u, solid->SubMeshCount());
+  EXPECT_EQ(6u, solid->SubMeshByIndex(0).lock()->VertexCount());
+}
+
+/////////////////////////////////////////////////
+TEST_F(STLLoader, Weld)
+{
+  const std::string filename =
+    this->WriteFile("square.stl", Binary("binary", kSquare));
+
+  common::STLLoader loader;
+  loader.SetWeldVertices(true);
+  EXPECT_TRUE(loader.WeldVertices());
+  std::unique_ptr<common::Mesh> mesh(loader.Load(filename));
+  ASSERT_NE(nullptr, mesh);
+  ASSERT_EQ(1u, mesh->SubMeshCount());
+
+  auto subMesh = mesh->SubMeshByIndex(0).lock();
+  ASSERT_EQ(4u, subMesh->VertexCount());
+  ASSERT_EQ(4u, subMesh->NormalCount());
+  ASSERT_EQ(6u, subMesh->IndexCount());
+  for (unsigned int c = 0; c < 6; ++c)
+  {
+    const auto &corner = kSquare[c / 3][1 + c % 3];
+    EXPECT_EQ(math::Vector3d(corner.X(), corner.Y(), corner.Z()),
+        subMesh->Vertex(subMesh->Index(c)));
+  }
+  EXPECT_EQ(subMesh->Index(0), subMesh->Index(3));
+  EXPECT_EQ(subMesh->Index(2), subMesh->Index(4));
+
+  // Corners with another normal are not merged
+  auto triangles = kSquare;
+  triangles[1][0].Set(0, 0, -1);
+  std::unique_ptr<common::Mesh> sharp(loader.Load(
+        this->WriteFile("sharp.stl", Binary("binary", triangles))));
+  ASSERT_NE(nullptr, sharp);
+  EXPECT_EQ(6u, sharp->SubMeshByIndex(0).lock()->VertexCount());
+}
+
+/////////////////////////////////////////////////
+TEST_F(STLLoader, Ascii)
+{
+  const std::string filename = this->WriteFile("square.stl",
+      "solid square\n"
+      "  facet normal 0 0 1\n"
+      "    outer loop\n"
+      "      vertex 0 0 0\n"
+      "      vertex 1 0 0\n"
+      "      vertex 1 1 0\n"
+      "    endloop\n"
+      "  endfacet\n"
+      "endsolid square\n");
+
+  common::STLLoader loader;
+  std::unique_ptr<common::Mesh> mesh(loader.Load(filename));
+  ASSERT_NE(nullptr, mesh);
+  ASSERT_EQ(1u, mesh->SubMeshCount());
+
+  auto subMesh = mesh->SubMeshByIndex(0).lock();
+  ASSERT_EQ(3u, subMesh->VertexCount());
+  EXPECT_EQ(math::Vector3d(1, 1, 0), subMesh->Vertex(2));
+  EXPECT_EQ(math::Vector3d::UnitZ, subMesh->Normal(2));
+}
+
+/////////////////////////////////////////////////
+TEST_F(STLLoader, AsciiChunks)
+{
+  // A grid of triangles, large enough to be parsed in several chunks, with
+  // facets that span the ends of the chunks. Each triangle has its own
+  // normal, and the corners of adjacent triangles are shared.
+  const int size = 100;
+  std::string content = "solid grid\n";
+  for (int x = 0; x < size; ++x)
+  {
+    for (int y = 0; y < size; ++y)
+    {
+      for (int t = 0; t < 2; ++t)
+      {
+        const int corners[2][3][2] = {
+          {{0, 0}, {1, 0}, {1, 1}}, {{0, 0}, {1, 1}, {0, 1}}};
+        content += (t == 0 ? "  facet normal " : "  FACET NORMAL ") +
+          std::to_string(x) + " " + std::to_string(y) + ".5 " +
+          std::to_string(t) + "\n    outer loop\n";
+        for (const auto &corner : corners[t])
+        {
+          content += "      vertex " + std::to_string(x + corner[0]) +
+            ".0 " + std::to_string(y + corner[1]) + "e0 -0.25\n";
+        }
+        content += "    endloop\n  endfacet\n";
+      }
+    }
+  }
+  content += "endsolid grid\n";
+  ASSERT_GT(content.size(), 2u << 20);
+
+  common::STLLoader loader;
+  std::unique_ptr<common::Mesh> mesh(
+      loader.Load(this->WriteFile("grid.stl", content)));
+  ASSERT_NE(nullptr, mesh);
+  ASSERT_EQ(1u, mesh->SubMeshCount());
+
+  auto subMesh = mesh->SubMeshByIndex(0).lock();
+  const unsigned int count = size * size * 6;
+  ASSERT_EQ(count, subMesh->VertexCount());
+  ASSERT_EQ(count, subMesh->NormalCount());
+  ASSERT_EQ(count, subMesh->IndexCount());
+  for (unsigned int c = 0; c < count; ++c)
+  {
+    const int triangle = c / 3;
+    const int x = triangle / (2 * size);
+    const int y = (triangle / 2) % size;
+    EXPECT_EQ(math::Vector3d(x, y + 0.5, triangle % 2), subMesh->Normal(c));
+    EXPECT_DOUBLE_EQ(-0.25, subMesh->Vertex(c).Z());
+
+    // Each corner is indexed to the first vertex at its position
+    const unsigned int index = subMesh->Index(c);
+    EXPECT_LE(index, c);
+    EXPECT_EQ(subMesh->Vertex(c), subMesh->Vertex(index));
+    EXPECT_EQ(static_cast<int>(index),
+        subMesh->IndexOfVertex(subMesh->Vertex(c)));
+  }
+}
+
+/////////////////////////////////////////////////
+TEST_F(STLLoader, Invalid)
+{
+  common::STLLoader loader;
+  EXPECT_EQ(nullptr, loader.Load(common::joinPaths(this->path, "none.stl")));
+
+  // A binary file with fewer records than announced
+  std::string content = Binary("binary", kSquare);
+  content.resize(content.size() - 10);
+  std::unique_ptr<common::Mesh> truncated(
+      loader.Load(this->WriteFile("truncated.stl", content)));
+  ASSERT_NE(nullptr, truncated);
+  EXPECT_EQ(0u, truncated->SubMeshCount());
+
+  // Shorter than a header
+  std::unique_ptr<common::Mesh> empty(
+      loader.Load(this->WriteFile("empty.stl", "")));
+  ASSERT_NE(nullptr, empty);
+  EXPECT_EQ(0u, empty->SubMeshCount());
+
+  // Trailing bytes after the records are ignored
+  content = Binary("binary", kSquare) + "trailing";
+  std::unique_ptr<common::Mesh> trailing(
+      loader.Load(this->WriteFile("trailing.stl", content)));
+  ASSERT_NE(nullptr, trailing);
+  ASSERT_EQ(1u, trailing->SubMeshCount());
+  EXPECT_EQ(6u, trailing->SubMeshByIndex(0).lock()->VertexCount());
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -262,6 +262,12 @@ void Skeleton::SetNumVertAttached(const unsigned int _vertices)
   this->data->rawNodeWeights.resize(_vertices);
 }
 
+//////////////////////////////////////////////////
+unsigned int Skeleton::NumVertAttached() const
+{
+  return this->data->rawNodeWeights.size();
+}
+
 //////////////////////////////////////////////////
 void Skeleton::AddVertNodeWeight(
     const unsigned int _vertex, const std::string &_node,
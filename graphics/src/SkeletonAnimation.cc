@@ -29,7 +29,7 @@ class ignition::common::SkeletonAnimationPrivate
   public: std::string name;
 
   /// \brief the duration of the longest animation
-  public: double length;
+  public: double length = 0.0;
 
   /// \brief a dictionary of node animations
   public: std::map<std::string, NodeAnimation*> animations;
@@ -175,3 +175,10 @@ double SkeletonAnimation::Length() const
 {
   return this->data->length;
 }
+
+//////////////////////////////////////////////////
+const std::map<std::string, NodeAnimation *> &
+SkeletonAnimation::NodeAnimations() const
+{
+  return this->data->animations;
+}
@@ -161,6 +161,12 @@ void SkeletonNode::SetInitialTransform(const math::Matrix4d &_trans)
   this->SetTransform(_trans);
 }
 
+//////////////////////////////////////////////////
+math::Matrix4d SkeletonNode::InitialTransform() const
+{
+  return this->data->initialTransform;
+}
+
 //////////////////////////////////////////////////
 void SkeletonNode::Reset(const bool _resetChildren)
 {
@@ -16,27 +16,388 @@
  */
 #include <string>
 #include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <type_traits>
 
 #include "ignition/math/Helpers.hh"
 
 #include "ignition/common/Console.hh"
 #include "ignition/common/Material.hh"
 #include "ignition/common/SubMesh.hh"
+#include "ignition/common/WorkerPool.hh"
+
+#include "VertexHash.hh"
 
 using namespace ignition;
 using namespace common;
 
-/// \brief Private data for SubMesh
-class ignition::common::SubMeshPrivate
+/// \brief An array of vectors of N components, stored as one array of
+/// scalars with the components of each vector in turn, x, y and z. The
+/// math vectors have a virtual destructor, so an array of them is neither
+/// packed nor as small, and it could not be exposed as a span of scalars.
+template<typename T, std::size_t N>
+class PackedVectors
+{
+  /// \brief Type of the vectors
+  public: using Vector = std::conditional_t<N == 3,
+          math::Vector3<T>, math::Vector2<T>>;
+
+  /// \brief Get the number of vectors.
+  /// \return The number of vectors
+  public: std::size_t Size() const
+  {
+    return this->values.size() / N;
+  }
+
+  /// \brief Change the number of vectors. New vectors are zero.
+  /// \param[in] _count The number of vectors
+  public: void Resize(const std::size_t _count)
+  {
+    this->values.resize(_count * N, T(0));
+  }
+
+  /// \brief Remove all the vectors and release their memory.
+  public: void Release()
+  {
+    std::vector<T>().swap(this->values);
+  }
+
+  /// \brief Get a vector.
+  /// \param[in] _index Index of the vector
+  /// \return A copy of the vector
+  public: Vector Get(const std::size_t _index) const
+  {
+    const T *v = &this->values[_index * N];
+    if constexpr (N == 3)
+      return Vector(v[0], v[1], v[2]);
+    else
+      return Vector(v[0], v[1]);
+  }
+
+  /// \brief Set a vector.
+  /// \param[in] _index Index of the vector
+  /// \param[in] _v The new value
+  public: void Set(const std::size_t _index, const Vector &_v)
+  {
+    T *v = &this->values[_index * N];
+    v[0] = _v.X();
+    v[1] = _v.Y();
+    if constexpr (N == 3)
+      v[2] = _v.Z();
+  }
+
+  /// \brief Add a vector at the end.
+  /// \param[in] _v The vector
+  public: void Add(const Vector &_v)
+  {
+    this->values.push_back(_v.X());
+    this->values.push_back(_v.Y());
+    if constexpr (N == 3)
+      this->values.push_back(_v.Z());
+  }
+
+  /// \brief The components of the vectors
+  public: std::vector<T> values;
+};
+
+/// \brief Vertex attributes in one precision. Each attribute is a separate
+/// array.
+template<typename T>
+class VertexData
 {
+  /// \brief Scalar type
+  public: using Scalar = T;
+
+  /// \brief Constructor
+  public: VertexData() = default;
+
+  /// \brief Copy constructor. The vertex hash is not copied.
+  /// \param[in] _other Data to copy
+  public: VertexData(const VertexData &_other)
+    : vertices(_other.vertices), normals(_other.normals),
+      texCoords(_other.texCoords)
+  {
+  }
+
+  /// \brief Assignment operator. The vertex hash is not copied.
+  /// \param[in] _other Data to copy
+  /// \return This data
+  public: VertexData &operator=(const VertexData &_other)
+  {
+    this->vertices = _other.vertices;
+    this->normals = _other.normals;
+    this->texCoords = _other.texCoords;
+    this->hash.reset();
+    return *this;
+  }
+
   /// \brief the vertex array
-  public: std::vector<ignition::math::Vector3d> vertices;
+  public: PackedVectors<T, 3> vertices;
 
   /// \brief the normal array
-  public: std::vector<ignition::math::Vector3d> normals;
+  public: PackedVectors<T, 3> normals;
 
   /// \brief the texture coordinate array
-  public: std::vector<ignition::math::Vector2d> texCoords;
+  public: PackedVectors<T, 2> texCoords;
+
+  /// \brief Spatial hash of the vertices, built by the first lookup and
+  /// kept up to date by AddVertex. Reset by the other changes to the
+  /// vertices.
+  public: std::unique_ptr<VertexHash<T>> hash;
+};
+
+/// \brief Scalar type of a VertexData
+template<typename D>
+using ScalarOf = typename std::decay_t<D>::Scalar;
+
+/// \brief Convert a vector to another precision
+/// \param[in] _v Vector to convert
+/// \return The converted vector
+template<typename To, typename From>
+math::Vector3<To> Cast(const math::Vector3<From> &_v)
+{
+  return math::Vector3<To>(static_cast<To>(_v.X()), static_cast<To>(_v.Y()),
+      static_cast<To>(_v.Z()));
+}
+
+/// \brief Convert a vector to another precision
+/// \param[in] _v Vector to convert
+/// \return The converted vector
+template<typename To, typename From>
+math::Vector2<To> Cast(const math::Vector2<From> &_v)
+{
+  return math::Vector2<To>(static_cast<To>(_v.X()), static_cast<To>(_v.Y()));
+}
+
+/// \brief Convert the vectors of an attribute to another precision
+/// \param[in,out] _from Vectors to convert, released
+/// \param[out] _to Converted vectors
+template<typename From, typename To, std::size_t N>
+void ConvertAttribute(PackedVectors<From, N> &_from,
+    PackedVectors<To, N> &_to)
+{
+  _to.values.resize(_from.values.size());
+  std::transform(_from.values.begin(), _from.values.end(),
+      _to.values.begin(), [](const From _value)
+      {
+        return static_cast<To>(_value);
+      });
+  _from.Release();
+}
+
+/// \brief Number of elements processed per task by the operations that
+/// run on the shared worker pool. Smaller meshes are processed on the
+/// calling thread.
+static const std::size_t ParallelGrain = 4096;
+
+/// \brief Tolerance of math::Vector3::operator==, used to find the vertices
+/// at the same position when smoothing normals.
+static const double PositionTolerance = 1e-3;
+
+/// \brief Tolerance of math::Vector3::Equal, used by
+/// SubMesh::IndexOfVertex.
+static const double EqualTolerance = 1e-6;
+
+/// \brief Call a function over the range [0, _count), in parallel chunks
+/// on the shared worker pool if the range is large.
+/// \param[in] _count Size of the range
+/// \param[in] _func Function called as _func(first, last) for each chunk
+template<typename Func>
+void ParallelChunks(const std::size_t _count, Func &&_func)
+{
+  if (_count <= ParallelGrain)
+  {
+    if (_count > 0)
+      _func(std::size_t(0), _count);
+    return;
+  }
+  WorkerPool::Shared().ParallelFor(0, _count, ParallelGrain, _func);
+}
+
+/// \brief Recalculate the normals of vertex data, see
+/// SubMesh::RecalculateNormals.
+///
+/// The normal of a vertex is the normalized sum of the normals of the
+/// triangles that have a corner at the same position, within
+/// PositionTolerance, so duplicated vertices along seams get smooth normals.
+/// The vertices at a position are found with a spatial hash, and each
+/// triangle normal is added once, in triangle order, which gives the same
+/// results as comparing every vertex with every triangle.
+/// \param[in,out] _data Vertex data
+/// \param[in] _indices Triangle indices
+template<typename T>
+void SmoothNormals(VertexData<T> &_data,
+    const std::vector<unsigned int> &_indices)
+{
+  using Vector3 = math::Vector3<T>;
+
+  if (_data.normals.Size() < 3u)
+    return;
+
+  const auto &vertices = _data.vertices;
+  const std::size_t vertexCount = vertices.Size();
+  const std::size_t faceCount = _indices.size() / 3;
+  _data.normals.Release();
+  _data.normals.Resize(vertexCount);
+
+  // Call a function once for each vertex of a triangle. Triangles with an
+  // index out of range are skipped.
+  auto forEachCorner = [&](const std::size_t _face, auto &&_func)
+  {
+    const unsigned int *corner = &_indices[_face * 3];
+    if (corner[0] >= vertexCount || corner[1] >= vertexCount ||
+        corner[2] >= vertexCount)
+    {
+      return;
+    }
+    _func(corner[0]);
+    if (corner[1] != corner[0])
+      _func(corner[1]);
+    if (corner[2] != corner[0] && corner[2] != corner[1])
+      _func(corner[2]);
+  };
+
+  // Triangle normals
+  std::vector<Vector3> faceNormals(faceCount);
+  ParallelChunks(faceCount, [&](const std::size_t _first,
+                                const std::size_t _last)
+  {
+    for (std::size_t f = _first; f < _last; ++f)
+    {
+      const unsigned int *corner = &_indices[f * 3];
+      if (corner[0] < vertexCount && corner[1] < vertexCount &&
+          corner[2] < vertexCount)
+      {
+        faceNormals[f] = Vector3::Normal(vertices.Get(corner[0]),
+            vertices.Get(corner[1]), vertices.Get(corner[2]));
+      }
+    }
+  });
+
+  // Triangles of each vertex, in increasing order
+  std::vector<uint32_t> faceStart(vertexCount + 1, 0);
+  for (std::size_t f = 0; f < faceCount; ++f)
+    forEachCorner(f, [&](const unsigned int _v) {++faceStart[_v + 1];});
+  std::partial_sum(faceStart.begin(), faceStart.end(), faceStart.begin());
+
+  std::vector<uint32_t> faces(faceStart.back());
+  std::vector<uint32_t> fill(faceStart.begin(), faceStart.end() - 1);
+  for (std::size_t f = 0; f < faceCount; ++f)
+  {
+    forEachCorner(f, [&](const unsigned int _v)
+    {
+      faces[fill[_v]++] = static_cast<uint32_t>(f);
+    });
+  }
+
+  VertexHash<T> hash(PositionTolerance);
+  hash.Build(vertices.values.data(), vertexCount);
+
+  ParallelChunks(vertexCount, [&](const std::size_t _first,
+                                  const std::size_t _last)
+  {
+    std::vector<uint32_t> adjacent;
+    for (std::size_t v = _first; v < _last; ++v)
+    {
+      // Triangles with a corner at the position of this vertex
+      adjacent.clear();
+      const Vector3 position = vertices.Get(v);
+      hash.ForEachNear(position, [&](const uint32_t _other)
+      {
+        if (vertices.Get(_other) == position)
+        {
+          adjacent.insert(adjacent.end(), faces.begin() + faceStart[_other],
+              faces.begin() + faceStart[_other + 1]);
+        }
+        return true;
+      });
+      std::sort(adjacent.begin(), adjacent.end());
+      adjacent.erase(std::unique(adjacent.begin(), adjacent.end()),
+          adjacent.end());
+
+      Vector3 normal(0, 0, 0);
+      for (const uint32_t f : adjacent)
+        normal += faceNormals[f];
+      normal.Normalize();
+      _data.normals.Set(v, normal);
+    }
+  });
+}
+
+/// \brief Private data for SubMesh
+class ignition::common::SubMeshPrivate
+{
+  /// \brief Call a function with the vertex data in the current precision.
+  /// \param[in] _func Function taking a VertexData<double> or
+  /// VertexData<float>
+  /// \return The value returned by _func
+  public: template<typename F>
+          auto Visit(F &&_func)
+  {
+    if (this->precision == SubMesh::SINGLE_PRECISION)
+      return _func(this->floatData);
+    return _func(this->doubleData);
+  }
+
+  /// \brief Get the vertex data of a precision.
+  /// \return The vertex data, or null if the data is stored in the other
+  /// precision.
+  public: template<typename T>
+          VertexData<T> *Data()
+  {
+    if constexpr (std::is_same_v<T, float>)
+    {
+      if (this->precision == SubMesh::SINGLE_PRECISION)
+        return &this->floatData;
+    }
+    else
+    {
+      if (this->precision == SubMesh::DOUBLE_PRECISION)
+        return &this->doubleData;
+    }
+
+    ignerr << "Vertex data is stored in "
+      << (this->precision == SubMesh::SINGLE_PRECISION ? "single" : "double")
+      << " precision" << std::endl;
+    return nullptr;
+  }
+
+  /// \brief Get the spatial hash of the vertices, building it if needed.
+  /// \param[in] _data Vertex data
+  /// \return The hash, or null if it is disabled.
+  public: template<typename T>
+          const VertexHash<T> *Hash(VertexData<T> &_data)
+  {
+    if (!this->hashEnabled)
+      return nullptr;
+
+    std::lock_guard<std::mutex> lock(this->hashMutex);
+    if (!_data.hash)
+    {
+      _data.hash.reset(new VertexHash<T>(EqualTolerance));
+      _data.hash->Build(_data.vertices.values.data(), _data.vertices.Size());
+    }
+    return _data.hash.get();
+  }
+
+  /// \brief Vertex data, when precision is DOUBLE_PRECISION
+  public: VertexData<double> doubleData;
+
+  /// \brief Vertex data, when precision is SINGLE_PRECISION
+  public: VertexData<float> floatData;
+
+  /// \brief Precision of the vertex data
+  public: SubMesh::Precision precision = SubMesh::DOUBLE_PRECISION;
+
+  /// \brief Whether vertex lookups use a spatial hash
+  public: bool hashEnabled = true;
+
+  /// \brief Protects building the spatial hash from const functions
+  public: std::mutex hashMutex;
 
   /// \brief the vertex index array
   public: std::vector<unsigned int> indices;
@@ -75,6 +436,10 @@ SubMesh::SubMesh(const SubMesh &_submesh)
   this->dataPtr->name = _submesh.dataPtr->name;
   this->dataPtr->materialIndex = _submesh.dataPtr->materialIndex;
   this->dataPtr->primitiveType = _submesh.dataPtr->primitiveType;
+  this->dataPtr->precision = _submesh.dataPtr->precision;
+  this->dataPtr->hashEnabled = _submesh.dataPtr->hashEnabled;
+  this->dataPtr->doubleData = _submesh.dataPtr->doubleData;
+  this->dataPtr->floatData = _submesh.dataPtr->floatData;
 
   std::copy(_submesh.dataPtr->nodeAssignments.begin(),
       _submesh.dataPtr->nodeAssignments.end(),
@@ -83,25 +448,46 @@ SubMesh::SubMesh(const SubMesh &_submesh)
   std::copy(_submesh.dataPtr->indices.begin(),
       _submesh.dataPtr->indices.end(),
       std::back_inserter(this->dataPtr->indices));
-  std::copy(_submesh.dataPtr->normals.begin(),
-      _submesh.dataPtr->normals.end(),
-      std::back_inserter(this->dataPtr->normals));
-  std::copy(_submesh.dataPtr->texCoords.begin(),
-      _submesh.dataPtr->texCoords.end(),
-      std::back_inserter(this->dataPtr->texCoords));
-  std::copy(_submesh.dataPtr->vertices.begin(),
-      _submesh.dataPtr->vertices.end(),
-      std::back_inserter(this->dataPtr->vertices));
 }
 
 //////////////////////////////////////////////////
 SubMesh::~SubMesh()
 {
-  this->dataPtr->vertices.clear();
   this->dataPtr->indices.clear();
   this->dataPtr->nodeAssignments.clear();
 }
 
+//////////////////////////////////////////////////
+void SubMesh::SetVertexPrecision(const Precision _precision)
+{
+  if (_precision == this->dataPtr->precision)
+    return;
+
+  auto &d = this->dataPtr->doubleData;
+  auto &f = this->dataPtr->floatData;
+  if (_precision == SINGLE_PRECISION)
+  {
+    ConvertAttribute(d.vertices, f.vertices);
+    ConvertAttribute(d.normals, f.normals);
+    ConvertAttribute(d.texCoords, f.texCoords);
+  }
+  else
+  {
+    ConvertAttribute(f.vertices, d.vertices);
+    ConvertAttribute(f.normals, d.normals);
+    ConvertAttribute(f.texCoords, d.texCoords);
+  }
+  d.hash.reset();
+  f.hash.reset();
+  this->dataPtr->precision = _precision;
+}
+
+//////////////////////////////////////////////////
+SubMesh::Precision SubMesh::VertexPrecision() const
+{
+  return this->dataPtr->precision;
+}
+
 //////////////////////////////////////////////////
 void SubMesh::SetPrimitiveType(PrimitiveType _type)
 {
@@ -123,7 +509,13 @@ void SubMesh::AddIndex(const unsigned int _index)
 //////////////////////////////////////////////////
 void SubMesh::AddVertex(const ignition::math::Vector3d &_v)
 {
-  this->dataPtr->vertices.push_back(_v);
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    const auto v = Cast<ScalarOf<decltype(_data)>>(_v);
+    _data.vertices.Add(v);
+    if (_data.hash)
+      _data.hash->Insert(v);
+  });
 }
 
 //////////////////////////////////////////////////
@@ -135,7 +527,10 @@ void SubMesh::AddVertex(const double _x, const double _y, const double _z)
 //////////////////////////////////////////////////
 void SubMesh::AddNormal(const ignition::math::Vector3d &_n)
 {
-  this->dataPtr->normals.push_back(_n);
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    _data.normals.Add(Cast<ScalarOf<decltype(_data)>>(_n));
+  });
 }
 
 //////////////////////////////////////////////////
@@ -147,13 +542,16 @@ void SubMesh::AddNormal(const double _x, const double _y, const double _z)
 //////////////////////////////////////////////////
 void SubMesh::AddTexCoord(const double _u, const double _v)
 {
-  this->dataPtr->texCoords.push_back(ignition::math::Vector2d(_u, _v));
+  this->AddTexCoord(ignition::math::Vector2d(_u, _v));
 }
 
 //////////////////////////////////////////////////
 void SubMesh::AddTexCoord(const ignition::math::Vector2d &_uv)
 {
-  this->dataPtr->texCoords.push_back(_uv);
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    _data.texCoords.Add(Cast<ScalarOf<decltype(_data)>>(_uv));
+  });
 }
 
 //////////////////////////////////////////////////
@@ -171,56 +569,66 @@ void SubMesh::AddNodeAssignment(const unsigned int _vertex,
 //////////////////////////////////////////////////
 ignition::math::Vector3d SubMesh::Vertex(const unsigned int _index) const
 {
-  if (_index >= this->dataPtr->vertices.size())
+  return this->dataPtr->Visit([&](const auto &_data)
   {
-    ignerr << "Index too large" << std::endl;
-    return math::Vector3d::Zero;
-  }
+    if (_index >= _data.vertices.Size())
+    {
+      ignerr << "Index too large" << std::endl;
+      return math::Vector3d::Zero;
+    }
 
-  return this->dataPtr->vertices[_index];
+    return Cast<double>(_data.vertices.Get(_index));
+  });
 }
 
 //////////////////////////////////////////////////
 bool SubMesh::HasVertex(const unsigned int _index) const
 {
-  return _index < this->dataPtr->vertices.size();
+  return _index < this->VertexCount();
 }
 
 //////////////////////////////////////////////////
 void SubMesh::SetVertex(const unsigned int _index,
     const ignition::math::Vector3d &_v)
 {
-  if (_index >= this->dataPtr->vertices.size())
+  this->dataPtr->Visit([&](auto &_data)
   {
-    ignerr << "Index too large" << std::endl;
-    return;
-  }
+    if (_index >= _data.vertices.Size())
+    {
+      ignerr << "Index too large" << std::endl;
+      return;
+    }
 
-  this->dataPtr->vertices[_index] = _v;
+    _data.vertices.Set(_index, Cast<ScalarOf<decltype(_data)>>(_v));
+    _data.hash.reset();
+  });
 }
 
 //////////////////////////////////////////////////
 ignition::math::Vector3d SubMesh::Normal(const unsigned int _index) const
 {
-  if (_index >= this->dataPtr->normals.size())
+  return this->dataPtr->Visit([&](const auto &_data)
   {
-    ignerr << "Index too large" << std::endl;
-    return math::Vector3d::Zero;
-  }
+    if (_index >= _data.normals.Size())
+    {
+      ignerr << "Index too large" << std::endl;
+      return math::Vector3d::Zero;
+    }
 
-  return this->dataPtr->normals[_index];
+    return Cast<double>(_data.normals.Get(_index));
+  });
 }
 
 //////////////////////////////////////////////////
 bool SubMesh::HasNormal(const unsigned int _index) const
 {
-  return _index < this->dataPtr->normals.size();
+  return _index < this->NormalCount();
 }
 
 //////////////////////////////////////////////////
 bool SubMesh::HasTexCoord(const unsigned int _index) const
 {
-  return _index < this->dataPtr->texCoords.size();
+  return _index < this->TexCoordCount();
 }
 
 //////////////////////////////////////////////////
@@ -233,38 +641,47 @@ bool SubMesh::HasNodeAssignment(const unsigned int _index) const
 void SubMesh::SetNormal(const unsigned int _index,
     const ignition::math::Vector3d &_n)
 {
-  if (_index >= this->dataPtr->normals.size())
+  this->dataPtr->Visit([&](auto &_data)
   {
-    ignerr << "Index too large" << std::endl;
-    return;
-  }
+    if (_index >= _data.normals.Size())
+    {
+      ignerr << "Index too large" << std::endl;
+      return;
+    }
 
-  this->dataPtr->normals[_index] = _n;
+    _data.normals.Set(_index, Cast<ScalarOf<decltype(_data)>>(_n));
+  });
 }
 
 //////////////////////////////////////////////////
 ignition::math::Vector2d SubMesh::TexCoord(const unsigned int _index) const
 {
-  if (_index >= this->dataPtr->texCoords.size())
+  return this->dataPtr->Visit([&](const auto &_data)
   {
-    ignerr << "Index too large" << std::endl;
-    return math::Vector2d::Zero;
-  }
+    if (_index >= _data.texCoords.Size())
+    {
+      ignerr << "Index too large" << std::endl;
+      return math::Vector2d::Zero;
+    }
 
-  return this->dataPtr->texCoords[_index];
+    return Cast<double>(_data.texCoords.Get(_index));
+  });
 }
 
 //////////////////////////////////////////////////
 void SubMesh::SetTexCoord(const unsigned int _index,
     const ignition::math::Vector2d &_t)
 {
-  if (_index >= this->dataPtr->texCoords.size())
+  this->dataPtr->Visit([&](auto &_data)
   {
-    ignerr << "Index too large" << std::endl;
-    return;
-  }
+    if (_index >= _data.texCoords.Size())
+    {
+      ignerr << "Index too large" << std::endl;
+      return;
+    }
 
-  this->dataPtr->texCoords[_index] = _t;
+    _data.texCoords.Set(_index, Cast<ScalarOf<decltype(_data)>>(_t));
+  });
 }
 
 //////////////////////////////////////////////////
@@ -307,57 +724,71 @@ NodeAssignment SubMesh::NodeAssignmentByIndex(
 //////////////////////////////////////////////////
 ignition::math::Vector3d SubMesh::Max() const
 {
-  if (this->dataPtr->vertices.empty())
-    return ignition::math::Vector3d::Zero;
+  return this->dataPtr->Visit([](const auto &_data)
+  {
+    if (_data.vertices.values.empty())
+      return ignition::math::Vector3d::Zero;
 
-  ignition::math::Vector3d max;
+    ignition::math::Vector3d max;
 
-  max.X(-ignition::math::MAX_F);
-  max.Y(-ignition::math::MAX_F);
-  max.Z(-ignition::math::MAX_F);
+    max.X(-ignition::math::MAX_F);
+    max.Y(-ignition::math::MAX_F);
+    max.Z(-ignition::math::MAX_F);
 
-  for (const auto &v : this->dataPtr->vertices)
-  {
-    max.X(std::max(max.X(), v.X()));
-    max.Y(std::max(max.Y(), v.Y()));
-    max.Z(std::max(max.Z(), v.Z()));
-  }
+    for (std::size_t i = 0; i < _data.vertices.Size(); ++i)
+    {
+      const auto v = _data.vertices.Get(i);
+      max.X(std::max(max.X(), static_cast<double>(v.X())));
+      max.Y(std::max(max.Y(), static_cast<double>(v.Y())));
+      max.Z(std::max(max.Z(), static_cast<double>(v.Z())));
+    }
 
-  return max;
+    return max;
+  });
 }
 
 //////////////////////////////////////////////////
 ignition::math::Vector3d SubMesh::Min() const
 {
-  if (this->dataPtr->vertices.empty())
-    return ignition::math::Vector3d::Zero;
+  return this->dataPtr->Visit([](const auto &_data)
+  {
+    if (_data.vertices.values.empty())
+      return ignition::math::Vector3d::Zero;
 
-  ignition::math::Vector3d min;
+    ignition::math::Vector3d min;
 
-  min.X(ignition::math::MAX_F);
-  min.Y(ignition::math::MAX_F);
-  min.Z(ignition::math::MAX_F);
+    min.X(ignition::math::MAX_F);
+    min.Y(ignition::math::MAX_F);
+    min.Z(ignition::math::MAX_F);
 
-  for (const auto &v : this->dataPtr->vertices)
-  {
-    min.X(std::min(min.X(), v.X()));
-    min.Y(std::min(min.Y(), v.Y()));
-    min.Z(std::min(min.Z(), v.Z()));
-  }
+    for (std::size_t i = 0; i < _data.vertices.Size(); ++i)
+    {
+      const auto v = _data.vertices.Get(i);
+      min.X(std::min(min.X(), static_cast<double>(v.X())));
+      min.Y(std::min(min.Y(), static_cast<double>(v.Y())));
+      min.Z(std::min(min.Z(), static_cast<double>(v.Z())));
+    }
 
-  return min;
+    return min;
+  });
 }
 
 //////////////////////////////////////////////////
 unsigned int SubMesh::VertexCount() const
 {
-  return this->dataPtr->vertices.size();
+  return this->dataPtr->Visit([](const auto &_data)
+  {
+    return static_cast<unsigned int>(_data.vertices.Size());
+  });
 }
 
 //////////////////////////////////////////////////
 unsigned int SubMesh::NormalCount() const
 {
-  return this->dataPtr->normals.size();
+  return this->dataPtr->Visit([](const auto &_data)
+  {
+    return static_cast<unsigned int>(_data.normals.Size());
+  });
 }
 
 //////////////////////////////////////////////////
@@ -369,7 +800,10 @@ unsigned int SubMesh::IndexCount() const
 //////////////////////////////////////////////////
 unsigned int SubMesh::TexCoordCount() const
 {
-  return this->dataPtr->texCoords.size();
+  return this->dataPtr->Visit([](const auto &_data)
+  {
+    return static_cast<unsigned int>(_data.texCoords.Size());
+  });
 }
 
 //////////////////////////////////////////////////
@@ -405,29 +839,394 @@ unsigned int SubMesh::MaterialIndex() const
 //////////////////////////////////////////////////
 bool SubMesh::HasVertex(const ignition::math::Vector3d &_v) const
 {
-  for (const auto &v : this->dataPtr->vertices)
-    if (_v.Equal(v))
+  return this->IndexOfVertex(_v) >= 0;
+}
+
+//////////////////////////////////////////////////
+int SubMesh::IndexOfVertex(const ignition::math::Vector3d &_v) const
+{
+  return this->dataPtr->Visit([&](auto &_data)
+  {
+    using T = ScalarOf<decltype(_data)>;
+
+    const VertexHash<T> *hash = this->dataPtr->Hash(_data);
+    if (!hash)
+    {
+      for (std::size_t i = 0; i < _data.vertices.Size(); ++i)
+      {
+        if (_v.Equal(Cast<double>(_data.vertices.Get(i))))
+          return static_cast<int>(i);
+      }
+      return -1;
+    }
+
+    // The first matching vertex, like the linear search
+    int index = -1;
+    hash->ForEachNear(Cast<T>(_v), [&](const uint32_t _candidate)
+    {
+      const int candidate = static_cast<int>(_candidate);
+      if ((index < 0 || candidate < index) &&
+          _v.Equal(Cast<double>(_data.vertices.Get(_candidate))))
+      {
+        index = candidate;
+      }
       return true;
+    });
+    return index;
+  });
+}
+
+//////////////////////////////////////////////////
+bool SubMesh::ReorderVertices(Span<const unsigned int> _order)
+{
+  const std::size_t count = this->VertexCount();
+  if (_order.size() != count)
+  {
+    ignerr << "Vertex order has [" << _order.size() << "] entries for ["
+      << count << "] vertices\n";
+    return false;
+  }
+
+  // Old index to new index
+  const unsigned int unset = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> remap(count, unset);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    if (_order[i] >= count || remap[_order[i]] != unset)
+    {
+      ignerr << "Vertex order is not a permutation\n";
+      return false;
+    }
+    remap[_order[i]] = static_cast<unsigned int>(i);
+  }
 
-  return false;
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    auto reorder = [&](auto &_values)
+    {
+      if (_values.Size() != count)
+        return;
+      const auto old = _values;
+      for (std::size_t i = 0; i < count; ++i)
+        _values.Set(i, old.Get(_order[i]));
+    };
+    reorder(_data.vertices);
+    reorder(_data.normals);
+    reorder(_data.texCoords);
+    _data.hash.reset();
+  });
+
+  for (auto &index : this->dataPtr->indices)
+  {
+    if (index < count)
+      index = remap[index];
+  }
+
+  for (auto &assignment : this->dataPtr->nodeAssignments)
+  {
+    if (assignment.vertexIndex < count)
+      assignment.vertexIndex = remap[assignment.vertexIndex];
+  }
+
+  return true;
 }
 
 //////////////////////////////////////////////////
-int SubMesh::IndexOfVertex(const ignition::math::Vector3d &_v) const
+void SubMesh::SetVertexHashEnabled(const bool _enabled)
 {
-  for (auto iter = this->dataPtr->vertices.begin();
-      iter != this->dataPtr->vertices.end(); ++iter)
+  this->dataPtr->hashEnabled = _enabled;
+  if (!_enabled)
   {
-    if (_v.Equal(*iter))
-      return iter - this->dataPtr->vertices.begin();
+    this->dataPtr->doubleData.hash.reset();
+    this->dataPtr->floatData.hash.reset();
   }
-  return -1;
+}
+
+//////////////////////////////////////////////////
+bool SubMesh::VertexHashEnabled() const
+{
+  return this->dataPtr->hashEnabled;
+}
+
+//////////////////////////////////////////////////
+void SubMesh::InvalidateVertexHash()
+{
+  this->dataPtr->doubleData.hash.reset();
+  this->dataPtr->floatData.hash.reset();
+}
+
+//////////////////////////////////////////////////
+unsigned int SubMesh::WeldVertices(const double _tolerance)
+{
+  auto &assignments = this->dataPtr->nodeAssignments;
+  auto &indices = this->dataPtr->indices;
+
+  return this->dataPtr->Visit([&](auto &_data) -> unsigned int
+  {
+    using T = ScalarOf<decltype(_data)>;
+
+    auto &vertices = _data.vertices;
+    auto &normals = _data.normals;
+    auto &texCoords = _data.texCoords;
+    const std::size_t count = vertices.Size();
+    const bool weldNormals = normals.Size() == count;
+    const bool weldTexCoords = texCoords.Size() == count;
+    const T tolerance = static_cast<T>(_tolerance);
+
+    // Find the first kept vertex that matches each vertex
+    VertexHash<T> hash(_tolerance);
+    std::vector<unsigned int> remap(count);
+    std::vector<std::size_t> kept;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      int match = -1;
+      const auto vertex = vertices.Get(i);
+      hash.ForEachNear(vertex, [&](const uint32_t _candidate)
+      {
+        const std::size_t other = kept[_candidate];
+        if ((match < 0 || _candidate < static_cast<uint32_t>(match)) &&
+            vertex.Equal(vertices.Get(other), tolerance) &&
+            (!weldNormals ||
+             normals.Get(i).Equal(normals.Get(other), tolerance)) &&
+            (!weldTexCoords ||
+             texCoords.Get(i).Equal(texCoords.Get(other), tolerance)))
+        {
+          match = static_cast<int>(_candidate);
+        }
+        return true;
+      });
+
+      if (match >= 0)
+      {
+        remap[i] = static_cast<unsigned int>(match);
+      }
+      else
+      {
+        remap[i] = static_cast<unsigned int>(kept.size());
+        kept.push_back(i);
+        hash.Insert(vertex);
+      }
+    }
+
+    if (kept.size() == count)
+      return 0u;
+
+    // Move the kept vertices to the front, in their order
+    for (std::size_t i = 0; i < kept.size(); ++i)
+    {
+      vertices.Set(i, vertices.Get(kept[i]));
+      if (weldNormals)
+        normals.Set(i, normals.Get(kept[i]));
+      if (weldTexCoords)
+        texCoords.Set(i, texCoords.Get(kept[i]));
+    }
+    vertices.Resize(kept.size());
+    if (weldNormals)
+      normals.Resize(kept.size());
+    if (weldTexCoords)
+      texCoords.Resize(kept.size());
+    _data.hash.reset();
+
+    for (auto &index : indices)
+    {
+      if (index < count)
+        index = remap[index];
+    }
+
+    // Welded vertices use the node assignments of the vertex they are
+    // merged with
+    std::vector<NodeAssignment> keptAssignments;
+    for (const auto &assignment : assignments)
+    {
+      const unsigned int v = assignment.vertexIndex;
+      if (v >= count)
+      {
+        keptAssignments.push_back(assignment);
+      }
+      else if (kept[remap[v]] == v)
+      {
+        keptAssignments.push_back(assignment);
+        keptAssignments.back().vertexIndex = remap[v];
+      }
+    }
+    assignments.swap(keptAssignments);
+
+    return static_cast<unsigned int>(count - kept.size());
+  });
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<const double> SubMesh::Vertices<double>() const
+{
+  auto data = this->dataPtr->Data<double>();
+  if (!data)
+    return {};
+  return data->vertices.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<double> SubMesh::MutableVertices<double>()
+{
+  auto data = this->dataPtr->Data<double>();
+  if (!data)
+    return {};
+  data->hash.reset();
+  return data->vertices.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<const float> SubMesh::Vertices<float>() const
+{
+  auto data = this->dataPtr->Data<float>();
+  if (!data)
+    return {};
+  return data->vertices.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<float> SubMesh::MutableVertices<float>()
+{
+  auto data = this->dataPtr->Data<float>();
+  if (!data)
+    return {};
+  data->hash.reset();
+  return data->vertices.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<const double> SubMesh::Normals<double>() const
+{
+  auto data = this->dataPtr->Data<double>();
+  if (!data)
+    return {};
+  return data->normals.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<double> SubMesh::MutableNormals<double>()
+{
+  auto data = this->dataPtr->Data<double>();
+  if (!data)
+    return {};
+  return data->normals.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<const float> SubMesh::Normals<float>() const
+{
+  auto data = this->dataPtr->Data<float>();
+  if (!data)
+    return {};
+  return data->normals.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<float> SubMesh::MutableNormals<float>()
+{
+  auto data = this->dataPtr->Data<float>();
+  if (!data)
+    return {};
+  return data->normals.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<const double> SubMesh::TexCoords<double>() const
+{
+  auto data = this->dataPtr->Data<double>();
+  if (!data)
+    return {};
+  return data->texCoords.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<double> SubMesh::MutableTexCoords<double>()
+{
+  auto data = this->dataPtr->Data<double>();
+  if (!data)
+    return {};
+  return data->texCoords.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<const float> SubMesh::TexCoords<float>() const
+{
+  auto data = this->dataPtr->Data<float>();
+  if (!data)
+    return {};
+  return data->texCoords.values;
+}
+
+//////////////////////////////////////////////////
+template<>
+Span<float> SubMesh::MutableTexCoords<float>()
+{
+  auto data = this->dataPtr->Data<float>();
+  if (!data)
+    return {};
+  return data->texCoords.values;
+}
+
+//////////////////////////////////////////////////
+Span<const unsigned int> SubMesh::Indices() const
+{
+  return this->dataPtr->indices;
+}
+
+//////////////////////////////////////////////////
+Span<unsigned int> SubMesh::MutableIndices()
+{
+  return this->dataPtr->indices;
+}
+
+//////////////////////////////////////////////////
+void SubMesh::SetVertexCount(const unsigned int _count)
+{
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    _data.vertices.Resize(_count);
+    _data.hash.reset();
+  });
+}
+
+//////////////////////////////////////////////////
+void SubMesh::SetNormalCount(const unsigned int _count)
+{
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    _data.normals.Resize(_count);
+  });
+}
+
+//////////////////////////////////////////////////
+void SubMesh::SetTexCoordCount(const unsigned int _count)
+{
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    _data.texCoords.Resize(_count);
+  });
+}
+
+//////////////////////////////////////////////////
+void SubMesh::SetIndexCount(const unsigned int _count)
+{
+  this->dataPtr->indices.resize(_count);
 }
 
 //////////////////////////////////////////////////
 void SubMesh::FillArrays(double **_vertArr, int **_indArr) const
 {
-  if (this->dataPtr->vertices.empty() || this->dataPtr->indices.empty())
+  if (this->VertexCount() == 0 || this->dataPtr->indices.empty())
   {
     ignerr << "No vertices or indices\n";
     return;
@@ -439,99 +1238,171 @@ void SubMesh::FillArrays(double **_vertArr, int **_indArr) const
   if (*_indArr)
     delete [] *_indArr;
 
-  *_vertArr = new double[this->dataPtr->vertices.size() * 3];
+  *_vertArr = new double[this->VertexCount() * 3];
   *_indArr = new int[this->dataPtr->indices.size()];
 
-  unsigned int vi = 0;
-  for (auto &v : this->dataPtr->vertices)
+  if (!this->FillBuffers(Span<double>(*_vertArr, this->VertexCount() * 3),
+      Span<int>(*_indArr, this->dataPtr->indices.size())))
   {
-    (*_vertArr)[vi++] = static_cast<float>(v.X());
-    (*_vertArr)[vi++] = static_cast<float>(v.Y());
-    (*_vertArr)[vi++] = static_cast<float>(v.Z());
+    delete [] *_vertArr;
+    delete [] *_indArr;
+    *_vertArr = nullptr;
+    *_indArr = nullptr;
+    return;
   }
 
-  unsigned int ii = 0;
-  for (auto &i : this->dataPtr->indices)
-  {
-    (*_indArr)[ii++] = i;
-  }
+  // The positions have always been rounded to float precision here
+  for (std::size_t i = 0; i < this->VertexCount() * 3; ++i)
+    (*_vertArr)[i] = static_cast<float>((*_vertArr)[i]);
 }
 
 //////////////////////////////////////////////////
-void SubMesh::RecalculateNormals()
+template<typename V, typename I>
+bool SubMesh::FillBuffers(Span<V> _vertices, Span<I> _indices,
+    const unsigned int _indexOffset) const
 {
-  if (this->dataPtr->normals.size() < 3u)
-    return;
-
-  // Reset all the normals
-  for (auto &n : this->dataPtr->normals)
-    n.Set(0, 0, 0);
+  const auto &indices = this->dataPtr->indices;
+  const std::size_t vertexCount = this->VertexCount();
+  if (_vertices.size() < vertexCount * 3 || _indices.size() < indices.size())
+  {
+    ignerr << "Buffers of [" << _vertices.size() << "] values and ["
+      << _indices.size() << "] indices are too small for [" << vertexCount
+      << "] vertices and [" << indices.size() << "] indices\n";
+    return false;
+  }
 
-  if (this->dataPtr->normals.size() != this->dataPtr->vertices.size())
-    this->dataPtr->normals.resize(this->dataPtr->vertices.size());
+  if (!indices.empty())
+  {
+    const uint64_t largest = static_cast<uint64_t>(this->MaxIndex()) +
+      _indexOffset;
+    if (largest > static_cast<uint64_t>(std::numeric_limits<I>::max()))
+    {
+      ignerr << "Index [" << largest << "] does not fit in the index type\n";
+      return false;
+    }
+  }
 
-  // For each face, which is defined by three indices, calculate the normals
-  for (unsigned int i = 0; i < this->dataPtr->indices.size(); i+= 3)
+  this->dataPtr->Visit([&](const auto &_data)
   {
-    ignition::math::Vector3d v1 =
-        this->dataPtr->vertices[this->dataPtr->indices[i]];
-    ignition::math::Vector3d v2 =
-        this->dataPtr->vertices[this->dataPtr->indices[i+1]];
-    ignition::math::Vector3d v3 =
-        this->dataPtr->vertices[this->dataPtr->indices[i+2]];
-    ignition::math::Vector3d n = ignition::math::Vector3d::Normal(v1, v2, v3);
+    using T = ScalarOf<decltype(_data)>;
 
-    for (unsigned int j = 0; j < this->dataPtr->vertices.size(); ++j)
+    if constexpr (std::is_same_v<T, V>)
     {
-      ignition::math::Vector3d v = this->dataPtr->vertices[j];
-      if (v == v1 || v == v2 || v == v3)
+      if (vertexCount > 0)
       {
-        this->dataPtr->normals[j] += n;
+        std::memcpy(_vertices.data(), _data.vertices.values.data(),
+            _data.vertices.values.size() * sizeof(T));
       }
     }
-  }
+    else
+    {
+      std::transform(_data.vertices.values.begin(),
+          _data.vertices.values.end(), _vertices.begin(),
+          [](const T _value)
+          {
+            return static_cast<V>(_value);
+          });
+    }
+  });
 
-  // Normalize the results
-  for (auto &n : this->dataPtr->normals)
+  // Only the instantiations with the index type of the storage can copy
+  // the indices as they are
+  if constexpr (std::is_same_v<I, unsigned int>)
   {
-    n.Normalize();
+    if (_indexOffset == 0)
+    {
+      if (!indices.empty())
+      {
+        std::memcpy(_indices.data(), indices.data(),
+            indices.size() * sizeof(indices[0]));
+      }
+      return true;
+    }
   }
+
+  for (std::size_t i = 0; i < indices.size(); ++i)
+    _indices[i] = static_cast<I>(indices[i] + _indexOffset);
+
+  return true;
 }
 
+/// \cond
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool SubMesh::FillBuffers(Span<double>, Span<int>, unsigned int) const;
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool SubMesh::FillBuffers(Span<double>, Span<uint32_t>, unsigned int) const;
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool SubMesh::FillBuffers(Span<double>, Span<uint16_t>, unsigned int) const;
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool SubMesh::FillBuffers(Span<float>, Span<int>, unsigned int) const;
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool SubMesh::FillBuffers(Span<float>, Span<uint32_t>, unsigned int) const;
+template IGNITION_COMMON_GRAPHICS_VISIBLE
+bool SubMesh::FillBuffers(Span<float>, Span<uint16_t>, unsigned int) const;
+/// \endcond
+
 //////////////////////////////////////////////////
-void SubMesh::GenSphericalTexCoord(const ignition::math::Vector3d &_center)
+void SubMesh::RecalculateNormals()
 {
-  this->dataPtr->texCoords.clear();
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    SmoothNormals(_data, this->dataPtr->indices);
+  });
+}
 
-  for (const auto &vert : this->dataPtr->vertices)
+//////////////////////////////////////////////////
+void SubMesh::GenSphericalTexCoord(const ignition::math::Vector3d &_center)
+{
+  this->dataPtr->Visit([&](auto &_data)
   {
-    // generate projected texture coordinates, projected from center
-    //  x, y, z for computing texture coordinate projections
-    double x = vert.X() - _center.X();
-    double y = vert.Y() - _center.Y();
-    double z = vert.Z() - _center.Z();
+    _data.texCoords.Release();
 
-    double r = std::max(0.000001, sqrt(x*x+y*y+z*z));
-    double s = std::min(1.0, std::max(-1.0, z/r));
-    double t = std::min(1.0, std::max(-1.0, y/r));
-    double u = acos(s) / IGN_PI;
-    double v = acos(t) / IGN_PI;
-    this->AddTexCoord(u, v);
-  }
+    for (std::size_t i = 0; i < _data.vertices.Size(); ++i)
+    {
+      const auto vert = _data.vertices.Get(i);
+      // generate projected texture coordinates, projected from center
+      //  x, y, z for computing texture coordinate projections
+      double x = vert.X() - _center.X();
+      double y = vert.Y() - _center.Y();
+      double z = vert.Z() - _center.Z();
+
+      double r = std::max(0.000001, sqrt(x*x+y*y+z*z));
+      double s = std::min(1.0, std::max(-1.0, z/r));
+      double t = std::min(1.0, std::max(-1.0, y/r));
+      double u = acos(s) / IGN_PI;
+      double v = acos(t) / IGN_PI;
+      this->AddTexCoord(u, v);
+    }
+  });
 }
 
 //////////////////////////////////////////////////
 void SubMesh::Scale(const ignition::math::Vector3d &_factor)
 {
-  for (auto &v : this->dataPtr->vertices)
-    v *= _factor;
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    const auto factor = Cast<ScalarOf<decltype(_data)>>(_factor);
+    auto &values = _data.vertices.values;
+    for (std::size_t i = 0; i < values.size(); i += 3)
+    {
+      values[i] *= factor.X();
+      values[i + 1] *= factor.Y();
+      values[i + 2] *= factor.Z();
+    }
+    _data.hash.reset();
+  });
 }
 
 //////////////////////////////////////////////////
 void SubMesh::Scale(const double &_factor)
 {
-  for (auto &v : this->dataPtr->vertices)
-    v *= _factor;
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    const auto factor = static_cast<ScalarOf<decltype(_data)>>(_factor);
+    for (auto &value : _data.vertices.values)
+      value *= factor;
+    _data.hash.reset();
+  });
 }
 
 //////////////////////////////////////////////////
@@ -548,8 +1419,18 @@ void SubMesh::Center(const ignition::math::Vector3d &_center)
 //////////////////////////////////////////////////
 void SubMesh::Translate(const ignition::math::Vector3d &_vec)
 {
-  for (auto &v : this->dataPtr->vertices)
-    v += _vec;
+  this->dataPtr->Visit([&](auto &_data)
+  {
+    const auto vec = Cast<ScalarOf<decltype(_data)>>(_vec);
+    auto &values = _data.vertices.values;
+    for (std::size_t i = 0; i < values.size(); i += 3)
+    {
+      values[i] += vec.X();
+      values[i + 1] += vec.Y();
+      values[i + 2] += vec.Z();
+    }
+    _data.hash.reset();
+  });
 }
 
 //////////////////////////////////////////////////
@@ -572,17 +1453,21 @@ double SubMesh::Volume() const
   {
     if (this->dataPtr->indices.size() % 3 == 0)
     {
-      for (unsigned int idx = 0; idx < this->dataPtr->indices.size(); idx += 3)
+      this->dataPtr->Visit([&](const auto &_data)
       {
-        ignition::math::Vector3d v1 =
-          this->dataPtr->vertices[this->dataPtr->indices[idx]];
-        ignition::math::Vector3d v2 =
-          this->dataPtr->vertices[this->dataPtr->indices[idx+1]];
-        ignition::math::Vector3d v3 =
-          this->dataPtr->vertices[this->dataPtr->indices[idx+2]];
-
-        volume += std::abs(v1.Cross(v2).Dot(v3) / 6.0);
-      }
+        const auto &indices = this->dataPtr->indices;
+        for (unsigned int idx = 0; idx < indices.size(); idx += 3)
+        {
+          ignition::math::Vector3d v1 =
+            Cast<double>(_data.vertices.Get(indices[idx]));
+          ignition::math::Vector3d v2 =
+            Cast<double>(_data.vertices.Get(indices[idx+1]));
+          ignition::math::Vector3d v3 =
+            Cast<double>(_data.vertices.Get(indices[idx+2]));
+
+          volume += std::abs(v1.Cross(v2).Dot(v3) / 6.0);
+        }
+      });
     }
     else
     {
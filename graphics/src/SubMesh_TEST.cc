@@ -428,6 +428,521 @@ TEST_F(SubMeshTest, Volume)
   EXPECT_DOUBLE_EQ(0.0, boxSub.Volume());
 }
 
+/////////////////////////////////////////////////
+TEST_F(SubMeshTest, BulkAccess)
+{
+  common::SubMesh submesh;
+  EXPECT_EQ(common::SubMesh::DOUBLE_PRECISION, submesh.VertexPrecision());
+  EXPECT_TRUE(submesh.Vertices().empty());
+  EXPECT_TRUE(submesh.Indices().empty());
+
+  submesh.AddVertex(0, 0, 1);
+  submesh.AddVertex(2, 0, 0);
+  submesh.AddNormal(1, 0, 0);
+  submesh.AddTexCoord(0.5, 1);
+  submesh.AddIndex(1);
+
+  // The spans refer to the stored data
+  // and hold three values per vertex
+  auto vertices = submesh.Vertices();
+  ASSERT_EQ(6u, vertices.size());
+  EXPECT_DOUBLE_EQ(1.0, vertices[2]);
+  EXPECT_DOUBLE_EQ(2.0, vertices[3]);
+  EXPECT_DOUBLE_EQ(0.0, vertices[5]);
+  ASSERT_EQ(3u, submesh.Normals().size());
+  EXPECT_DOUBLE_EQ(1.0, submesh.Normals()[0]);
+  ASSERT_EQ(2u, submesh.TexCoords().size());
+  EXPECT_DOUBLE_EQ(0.5, submesh.TexCoords()[0]);
+  EXPECT_DOUBLE_EQ(1.0, submesh.TexCoords()[1]);
+  ASSERT_EQ(1u, submesh.Indices().size());
+  EXPECT_EQ(1u, submesh.Indices()[0]);
+
+  // The other precision is not available
+  EXPECT_TRUE(submesh.Vertices<float>().empty());
+  EXPECT_TRUE(submesh.MutableNormals<float>().empty());
+
+  // Bulk write
+  submesh.SetVertexCount(4);
+  submesh.SetIndexCount(6);
+  EXPECT_EQ(4u, submesh.VertexCount());
+  EXPECT_EQ(6u, submesh.IndexCount());
+  EXPECT_EQ(math::Vector3d::Zero, submesh.Vertex(3));
+
+  auto mutableVertices = submesh.MutableVertices();
+  ASSERT_EQ(12u, mutableVertices.size());
+  for (std::size_t i = 0; i < mutableVertices.size(); i += 3)
+  {
+    mutableVertices[i] = static_cast<double>(i / 3);
+    mutableVertices[i + 1] = 1;
+    mutableVertices[i + 2] = 2;
+  }
+  auto indices = submesh.MutableIndices();
+  const unsigned int quad[] = {0, 1, 2, 0, 2, 3};
+  std::copy(std::begin(quad), std::end(quad), indices.begin());
+
+  EXPECT_EQ(math::Vector3d(3, 1, 2), submesh.Vertex(3));
+  EXPECT_EQ(3, submesh.Index(5));
+  EXPECT_EQ(3u, submesh.MaxIndex());
+}
+
+/////////////////////////////////////////////////
+TEST_F(SubMeshTest, SinglePrecision)
+{
+  common::SubMesh submesh;
+  submesh.AddVertex(0, 0, 1);
+  submesh.AddVertex(2, 0, 0);
+  submesh.AddVertex(0, 3, 3);
+  submesh.AddNormal(1, 0, 0);
+  submesh.AddNormal(0, 1, 0);
+  submesh.AddNormal(0, 0, 1);
+  submesh.AddTexCoord(0.25, 0.5);
+  submesh.AddIndex(0);
+  submesh.AddIndex(1);
+  submesh.AddIndex(2);
+
+  // Existing data is converted
+  submesh.SetVertexPrecision(common::SubMesh::SINGLE_PRECISION);
+  EXPECT_EQ(common::SubMesh::SINGLE_PRECISION, submesh.VertexPrecision());
+  EXPECT_TRUE(submesh.Vertices().empty());
+  EXPECT_EQ(3u, submesh.VertexCount());
+  EXPECT_EQ(3u, submesh.NormalCount());
+  EXPECT_EQ(1u, submesh.TexCoordCount());
+
+  // The attributes are arrays of floats
+  auto vertices = submesh.Vertices<float>();
+  ASSERT_EQ(9u, vertices.size());
+  EXPECT_FLOAT_EQ(2.0f, vertices[3]);
+  EXPECT_FLOAT_EQ(3.0f, vertices[8]);
+  EXPECT_EQ(9 * sizeof(float), vertices.size_bytes());
+
+  // Per-element access still uses doubles
+  EXPECT_EQ(math::Vector3d(2, 0, 0), submesh.Vertex(1));
+  EXPECT_EQ(math::Vector3d(0, 1, 0), submesh.Normal(1));
+  EXPECT_EQ(math::Vector2d(0.25, 0.5), submesh.TexCoord(0));
+  EXPECT_EQ(1, submesh.IndexOfVertex(math::Vector3d(2, 0, 0)));
+  EXPECT_EQ(math::Vector3d(2, 3, 3), submesh.Max());
+  EXPECT_EQ(math::Vector3d(0, 0, 0), submesh.Min());
+
+  submesh.AddVertex(1, 1, 1);
+  submesh.SetNormal(0, math::Vector3d(0, 0, -1));
+  EXPECT_EQ(12u, submesh.Vertices<float>().size());
+  EXPECT_FLOAT_EQ(-1.0f, submesh.Normals<float>()[2]);
+
+  submesh.Translate(math::Vector3d(1, 0, 0));
+  submesh.Scale(2.0);
+  EXPECT_EQ(math::Vector3d(6, 0, 0), submesh.Vertex(1));
+
+  auto mutableTexCoords = submesh.MutableTexCoords<float>();
+  ASSERT_EQ(2u, mutableTexCoords.size());
+  mutableTexCoords[0] = 1;
+  mutableTexCoords[1] = 0;
+  EXPECT_EQ(math::Vector2d(1, 0), submesh.TexCoord(0));
+
+  // Copies keep the precision
+  common::SubMesh copy(submesh);
+  EXPECT_EQ(common::SubMesh::SINGLE_PRECISION, copy.VertexPrecision());
+  EXPECT_EQ(12u, copy.Vertices<float>().size());
+
+  // And back to double precision
+  submesh.SetVertexPrecision(common::SubMesh::DOUBLE_PRECISION);
+  EXPECT_TRUE(submesh.Vertices<float>().empty());
+  ASSERT_EQ(12u, submesh.Vertices().size());
+  EXPECT_DOUBLE_EQ(6.0, submesh.Vertices()[3]);
+  EXPECT_EQ(math::Vector3d(0, 0, -1), submesh.Normal(0));
+}
+
+/////////////////////////////////////////////////
+/// \brief Normals computed by comparing every vertex with every triangle
+std::vector<math::Vector3d> ReferenceNormals(const common::SubMesh &_submesh)
+{
+  std::vector<math::Vector3d> normals(_submesh.VertexCount());
+  for (unsigned int i = 0; i + 2 < _submesh.IndexCount(); i += 3)
+  {
+    math::Vector3d v1 = _submesh.Vertex(_submesh.Index(i));
+    math::Vector3d v2 = _submesh.Vertex(_submesh.Index(i + 1));
+    math::Vector3d v3 = _submesh.Vertex(_submesh.Index(i + 2));
+    math::Vector3d n = math::Vector3d::Normal(v1, v2, v3);
+    for (unsigned int j = 0; j < _submesh.VertexCount(); ++j)
+    {
+      math::Vector3d v = _submesh.Vertex(j);
+      if (v == v1 || v == v2 || v == v3)
+        normals[j] += n;
+    }
+  }
+  for (auto &n : normals)
+    n.Normalize();
+  return normals;
+}
+
+/////////////////////////////////////////////////
+TEST_F(SubMeshTest, RecalculateNormalsSeams)
+{
+  // A bumpy grid where every triangle has its own vertices, like the
+  // meshes of STL files, so the normals are only smooth if the vertices
+  // at the same position are found. It is large enough to be processed in
+  // parallel.
+  const int size = 40;
+  auto height = [](int _x, int _y)
+  {
+    return std::sin(_x * 0.3) * std::cos(_y * 0.2);
+  };
+
+  common::SubMesh submesh;
+  for (int x = 0; x < size; ++x)
+  {
+    for (int y = 0; y < size; ++y)
+    {
+      const math::Vector3d corners[4] = {
+        {x * 0.1, y * 0.1, height(x, y)},
+        {(x + 1) * 0.1, y * 0.1, height(x + 1, y)},
+        {(x + 1) * 0.1, (y + 1) * 0.1, height(x + 1, y + 1)},
+        {x * 0.1, (y + 1) * 0.1, height(x, y + 1)}};
+      for (int c : {0, 1, 2, 0, 2, 3})
+      {
+        submesh.AddIndex(submesh.VertexCount());
+        submesh.AddVertex(corners[c]);
+        submesh.AddNormal(math::Vector3d::UnitZ);
+      }
+    }
+  }
+  ASSERT_GT(submesh.VertexCount(), 4096u);
+
+  const auto expected = ReferenceNormals(submesh);
+  submesh.RecalculateNormals();
+  ASSERT_EQ(expected.size(), submesh.NormalCount());
+  for (unsigned int i = 0; i < submesh.NormalCount(); ++i)
+  {
+    const math::Vector3d normal = submesh.Normal(i);
+    EXPECT_DOUBLE_EQ(expected[i].X(), normal.X()) << i;
+    EXPECT_DOUBLE_EQ(expected[i].Y(), normal.Y()) << i;
+    EXPECT_DOUBLE_EQ(expected[i].Z(), normal.Z()) << i;
+  }
+
+  // Vertices at the same position get the same normal
+  EXPECT_EQ(submesh.Normal(2), submesh.Normal(4));
+
+  // Single precision gives the same normals
+  submesh.SetVertexPrecision(common::SubMesh::SINGLE_PRECISION);
+  submesh.RecalculateNormals();
+  for (unsigned int i = 0; i < submesh.NormalCount(); ++i)
+    EXPECT_TRUE(expected[i].Equal(submesh.Normal(i), 1e-4)) << i;
+}
+
+/////////////////////////////////////////////////
+TEST_F(SubMeshTest, RecalculateNormalsInvalid)
+{
+  common::SubMesh submesh;
+  submesh.AddVertex(0, 0, 0);
+  submesh.AddVertex(1, 0, 0);
+  submesh.AddVertex(0, 1, 0);
+  submesh.AddVertex(0, 0, 0);
+  for (int i = 0; i < 3; ++i)
+    submesh.AddNormal(math::Vector3d::UnitX);
+  submesh.AddIndex(0);
+  submesh.AddIndex(1);
+  submesh.AddIndex(2);
+  // Out of range, and incomplete triangles are ignored
+  submesh.AddIndex(0);
+  submesh.AddIndex(9);
+  submesh.AddIndex(2);
+  submesh.AddIndex(1);
+
+  submesh.RecalculateNormals();
+  ASSERT_EQ(4u, submesh.NormalCount());
+  for (unsigned int i = 0; i < 4; ++i)
+    EXPECT_EQ(math::Vector3d::UnitZ, submesh.Normal(i));
+}
+
+/////////////////////////////////////////////////
+TEST_F(SubMeshTest, VertexHash)
+{
+  for (const auto precision : {common::SubMesh::DOUBLE_PRECISION,
+                               common::SubMesh::SINGLE_PRECISION})
+  {
+    common::SubMesh submesh;
+    submesh.SetVertexPrecision(precision);
+    EXPECT_TRUE(submesh.VertexHashEnabled());
+    EXPECT_EQ(-1, submesh.IndexOfVertex(math::Vector3d::Zero));
+
+    for (int i = 0; i < 1000; ++i)
+      submesh.AddVertex(math::Vector3d(i * 0.5, i % 7, -i * 0.25));
+    submesh.AddVertex(math::Vector3d(10, 3, -5));
+
+    // The first of the duplicate vertices is found
+    EXPECT_EQ(20, submesh.IndexOfVertex(math::Vector3d(10, 6, -5)));
+    EXPECT_EQ(-1, submesh.IndexOfVertex(math::Vector3d(10, 3, -5.1)));
+    EXPECT_EQ(1000, submesh.IndexOfVertex(math::Vector3d(10, 3, -5)));
+
+    // Vertices added after a lookup are found
+    submesh.AddVertex(math::Vector3d(0.5, 6, -5));
+    submesh.AddVertex(math::Vector3d(0, 0, 0));
+    EXPECT_EQ(1001, submesh.IndexOfVertex(math::Vector3d(0.5, 6, -5)));
+    EXPECT_EQ(0, submesh.IndexOfVertex(math::Vector3d::Zero));
+    EXPECT_TRUE(submesh.HasVertex(math::Vector3d(0.5, 1, -0.25)));
+    EXPECT_FALSE(submesh.HasVertex(math::Vector3d(0.5, 1, 0.25)));
+
+    // Lookups see every change to the vertices
+    submesh.SetVertex(0, math::Vector3d(-1, -1, -1));
+    EXPECT_EQ(1002, submesh.IndexOfVertex(math::Vector3d::Zero));
+    EXPECT_EQ(0, submesh.IndexOfVertex(math::Vector3d(-1, -1, -1)));
+
+    submesh.Translate(math::Vector3d(1, 1, 1));
+    EXPECT_EQ(0, submesh.IndexOfVertex(math::Vector3d::Zero));
+    submesh.Scale(2.0);
+    EXPECT_EQ(1002, submesh.IndexOfVertex(math::Vector3d(2, 2, 2)));
+
+    if (precision == common::SubMesh::DOUBLE_PRECISION)
+    {
+      auto values = submesh.MutableVertices();
+      values[3] = 7;
+      values[4] = 8;
+      values[5] = 9;
+    }
+    else
+    {
+      auto values = submesh.MutableVertices<float>();
+      values[3] = 7;
+      values[4] = 8;
+      values[5] = 9;
+    }
+    EXPECT_EQ(1, submesh.IndexOfVertex(math::Vector3d(7, 8, 9)));
+
+    // Writes through a span kept across a lookup need the hash to be
+    // invalidated
+    auto writeKept = [&submesh](auto _kept)
+    {
+      _kept[3] = 1;
+      _kept[4] = 2;
+      _kept[5] = 3;
+      EXPECT_EQ(1, submesh.IndexOfVertex(math::Vector3d(1, 2, 3)));
+      _kept[3] = 4;
+      _kept[4] = 5;
+      _kept[5] = 6;
+      submesh.InvalidateVertexHash();
+      EXPECT_EQ(1, submesh.IndexOfVertex(math::Vector3d(4, 5, 6)));
+      EXPECT_EQ(-1, submesh.IndexOfVertex(math::Vector3d(1, 2, 3)));
+    };
+    if (precision == common::SubMesh::DOUBLE_PRECISION)
+      writeKept(submesh.MutableVertices());
+    else
+      writeKept(submesh.MutableVertices<float>());
+
+    submesh.SetVertexCount(1);
+    EXPECT_EQ(-1, submesh.IndexOfVertex(math::Vector3d(7, 8, 9)));
+    EXPECT_EQ(0, submesh.IndexOfVertex(math::Vector3d::Zero));
+
+    // Without the hash, the results are the same
+    submesh.SetVertexHashEnabled(false);
+    EXPECT_FALSE(submesh.VertexHashEnabled());
+    submesh.AddVertex(math::Vector3d(7, 8, 9));
+    EXPECT_EQ(1, submesh.IndexOfVertex(math::Vector3d(7, 8, 9)));
+    EXPECT_EQ(-1, submesh.IndexOfVertex(math::Vector3d(7, 8, 9.1)));
+    submesh.SetVertexHashEnabled(true);
+    EXPECT_EQ(1, submesh.IndexOfVertex(math::Vector3d(7, 8, 9)));
+  }
+}
+
+/////////////////////////////////////////////////
+TEST_F(SubMeshTest, WeldVertices)
+{
+  // A 2x2 grid of quads, where each triangle has its own vertices
+  common::SubMesh submesh;
+  unsigned int index = 0;
+  for (int x = 0; x < 2; ++x)
+  {
+    for (int y = 0; y < 2; ++y)
+    {
+      const math::Vector3d corners[4] = {
+        {x * 1.0, y * 1.0, 0}, {x + 1.0, y * 1.0, 0},
+        {x + 1.0, y + 1.0, 0}, {x * 1.0, y + 1.0, 0}};
+      for (int c : {0, 1, 2, 0, 2, 3})
+      {
+        submesh.AddVertex(corners[c]);
+        submesh.AddNormal(math::Vector3d::UnitZ);
+        // The quad at (1, 1) has its own texture, which makes a seam
+        submesh.AddTexCoord(x == 1 && y == 1 ? 0.5 : 0.0, 0.0);
+        submesh.AddIndex(index++);
+      }
+    }
+  }
+  submesh.AddNodeAssignment(0, 3, 0.5f);
+  submesh.AddNodeAssignment(3, 4, 0.5f);
+  submesh.AddNodeAssignment(8, 5, 1.0f);
+
+  std::vector<math::Vector3d> triangles;
+  for (unsigned int i : submesh.Indices())
+    triangles.push_back(submesh.Vertex(i));
+
+  // 9 positions, 3 of which are duplicated on the seam
+  EXPECT_EQ(24u - 12u, submesh.WeldVertices());
+  EXPECT_EQ(12u, submesh.VertexCount());
+  EXPECT_EQ(12u, submesh.NormalCount());
+  EXPECT_EQ(12u, submesh.TexCoordCount());
+  ASSERT_EQ(24u, submesh.IndexCount());
+  for (unsigned int i = 0; i < submesh.IndexCount(); ++i)
+    EXPECT_EQ(triangles[i], submesh.Vertex(submesh.Index(i)));
+
+  // The kept vertices are in their original order
+  EXPECT_EQ(math::Vector3d::Zero, submesh.Vertex(0));
+  EXPECT_EQ(math::Vector3d(1, 0, 0), submesh.Vertex(1));
+  EXPECT_EQ(math::Vector3d(1, 1, 0), submesh.Vertex(2));
+  EXPECT_EQ(math::Vector3d(0, 1, 0), submesh.Vertex(3));
+
+  // Assignments of the removed vertex 3 are dropped
+  ASSERT_EQ(2u, submesh.NodeAssignmentsCount());
+  EXPECT_EQ(0u, submesh.NodeAssignmentByIndex(0).vertexIndex);
+  EXPECT_EQ(4u, submesh.NodeAssignmentByIndex(1).vertexIndex);
+  EXPECT_EQ(5u, submesh.NodeAssignmentByIndex(1).nodeIndex);
+
+  EXPECT_EQ(0u, submesh.WeldVertices());
+
+  // Welding by position only, and with a tolerance
+  submesh.SetNormalCount(0);
+  submesh.SetTexCoordCount(0);
+  submesh.SetVertex(11, submesh.Vertex(11) + math::Vector3d(0, 0, 1e-3));
+  EXPECT_EQ(2u, submesh.WeldVertices());
+  EXPECT_EQ(1u, submesh.WeldVertices(1e-2));
+  EXPECT_EQ(9u, submesh.VertexCount());
+  for (unsigned int i = 0; i < submesh.IndexCount(); ++i)
+    EXPECT_TRUE(triangles[i].Equal(submesh.Vertex(submesh.Index(i)), 1e-2));
+}
+
+/////////////////////////////////////////////////
+TEST_F(SubMeshTest, WeldVerticesZeroTolerance)
+{
+  // Every position of a grid twice, plus positions very close to some of
+  // them, which are only merged with a tolerance
+  common::SubMesh submesh;
+  const int size = 64;
+  for (int copy = 0; copy < 2; ++copy)
+  {
+    for (int x = 0; x < size; ++x)
+    {
+      for (int y = 0; y < size; ++y)
+        submesh.AddVertex(x * 0.5, y * 0.25, -1e3);
+    }
+  }
+  for (int x = 0; x < size; ++x)
+    submesh.AddVertex(x * 0.5 + 1e-6, 0, -1e3);
+  for (unsigned int i = 0; i < submesh.VertexCount(); ++i)
+    submesh.AddIndex(i);
+
+  EXPECT_EQ(static_cast<unsigned int>(size * size),
+      submesh.WeldVertices(0.0));
+  EXPECT_EQ(static_cast<unsigned int>(size * size + size),
+      submesh.VertexCount());
+  for (unsigned int i = 0; i < submesh.IndexCount(); ++i)
+  {
+    const unsigned int index = submesh.Index(i);
+    if (i < 2u * size * size)
+      EXPECT_EQ(i % (size * size), index);
+    else
+      EXPECT_EQ(i - size * size, index);
+  }
+
+  EXPECT_EQ(0u, submesh.WeldVertices(0.0));
+  EXPECT_EQ(static_cast<unsigned int>(size), submesh.WeldVertices(1e-5));
+}
+
+/////////////////////////////////////////////////
+TEST_F(SubMeshTest, FillBuffers)
+{
+  common::SubMesh submesh;
+  submesh.AddVertex(0.1, 0.2, 0.3);
+  submesh.AddVertex(-1, 2, 1e10);
+  submesh.AddVertex(4, 5, 6);
+  for (unsigned int i : {2u, 1u, 0u, 0u, 1u, 2u})
+    submesh.AddIndex(i);
+
+  // In the storage precision, the values are exact
+  std::vector<double> vertices(9);
+  std::vector<uint32_t> indices(6);
+  EXPECT_TRUE(submesh.FillBuffers(common::Span<double>(vertices),
+        common::Span<uint32_t>(indices)));
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    EXPECT_EQ(submesh.Vertex(i),
+        math::Vector3d(vertices[i*3], vertices[i*3+1], vertices[i*3+2]));
+  }
+  for (unsigned int i = 0; i < 6; ++i)
+    EXPECT_EQ(submesh.Index(i), indices[i]);
+
+  // Other types, with an offset
+  std::vector<float> verticesf(10, -1.0f);
+  std::vector<uint16_t> indices16(6);
+  EXPECT_TRUE(submesh.FillBuffers(common::Span<float>(verticesf),
+        common::Span<uint16_t>(indices16), 100));
+  for (unsigned int i = 0; i < 9; ++i)
+    EXPECT_FLOAT_EQ(static_cast<float>(vertices[i]), verticesf[i]);
+  EXPECT_FLOAT_EQ(-1.0f, verticesf[9]);
+  for (unsigned int i = 0; i < 6; ++i)
+    EXPECT_EQ(submesh.Index(i) + 100, indices16[i]);
+
+  // Buffers that are too small, and indices that do not fit, are errors
+  // that leave the buffers as they are
+  std::vector<double> small(8, -1.0);
+  std::vector<int> indicesi(6, -1);
+  EXPECT_FALSE(submesh.FillBuffers(common::Span<double>(small),
+        common::Span<int>(indicesi)));
+  EXPECT_FALSE(submesh.FillBuffers(common::Span<double>(vertices),
+        common::Span<int>(indicesi.data(), 5)));
+  EXPECT_FALSE(submesh.FillBuffers(common::Span<float>(verticesf),
+        common::Span<uint16_t>(indices16), 65534));
+  EXPECT_EQ(std::vector<double>(8, -1.0), small);
+  EXPECT_EQ(std::vector<int>(6, -1), indicesi);
+  EXPECT_EQ(102u, indices16[0]);
+
+  // The conversion is the same from single precision
+  submesh.SetVertexPrecision(common::SubMesh::SINGLE_PRECISION);
+  EXPECT_TRUE(submesh.FillBuffers(common::Span<double>(vertices),
+        common::Span<int>(indicesi)));
+  for (unsigned int i = 0; i < 9; ++i)
+    EXPECT_EQ(static_cast<double>(verticesf[i]), vertices[i]);
+  for (unsigned int i = 0; i < 6; ++i)
+    EXPECT_EQ(static_cast<int>(submesh.Index(i)), indicesi[i]);
+
+  // An empty submesh has nothing to fill
+  common::SubMesh empty;
+  EXPECT_TRUE(empty.FillBuffers(common::Span<float>(),
+        common::Span<uint16_t>()));
+}
+
+/////////////////////////////////////////////////
+TEST_F(SubMeshTest, ReorderVertices)
+{
+  common::SubMesh submesh;
+  for (int i = 0; i < 4; ++i)
+  {
+    submesh.AddVertex(i, 0, 0);
+    submesh.AddTexCoord(i, 1);
+    submesh.AddIndex(i);
+  }
+  // Normals are not per vertex, so they are not reordered
+  submesh.AddNormal(0, 0, 1);
+  submesh.AddNodeAssignment(3, 1, 1.0f);
+
+  const std::vector<unsigned int> order = {2, 0, 3, 1};
+  EXPECT_TRUE(submesh.ReorderVertices(order));
+  for (unsigned int i = 0; i < 4; ++i)
+  {
+    EXPECT_EQ(math::Vector3d(order[i], 0, 0), submesh.Vertex(i));
+    EXPECT_EQ(math::Vector2d(order[i], 1), submesh.TexCoord(i));
+    EXPECT_EQ(math::Vector3d(i, 0, 0), submesh.Vertex(submesh.Index(i)));
+  }
+  EXPECT_EQ(1u, submesh.NormalCount());
+  EXPECT_EQ(2u, submesh.NodeAssignmentByIndex(0).vertexIndex);
+  EXPECT_EQ(2, submesh.IndexOfVertex(math::Vector3d(3, 0, 0)));
+
+  // Not permutations
+  const std::vector<unsigned int> duplicate = {0, 1, 1, 2};
+  const std::vector<unsigned int> outOfRange = {0, 1, 2, 4};
+  const std::vector<unsigned int> shorter = {0, 1, 2};
+  EXPECT_FALSE(submesh.ReorderVertices(duplicate));
+  EXPECT_FALSE(submesh.ReorderVertices(outOfRange));
+  EXPECT_FALSE(submesh.ReorderVertices(shorter));
+  EXPECT_EQ(math::Vector3d(2, 0, 0), submesh.Vertex(0));
+}
+
 /////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef IGNITION_COMMON_TEXTPARSER_HH_
+#define IGNITION_COMMON_TEXTPARSER_HH_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ignition
+{
+  namespace common
+  {
+    /// \brief Helpers to parse the text mesh formats, OBJ, ASCII STL and
+    /// the arrays of COLLADA, in place, straight from a memory mapped file
+    /// or an XML element. The text may not be null terminated, so every
+    /// function takes the end of the text. Numbers are parsed
+    /// without the C locale, which strtod and sscanf look up for every
+    /// number, and which breaks on locales with a decimal comma.
+    class TextParser
+    {
+      /// \brief A range of text, [first, second)
+      public: using Range = std::pair<const char *, const char *>;
+
+      /// \brief Split a text into chunks of about _chunkSize bytes, which
+      /// end at the end of a line, to parse them in parallel. Lines end
+      /// with "\n", "\r\n" or a lone "\r", as in tinyobj.
+      /// \param[in] _data The text
+      /// \param[in] _size Size of the text
+      /// \param[in] _chunkSize Size of a chunk
+      /// \return The chunks, in order, which cover the whole text
+      public: static std::vector<Range> SplitLines(const char *_data,
+          const std::size_t _size, const std::size_t _chunkSize)
+      {
+        std::vector<Range> chunks;
+        const char *end = _data + _size;
+        const char *first = _data;
+        while (first < end)
+        {
+          const char *last = end;
+          if (static_cast<std::size_t>(end - first) > _chunkSize)
+          {
+            const char *lineEnd = LineEnd(first + _chunkSize, end);
+            if (lineEnd < end)
+              last = NextLine(lineEnd, end);
+          }
+          chunks.push_back(Range(first, last));
+          first = last;
+        }
+        return chunks;
+      }
+
+      /// \brief Get the end of a line, at the first '\n' or '\r'.
+      /// \param[in] _first Start of the line
+      /// \param[in] _end End of the text
+      /// \return Pointer to the character that ends the line, or _end
+      public: static const char *LineEnd(const char *_first, const char *_end)
+      {
+        // Look for the common '\n' first, then for a '\r' before it
+        const void *newline = std::memchr(_first, '\n',
+            static_cast<std::size_t>(_end - _first));
+        const char *last = newline ? static_cast<const char *>(newline) : _end;
+        const void *carriage = std::memchr(_first, '\r',
+            static_cast<std::size_t>(last - _first));
+        return carriage ? static_cast<const char *>(carriage) : last;
+      }
+
+      /// \brief Get the start of the next line.
+      /// \param[in] _lineEnd End of the line, as returned by LineEnd
+      /// \param[in] _end End of the text
+      /// \return Pointer after the "\n", "\r\n" or "\r" that ends the
+      /// line, or _end.
+      public: static const char *NextLine(const char *_lineEnd,
+          const char *_end)
+      {
+        if (_lineEnd >= _end)
+          return _end;
+        if (_lineEnd + 1 < _end && _lineEnd[0] == '\r' && _lineEnd[1] == '\n')
+          return _lineEnd + 2;
+        return _lineEnd + 1;
+      }
+
+      /// \brief Skip spaces, tabs and carriage returns.
+      /// \param[in,out] _p Current position
+      /// \param[in] _end End of the text
+      public: static void SkipSpaces(const char *&_p, const char *_end)
+      {
+        while (_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\r'))
+          ++_p;
+      }
+
+      /// \brief Skip spaces, then a word.
+      /// \param[in,out] _p Current position
+      /// \param[in] _end End of the text
+      /// \return The word
+      public: static Range Word(const char *&_p, const char *_end)
+      {
+        SkipSpaces(_p, _end);
+        const char *first = _p;
+        while (_p < _end && *_p != ' ' && *_p != '\t' && *_p != '\r' &&
+               *_p != '\n')
+        {
+          ++_p;
+        }
+        return Range(first, _p);
+      }
+
+      /// \brief Get whether a character is a decimal digit.
+      /// \param[in] _c The character
+      /// \return True for '0' to '9'
+      public: static bool IsDigit(const char _c)
+      {
+        return static_cast<unsigned int>(_c - '0') < 10u;
+      }
+
+      /// \brief Skip spaces, then parse an integer, like atoi.
+      /// \param[in,out] _p Current position, moved after the integer
+      /// \param[in] _end End of the text
+      /// \param[out] _value The integer
+      /// \return False if there is no integer, in which case _p is not moved
+      public: static bool ParseInt(const char *&_p, const char *_end,
+          int &_value)
+      {
+        const char *p = _p;
+        SkipSpaces(p, _end);
+        bool negative = false;
+        if (p < _end && (*p == '-' || *p == '+'))
+          negative = *p++ == '-';
+        if (p == _end || !IsDigit(*p))
+          return false;
+
+        int64_t value = 0;
+        for (; p < _end && IsDigit(*p); ++p)
+        {
+          if (value < (int64_t(1) << 32))
+            value = value * 10 + (*p - '0');
+        }
+        _value = static_cast<int>(negative ? -value : value);
+        _p = p;
+        return true;
+      }
+
+      /// \brief Skip spaces, then parse a decimal number such as "-1.5e-3".
+      /// The result is exact for the numbers with up to 15 significant
+      /// digits and small exponents found in meshes, and correctly rounded
+      /// through a slower path for the others.
+      /// \param[in,out] _p Current position, moved after the number
+      /// \param[in] _end End of the text
+      /// \param[out] _value The number
+      /// \return False if there is no number, in which case _p is not moved
+      public: static bool ParseDouble(const char *&_p, const char *_end,
+          double &_value)
+      {
+        // Powers of ten that are exact doubles
+        static const double powers[] = {
+          1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+        const char *p = _p;
+        SkipSpaces(p, _end);
+        const char *first = p;
+
+        bool negative = false;
+        if (p < _end && (*p == '-' || *p == '+'))
+          negative = *p++ == '-';
+
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        bool digits = false;
+        bool truncated = false;
+        for (; p < _end && IsDigit(*p); ++p)
+        {
+          digits = true;
+          if (mantissa < 100000000000000000ULL)
+            mantissa = mantissa * 10 + static_cast<unsigned int>(*p - '0');
+          else
+          {
+            ++exponent;
+            truncated = truncated || *p != '0';
+          }
+        }
+        if (p < _end && *p == '.')
+        {
+          for (++p; p < _end && IsDigit(*p); ++p)
+          {
+            digits = true;
+            if (mantissa < 100000000000000000ULL)
+            {
+              mantissa = mantissa * 10 + static_cast<unsigned int>(*p - '0');
+              --exponent;
+            }
+            else
+            {
+              truncated = truncated || *p != '0';
+            }
+          }
+        }
+        if (!digits)
+          return false;
+
+        // The exponent is only consumed if it has digits, like strtod
+        if (p < _end && (*p == 'e' || *p == 'E'))
+        {
+          const char *e = p + 1;
+          bool negativeExponent = false;
+          if (e < _end && (*e == '-' || *e == '+'))
+            negativeExponent = *e++ == '-';
+          if (e < _end && IsDigit(*e))
+          {
+            int value = 0;
+            for (; e < _end && IsDigit(*e); ++e)
+            {
+              if (value < 100000)
+                value = value * 10 + (*e - '0');
+            }
+            exponent += negativeExponent ? -value : value;
+            p = e;
+          }
+        }
+
+        double value;
+        if (!truncated && mantissa <= (1ULL << 53) &&
+            exponent >= -22 && exponent <= 22)
+        {
+          // Both the mantissa and the power of ten are exact, so a single
+          // rounding gives the correctly rounded result.
+          value = static_cast<double>(mantissa);
+          value = exponent < 0 ? value / powers[-exponent] :
+            value * powers[exponent];
+          if (negative)
+            value = -value;
+        }
+        else
+        {
+          std::istringstream stream(std::string(first, p));
+          stream.imbue(std::locale::classic());
+          if (!(stream >> value))
+          {
+            value = static_cast<double>(mantissa) *
+              std::pow(10.0, static_cast<double>(exponent));
+            if (negative)
+              value = -value;
+          }
+        }
+
+        _value = value;
+        _p = p;
+        return true;
+      }
+
+      /// \brief Get whether a character is whitespace, including line ends.
+      /// \param[in] _c The character
+      /// \return True for spaces, tabs, carriage returns and newlines
+      public: static bool IsSpace(const char _c)
+      {
+        return _c == ' ' || _c == '\t' || _c == '\r' || _c == '\n';
+      }
+
+      /// \brief Parse the next number of a list separated by whitespace,
+      /// including line ends, such as the arrays of COLLADA files. A token
+      /// that is not a number as a whole is skipped and gives NaN, like
+      /// math::parseFloat.
+      /// \param[in,out] _p Current position, moved after the token
+      /// \param[in] _end End of the text
+      /// \param[out] _value The number
+      /// \return False at the end of the text
+      public: static bool NextDouble(const char *&_p, const char *_end,
+          double &_value)
+      {
+        while (_p < _end && IsSpace(*_p))
+          ++_p;
+        if (_p == _end)
+          return false;
+
+        if (!ParseDouble(_p, _end, _value) || (_p < _end && !IsSpace(*_p)))
+        {
+          _value = std::numeric_limits<double>::quiet_NaN();
+          while (_p < _end && !IsSpace(*_p))
+            ++_p;
+        }
+        return true;
+      }
+
+      /// \brief Parse the next integer of a list separated by whitespace,
+      /// including line ends. A token that is not an integer as a whole is
+      /// skipped and gives 0, like math::parseInt.
+      /// \param[in,out] _p Current position, moved after the token
+      /// \param[in] _end End of the text
+      /// \param[out] _value The integer
+      /// \return False at the end of the text
+      public: static bool NextInt(const char *&_p, const char *_end,
+          int &_value)
+      {
+        while (_p < _end && IsSpace(*_p))
+          ++_p;
+        if (_p == _end)
+          return false;
+
+        if (!ParseInt(_p, _end, _value) || (_p < _end && !IsSpace(*_p)))
+        {
+          _value = 0;
+          while (_p < _end && !IsSpace(*_p))
+            ++_p;
+        }
+        return true;
+      }
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef IGNITION_COMMON_VERTEXHASH_HH_
+#define IGNITION_COMMON_VERTEXHASH_HH_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <ignition/math/Vector3.hh>
+
+namespace ignition
+{
+  namespace common
+  {
+    /// \brief Spatial hash of vertex positions on a uniform grid. It finds
+    /// the vertices that may be within a tolerance of a position, per
+    /// component, in constant expected time. The caller compares the
+    /// candidates with the tolerance it needs.
+    ///
+    /// Positions that are not finite are never returned as candidates,
+    /// since they compare unequal to everything.
+    template<typename T>
+    class VertexHash
+    {
+      /// \brief Constructor
+      /// \param[in] _tolerance Largest difference per component between
+      /// two positions that must be found as neighbors. A zero tolerance
+      /// uses the smallest cell size, so only nearly equal positions share
+      /// a cell.
+      public: explicit VertexHash(const double _tolerance)
+        : cellSize(std::max(MinCellSize, 2.0 * _tolerance))
+      {
+      }
+
+      /// \brief Index all the vertices of an array, replacing the current
+      /// content.
+      /// \param[in] _values The positions of the vertices, three values
+      /// per vertex. Vertex i gets index i.
+      /// \param[in] _count Number of vertices
+      public: void Build(const T *_values, const std::size_t _count)
+      {
+        this->cells.clear();
+        this->next.clear();
+        this->cells.reserve(_count);
+        this->next.reserve(_count);
+
+        std::size_t size = 16;
+        while (size < 2 * _count)
+          size *= 2;
+        this->table.assign(size, Empty);
+        this->used = 0;
+
+        for (std::size_t i = 0; i < _count; ++i)
+        {
+          const T *v = _values + 3 * i;
+          this->Insert(math::Vector3<T>(v[0], v[1], v[2]));
+        }
+      }
+
+      /// \brief Add a vertex, with the next index.
+      /// \param[in] _vertex Position of the vertex
+      public: void Insert(const math::Vector3<T> &_vertex)
+      {
+        const uint32_t index = static_cast<uint32_t>(this->cells.size());
+        this->cells.push_back(this->CellOf(_vertex));
+        this->next.push_back(Empty);
+
+        const Cell &cell = this->cells.back();
+        if (!cell.valid)
+          return;
+
+        if (2 * (this->used + 1) > this->table.size())
+          this->Grow();
+
+        std::size_t slot = this->Find(cell);
+        if (this->table[slot] == Empty)
+          ++this->used;
+        else
+          this->next[index] = this->table[slot];
+        this->table[slot] = index;
+      }
+
+      /// \brief Get the number of vertices indexed.
+      /// \return The number of vertices.
+      public: std::size_t Size() const
+      {
+        return this->cells.size();
+      }
+
+      /// \brief Call a function for every vertex that may be within the
+      /// tolerance of a position, in no particular order.
+      /// \param[in] _pos The position
+      /// \param[in] _func Function called with the index of each candidate.
+      /// It may return false to stop the search early.
+      /// \return False if _func stopped the search.
+      public: template<typename F>
+              bool ForEachNear(const math::Vector3<T> &_pos, F &&_func) const
+      {
+        const Cell center = this->CellOf(_pos);
+        if (!center.valid || this->table.empty())
+          return true;
+
+        for (int64_t dx = -1; dx <= 1; ++dx)
+        {
+          for (int64_t dy = -1; dy <= 1; ++dy)
+          {
+            for (int64_t dz = -1; dz <= 1; ++dz)
+            {
+              Cell cell{center.x + dx, center.y + dy, center.z + dz, true};
+              const uint32_t first = this->table[this->Find(cell)];
+              for (uint32_t i = first; i != Empty; i = this->next[i])
+              {
+                if (!_func(i))
+                  return false;
+              }
+            }
+          }
+        }
+        return true;
+      }
+
+      /// \brief Cell of the grid
+      private: struct Cell
+      {
+        /// \brief Coordinate along x
+        int64_t x;
+
+        /// \brief Coordinate along y
+        int64_t y;
+
+        /// \brief Coordinate along z
+        int64_t z;
+
+        /// \brief False if the position is not finite
+        bool valid;
+
+        /// \brief Equality operator
+        /// \param[in] _other Cell to compare with
+        /// \return True if the coordinates are the same
+        bool operator==(const Cell &_other) const
+        {
+          return this->x == _other.x && this->y == _other.y &&
+            this->z == _other.z;
+        }
+      };
+
+      /// \brief Get the cell of a position.
+      /// \param[in] _pos The position
+      /// \return The cell
+      private: Cell CellOf(const math::Vector3<T> &_pos) const
+      {
+        Cell cell{0, 0, 0, true};
+        int64_t *coords[3] = {&cell.x, &cell.y, &cell.z};
+        // Coordinates far out of the range of int64_t share the cells at
+        // the end of the range, which stays correct but slower.
+        const double limit = 4.0e18;
+        for (int i = 0; i < 3; ++i)
+        {
+          const double value = static_cast<double>(_pos[i]);
+          if (!std::isfinite(value))
+          {
+            cell.valid = false;
+            return cell;
+          }
+          double c = std::floor(value / this->cellSize);
+          c = std::max(-limit, std::min(limit, c));
+          *coords[i] = static_cast<int64_t>(c);
+        }
+        return cell;
+      }
+
+      /// \brief Find the slot of the table for a cell.
+      /// \param[in] _cell The cell
+      /// \return Slot holding the first vertex of the cell, or the empty
+      /// slot where it would go.
+      private: std::size_t Find(const Cell &_cell) const
+      {
+        uint64_t h = static_cast<uint64_t>(_cell.x) * 0x9E3779B97F4A7C15ull;
+        h ^= static_cast<uint64_t>(_cell.y) * 0xC2B2AE3D27D4EB4Full;
+        h ^= static_cast<uint64_t>(_cell.z) * 0x165667B19E3779F9ull;
+        h ^= h >> 29;
+
+        const std::size_t mask = this->table.size() - 1;
+        std::size_t slot = static_cast<std::size_t>(h) & mask;
+        while (this->table[slot] != Empty &&
+               !(this->cells[this->table[slot]] == _cell))
+        {
+          slot = (slot + 1) & mask;
+        }
+        return slot;
+      }
+
+      /// \brief Double the size of the table.
+      private: void Grow()
+      {
+        std::vector<uint32_t> old;
+        old.swap(this->table);
+        this->table.assign(std::max<std::size_t>(16, old.size() * 2), Empty);
+        for (const uint32_t first : old)
+        {
+          if (first != Empty)
+            this->table[this->Find(this->cells[first])] = first;
+        }
+      }
+
+      /// \brief Marks an empty slot, and the end of a chain
+      private: static constexpr uint32_t Empty =
+                 std::numeric_limits<uint32_t>::max();
+
+      /// \brief Smallest size of the cells. A zero size would put every
+      /// vertex in the cells at the ends of the range. Coordinates up to
+      /// about 4e9 still get distinct cells.
+      private: static constexpr double MinCellSize = 1e-9;
+
+      /// \brief Size of the cells
+      private: double cellSize;
+
+      /// \brief Open addressing table of cells, holding the last vertex
+      /// inserted in each cell.
+      private: std::vector<uint32_t> table;
+
+      /// \brief Number of slots used in the table
+      private: std::size_t used = 0;
+
+      /// \brief Cell of each vertex
+      private: std::vector<Cell> cells;
+
+      /// \brief Previous vertex inserted in the same cell, for each vertex
+      private: std::vector<uint32_t> next;
+    };
+  }
+}
+
+#endif
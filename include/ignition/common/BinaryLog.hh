@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_COMMON_BINARYLOG_HH_
+#define IGNITION_COMMON_BINARYLOG_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ignition/common/Export.hh>
+#include <ignition/common/SuppressWarning.hh>
+
+namespace ignition
+{
+  namespace common
+  {
+    // Forward declarations
+    class BinaryLogReaderPrivate;
+
+    /// \class BinaryLogRecord BinaryLog.hh ignition/common/BinaryLog.hh
+    /// \brief A message decoded from a binary log file.
+    class IGNITION_COMMON_VISIBLE BinaryLogRecord
+    {
+      /// \brief Get the message, with the arguments in place of the "{}"
+      /// of the format.
+      /// \return The message.
+      public: std::string Text() const;
+
+      /// \brief Get the message as a line of a text log file, with the
+      /// time, level, thread and source location.
+      /// \return The line, without a trailing newline.
+      public: std::string ToString() const;
+
+      /// \brief Time the message was written.
+      public: std::chrono::system_clock::time_point time;
+
+      /// \brief Level of the message, 0 for text written to the logger.
+      public: int level = 0;
+
+      /// \brief Small id of the thread that wrote the message, numbered
+      /// from 1 in order of first use.
+      public: uint32_t thread = 0;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Source file, empty for text written to the logger.
+      public: std::string file;
+
+      /// \brief Line in the source file.
+      public: int line = 0;
+
+      /// \brief Format string.
+      public: std::string format;
+
+      /// \brief Arguments, as text.
+      public: std::vector<std::string> args;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+
+    /// \class BinaryLogReader BinaryLog.hh ignition/common/BinaryLog.hh
+    /// \brief Reads the binary log files written by FileLogger, see
+    /// FileLogger::InitBinary.
+    ///
+    /// \code
+    ///   BinaryLogReader reader(path);
+    ///   BinaryLogRecord record;
+    ///   while (reader.Next(record))
+    ///     std::cout << record.ToString() << std::endl;
+    /// \endcode
+    class IGNITION_COMMON_VISIBLE BinaryLogReader
+    {
+      /// \brief Constructor, opens a file.
+      /// \param[in] _filename Path of the binary log file.
+      public: explicit BinaryLogReader(const std::string &_filename);
+
+      /// \brief Destructor.
+      public: ~BinaryLogReader();
+
+      /// \brief Get whether the file was opened and has a valid header.
+      /// \return True if the file can be read.
+      public: bool Valid() const;
+
+      /// \brief Read the next message.
+      /// \param[out] _record The message.
+      /// \return False at the end of the file, or if the rest of the file
+      /// is truncated or corrupt.
+      public: bool Next(BinaryLogRecord &_record);
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer.
+      private: std::unique_ptr<BinaryLogReaderPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+  }
+}
+#endif
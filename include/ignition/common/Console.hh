@@ -17,10 +17,16 @@
 #ifndef IGNITION_COMMON_CONSOLE_HH_
 #define IGNITION_COMMON_CONSOLE_HH_
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <ignition/common/Util.hh>
 #include <ignition/common/Export.hh>
@@ -60,6 +66,85 @@ namespace ignition
     #define ignLogDirectory()\
         (ignition::common::Console::log.LogDirectory())
 
+    /// \brief Initialize a binary log file, see FileLogger::InitBinary.
+    /// \param[in] _dir Name of directory in which to store the log file.
+    /// \param[in] _file Name of the log file.
+    #define ignLogInitBinary(_dir, _file)\
+        ignition::common::Console::log.InitBinary(_dir, _file)
+
+    /// \brief Write a structured message to the log file, regardless of
+    /// verbosity level. The format is a string literal in which each "{}"
+    /// is replaced by the next argument. It is interned once per call site,
+    /// so a binary log only stores its id and the arguments.
+    ///
+    /// \code
+    ///   ignlogf(3, "Reached waypoint {} at {} m/s")(index, speed);
+    /// \endcode
+    /// \param[in] _level Level of the message, like the verbosity levels:
+    /// 1 for errors to 4 for debug messages.
+    /// \param[in] _format Format string literal.
+    #define ignlogf(_level, _format)\
+        ([]() -> const ignition::common::LogFormat &\
+        {\
+          static const ignition::common::LogFormat ignLogFormat(\
+              _level, __FILE__, __LINE__, _format);\
+          return ignLogFormat;\
+        }())
+
+    /// \class LogFormat Console.hh ignition/common/Console.hh
+    /// \brief Format of a structured log message, interned once per call
+    /// site. See ignlogf.
+    class IGNITION_COMMON_VISIBLE LogFormat
+    {
+      /// \brief Constructor, assigns a unique id.
+      /// \param[in] _level Level of the messages.
+      /// \param[in] _file Source file, with static storage duration.
+      /// \param[in] _line Line in the source file.
+      /// \param[in] _format Format string, with static storage duration.
+      public: LogFormat(const int _level, const char *_file, const int _line,
+                        const char *_format);
+
+      /// \brief Write a message with this format to Console::log.
+      /// \param[in] _args Arguments that replace the "{}" of the format.
+      public: template<typename ... Args>
+              void operator()(const Args &... _args) const;
+
+      /// \brief Get the unique id of the format, never zero.
+      /// \return The id.
+      public: uint32_t Id() const;
+
+      /// \brief Get the level of the messages.
+      /// \return The level.
+      public: int Level() const;
+
+      /// \brief Get the source file.
+      /// \return The source file.
+      public: const char *File() const;
+
+      /// \brief Get the line in the source file.
+      /// \return The line.
+      public: int Line() const;
+
+      /// \brief Get the format string.
+      /// \return The format string.
+      public: const char *Format() const;
+
+      /// \brief Unique id
+      private: uint32_t id;
+
+      /// \brief Level of the messages
+      private: int level;
+
+      /// \brief Source file
+      private: const char *file;
+
+      /// \brief Line in the source file
+      private: int line;
+
+      /// \brief Format string
+      private: const char *format;
+    };
+
     /// \class FileLogger FileLogger.hh common/common.hh
     /// \brief A logger that outputs messages to a file.
     class IGNITION_COMMON_VISIBLE FileLogger : public std::ostream
@@ -78,6 +163,60 @@ namespace ignition
       public: void Init(const std::string &_directory,
                         const std::string &_filename);
 
+      /// \brief Initialize the file logger to write a binary log file,
+      /// made of fixed-layout records: timestamp, level, format id, thread
+      /// id and arguments. Each format is written once, the first time it
+      /// is used. Text written to the logger becomes one record per line.
+      /// Records are buffered, and written to disk when the logger is
+      /// flushed or closed. Use BinaryLogReader or the ign_log_decode4 tool
+      /// to read the file.
+      /// \param[in] _directory Name of directory that holds the log file.
+      /// \param[in] _filename Name of the log file to write output into.
+      /// \sa ignlogf
+      public: void InitBinary(const std::string &_directory,
+                              const std::string &_filename);
+
+      /// \brief Get whether the log file is binary.
+      /// \return True if the logger was initialized with InitBinary.
+      public: bool Binary() const;
+
+      /// \brief Write a structured message. In a binary log file, this
+      /// writes the format id and the arguments, otherwise the formatted
+      /// text.
+      /// \param[in] _format Format of the message.
+      /// \param[in] _args Arguments that replace the "{}" of the format.
+      /// \sa ignlogf
+      public: template<typename ... Args>
+              void Write(const LogFormat &_format, const Args &... _args);
+
+      /// \brief Write complete lines of text straight to the log file,
+      /// without going through the stream buffer of this logger, so that
+      /// it can be called while other threads write to the logger. In a
+      /// binary log file, each line becomes a record.
+      /// \param[in] _text Lines of text, each ending with a newline.
+      public: void WriteLines(const std::string &_text);
+
+      /// \brief Write complete lines of text of a message straight to the
+      /// log file, like WriteLines. In a binary log file, each record keeps
+      /// the time, level and thread of the message instead of the ones of
+      /// the calling thread.
+      /// \param[in] _text Lines of text, each ending with a newline.
+      /// \param[in] _time When the message was logged.
+      /// \param[in] _level Level of the message, 1 for errors to 4 for
+      /// debug messages, or 0 for none.
+      /// \param[in] _thread Id of the thread that logged the message, see
+      /// ThreadId.
+      /// \param[in] _flush True to flush the log file.
+      public: void WriteLines(const std::string &_text,
+                  const std::chrono::system_clock::time_point &_time,
+                  const int _level, const uint32_t _thread,
+                  const bool _flush);
+
+      /// \brief Get the id of the calling thread in binary log files.
+      /// Threads are numbered from 1 in order of first use.
+      /// \return The id.
+      public: static uint32_t ThreadId();
+
       /// \brief Output a filename and line number, then return a reference
       /// to the logger.
       /// \return Reference to this logger.
@@ -111,10 +250,67 @@ namespace ignition
                    /// \return Return 0 on success.
                    public: virtual int sync();
 
+                   /// \brief Write a record to a binary log file, with
+                   /// the current time, the level of the format and the
+                   /// calling thread.
+                   /// \param[in] _format Format of the record.
+                   /// \param[in] _args Encoded arguments.
+                   /// \param[in] _argCount Number of arguments.
+                   public: void WriteRecord(const LogFormat *_format,
+                               const std::string &_args,
+                               const uint16_t _argCount);
+
+                   /// \brief Write a record to a binary log file.
+                   /// \param[in] _format Format of the record, or null
+                   /// for a line of text.
+                   /// \param[in] _args Encoded arguments.
+                   /// \param[in] _argCount Number of arguments.
+                   /// \param[in] _time When the message was logged.
+                   /// \param[in] _level Level of the message.
+                   /// \param[in] _thread Thread that logged the message.
+                   public: void WriteRecord(const LogFormat *_format,
+                               const std::string &_args,
+                               const uint16_t _argCount,
+                               const std::chrono::system_clock::time_point
+                                 &_time,
+                               const int _level, const uint32_t _thread);
+
+                   /// \brief Write lines of text to the stream, one
+                   /// record per line in a binary log file.
+                   /// \param[in] _text Text to write
+                   /// \param[in] _time When the text was logged.
+                   /// \param[in] _level Level of the text, or 0.
+                   /// \param[in] _thread Thread that logged the text.
+                   /// \return Length of the text after the last newline,
+                   /// which is not written to a binary log file.
+                   public: std::size_t WriteText(const std::string &_text,
+                               const std::chrono::system_clock::time_point
+                                 &_time,
+                               const int _level, const uint32_t _thread);
+
                    /// \brief Stream to output information into.
                    public: std::ofstream *stream;
+
+                   /// \brief True if the stream is a binary log file.
+                   public: std::atomic<bool> binary{false};
+
+                   IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+                   /// \brief Whether each format id was written to the
+                   /// binary log file.
+                   public: std::vector<bool> writtenFormats;
+
+                   /// \brief Serializes the writes to the stream.
+                   public: std::mutex mutex;
+                   IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
                  };
 
+      /// \brief Open the log file.
+      /// \param[in] _directory Name of directory that holds the log file.
+      /// \param[in] _filename Name of the log file to write output into.
+      /// \param[in] _binary True for a binary log file.
+      private: void Open(const std::string &_directory,
+                         const std::string &_filename, const bool _binary);
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \brief Stores the full path of the directory where all the log files
       /// are stored.
@@ -181,6 +377,20 @@ namespace ignition
                    /// \return Return 0 on success.
                    public: virtual int sync();
 
+                   /// \brief Append a character to the message of the
+                   /// calling thread.
+                   /// \param[in] _c Character to append.
+                   /// \return _c, or EOF on failure.
+                   protected: virtual int_type overflow(int_type _c);
+
+                   /// \brief Append characters to the message of the
+                   /// calling thread.
+                   /// \param[in] _s Characters to append.
+                   /// \param[in] _n Number of characters.
+                   /// \return Number of characters appended.
+                   protected: virtual std::streamsize xsputn(
+                                  const char *_s, std::streamsize _n);
+
                    /// \brief Destination type for the messages.
                    public: LogType type;
 
@@ -191,6 +401,13 @@ namespace ignition
 
                    /// \brief Level of verbosity
                    public: int verbosity;
+
+                   IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+                   /// \brief Message used by threads whose thread local
+                   /// message buffers were already destroyed, during
+                   /// shutdown.
+                   public: std::string fallback;
+                   IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
                  };
 
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
@@ -238,6 +455,42 @@ namespace ignition
       /// \sa void SetPrefix(const std::string &_customPrefix)
       public: static std::string Prefix();
 
+      /// \brief Enable or disable asynchronous logging. By default, the
+      /// loggers write every message to the terminal and to the log file
+      /// on the calling thread, flushing after each write.
+      ///
+      /// In asynchronous mode, each thread composes its messages in its own
+      /// buffer, without locking. A complete message, one that ends with a
+      /// newline, is pushed into a bounded lock-free queue, and a
+      /// background thread does the timestamp formatting, the terminal
+      /// output and the file I/O, in batches. When the queue is full the
+      /// message is dropped and counted, see DroppedCount; logging never
+      /// blocks the caller.
+      ///
+      /// Messages written directly to the file logger, with ignlog, are
+      /// not affected.
+      /// \param[in] _async True to enable asynchronous logging.
+      /// \param[in] _queueSize Maximum number of messages waiting to be
+      /// written, rounded up to a power of two.
+      /// \sa Flush()
+      public: static void SetAsync(const bool _async,
+                                   const std::size_t _queueSize = 4096);
+
+      /// \brief Get whether asynchronous logging is enabled.
+      /// \return True if messages are written by a background thread.
+      /// \sa SetAsync(const bool _async, const std::size_t _queueSize)
+      public: static bool Async();
+
+      /// \brief Wait until the background thread has written the messages
+      /// that were queued before this call, including the incomplete
+      /// message of the calling thread. Does nothing in synchronous mode.
+      public: static void Flush();
+
+      /// \brief Get the number of messages dropped because the queue was
+      /// full, since asynchronous logging was last enabled.
+      /// \return Number of dropped messages.
+      public: static uint64_t DroppedCount();
+
       /// \brief Global instance of the message logger.
       public: static Logger msg;
 
@@ -263,4 +516,7 @@ namespace ignition
     };
   }
 }
+
+#include <ignition/common/detail/Console.hh>
+
 #endif
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_COMMON_SPAN_HH_
+#define IGNITION_COMMON_SPAN_HH_
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace ignition
+{
+  namespace common
+  {
+    /// \class Span Span.hh ignition/common/Span.hh
+    /// \brief A non-owning view of contiguous elements, with the interface
+    /// of a subset of C++20 std::span. A Span is only valid as long as the
+    /// storage it refers to is neither destroyed nor resized.
+    ///
+    /// \code
+    ///   std::vector<float> values(10);
+    ///   Span<float> view(values);
+    ///   for (float &v : view)
+    ///     v = 1.0f;
+    ///   Span<const float> constView = view;
+    /// \endcode
+    template<typename T>
+    class Span
+    {
+      /// \brief Type of the elements
+      public: using element_type = T;
+
+      /// \brief Type of the elements, without const
+      public: using value_type = std::remove_cv_t<T>;
+
+      /// \brief Type of the element count
+      public: using size_type = std::size_t;
+
+      /// \brief Iterator type
+      public: using iterator = T *;
+
+      /// \brief Constructor of an empty span
+      public: constexpr Span() noexcept = default;
+
+      /// \brief Constructor
+      /// \param[in] _data First element
+      /// \param[in] _size Number of elements
+      public: constexpr Span(T *_data, const std::size_t _size) noexcept
+        : ptr(_data), count(_size)
+      {
+      }
+
+      /// \brief Constructor from a contiguous container, such as
+      /// std::vector or std::array.
+      /// \param[in] _container The container
+      public: template<typename Container,
+        typename = std::enable_if_t<
+          !std::is_base_of_v<Span, std::decay_t<Container>> &&
+          std::is_convertible_v<
+            std::remove_pointer_t<
+              decltype(std::declval<Container &>().data())> (*)[],
+            T (*)[]>>>
+      constexpr Span(Container &_container) noexcept
+        : ptr(_container.data()), count(_container.size())
+      {
+      }
+
+      /// \brief Conversion from a span of non-const elements to a span of
+      /// const elements.
+      /// \param[in] _other The other span
+      public: template<typename U,
+        typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+      constexpr Span(const Span<U> &_other) noexcept
+        : ptr(_other.data()), count(_other.size())
+      {
+      }
+
+      /// \brief Get the first element.
+      /// \return Pointer to the first element, which may be null if the
+      /// span is empty.
+      public: constexpr T *data() const noexcept
+      {
+        return this->ptr;
+      }
+
+      /// \brief Get the number of elements.
+      /// \return The number of elements.
+      public: constexpr std::size_t size() const noexcept
+      {
+        return this->count;
+      }
+
+      /// \brief Get the size of the elements in bytes.
+      /// \return The number of bytes.
+      public: constexpr std::size_t size_bytes() const noexcept
+      {
+        return this->count * sizeof(T);
+      }
+
+      /// \brief Get whether the span has no elements.
+      /// \return True if the span is empty.
+      public: constexpr bool empty() const noexcept
+      {
+        return this->count == 0;
+      }
+
+      /// \brief Access an element, without bounds checking.
+      /// \param[in] _index Index of the element
+      /// \return The element.
+      public: constexpr T &operator[](const std::size_t _index) const
+      {
+        return this->ptr[_index];
+      }
+
+      /// \brief Get the first element. The span must not be empty.
+      /// \return The first element.
+      public: constexpr T &front() const
+      {
+        return this->ptr[0];
+      }
+
+      /// \brief Get the last element. The span must not be empty.
+      /// \return The last element.
+      public: constexpr T &back() const
+      {
+        return this->ptr[this->count - 1];
+      }
+
+      /// \brief Get an iterator to the first element.
+      /// \return The iterator.
+      public: constexpr iterator begin() const noexcept
+      {
+        return this->ptr;
+      }
+
+      /// \brief Get an iterator past the last element.
+      /// \return The iterator.
+      public: constexpr iterator end() const noexcept
+      {
+        return this->ptr + this->count;
+      }
+
+      /// \brief Get a view of part of the elements. The range must be
+      /// inside the span.
+      /// \param[in] _offset Index of the first element
+      /// \param[in] _count Number of elements
+      /// \return The view.
+      public: constexpr Span subspan(const std::size_t _offset,
+                  const std::size_t _count) const
+      {
+        return Span(this->ptr + _offset, _count);
+      }
+
+      /// \brief First element
+      private: T *ptr = nullptr;
+
+      /// \brief Number of elements
+      private: std::size_t count = 0;
+    };
+  }
+}
+
+#endif
@@ -20,6 +20,8 @@
 
 #include <functional>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 #include <ignition/common/Export.hh>
 #include <ignition/common/Time.hh>
@@ -31,10 +33,170 @@ namespace ignition
   {
     /// \brief forward declaration
     class WorkerPoolPrivate;
+    class WorkerPool;
+    class TaskGroup;
+
+    namespace detail
+    {
+      class ParallelForState;
+      class TaskStateBase;
+      class TaskGroupState;
+      class WorkItem;
+      template <typename T> class TaskState;
+
+      /// \brief Type returned by a callable submitted to a WorkerPool.
+      template <typename Func>
+      using TaskResult = std::invoke_result_t<std::decay_t<Func>&>;
+
+      /// \brief Enables the templated WorkerPool::AddWork for callables
+      /// other than std::function<void()>, which use the overload taking a
+      /// callback.
+      template <typename Func>
+      using EnableIfWork = std::enable_if_t<
+        !std::is_same<std::decay_t<Func>, std::function<void()>>::value &&
+        std::is_invocable<std::decay_t<Func>&>::value>;
+    }
+
+    /// \brief Type-erased handle to a piece of work submitted through
+    /// WorkerPool::Submit or TaskGroup::Submit. Handles are cheap to copy
+    /// and all copies refer to the same piece of work. A list of handles is
+    /// used to express the dependencies of a continuation, see
+    /// WorkerPool::SubmitAfter.
+    class TaskHandleBase
+    {
+      /// \brief Default constructor. Creates an invalid handle.
+      public: TaskHandleBase() = default;
+
+      /// \brief Get whether this handle refers to a piece of work.
+      /// \return True if this handle was returned by a Submit call.
+      public: bool Valid() const;
+
+      /// \brief Get whether the work has finished, either by returning or
+      /// by throwing an exception.
+      /// \return True if the work has finished, false if it hasn't or if
+      /// this handle is invalid.
+      public: bool Ready() const;
+
+      /// \brief Wait until the work has finished.
+      /// \param[in] _timeout How long to wait, default to forever
+      /// \return True if the work finished, false on timeout or if this
+      /// handle is invalid.
+      /// \note Waiting from inside a worker thread of the same pool may
+      /// deadlock if every other worker is waiting as well.
+      public: bool Wait(const Time &_timeout = Time::Zero) const;
+
+      /// \brief Constructor used by the WorkerPool.
+      /// \param[in] _state State shared with the submitted work.
+      protected: explicit TaskHandleBase(
+                     std::shared_ptr<detail::TaskStateBase> _state);
+
+      /// \brief State shared with the submitted work.
+      protected: std::shared_ptr<detail::TaskStateBase> state;
+
+      /// \brief The pool resolves dependencies through the shared state.
+      friend class WorkerPool;
+    };
+
+    /// \brief Future-like handle to the result of a piece of work submitted
+    /// through WorkerPool::Submit or TaskGroup::Submit.
+    /// \tparam T Type returned by the work.
+    template <typename T>
+    class TaskHandle : public TaskHandleBase
+    {
+      /// \brief Type returned by Get(), a const reference to the result,
+      /// or void.
+      public: using GetType = std::conditional_t<std::is_void<T>::value,
+                  void, std::add_lvalue_reference_t<const T>>;
+
+      /// \brief Default constructor. Creates an invalid handle.
+      public: TaskHandle() = default;
+
+      /// \brief Wait until the work has finished and get its result. If
+      /// the work threw an exception, it is rethrown here.
+      /// \pre Valid() is true.
+      /// \return The result of the work.
+      public: GetType Get() const;
+
+      /// \brief Constructor used by the WorkerPool.
+      /// \param[in] _state State shared with the submitted work.
+      private: explicit TaskHandle(
+                   std::shared_ptr<detail::TaskState<T>> _state);
+
+      /// \brief The pool creates handles.
+      friend class WorkerPool;
+    };
 
     /// \brief A pool of worker threads that do stuff in parallel
     class IGNITION_COMMON_VISIBLE WorkerPool
     {
+      /// \enum SchedulerType
+      /// \brief Strategy used to hand out work to the worker threads.
+      public: enum class SchedulerType
+      {
+        /// \brief All work goes through a single queue that is shared by
+        /// every worker thread.
+        SHARED_QUEUE = 0,
+
+        /// \brief Every worker thread owns a queue of work. Work added from
+        /// a worker thread goes to that worker's queue, work added from any
+        /// other thread is spread over the queues. Workers take the work of
+        /// their own queue first, and the most urgent work of any queue
+        /// once theirs is empty or work of a higher priority waits
+        /// elsewhere. This greatly reduces lock contention when many small
+        /// pieces of work are added.
+        WORK_STEALING = 1
+      };
+
+      /// \enum Priority
+      /// \brief Importance of a piece of work. Workers always pick the most
+      /// urgent work first, see TaskOptions.
+      public: enum class Priority
+      {
+        /// \brief Background work, such as large batch jobs
+        LOW = 0,
+
+        /// \brief Default priority
+        NORMAL = 1,
+
+        /// \brief Work that should run before normal work
+        HIGH = 2,
+
+        /// \brief Latency critical work, such as sensor callbacks
+        CRITICAL = 3
+      };
+
+      /// \brief Number of values of Priority.
+      public: static constexpr std::size_t PriorityCount = 4;
+
+      /// \brief Scheduling options of a piece of work.
+      ///
+      /// Work is handed out in order of urgency, which is the time by which
+      /// it should start. Work of priority CRITICAL should start right away,
+      /// and every lower priority gets AgingInterval() more slack. A lower
+      /// priority therefore only delays work; once it has waited long
+      /// enough it runs before newer work of higher priority, so it can't be
+      /// starved. A deadline makes work more urgent than its priority alone
+      /// would.
+      public: class TaskOptions
+      {
+        /// \brief Constructor
+        /// \param[in] _priority Priority of the work
+        /// \param[in] _deadline Deadline of the work, zero for none
+        public: explicit TaskOptions(
+                    const Priority _priority = Priority::NORMAL,
+                    const Time &_deadline = Time::Zero)
+          : priority(_priority), deadline(_deadline)
+        {
+        }
+
+        /// \brief Priority of the work
+        public: Priority priority = Priority::NORMAL;
+
+        /// \brief Time after which the work should have started, counted
+        /// from when it is added. Zero, the default, means no deadline.
+        public: Time deadline;
+      };
+
       /// \brief Creates worker threads. The number of worker threads is
       /// determined by max(std::thread::hardware_concurrency, _minThreadCount).
       /// \param[in] _minThreadCount The minimum number of threads to
@@ -43,7 +205,16 @@ namespace ignition
       /// std::thread::hardware_concurrency.
       public: explicit WorkerPool(const unsigned int _minThreadCount = 1u);
 
-      /// \brief closes worker threads
+      /// \brief Creates worker threads that use the given scheduler.
+      /// \param[in] _minThreadCount The minimum number of threads to
+      /// create in the pool. See WorkerPool(const unsigned int).
+      /// \param[in] _scheduler Strategy used to hand out work.
+      public: WorkerPool(const unsigned int _minThreadCount,
+                         const SchedulerType _scheduler);
+
+      /// \brief closes worker threads. Work that didn't start is dropped,
+      /// and the tasks submitted with it finish with a
+      /// std::future_error whose code is std::future_errc::broken_promise.
       public: ~WorkerPool();
 
       /// \brief Adds work to the worker pool with optional callback
@@ -54,6 +225,20 @@ namespace ignition
       public: void AddWork(std::function<void()> _work,
                   std::function<void()> _cb = std::function<void()>());
 
+      /// \brief Adds work to the worker pool. The callable is moved into
+      /// the queue without going through std::function, so it may be
+      /// move-only, and it doesn't allocate as long as its captures fit in
+      /// a few pointers. See AllocationCount().
+      /// \param[in] _work Callable that takes no arguments
+      public: template <typename Func, typename = detail::EnableIfWork<Func>>
+              void AddWork(Func &&_work);
+
+      /// \brief Adds work with a priority and an optional deadline.
+      /// \param[in] _options Priority and deadline of the work
+      /// \param[in] _work Callable that takes no arguments
+      public: template <typename Func, typename = detail::EnableIfWork<Func>>
+              void AddWork(const TaskOptions &_options, Func &&_work);
+
       /// \brief Waits until all work is done and threads are idle
       /// \param[in] _timeout How long to wait, default to forever
       /// \returns true if all work was finished
@@ -61,12 +246,280 @@ namespace ignition
       //           the WorkerPool is destructed before all work is completed
       public: bool WaitForResults(const Time &_timeout = Time::Zero);
 
+      /// \brief Submit a piece of work and get a handle to its result.
+      /// Unlike AddWork, the work may return a value and may throw. Both
+      /// are delivered through the returned handle.
+      /// \param[in] _func Callable that takes no arguments.
+      /// \return Handle to the result of _func.
+      public: template <typename Func>
+              TaskHandle<detail::TaskResult<Func>> Submit(Func &&_func);
+
+      /// \brief Submit a piece of work with a priority and an optional
+      /// deadline, and get a handle to its result.
+      /// \param[in] _options Priority and deadline of the work
+      /// \param[in] _func Callable that takes no arguments.
+      /// \return Handle to the result of _func.
+      public: template <typename Func>
+              TaskHandle<detail::TaskResult<Func>> Submit(
+                  const TaskOptions &_options, Func &&_func);
+
+      /// \brief Submit a continuation, which is a piece of work that is only
+      /// handed to a worker once all of its dependencies have finished.
+      /// Dependencies that finished by throwing an exception still count as
+      /// finished, and their exception is available through their handle.
+      /// \param[in] _dependencies Handles to the work that must finish
+      /// first. Invalid handles are ignored.
+      /// \param[in] _func Callable that takes no arguments.
+      /// \return Handle to the result of _func.
+      /// \note The pool must outlive all the dependencies.
+      public: template <typename Func>
+              TaskHandle<detail::TaskResult<Func>> SubmitAfter(
+                  const std::vector<TaskHandleBase> &_dependencies,
+                  Func &&_func);
+
+      /// \brief Call a function over the range [_begin, _end), split into
+      /// chunks that are processed in parallel by the workers of this pool.
+      /// The calling thread processes chunks as well, and the call returns
+      /// once every chunk has been processed, so it is safe to call this from
+      /// inside a worker of the same pool.
+      ///
+      /// \code
+      ///   std::vector<double> values(100000);
+      ///   pool.ParallelFor(0, values.size(), 0,
+      ///       [&values](const std::size_t _first, const std::size_t _last)
+      ///       {
+      ///         for (std::size_t i = _first; i < _last; ++i)
+      ///           values[i] = std::sqrt(i);
+      ///       });
+      /// \endcode
+      ///
+      /// \param[in] _begin First index of the range.
+      /// \param[in] _end One past the last index of the range.
+      /// \param[in] _grain Number of indices per chunk. Zero picks a chunk
+      /// size that gives every thread a few chunks to balance the load.
+      /// \param[in] _func Callable with signature
+      /// void(std::size_t _first, std::size_t _last), called once per chunk.
+      /// If it throws, the remaining chunks are skipped and the first
+      /// exception is rethrown by this function.
+      public: template <typename Func>
+              void ParallelFor(const std::size_t _begin,
+                               const std::size_t _end,
+                               const std::size_t _grain,
+                               Func &&_func);
+
+      /// \brief Compute one value for every chunk of the range
+      /// [_begin, _end) in parallel, then combine the chunk values in order.
+      /// The chunks are processed like in ParallelFor.
+      ///
+      /// \code
+      ///   double sum = pool.ParallelReduce(0, values.size(), 0, 0.0,
+      ///       [&values](const std::size_t _first, const std::size_t _last)
+      ///       {
+      ///         return std::accumulate(values.begin() + _first,
+      ///                                values.begin() + _last, 0.0);
+      ///       },
+      ///       std::plus<double>());
+      /// \endcode
+      ///
+      /// \param[in] _begin First index of the range.
+      /// \param[in] _end One past the last index of the range.
+      /// \param[in] _grain Number of indices per chunk, or zero to pick it
+      /// automatically.
+      /// \param[in] _identity Value returned for an empty range, and
+      /// starting value of the combination.
+      /// \param[in] _map Callable with signature
+      /// T(std::size_t _first, std::size_t _last) that computes the value of
+      /// one chunk.
+      /// \param[in] _reduce Callable with signature T(const T&, const T&)
+      /// that combines two values. Chunk values are combined from left to
+      /// right, so the result is deterministic for a given chunk size.
+      /// \return The combination of all the chunk values.
+      public: template <typename T, typename MapFunc, typename ReduceFunc>
+              T ParallelReduce(const std::size_t _begin,
+                               const std::size_t _end,
+                               const std::size_t _grain,
+                               const T &_identity,
+                               MapFunc &&_map,
+                               ReduceFunc &&_reduce);
+
+      /// \brief Get a pool that is shared by the whole process. It uses the
+      /// work stealing scheduler with one worker per hardware thread, and is
+      /// created the first time this function is called. Library code that
+      /// wants to use every core, without owning a pool of its own, should
+      /// use this pool. The pool is never destroyed, so it can be used until
+      /// the process ends, including from destructors of static objects.
+      /// \return The shared pool.
+      public: static WorkerPool &Shared();
+
+      /// \brief Get the number of pieces of work added to this pool since
+      /// it was created, through any of the functions that add work.
+      /// \return Number of pieces of work.
+      public: std::size_t AddedWorkCount() const;
+
+      /// \brief Get the number of heap allocations this pool made while
+      /// adding work. An allocation is made when a callable is too large to
+      /// be stored inline in the queue, or when a queue has to grow. Submit
+      /// also allocates the state shared with the returned handle, plus one
+      /// allocation for the work waiting on dependencies and one per
+      /// dependency still running, and ParallelFor allocates the state
+      /// shared by its chunks. Once the queues have reached their working
+      /// size, AddWork with small work doesn't allocate. Allocations made
+      /// by the callables themselves, or by the caller to build a
+      /// std::function, are not counted.
+      /// \return Number of allocations.
+      public: std::size_t AllocationCount() const;
+
+      /// \brief Get the average number of heap allocations per piece of
+      /// work, AllocationCount() / AddedWorkCount().
+      /// \return Allocations per piece of work, zero if no work was added.
+      public: double AllocationsPerTask() const;
+
+      /// \brief Get the number of pieces of work of a priority that are
+      /// waiting to be handed out to a worker.
+      /// \param[in] _priority Priority to query
+      /// \return Number of waiting pieces of work.
+      public: std::size_t QueueDepth(const Priority _priority) const;
+
+      /// \brief Get a percentile of the time that work of a priority spent
+      /// waiting to be handed out, over all the work handed out since the
+      /// pool was created or since ResetWaitTimes() was called. The result
+      /// is rounded up to within 12.5% of the exact value.
+      /// \param[in] _priority Priority to query
+      /// \param[in] _percentile Percentile in [0, 100], e.g. 50 for the
+      /// median or 99 for the 99th percentile
+      /// \return The waiting time, zero if no work of that priority was
+      /// handed out.
+      public: Time WaitTimePercentile(const Priority _priority,
+                                      const double _percentile) const;
+
+      /// \brief Forget the waiting times recorded so far.
+      public: void ResetWaitTimes();
+
+      /// \brief Set how much longer work may wait for every priority level
+      /// below CRITICAL. See TaskOptions. Defaults to 100 milliseconds.
+      /// Only affects work added after this call.
+      /// \param[in] _interval Waiting time between two priority levels
+      public: void SetAgingInterval(const Time &_interval);
+
+      /// \brief Get how much longer work may wait for every priority level
+      /// below CRITICAL.
+      /// \return Waiting time between two priority levels.
+      public: Time AgingInterval() const;
+
+      /// \brief Get the scheduler used by this pool.
+      /// \return The scheduler type given at construction.
+      public: SchedulerType Scheduler() const;
+
+      /// \brief Get the number of worker threads in this pool.
+      /// \return Number of worker threads.
+      public: unsigned int ThreadCount() const;
+
+      /// \brief Get the number of indices per chunk used by ParallelFor.
+      /// \param[in] _count Number of indices in the range.
+      /// \param[in] _grain Requested chunk size, or zero for automatic.
+      /// \return Number of indices per chunk, at least one.
+      private: std::size_t GrainSize(const std::size_t _count,
+                                     const std::size_t _grain) const;
+
+      /// \brief Account for heap allocations made while adding work.
+      /// \param[in] _count Number of allocations
+      /// \sa AllocationCount()
+      private: void CountAllocations(const std::size_t _count);
+
+      /// \brief Put a work item in the queues.
+      /// \param[in] _item The work item
+      /// \param[in] _options Priority and deadline of the work, null for
+      /// the default options
+      private: void AddWorkItem(detail::WorkItem &&_item,
+                                const TaskOptions *_options);
+
+      /// \brief Implementation of the submit functions.
+      /// \param[in] _dependencies Work that must finish first.
+      /// \param[in] _group Group to account the work in, may be null.
+      /// \param[in] _options Priority and deadline of the work, null for
+      /// the default options.
+      /// \param[in] _func Callable that takes no arguments.
+      /// \return Handle to the result of _func.
+      private: template <typename Func>
+               TaskHandle<detail::TaskResult<Func>> SubmitImpl(
+                   const std::vector<TaskHandleBase> &_dependencies,
+                   const std::shared_ptr<detail::TaskGroupState> &_group,
+                   const TaskOptions *_options,
+                   Func &&_func);
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \brief private implementation pointer
       private: std::unique_ptr<WorkerPoolPrivate> dataPtr;
       IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+
+      /// \brief Task groups submit through SubmitImpl.
+      friend class TaskGroup;
+    };
+
+    /// \brief A group of pieces of work submitted to a WorkerPool that can be
+    /// waited on independently of any other work in the pool. This allows
+    /// several subsystems to share a pool without waiting on each other's
+    /// work through WorkerPool::WaitForResults.
+    class IGNITION_COMMON_VISIBLE TaskGroup
+    {
+      /// \brief Constructor.
+      /// \param[in] _pool Pool that runs the work of this group. The pool
+      /// must outlive the work submitted to this group.
+      public: explicit TaskGroup(WorkerPool &_pool);
+
+      /// \brief Destructor. Does not wait for the work of this group.
+      public: ~TaskGroup();
+
+      /// \brief Submit a piece of work to this group.
+      /// \param[in] _func Callable that takes no arguments.
+      /// \return Handle to the result of _func.
+      /// \sa WorkerPool::Submit
+      public: template <typename Func>
+              TaskHandle<detail::TaskResult<Func>> Submit(Func &&_func);
+
+      /// \brief Submit a piece of work to this group with a priority and
+      /// an optional deadline.
+      /// \param[in] _options Priority and deadline of the work
+      /// \param[in] _func Callable that takes no arguments.
+      /// \return Handle to the result of _func.
+      /// \sa WorkerPool::Submit
+      public: template <typename Func>
+              TaskHandle<detail::TaskResult<Func>> Submit(
+                  const WorkerPool::TaskOptions &_options, Func &&_func);
+
+      /// \brief Submit a continuation to this group. The continuation counts
+      /// as work of this group from the moment it is submitted.
+      /// \param[in] _dependencies Handles to the work that must finish
+      /// first. They don't need to belong to this group.
+      /// \param[in] _func Callable that takes no arguments.
+      /// \return Handle to the result of _func.
+      /// \sa WorkerPool::SubmitAfter
+      public: template <typename Func>
+              TaskHandle<detail::TaskResult<Func>> SubmitAfter(
+                  const std::vector<TaskHandleBase> &_dependencies,
+                  Func &&_func);
+
+      /// \brief Wait until all the work of this group has finished.
+      /// \param[in] _timeout How long to wait, default to forever
+      /// \return True if all the work of this group finished
+      public: bool Wait(const Time &_timeout = Time::Zero);
+
+      /// \brief Get the number of pieces of work of this group that
+      /// haven't finished yet.
+      /// \return Number of unfinished pieces of work.
+      public: std::size_t PendingCount() const;
+
+      /// \brief Pool that runs the work of this group.
+      private: WorkerPool *pool = nullptr;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Counter of unfinished work, shared with the work itself.
+      private: std::shared_ptr<detail::TaskGroupState> state;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
     };
   }
 }
 
+#include "ignition/common/detail/WorkerPool.hh"
+
 #endif
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_COMMON_DETAIL_CONSOLE_HH_
+#define IGNITION_COMMON_DETAIL_CONSOLE_HH_
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "ignition/common/Console.hh"
+
+namespace ignition
+{
+  namespace common
+  {
+    namespace detail
+    {
+      /// \brief Type tags of the arguments in a binary log record.
+      enum class LogArgType : uint8_t
+      {
+        INT64 = 1,
+        UINT64 = 2,
+        DOUBLE = 3,
+        BOOL = 4,
+        STRING = 5
+      };
+
+      /// \brief Replace each "{}" of a format with the next argument.
+      /// Arguments left over are appended, separated by spaces.
+      /// \param[in] _format Format string
+      /// \param[in] _args Arguments, as text
+      /// \return The formatted text.
+      std::string IGNITION_COMMON_VISIBLE FormatLogText(const char *_format,
+          const std::vector<std::string> &_args);
+
+      /// \brief Append the bytes of a value.
+      /// \param[in,out] _out Encoded arguments
+      /// \param[in] _value Value to append
+      template<typename T>
+      void AppendLogBytes(std::string &_out, const T &_value)
+      {
+        _out.append(reinterpret_cast<const char *>(&_value), sizeof(T));
+      }
+
+      /// \brief Append a string argument.
+      /// \param[in,out] _out Encoded arguments
+      /// \param[in] _text Text of the argument
+      inline void EncodeLogString(std::string &_out,
+                                  const std::string_view _text)
+      {
+        _out.push_back(static_cast<char>(LogArgType::STRING));
+        AppendLogBytes(_out, static_cast<uint32_t>(_text.size()));
+        _out.append(_text.data(), _text.size());
+      }
+
+      /// \brief Convert an argument to the text that replaces its "{}".
+      /// The decoder of binary logs produces the same text.
+      /// \param[in] _value Argument
+      /// \return The text.
+      template<typename T>
+      std::string LogArgText(const T &_value)
+      {
+        std::ostringstream stream;
+        if constexpr (std::is_same_v<T, bool>)
+          stream << (_value ? "true" : "false");
+        else if constexpr (std::is_same_v<T, char>)
+          stream << _value;
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+          stream << static_cast<int64_t>(_value);
+        else if constexpr (std::is_integral_v<T>)
+          stream << static_cast<uint64_t>(_value);
+        else if constexpr (std::is_enum_v<T>)
+          stream << static_cast<int64_t>(_value);
+        else if constexpr (std::is_floating_point_v<T>)
+          stream << static_cast<double>(_value);
+        else
+          stream << _value;
+        return stream.str();
+      }
+
+      /// \brief Append an argument, with its type tag. Numbers are stored
+      /// as 64 bit values, strings with their size, and other types as the
+      /// text they print with operator<<.
+      /// \param[in,out] _out Encoded arguments
+      /// \param[in] _value Argument
+      template<typename T>
+      void EncodeLogArg(std::string &_out, const T &_value)
+      {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+          _out.push_back(static_cast<char>(LogArgType::BOOL));
+          _out.push_back(_value ? 1 : 0);
+        }
+        else if constexpr (std::is_same_v<T, char>)
+        {
+          EncodeLogString(_out, std::string_view(&_value, 1));
+        }
+        else if constexpr ((std::is_integral_v<T> && std::is_signed_v<T>) ||
+                           std::is_enum_v<T>)
+        {
+          _out.push_back(static_cast<char>(LogArgType::INT64));
+          AppendLogBytes(_out, static_cast<int64_t>(_value));
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+          _out.push_back(static_cast<char>(LogArgType::UINT64));
+          AppendLogBytes(_out, static_cast<uint64_t>(_value));
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+          _out.push_back(static_cast<char>(LogArgType::DOUBLE));
+          AppendLogBytes(_out, static_cast<double>(_value));
+        }
+        else if constexpr (std::is_convertible_v<const T &, std::string_view>)
+        {
+          EncodeLogString(_out, std::string_view(_value));
+        }
+        else
+        {
+          EncodeLogString(_out, LogArgText(_value));
+        }
+      }
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args>
+    void LogFormat::operator()(const Args &... _args) const
+    {
+      Console::log.Write(*this, _args...);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ... Args>
+    void FileLogger::Write(const LogFormat &_format, const Args &... _args)
+    {
+      if (!this->Binary())
+      {
+        const std::vector<std::string> args = {detail::LogArgText(_args)...};
+        (*this)(_format.File(), _format.Line()) << " "
+          << detail::FormatLogText(_format.Format(), args) << std::endl;
+        return;
+      }
+
+      thread_local std::string encoded;
+      encoded.clear();
+      (detail::EncodeLogArg(encoded, _args), ...);
+      static_cast<Buffer *>(this->rdbuf())->WriteRecord(
+          &_format, encoded, static_cast<uint16_t>(sizeof...(Args)));
+    }
+  }
+}
+
+#endif
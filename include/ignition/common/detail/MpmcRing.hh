@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_COMMON_DETAIL_MPMCRING_HH_
+#define IGNITION_COMMON_DETAIL_MPMCRING_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace ignition
+{
+  namespace common
+  {
+    namespace detail
+    {
+      /// \brief Bounded ring buffer that any number of threads may push to
+      /// and pop from without locking. Each cell has a sequence number that
+      /// tells whether it is free for the producer of a given position, or
+      /// holds the value for the consumer of a given position.
+      /// \tparam T Type of the values
+      template<typename T>
+      class MpmcRing
+      {
+        /// \brief Constructor
+        /// \param[in] _capacity Number of values that fit in the ring,
+        /// rounded up to a power of two, at least 2.
+        public: explicit MpmcRing(const std::size_t _capacity)
+        {
+          std::size_t capacity = 2;
+          while (capacity < _capacity)
+            capacity *= 2;
+
+          this->cells = std::vector<Cell>(capacity);
+          for (std::size_t i = 0; i < capacity; ++i)
+            this->cells[i].sequence.store(i, std::memory_order_relaxed);
+          this->mask = capacity - 1;
+        }
+
+        /// \brief Try to add a value at the back of the ring.
+        /// \param[in] _value Value, moved from on success
+        /// \return False if the ring is full.
+        public: bool TryPush(T &_value)
+        {
+          std::size_t pos = this->tail.load(std::memory_order_relaxed);
+          while (true)
+          {
+            Cell &cell = this->cells[pos & this->mask];
+            const std::size_t seq =
+              cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) -
+              static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+              if (this->tail.compare_exchange_weak(pos, pos + 1,
+                    std::memory_order_relaxed))
+              {
+                cell.value.emplace(std::move(_value));
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+              }
+            }
+            else if (diff < 0)
+            {
+              return false;
+            }
+            else
+            {
+              pos = this->tail.load(std::memory_order_relaxed);
+            }
+          }
+        }
+
+        /// \brief Try to take the value at the front of the ring.
+        /// \param[out] _value Value that was taken
+        /// \return False if the ring is empty.
+        public: bool TryPop(std::optional<T> &_value)
+        {
+          std::size_t pos = this->head.load(std::memory_order_relaxed);
+          while (true)
+          {
+            Cell &cell = this->cells[pos & this->mask];
+            const std::size_t seq =
+              cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) -
+              static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+              if (this->head.compare_exchange_weak(pos, pos + 1,
+                    std::memory_order_relaxed))
+              {
+                _value.emplace(std::move(*cell.value));
+                cell.value.reset();
+                cell.sequence.store(pos + this->mask + 1,
+                    std::memory_order_release);
+                return true;
+              }
+            }
+            else if (diff < 0)
+            {
+              return false;
+            }
+            else
+            {
+              pos = this->head.load(std::memory_order_relaxed);
+            }
+          }
+        }
+
+        /// \brief Check whether the value at the front of the ring is
+        /// ready to be taken. A push in progress may not be visible yet.
+        /// \return True if TryPop would find a value.
+        public: bool Ready() const
+        {
+          const std::size_t pos = this->head.load(std::memory_order_relaxed);
+          return this->cells[pos & this->mask].sequence.load(
+              std::memory_order_acquire) == pos + 1;
+        }
+
+        /// \brief Cell of the ring
+        private: struct Cell
+        {
+          /// \brief Sequence number
+          std::atomic<std::size_t> sequence;
+
+          /// \brief Value, set while the cell holds one
+          std::optional<T> value;
+        };
+
+        /// \brief Cells of the ring
+        private: std::vector<Cell> cells;
+
+        /// \brief Capacity of the ring minus one
+        private: std::size_t mask = 0;
+
+        /// \brief Next position to write
+        private: alignas(64) std::atomic<std::size_t> tail{0};
+
+        /// \brief Next position to read
+        private: alignas(64) std::atomic<std::size_t> head{0};
+      };
+    }
+  }
+}
+#endif
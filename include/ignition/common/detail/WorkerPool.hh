@@ -0,0 +1,812 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_COMMON_DETAIL_WORKER_POOL_HH_
+#define IGNITION_COMMON_DETAIL_WORKER_POOL_HH_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "ignition/common/WorkerPool.hh"
+
+namespace ignition
+{
+  namespace common
+  {
+    namespace detail
+    {
+      /// \brief Wait on a condition variable for a common::Time, where a
+      /// zero time means forever.
+      /// \param[in] _cv Condition variable to wait on
+      /// \param[in] _lock Lock held on the mutex of _cv
+      /// \param[in] _timeout How long to wait
+      /// \param[in] _pred Condition to wait for
+      /// \return The value of _pred when the wait ended
+      template <typename Pred>
+      bool WaitFor(std::condition_variable &_cv,
+                   std::unique_lock<std::mutex> &_lock,
+                   const Time &_timeout, Pred _pred)
+      {
+        if (Time::Zero == _timeout)
+        {
+          _cv.wait(_lock, _pred);
+          return true;
+        }
+
+        return _cv.wait_for(_lock,
+            std::chrono::seconds(_timeout.sec) +
+            std::chrono::nanoseconds(_timeout.nsec), _pred);
+      }
+
+      /// \brief A move-only, type-erased void() callable, used to store work
+      /// in the queues of a WorkerPool. Callables that fit in InlineSize
+      /// bytes and can be moved without throwing are stored inside the item
+      /// itself, larger ones are moved to the heap.
+      class WorkItem
+      {
+        /// \brief Number of bytes available to store a callable without a
+        /// heap allocation. At least a handful of pointers and shared
+        /// pointers, and enough for a lambda holding two std::function
+        /// objects, whose size depends on the standard library.
+        public: static constexpr std::size_t InlineSize =
+                    std::max(8 * sizeof(void *),
+                        2 * sizeof(std::function<void()>));
+
+        /// \brief Default constructor. Creates an empty item.
+        public: WorkItem() = default;
+
+        /// \brief Constructor.
+        /// \param[in] _func Callable that takes no arguments.
+        public: template <typename Func, typename = std::enable_if_t<
+                    !std::is_same<std::decay_t<Func>, WorkItem>::value>>
+                explicit WorkItem(Func &&_func)
+        {
+          using F = std::decay_t<Func>;
+          if constexpr (FitsInline<F>())
+          {
+            new (&this->storage) F(std::forward<Func>(_func));
+            this->ops = &InlineOps<F>;
+          }
+          else
+          {
+            *reinterpret_cast<F **>(&this->storage) =
+              new F(std::forward<Func>(_func));
+            this->ops = &HeapOps<F>;
+          }
+        }
+
+        /// \brief Move constructor.
+        /// \param[in] _other Item to move from, left empty.
+        public: WorkItem(WorkItem &&_other) noexcept
+        {
+          this->MoveFrom(_other);
+        }
+
+        /// \brief Move assignment.
+        /// \param[in] _other Item to move from, left empty.
+        /// \return Reference to this item.
+        public: WorkItem &operator=(WorkItem &&_other) noexcept
+        {
+          if (this != &_other)
+          {
+            this->Reset();
+            this->MoveFrom(_other);
+          }
+          return *this;
+        }
+
+        /// \brief Work items are not copyable.
+        public: WorkItem(const WorkItem &) = delete;
+
+        /// \brief Work items are not copyable.
+        public: WorkItem &operator=(const WorkItem &) = delete;
+
+        /// \brief Destructor.
+        public: ~WorkItem()
+        {
+          this->Reset();
+        }
+
+        /// \brief Destroy the stored callable, leaving the item empty.
+        public: void Reset()
+        {
+          if (this->ops)
+          {
+            this->ops->destroy(&this->storage);
+            this->ops = nullptr;
+          }
+        }
+
+        /// \brief Get whether a callable is stored.
+        /// \return True if the item is not empty.
+        public: explicit operator bool() const
+        {
+          return this->ops != nullptr;
+        }
+
+        /// \brief Get whether the stored callable had to be moved to the
+        /// heap because it is too large.
+        /// \return True if the callable lives on the heap.
+        public: bool HeapAllocated() const
+        {
+          return this->ops && this->ops->heap;
+        }
+
+        /// \brief Call the stored callable.
+        /// \pre The item is not empty.
+        public: void operator()()
+        {
+          this->ops->invoke(&this->storage);
+        }
+
+        /// \brief Get whether a callable type is stored inline.
+        /// \return True if F fits in the inline storage.
+        public: template <typename F>
+                static constexpr bool FitsInline()
+        {
+          return sizeof(F) <= InlineSize &&
+            alignof(std::max_align_t) % alignof(F) == 0 &&
+            std::is_nothrow_move_constructible<F>::value;
+        }
+
+        /// \brief Take the callable of another item.
+        /// \param[in] _other Item to move from, left empty.
+        private: void MoveFrom(WorkItem &_other) noexcept
+        {
+          if (_other.ops)
+          {
+            _other.ops->move(&_other.storage, &this->storage);
+            this->ops = _other.ops;
+            _other.ops = nullptr;
+          }
+        }
+
+        /// \brief Operations on the stored callable.
+        private: struct Ops
+        {
+          /// \brief Call the callable.
+          void (*invoke)(void *);
+
+          /// \brief Move the callable to uninitialized storage and destroy
+          /// the source.
+          void (*move)(void *, void *);
+
+          /// \brief Destroy the callable.
+          void (*destroy)(void *);
+
+          /// \brief True if the storage holds a pointer to the callable.
+          bool heap;
+        };
+
+        /// \brief Operations on a callable stored inline.
+        private: template <typename F>
+                 static constexpr Ops InlineOps = {
+          [] (void *_s) { (*static_cast<F *>(_s))(); },
+          [] (void *_from, void *_to)
+          {
+            new (_to) F(std::move(*static_cast<F *>(_from)));
+            static_cast<F *>(_from)->~F();
+          },
+          [] (void *_s) { static_cast<F *>(_s)->~F(); },
+          false};
+
+        /// \brief Operations on a callable stored on the heap.
+        private: template <typename F>
+                 static constexpr Ops HeapOps = {
+          [] (void *_s) { (**static_cast<F **>(_s))(); },
+          [] (void *_from, void *_to)
+          {
+            *static_cast<F **>(_to) = *static_cast<F **>(_from);
+          },
+          [] (void *_s) { delete *static_cast<F **>(_s); },
+          true};
+
+        /// \brief Storage of the callable, or of a pointer to it.
+        private: alignas(std::max_align_t) unsigned char storage[InlineSize];
+
+        /// \brief Operations on the stored callable, null when empty.
+        private: const Ops *ops = nullptr;
+      };
+
+      /// \brief State shared between a piece of submitted work and all the
+      /// handles to it.
+      class TaskStateBase
+      {
+        /// \brief Destructor
+        public: virtual ~TaskStateBase() = default;
+
+        /// \brief Mark the work as finished and hand out the continuations
+        /// that were waiting on it.
+        /// \param[in] _error Exception thrown by the work, if any
+        public: void Finish(std::exception_ptr _error)
+        {
+          std::vector<std::function<void()>> ready;
+          {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->finished = true;
+            this->error = _error;
+            ready.swap(this->continuations);
+          }
+          this->signalFinished.notify_all();
+
+          for (auto &continuation : ready)
+            continuation();
+        }
+
+        /// \brief Register a function to call once the work has finished.
+        /// \param[in] _continuation Function to call
+        /// \return False if the work has already finished, in which case
+        /// _continuation is not registered and should be called right away.
+        public: bool AddContinuation(std::function<void()> _continuation)
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          if (this->finished)
+            return false;
+
+          this->continuations.push_back(std::move(_continuation));
+          return true;
+        }
+
+        /// \brief Get whether the work has finished.
+        /// \return True if the work has finished.
+        public: bool Finished() const
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          return this->finished;
+        }
+
+        /// \brief Wait until the work has finished.
+        /// \param[in] _timeout How long to wait, default to forever
+        /// \return True if the work has finished.
+        public: bool Wait(const Time &_timeout)
+        {
+          std::unique_lock<std::mutex> lock(this->mutex);
+          return WaitFor(this->signalFinished, lock, _timeout,
+              [this] () { return this->finished; });
+        }
+
+        /// \brief Wait until the work has finished and rethrow the
+        /// exception it threw, if any.
+        protected: void WaitAndRethrow()
+        {
+          this->Wait(Time::Zero);
+          if (this->error)
+            std::rethrow_exception(this->error);
+        }
+
+        /// \brief Protects the members below
+        private: mutable std::mutex mutex;
+
+        /// \brief Signaled when the work finishes
+        private: std::condition_variable signalFinished;
+
+        /// \brief True once the work has finished
+        private: bool finished = false;
+
+        /// \brief Exception thrown by the work, if any
+        private: std::exception_ptr error;
+
+        /// \brief Functions to call once the work has finished
+        private: std::vector<std::function<void()>> continuations;
+      };
+
+      /// \brief Shared state of work that returns a value.
+      /// \tparam T Type returned by the work.
+      template <typename T>
+      class TaskState : public TaskStateBase
+      {
+        /// \brief Run the work and store its result.
+        /// \param[in] _func The work
+        public: template <typename Func>
+                void Run(Func &_func)
+        {
+          std::exception_ptr err;
+          try
+          {
+            this->value.emplace(_func());
+          }
+          catch (...)
+          {
+            err = std::current_exception();
+          }
+          this->Finish(err);
+        }
+
+        /// \brief Wait for the result.
+        /// \return The result of the work.
+        public: const T &Get()
+        {
+          this->WaitAndRethrow();
+          return *this->value;
+        }
+
+        /// \brief Result of the work
+        private: std::optional<T> value;
+      };
+
+      /// \brief Shared state of work that doesn't return a value.
+      template <>
+      class TaskState<void> : public TaskStateBase
+      {
+        /// \brief Run the work.
+        /// \param[in] _func The work
+        public: template <typename Func>
+                void Run(Func &_func)
+        {
+          std::exception_ptr err;
+          try
+          {
+            _func();
+          }
+          catch (...)
+          {
+            err = std::current_exception();
+          }
+          this->Finish(err);
+        }
+
+        /// \brief Wait for the work to finish.
+        public: void Get()
+        {
+          this->WaitAndRethrow();
+        }
+      };
+
+      /// \brief Counter of the unfinished work of a TaskGroup.
+      class TaskGroupState
+      {
+        /// \brief Account for a new piece of work.
+        public: void Add()
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          ++this->pending;
+        }
+
+        /// \brief Account for a finished piece of work.
+        public: void Done()
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          if (--this->pending == 0)
+            this->signalDone.notify_all();
+        }
+
+        /// \brief Wait until all the work has finished.
+        /// \param[in] _timeout How long to wait, default to forever
+        /// \return True if all the work has finished.
+        public: bool Wait(const Time &_timeout)
+        {
+          std::unique_lock<std::mutex> lock(this->mutex);
+          return WaitFor(this->signalDone, lock, _timeout,
+              [this] () { return this->pending == 0; });
+        }
+
+        /// \brief Get the amount of unfinished work.
+        /// \return Number of unfinished pieces of work.
+        public: std::size_t Pending() const
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          return this->pending;
+        }
+
+        /// \brief Protects the members below
+        private: mutable std::mutex mutex;
+
+        /// \brief Signaled when the last piece of work finishes
+        private: std::condition_variable signalDone;
+
+        /// \brief Number of unfinished pieces of work
+        private: std::size_t pending = 0;
+      };
+
+      /// \brief Work submitted to a pool, with the state of its task. If
+      /// it is destroyed without running, for example because the pool is
+      /// destroyed first, the task finishes with a broken promise error, so
+      /// that waiting for it doesn't block forever.
+      /// \tparam T Type returned by the work.
+      /// \tparam F Type of the work.
+      template <typename T, typename F>
+      class SubmittedWork
+      {
+        /// \brief Constructor.
+        /// \param[in] _state State of the task
+        /// \param[in] _func The work
+        /// \param[in] _group Group of the task, or null
+        public: template <typename Func>
+                SubmittedWork(std::shared_ptr<TaskState<T>> _state,
+                    Func &&_func, std::shared_ptr<TaskGroupState> _group)
+                : state(std::move(_state)), func(std::forward<Func>(_func)),
+                  group(std::move(_group))
+        {
+        }
+
+        /// \brief Move constructor, leaves _other without a task.
+        public: SubmittedWork(SubmittedWork &&_other) = default;
+
+        /// \brief Destructor. Finishes the task if it didn't run.
+        public: ~SubmittedWork()
+        {
+          if (this->state)
+          {
+            this->state->Finish(std::make_exception_ptr(
+                std::future_error(std::future_errc::broken_promise)));
+            if (this->group)
+              this->group->Done();
+          }
+        }
+
+        /// \brief Run the work, once.
+        public: void operator()()
+        {
+          const std::shared_ptr<TaskState<T>> run = std::move(this->state);
+          run->Run(this->func);
+          if (this->group)
+            this->group->Done();
+        }
+
+        /// \brief State of the task, null once it ran
+        private: std::shared_ptr<TaskState<T>> state;
+
+        /// \brief The work
+        private: F func;
+
+        /// \brief Group of the task, or null
+        private: std::shared_ptr<TaskGroupState> group;
+      };
+
+      /// \brief Chunk bookkeeping shared by the threads taking part in a
+      /// WorkerPool::ParallelFor call.
+      class ParallelForState
+      {
+        /// \brief Constructor
+        /// \param[in] _chunkCount Number of chunks to process
+        public: explicit ParallelForState(const std::size_t _chunkCount)
+          : chunkCount(_chunkCount)
+        {
+        }
+
+        /// \brief Process chunks until there are none left.
+        /// \param[in] _func Function called for every chunk
+        /// \param[in] _begin First index of the whole range
+        /// \param[in] _end One past the last index of the whole range
+        /// \param[in] _grain Number of indices per chunk
+        public: template <typename Func>
+                void Run(Func &_func, const std::size_t _begin,
+                         const std::size_t _end, const std::size_t _grain)
+        {
+          std::size_t chunk;
+          while ((chunk = this->nextChunk.fetch_add(1)) < this->chunkCount)
+          {
+            if (!this->failed)
+            {
+              const std::size_t first = _begin + chunk * _grain;
+              try
+              {
+                _func(first, std::min(first + _grain, _end));
+              }
+              catch (...)
+              {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                if (!this->error)
+                  this->error = std::current_exception();
+                this->failed = true;
+              }
+            }
+
+            if (++this->doneChunks == this->chunkCount)
+            {
+              std::lock_guard<std::mutex> lock(this->mutex);
+              this->signalDone.notify_all();
+            }
+          }
+        }
+
+        /// \brief Wait until every chunk is processed and rethrow the first
+        /// exception thrown by a chunk, if any.
+        public: void WaitAndRethrow()
+        {
+          std::unique_lock<std::mutex> lock(this->mutex);
+          this->signalDone.wait(lock, [this] ()
+              {
+                return this->doneChunks == this->chunkCount;
+              });
+          if (this->error)
+            std::rethrow_exception(this->error);
+        }
+
+        /// \brief Number of chunks in the range
+        private: const std::size_t chunkCount;
+
+        /// \brief Next chunk to hand out
+        private: std::atomic<std::size_t> nextChunk{0};
+
+        /// \brief Number of chunks processed, or skipped after a failure
+        private: std::atomic<std::size_t> doneChunks{0};
+
+        /// \brief Set once a chunk has thrown, to skip the remaining ones
+        private: std::atomic<bool> failed{false};
+
+        /// \brief Protects error and is used with signalDone
+        private: std::mutex mutex;
+
+        /// \brief Signaled when the last chunk is done
+        private: std::condition_variable signalDone;
+
+        /// \brief First exception thrown by a chunk
+        private: std::exception_ptr error;
+      };
+    }
+
+    //////////////////////////////////////////////////
+    inline TaskHandleBase::TaskHandleBase(
+        std::shared_ptr<detail::TaskStateBase> _state)
+      : state(std::move(_state))
+    {
+    }
+
+    //////////////////////////////////////////////////
+    inline bool TaskHandleBase::Valid() const
+    {
+      return this->state != nullptr;
+    }
+
+    //////////////////////////////////////////////////
+    inline bool TaskHandleBase::Ready() const
+    {
+      return this->state && this->state->Finished();
+    }
+
+    //////////////////////////////////////////////////
+    inline bool TaskHandleBase::Wait(const Time &_timeout) const
+    {
+      return this->state && this->state->Wait(_timeout);
+    }
+
+    //////////////////////////////////////////////////
+    template <typename T>
+    TaskHandle<T>::TaskHandle(std::shared_ptr<detail::TaskState<T>> _state)
+      : TaskHandleBase(std::move(_state))
+    {
+    }
+
+    //////////////////////////////////////////////////
+    template <typename T>
+    typename TaskHandle<T>::GetType TaskHandle<T>::Get() const
+    {
+      return static_cast<detail::TaskState<T>&>(*this->state).Get();
+    }
+
+    //////////////////////////////////////////////////
+    template <typename Func, typename>
+    void WorkerPool::AddWork(Func &&_work)
+    {
+      this->AddWorkItem(detail::WorkItem(std::forward<Func>(_work)),
+          nullptr);
+    }
+
+    //////////////////////////////////////////////////
+    template <typename Func, typename>
+    void WorkerPool::AddWork(const TaskOptions &_options, Func &&_work)
+    {
+      this->AddWorkItem(detail::WorkItem(std::forward<Func>(_work)),
+          &_options);
+    }
+
+    //////////////////////////////////////////////////
+    template <typename Func>
+    TaskHandle<detail::TaskResult<Func>> WorkerPool::Submit(Func &&_func)
+    {
+      return this->SubmitImpl({}, nullptr, nullptr,
+          std::forward<Func>(_func));
+    }
+
+    //////////////////////////////////////////////////
+    template <typename Func>
+    TaskHandle<detail::TaskResult<Func>> WorkerPool::Submit(
+        const TaskOptions &_options, Func &&_func)
+    {
+      return this->SubmitImpl({}, nullptr, &_options,
+          std::forward<Func>(_func));
+    }
+
+    //////////////////////////////////////////////////
+    template <typename Func>
+    TaskHandle<detail::TaskResult<Func>> WorkerPool::SubmitAfter(
+        const std::vector<TaskHandleBase> &_dependencies, Func &&_func)
+    {
+      return this->SubmitImpl(_dependencies, nullptr, nullptr,
+          std::forward<Func>(_func));
+    }
+
+    //////////////////////////////////////////////////
+    template <typename Func>
+    TaskHandle<detail::TaskResult<Func>> WorkerPool::SubmitImpl(
+        const std::vector<TaskHandleBase> &_dependencies,
+        const std::shared_ptr<detail::TaskGroupState> &_group,
+        const TaskOptions *_options, Func &&_func)
+    {
+      using ResultT = detail::TaskResult<Func>;
+
+      auto state = std::make_shared<detail::TaskState<ResultT>>();
+      std::size_t allocations = 1;
+
+      if (_group)
+        _group->Add();
+
+      detail::WorkItem work(
+          detail::SubmittedWork<ResultT, std::decay_t<Func>>(
+            state, std::forward<Func>(_func), _group));
+
+      if (_dependencies.empty())
+      {
+        this->CountAllocations(allocations);
+        this->AddWorkItem(std::move(work), _options);
+      }
+      else
+      {
+        // One count per dependency, plus one released below once all the
+        // continuations are registered, so that the work can't be handed
+        // out while we are still going through the dependencies.
+        struct PendingWork
+        {
+          std::atomic<std::size_t> remaining;
+          detail::WorkItem work;
+          std::optional<TaskOptions> options;
+        };
+        auto pending = std::make_shared<PendingWork>();
+        ++allocations;
+        pending->remaining = _dependencies.size() + 1;
+        pending->work = std::move(work);
+        if (_options)
+          pending->options = *_options;
+
+        auto release = [this, pending] ()
+        {
+          if (--pending->remaining == 0)
+          {
+            this->AddWorkItem(std::move(pending->work),
+                pending->options ? &*pending->options : nullptr);
+          }
+        };
+
+        for (const TaskHandleBase &dependency : _dependencies)
+        {
+          if (!dependency.state ||
+              !dependency.state->AddContinuation(release))
+          {
+            release();
+          }
+          else
+          {
+            ++allocations;
+          }
+        }
+        this->CountAllocations(allocations);
+        release();
+      }
+
+      return TaskHandle<ResultT>(std::move(state));
+    }
+
+    //////////////////////////////////////////////////
+    template <typename Func>
+    void WorkerPool::ParallelFor(const std::size_t _begin,
+        const std::size_t _end, const std::size_t _grain, Func &&_func)
+    {
+      if (_end <= _begin)
+        return;
+
+      const std::size_t count = _end - _begin;
+      const std::size_t grain = this->GrainSize(count, _grain);
+      const std::size_t chunks = (count + grain - 1) / grain;
+
+      if (chunks == 1)
+      {
+        _func(_begin, _end);
+        return;
+      }
+
+      // Workers that only get to run after all the chunks were taken see an
+      // exhausted state and never touch _func, so it is safe to refer to it
+      // after this function returns. The state itself is shared.
+      auto state = std::make_shared<detail::ParallelForState>(chunks);
+      this->CountAllocations(1);
+      auto *func = &_func;
+      auto helper = [state, func, _begin, _end, grain] ()
+      {
+        state->Run(*func, _begin, _end, grain);
+      };
+
+      const std::size_t helpers =
+        std::min<std::size_t>(chunks - 1, this->ThreadCount());
+      for (std::size_t h = 0; h < helpers; ++h)
+        this->AddWork(helper);
+
+      state->Run(_func, _begin, _end, grain);
+      state->WaitAndRethrow();
+    }
+
+    //////////////////////////////////////////////////
+    template <typename T, typename MapFunc, typename ReduceFunc>
+    T WorkerPool::ParallelReduce(const std::size_t _begin,
+        const std::size_t _end, const std::size_t _grain, const T &_identity,
+        MapFunc &&_map, ReduceFunc &&_reduce)
+    {
+      if (_end <= _begin)
+        return _identity;
+
+      const std::size_t count = _end - _begin;
+      const std::size_t grain = this->GrainSize(count, _grain);
+      const std::size_t chunks = (count + grain - 1) / grain;
+
+      std::vector<T> partials(chunks, _identity);
+      this->ParallelFor(0, chunks, 1,
+          [&] (const std::size_t _firstChunk, const std::size_t _lastChunk)
+          {
+            for (std::size_t c = _firstChunk; c < _lastChunk; ++c)
+            {
+              const std::size_t first = _begin + c * grain;
+              partials[c] = _map(first, std::min(first + grain, _end));
+            }
+          });
+
+      T result = _identity;
+      for (const T &partial : partials)
+        result = _reduce(result, partial);
+      return result;
+    }
+
+    //////////////////////////////////////////////////
+    template <typename Func>
+    TaskHandle<detail::TaskResult<Func>> TaskGroup::Submit(Func &&_func)
+    {
+      return this->pool->SubmitImpl({}, this->state, nullptr,
+          std::forward<Func>(_func));
+    }
+
+    //////////////////////////////////////////////////
+    template <typename Func>
+    TaskHandle<detail::TaskResult<Func>> TaskGroup::Submit(
+        const WorkerPool::TaskOptions &_options, Func &&_func)
+    {
+      return this->pool->SubmitImpl({}, this->state, &_options,
+          std::forward<Func>(_func));
+    }
+
+    //////////////////////////////////////////////////
+    template <typename Func>
+    TaskHandle<detail::TaskResult<Func>> TaskGroup::SubmitAfter(
+        const std::vector<TaskHandleBase> &_dependencies, Func &&_func)
+    {
+      return this->pool->SubmitImpl(_dependencies, this->state, nullptr,
+          std::forward<Func>(_func));
+    }
+  }
+}
+
+#endif
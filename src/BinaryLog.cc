@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ignition/common/BinaryLog.hh"
+#include "ignition/common/Console.hh"
+#include "ignition/common/Util.hh"
+
+#include "BinaryLogFormat.hh"
+
+using namespace ignition;
+using namespace common;
+
+/// \brief A format read from the file
+struct LogFormatDefinition
+{
+  /// \brief Level of the messages
+  int level = 0;
+
+  /// \brief Line in the source file
+  int line = 0;
+
+  /// \brief Source file
+  std::string file;
+
+  /// \brief Format string
+  std::string format;
+};
+
+/// \brief Private data for BinaryLogReader
+class ignition::common::BinaryLogReaderPrivate
+{
+  /// \brief Read bytes from the file.
+  /// \param[out] _out Bytes read
+  /// \param[in] _size Number of bytes
+  /// \return False if the file is too short.
+  public: bool ReadBytes(std::string &_out, const std::size_t _size)
+  {
+    _out.resize(_size);
+    if (_size == 0)
+      return true;
+    this->stream.read(&_out[0], static_cast<std::streamsize>(_size));
+    return static_cast<std::size_t>(this->stream.gcount()) == _size;
+  }
+
+  /// \brief Read a string preceded by its size.
+  /// \param[out] _out String read
+  /// \return False if the file is too short.
+  public: bool ReadString(std::string &_out)
+  {
+    uint32_t size = 0;
+    if (!this->ReadBytes(this->scratch, sizeof(size)))
+      return false;
+    std::memcpy(&size, this->scratch.data(), sizeof(size));
+    return this->ReadBytes(_out, size);
+  }
+
+  /// \brief File being read
+  public: std::ifstream stream;
+
+  /// \brief Whether the header is valid
+  public: bool valid = false;
+
+  /// \brief Formats read so far, by id
+  public: std::unordered_map<uint32_t, LogFormatDefinition> formats;
+
+  /// \brief Buffer of the record being read
+  public: std::string scratch;
+};
+
+//////////////////////////////////////////////////
+std::string detail::FormatLogText(const char *_format,
+    const std::vector<std::string> &_args)
+{
+  std::string text;
+  std::size_t next = 0;
+  for (const char *c = _format; *c != '\0'; ++c)
+  {
+    if (c[0] == '{' && c[1] == '}' && next < _args.size())
+    {
+      text += _args[next++];
+      ++c;
+    }
+    else
+    {
+      text += *c;
+    }
+  }
+
+  for (; next < _args.size(); ++next)
+    text += " " + _args[next];
+
+  return text;
+}
+
+//////////////////////////////////////////////////
+std::string BinaryLogRecord::Text() const
+{
+  return detail::FormatLogText(this->format.c_str(), this->args);
+}
+
+//////////////////////////////////////////////////
+std::string BinaryLogRecord::ToString() const
+{
+  static const char *const levels[] = {"", "[Err] ", "[Wrn] ", "[Msg] ",
+    "[Dbg] "};
+
+  std::ostringstream stream;
+  stream << "(" << timeToIso(this->time) << ") ";
+  // Lines of text already start with the prefix of their logger
+  if (this->level > 0 && this->level < 5 && !this->file.empty())
+    stream << levels[this->level];
+  stream << "[T" << this->thread << "] ";
+  if (!this->file.empty())
+  {
+    const std::size_t index = this->file.find_last_of("/\\") + 1;
+    stream << "[" << this->file.substr(index) << ":" << this->line << "] ";
+  }
+  stream << this->Text();
+  return stream.str();
+}
+
+//////////////////////////////////////////////////
+BinaryLogReader::BinaryLogReader(const std::string &_filename)
+  : dataPtr(new BinaryLogReaderPrivate)
+{
+  this->dataPtr->stream.open(_filename, std::ios::in | std::ios::binary);
+  if (!this->dataPtr->stream.is_open())
+  {
+    ignerr << "Unable to open binary log file [" << _filename << "]\n";
+    return;
+  }
+
+  std::string header;
+  if (!this->dataPtr->ReadBytes(header, binarylog::HeaderSize) ||
+      std::memcmp(header.data(), binarylog::Magic,
+                  sizeof(binarylog::Magic)) != 0)
+  {
+    ignerr << "[" << _filename << "] is not a binary log file\n";
+    return;
+  }
+
+  const char *data = header.data() + sizeof(binarylog::Magic);
+  const char *end = header.data() + header.size();
+  uint32_t version = 0;
+  uint32_t byteOrder = 0;
+  binarylog::Read(data, end, version);
+  binarylog::Read(data, end, byteOrder);
+  if (version != binarylog::Version || byteOrder != binarylog::ByteOrderMark)
+  {
+    ignerr << "Unsupported version or byte order in binary log file ["
+      << _filename << "]\n";
+    return;
+  }
+
+  this->dataPtr->valid = true;
+}
+
+//////////////////////////////////////////////////
+BinaryLogReader::~BinaryLogReader()
+{
+}
+
+//////////////////////////////////////////////////
+bool BinaryLogReader::Valid() const
+{
+  return this->dataPtr->valid;
+}
+
+//////////////////////////////////////////////////
+bool BinaryLogReader::Next(BinaryLogRecord &_record)
+{
+  if (!this->dataPtr->valid)
+    return false;
+
+  std::string &scratch = this->dataPtr->scratch;
+  while (true)
+  {
+    uint8_t kind = 0;
+    if (!this->dataPtr->ReadBytes(scratch, 1))
+      return false;
+    kind = static_cast<uint8_t>(scratch[0]);
+
+    if (kind == binarylog::FORMAT_RECORD)
+    {
+      if (!this->dataPtr->ReadBytes(scratch, 3 * sizeof(uint32_t)))
+        return false;
+
+      const char *data = scratch.data();
+      const char *end = data + scratch.size();
+      uint32_t id = 0;
+      int32_t level = 0;
+      int32_t line = 0;
+      binarylog::Read(data, end, id);
+      binarylog::Read(data, end, level);
+      binarylog::Read(data, end, line);
+
+      LogFormatDefinition definition;
+      definition.level = level;
+      definition.line = line;
+      if (!this->dataPtr->ReadString(definition.file) ||
+          !this->dataPtr->ReadString(definition.format))
+      {
+        return false;
+      }
+      this->dataPtr->formats[id] = std::move(definition);
+      continue;
+    }
+
+    if (kind != binarylog::MESSAGE_RECORD)
+    {
+      ignerr << "Corrupt binary log file, unknown record kind ["
+        << static_cast<int>(kind) << "]\n";
+      return false;
+    }
+
+    if (!this->dataPtr->ReadBytes(scratch,
+          binarylog::MessageHeaderSize - 1))
+    {
+      return false;
+    }
+
+    const char *data = scratch.data();
+    const char *end = data + scratch.size();
+    int64_t time = 0;
+    uint32_t formatId = 0;
+    uint32_t thread = 0;
+    uint8_t level = 0;
+    uint16_t argCount = 0;
+    uint32_t argsSize = 0;
+    binarylog::Read(data, end, time);
+    binarylog::Read(data, end, formatId);
+    binarylog::Read(data, end, thread);
+    binarylog::Read(data, end, level);
+    binarylog::Read(data, end, argCount);
+    binarylog::Read(data, end, argsSize);
+
+    _record.time = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds(time)));
+    _record.level = level;
+    _record.thread = thread;
+    _record.file.clear();
+    _record.line = 0;
+    _record.format = "{}";
+    _record.args.clear();
+
+    if (formatId != 0)
+    {
+      auto format = this->dataPtr->formats.find(formatId);
+      if (format != this->dataPtr->formats.end())
+      {
+        _record.file = format->second.file;
+        _record.line = format->second.line;
+        _record.format = format->second.format;
+      }
+      else
+      {
+        _record.format.clear();
+      }
+    }
+
+    if (!this->dataPtr->ReadBytes(scratch, argsSize))
+      return false;
+
+    data = scratch.data();
+    end = data + scratch.size();
+    for (uint16_t i = 0; i < argCount; ++i)
+    {
+      uint8_t type = 0;
+      if (!binarylog::Read(data, end, type))
+        return false;
+
+      std::ostringstream text;
+      switch (static_cast<detail::LogArgType>(type))
+      {
+        case detail::LogArgType::INT64:
+        {
+          int64_t value = 0;
+          if (!binarylog::Read(data, end, value))
+            return false;
+          text << value;
+          break;
+        }
+        case detail::LogArgType::UINT64:
+        {
+          uint64_t value = 0;
+          if (!binarylog::Read(data, end, value))
+            return false;
+          text << value;
+          break;
+        }
+        case detail::LogArgType::DOUBLE:
+        {
+          double value = 0;
+          if (!binarylog::Read(data, end, value))
+            return false;
+          text << value;
+          break;
+        }
+        case detail::LogArgType::BOOL:
+        {
+          uint8_t value = 0;
+          if (!binarylog::Read(data, end, value))
+            return false;
+          text << (value ? "true" : "false");
+          break;
+        }
+        case detail::LogArgType::STRING:
+        {
+          uint32_t size = 0;
+          if (!binarylog::Read(data, end, size) ||
+              static_cast<std::size_t>(end - data) < size)
+          {
+            return false;
+          }
+          text.write(data, size);
+          data += size;
+          break;
+        }
+        default:
+          ignerr << "Corrupt binary log file, unknown argument type ["
+            << static_cast<int>(type) << "]\n";
+          return false;
+      }
+      _record.args.push_back(text.str());
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_COMMON_BINARYLOGFORMAT_HH_
+#define IGNITION_COMMON_BINARYLOGFORMAT_HH_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace ignition
+{
+  namespace common
+  {
+    /// \brief Layout of the binary log files written by FileLogger.
+    ///
+    /// The file starts with Magic, then Version and ByteOrderMark as
+    /// uint32_t. It is followed by records, each starting with a
+    /// RecordKind byte. All values are in the byte order of the writer.
+    ///
+    /// A FORMAT_RECORD defines a format, before its first use:
+    ///   uint32_t id, int32_t level, int32_t line,
+    ///   uint32_t file size, file, uint32_t format size, format.
+    ///
+    /// A MESSAGE_RECORD is a message:
+    ///   int64_t nanoseconds since the epoch, uint32_t format id (0 for a
+    ///   line of text, with a single string argument), uint32_t thread id,
+    ///   uint8_t level, uint16_t argument count, uint32_t arguments size,
+    ///   arguments, each a detail::LogArgType byte followed by the value.
+    namespace binarylog
+    {
+      /// \brief First bytes of a binary log file
+      constexpr char Magic[8] = {'I', 'G', 'N', 'B', 'L', 'O', 'G', '\0'};
+
+      /// \brief Version of the layout
+      constexpr uint32_t Version = 1;
+
+      /// \brief Written as uint32_t to detect the byte order
+      constexpr uint32_t ByteOrderMark = 0x01020304;
+
+      /// \brief Size of the file header
+      constexpr std::size_t HeaderSize = sizeof(Magic) + 2 * sizeof(uint32_t);
+
+      /// \brief Size of a message record before its arguments
+      constexpr std::size_t MessageHeaderSize = 1 + 8 + 4 + 4 + 1 + 2 + 4;
+
+      /// \brief Kinds of records
+      enum RecordKind : uint8_t
+      {
+        FORMAT_RECORD = 1,
+        MESSAGE_RECORD = 2
+      };
+
+      /// \brief Append the bytes of a value.
+      /// \param[in,out] _out Buffer
+      /// \param[in] _value Value
+      template<typename T>
+      void Append(std::string &_out, const T &_value)
+      {
+        _out.append(reinterpret_cast<const char *>(&_value), sizeof(T));
+      }
+
+      /// \brief Read a value and advance.
+      /// \param[in,out] _data Position, advanced past the value
+      /// \param[in] _end End of the data
+      /// \param[out] _value Value read
+      /// \return False if there are not enough bytes.
+      template<typename T>
+      bool Read(const char *&_data, const char *_end, T &_value)
+      {
+        if (static_cast<std::size_t>(_end - _data) < sizeof(T))
+          return false;
+        std::memcpy(&_value, _data, sizeof(T));
+        _data += sizeof(T);
+        return true;
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/common/BinaryLog.hh"
+#include "ignition/common/Console.hh"
+#include "ignition/common/Filesystem.hh"
+#include "ignition/common/Util.hh"
+
+#include "test/util.hh"
+
+using namespace ignition;
+
+/// \brief Type written with its operator<<
+struct Point
+{
+  int x;
+  int y;
+};
+
+/////////////////////////////////////////////////
+std::ostream &operator<<(std::ostream &_out, const Point &_point)
+{
+  _out << "(" << _point.x << ", " << _point.y << ")";
+  return _out;
+}
+
+/////////////////////////////////////////////////
+class BinaryLog_TEST : public ::testing::Test
+{
+  /// \brief Create a log directory
+  public: void SetUp() override
+  {
+    this->dir = common::joinPaths(IGN_TMP_DIR, common::uuid());
+    std::string home;
+    common::env(IGN_HOMEDIR, home);
+    this->absDir = common::joinPaths(home, this->dir);
+  }
+
+  /// \brief Remove the log directory, and go back to a text log
+  public: void TearDown() override
+  {
+    ignLogInit(this->dir, "text.log");
+    common::removeAll(this->absDir);
+  }
+
+  /// \brief Read all the records of a binary log file
+  /// \param[in] _file Name of the file in the log directory
+  /// \return The records
+  public: std::vector<common::BinaryLogRecord> ReadAll(
+              const std::string &_file)
+  {
+    common::Console::log.flush();
+    common::BinaryLogReader reader(common::joinPaths(this->absDir, _file));
+    EXPECT_TRUE(reader.Valid());
+
+    std::vector<common::BinaryLogRecord> records;
+    common::BinaryLogRecord record;
+    while (reader.Next(record))
+      records.push_back(record);
+    return records;
+  }
+
+  /// \brief Log directory, relative to the home directory
+  public: std::string dir;
+
+  /// \brief Absolute log directory
+  public: std::string absDir;
+};
+
+/////////////////////////////////////////////////
+TEST_F(BinaryLog_TEST, RoundTrip)
+{
+  ignLogInitBinary(this->dir, "test.blog");
+  EXPECT_TRUE(common::Console::log.Binary());
+
+  const int line = __LINE__ + 1;
+  ignlogf(3, "reached waypoint {} at {} m/s: {}")(7, 2.5, "done");
+  ignlogf(1, "flags {} {} {} {}")(true, 'c', 42u, Point{1, -2});
+  ignlogf(4, "no arguments")();
+  ignlogf(2, "extra {}")(1, int64_t(-5), 0.25f);
+  ignlog << "plain text " << 3 << std::endl;
+
+  auto records = this->ReadAll("test.blog");
+  ASSERT_EQ(5u, records.size());
+
+  EXPECT_EQ("reached waypoint 7 at 2.5 m/s: done", records[0].Text());
+  EXPECT_EQ(3, records[0].level);
+  EXPECT_EQ(line, records[0].line);
+  EXPECT_NE(std::string::npos,
+      records[0].file.find("BinaryLog_TEST.cc"));
+  EXPECT_EQ(std::vector<std::string>({"7", "2.5", "done"}),
+      records[0].args);
+
+  EXPECT_EQ("flags true c 42 (1, -2)", records[1].Text());
+  EXPECT_EQ(1, records[1].level);
+  EXPECT_EQ(line + 1, records[1].line);
+
+  EXPECT_EQ("no arguments", records[2].Text());
+  EXPECT_EQ("extra 1 -5 0.25", records[3].Text());
+
+  // Text written to the logger is one record per line
+  EXPECT_EQ(0, records[4].level);
+  EXPECT_TRUE(records[4].file.empty());
+  EXPECT_NE(std::string::npos, records[4].Text().find("plain text 3"));
+
+  for (const auto &record : records)
+    EXPECT_EQ(records[0].thread, record.thread);
+
+  const std::string text = records[0].ToString();
+  EXPECT_NE(std::string::npos, text.find("[Msg] "));
+  EXPECT_NE(std::string::npos, text.find(
+        "[BinaryLog_TEST.cc:" + std::to_string(line) + "] reached"));
+}
+
+/////////////////////////////////////////////////
+TEST_F(BinaryLog_TEST, FormatWrittenOnce)
+{
+  ignLogInitBinary(this->dir, "test.blog");
+
+  for (int i = 0; i < 100; ++i)
+  {
+    ignlogf(3, "a format with a long text that is only stored once, "
+        "followed by an argument {}")(i);
+  }
+
+  auto records = this->ReadAll("test.blog");
+  ASSERT_EQ(100u, records.size());
+  EXPECT_EQ(records.front().line, records.back().line);
+  EXPECT_NE(std::string::npos, records.back().Text().find("argument 99"));
+
+  // The records hold the arguments, not the format
+  std::ifstream file(common::joinPaths(this->absDir, "test.blog"),
+      std::ios::binary | std::ios::ate);
+  EXPECT_LT(file.tellg(), 100 * 50);
+}
+
+/////////////////////////////////////////////////
+TEST_F(BinaryLog_TEST, Threads)
+{
+  ignLogInitBinary(this->dir, "test.blog");
+
+  const int threadCount = 4;
+  const int messages = 500;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t)
+  {
+    threads.emplace_back([t, messages]
+        {
+          for (int i = 0; i < messages; ++i)
+            ignlogf(4, "thread {} message {}")(t, i);
+        });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  auto records = this->ReadAll("test.blog");
+  ASSERT_EQ(static_cast<std::size_t>(threadCount * messages),
+      records.size());
+
+  // Each writer has its own thread id, and its messages are in order
+  std::map<uint32_t, int> next;
+  for (const auto &record : records)
+  {
+    ASSERT_EQ(2u, record.args.size());
+    EXPECT_EQ(std::to_string(next[record.thread]++), record.args[1]);
+  }
+  EXPECT_EQ(static_cast<std::size_t>(threadCount), next.size());
+}
+
+/////////////////////////////////////////////////
+TEST_F(BinaryLog_TEST, TextMode)
+{
+  // In a text log file, the message is formatted in place
+  ignLogInit(this->dir, "test.log");
+  EXPECT_FALSE(common::Console::log.Binary());
+
+  ignlogf(3, "reached waypoint {} at {} m/s")(7, 2.5);
+
+  std::ifstream file(common::joinPaths(this->absDir, "test.log"));
+  std::string content((std::istreambuf_iterator<char>(file)),
+      std::istreambuf_iterator<char>());
+  EXPECT_NE(std::string::npos,
+      content.find("] reached waypoint 7 at 2.5 m/s\n"));
+}
+
+/////////////////////////////////////////////////
+TEST_F(BinaryLog_TEST, MessageMetadata)
+{
+  ignLogInitBinary(this->dir, "test.blog");
+  const int verbosity = common::Console::Verbosity();
+  common::Console::SetVerbosity(0);
+
+  const auto before = IGN_SYSTEM_TIME();
+  ignerr << "sync " << "error" << std::endl;
+  ignwarn << "sync warning\n";
+
+  // Asynchronous records are written by a background thread
+  common::Console::SetAsync(true);
+  uint32_t producer = 0;
+  std::chrono::system_clock::time_point logged;
+  std::thread thread([&producer, &logged]
+      {
+        producer = common::FileLogger::ThreadId();
+        ignmsg << "async message" << std::endl;
+        igndbg << "async debug" << std::endl;
+        logged = IGN_SYSTEM_TIME();
+      });
+  thread.join();
+  common::Console::Flush();
+  common::Console::SetAsync(false);
+  common::Console::SetVerbosity(verbosity);
+
+  std::map<std::string, common::BinaryLogRecord> records;
+  for (const auto &record : this->ReadAll("test.blog"))
+  {
+    for (const std::string text : {"sync error", "sync warning",
+                                   "async message", "async debug"})
+    {
+      if (record.Text().find(text) != std::string::npos)
+        records[text] = record;
+    }
+  }
+  ASSERT_EQ(4u, records.size());
+
+  // Each record has the level, thread and time of its message
+  EXPECT_EQ(1, records["sync error"].level);
+  EXPECT_EQ(2, records["sync warning"].level);
+  EXPECT_EQ(3, records["async message"].level);
+  EXPECT_EQ(4, records["async debug"].level);
+  const uint32_t self = common::FileLogger::ThreadId();
+  EXPECT_EQ(self, records["sync error"].thread);
+  EXPECT_EQ(self, records["sync warning"].thread);
+  EXPECT_NE(self, producer);
+  EXPECT_EQ(producer, records["async message"].thread);
+  EXPECT_EQ(producer, records["async debug"].thread);
+  for (const auto &record : records)
+  {
+    EXPECT_LE(before, record.second.time);
+    EXPECT_LE(record.second.time, logged);
+  }
+
+  // The prefix of the logger is not repeated
+  const std::string text = records["sync error"].ToString();
+  EXPECT_EQ(text.find("[Err] "), text.rfind("[Err] "));
+}
+
+/////////////////////////////////////////////////
+TEST_F(BinaryLog_TEST, InvalidFile)
+{
+  common::BinaryLogReader missing(
+      common::joinPaths(this->absDir, "missing.blog"));
+  EXPECT_FALSE(missing.Valid());
+
+  ignLogInit(this->dir, "test.log");
+  ignlog << "not a binary log" << std::endl;
+  common::BinaryLogReader text(common::joinPaths(this->absDir, "test.log"));
+  EXPECT_FALSE(text.Valid());
+
+  common::BinaryLogRecord record;
+  EXPECT_FALSE(text.Next(record));
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
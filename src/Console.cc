@@ -14,11 +14,22 @@
  * limitations under the License.
  *
  */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <ignition/common/Console.hh>
 #include <ignition/common/config.hh>
+#include <ignition/common/detail/MpmcRing.hh>
+
+#include "BinaryLogFormat.hh"
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -52,6 +63,524 @@ Logger Console::dbg("[Dbg] ", blue, Logger::STDOUT, 4);
 int Console::verbosity = 1;
 std::string Console::customPrefix = ""; // NOLINT(*)
 
+namespace
+{
+  /// \brief A complete message, waiting to be written.
+  struct LogRecord
+  {
+    /// \brief Terminal stream to write to
+    Logger::LogType type = Logger::STDOUT;
+
+    /// \brief Color of the terminal output
+    int color = 0;
+
+    /// \brief Whether the verbosity allowed terminal output when the
+    /// message was logged
+    bool toTerminal = false;
+
+    /// \brief When the message was started
+    std::chrono::system_clock::time_point time;
+
+    /// \brief Verbosity level of the logger
+    int level = 0;
+
+    /// \brief Thread that logged the message, see FileLogger::ThreadId
+    uint32_t thread = 0;
+
+    /// \brief Text, including the prefix
+    std::string text;
+  };
+
+  /// \brief A message being composed by a thread, for one logger.
+  struct PendingMessage
+  {
+    /// \brief Logger buffer that the message belongs to
+    const void *owner = nullptr;
+
+    /// \brief Terminal stream of the logger
+    Logger::LogType type = Logger::STDOUT;
+
+    /// \brief Color of the logger
+    int color = 0;
+
+    /// \brief Verbosity level of the logger
+    int verbosity = 0;
+
+    /// \brief Text written so far
+    std::string text;
+
+    /// \brief When the message was started, valid if timed is true
+    std::chrono::system_clock::time_point time;
+
+    /// \brief Whether time was set
+    bool timed = false;
+
+    /// \brief In synchronous mode, text of the current line not written
+    /// yet to a binary log file
+    std::string fileText;
+  };
+
+  /// \brief Background thread and bounded queue of asynchronous logging.
+  class AsyncLog
+  {
+    /// \brief Constructor, starts the background thread.
+    /// \param[in] _capacity Capacity of the queue
+    public: explicit AsyncLog(const std::size_t _capacity)
+      : queue(_capacity)
+    {
+      this->thread = std::thread(&AsyncLog::Run, this);
+    }
+
+    /// \brief Destructor, writes the queued records and stops the thread.
+    public: ~AsyncLog()
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+        this->wake.notify_all();
+      }
+      this->thread.join();
+    }
+
+    /// \brief Queue a record, or drop it if the queue is full.
+    /// \param[in] _record Record, moved from if it was queued.
+    public: void Push(LogRecord &_record)
+    {
+      if (!this->queue.TryPush(_record))
+      {
+        ++this->dropped;
+        return;
+      }
+
+      ++this->pushed;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (this->sleeping)
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->wake.notify_all();
+      }
+    }
+
+    /// \brief Wait until the records queued so far have been written.
+    public: void Flush()
+    {
+      const uint64_t target = this->pushed;
+      std::unique_lock<std::mutex> lock(this->mutex);
+      ++this->flushing;
+      this->wake.notify_all();
+      this->flushed.wait(lock, [this, target]
+          {
+            return this->written >= target;
+          });
+      --this->flushing;
+    }
+
+    /// \brief Number of records dropped because the queue was full
+    public: std::atomic<uint64_t> dropped{0};
+
+    /// \brief Loop of the background thread.
+    private: void Run()
+    {
+      std::vector<LogRecord> batch;
+      std::optional<LogRecord> record;
+      while (true)
+      {
+        while (batch.size() < 256 && this->queue.TryPop(record))
+          batch.push_back(std::move(*record));
+
+        if (!batch.empty())
+        {
+          Write(batch);
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->written += batch.size();
+          if (this->flushing > 0)
+            this->flushed.notify_all();
+          batch.clear();
+          continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if (this->stop)
+          break;
+
+        this->sleeping = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!this->queue.Ready())
+        {
+          // The timeout only guards against a push in progress whose
+          // record isn't visible yet.
+          this->wake.wait_for(lock, std::chrono::milliseconds(50));
+        }
+        this->sleeping = false;
+      }
+    }
+
+    /// \brief Write records to the log file and the terminal.
+    /// \param[in] _batch Records to write
+    private: static void Write(const std::vector<LogRecord> &_batch);
+
+    /// \brief Queue, only popped by the background thread
+    private: detail::MpmcRing<LogRecord> queue;
+
+    /// \brief Number of records queued
+    private: std::atomic<uint64_t> pushed{0};
+
+    /// \brief Number of records written, guarded by mutex
+    private: uint64_t written = 0;
+
+    /// \brief Number of threads in Flush, guarded by mutex
+    private: unsigned int flushing = 0;
+
+    /// \brief True while the background thread may wait for records
+    private: std::atomic<bool> sleeping{false};
+
+    /// \brief True to stop the background thread, guarded by mutex
+    private: bool stop = false;
+
+    /// \brief Used with the condition variables
+    private: std::mutex mutex;
+
+    /// \brief Wakes the background thread
+    private: std::condition_variable wake;
+
+    /// \brief Signaled when records were written
+    private: std::condition_variable flushed;
+
+    /// \brief Background thread
+    private: std::thread thread;
+  };
+
+  /// \brief Serializes the changes of asynchronous mode.
+  std::mutex gAsyncMutex;
+
+  /// \brief Asynchronous log, or null in synchronous mode.
+  std::atomic<AsyncLog *> gAsync{nullptr};
+
+  /// \brief Dropped count of the last asynchronous log.
+  std::atomic<uint64_t> gLastDropped{0};
+
+  /// \brief Hazard slot, in which a thread publishes the asynchronous log
+  /// it uses, on its own cache line. An asynchronous log is only deleted
+  /// once no slot holds it.
+  struct alignas(64) AsyncSlot
+  {
+    /// \brief Asynchronous log in use by the owner, or null
+    std::atomic<AsyncLog *> log{nullptr};
+
+    /// \brief Whether a thread owns the slot
+    std::atomic<bool> owned{true};
+
+    /// \brief Next slot of gAsyncSlots
+    AsyncSlot *next = nullptr;
+  };
+
+  /// \brief Slots of all the threads. Slots of threads that exited are
+  /// reused, and never freed, so that loggers still work while static
+  /// objects are destroyed.
+  std::atomic<AsyncSlot *> gAsyncSlots{nullptr};
+
+  /// \brief Slot of the calling thread, null before its first use and
+  /// after it is released.
+  thread_local AsyncSlot *tlsAsyncSlot = nullptr;
+
+  /// \brief Set once the calling thread released its slot.
+  thread_local bool tlsAsyncSlotReleased = false;
+
+  /// \brief Releases the slot of a thread when the thread exits.
+  class AsyncSlotOwner
+  {
+    /// \brief Destructor
+    public: ~AsyncSlotOwner()
+    {
+      tlsAsyncSlot->owned.store(false, std::memory_order_release);
+      tlsAsyncSlot = nullptr;
+      tlsAsyncSlotReleased = true;
+    }
+  };
+
+  /// \brief Get the slot of the calling thread.
+  /// \return The slot, or null once the thread released it.
+  AsyncSlot *ThreadAsyncSlot()
+  {
+    if (tlsAsyncSlot || tlsAsyncSlotReleased)
+      return tlsAsyncSlot;
+
+    // Reuse the slot of a thread that exited, or add one
+    for (AsyncSlot *slot = gAsyncSlots.load(); slot; slot = slot->next)
+    {
+      bool owned = false;
+      if (slot->owned.compare_exchange_strong(owned, true))
+      {
+        tlsAsyncSlot = slot;
+        break;
+      }
+    }
+    if (!tlsAsyncSlot)
+    {
+      AsyncSlot *slot = new AsyncSlot;
+      slot->next = gAsyncSlots.load();
+      while (!gAsyncSlots.compare_exchange_weak(slot->next, slot))
+      {
+      }
+      tlsAsyncSlot = slot;
+    }
+
+    thread_local AsyncSlotOwner owner;
+    return tlsAsyncSlot;
+  }
+
+  /// \brief Marks gAsync as used by the calling thread for as long as it
+  /// exists, only touching the slot of the thread. A thread holds at most
+  /// one guard at a time.
+  class AsyncGuard
+  {
+    /// \brief Constructor
+    public: AsyncGuard()
+      : slot(ThreadAsyncSlot())
+    {
+      if (!this->slot)
+      {
+        // The thread is exiting and released its slot
+        this->lock = std::unique_lock<std::mutex>(gAsyncMutex);
+        this->log = gAsync.load();
+        return;
+      }
+
+      // Publish the log, then check that it wasn't replaced meanwhile, in
+      // which case SetAsync may not have seen the slot.
+      this->log = gAsync.load();
+      while (true)
+      {
+        this->slot->log.store(this->log);
+        AsyncLog *current = gAsync.load();
+        if (current == this->log)
+          break;
+        this->log = current;
+      }
+    }
+
+    /// \brief Destructor
+    public: ~AsyncGuard()
+    {
+      if (this->slot)
+        this->slot->log.store(nullptr, std::memory_order_release);
+    }
+
+    /// \brief Asynchronous log, or null
+    public: AsyncLog *log = nullptr;
+
+    /// \brief Slot of the calling thread
+    private: AsyncSlot *slot;
+
+    /// \brief Lock of gAsyncMutex, if the thread has no slot
+    private: std::unique_lock<std::mutex> lock;
+  };
+
+  /// \brief Write a message to the terminal.
+  /// \param[in] _type Terminal stream
+  /// \param[in] _color Color of the text
+  /// \param[in] _text Text to write
+  void WriteToTerminal(const Logger::LogType _type, const int _color,
+                       std::string _text)
+  {
+    if (_text.empty())
+      return;
+
+#ifndef _WIN32
+    bool lastNewLine = _text.back() == '\n';
+    FILE *outstream = _type == Logger::STDOUT ? stdout : stderr;
+
+    if (lastNewLine)
+      _text.pop_back();
+
+    std::stringstream ss;
+    ss << "\033[1;" << _color << "m" << _text << "\033[0m";
+    if (lastNewLine)
+      ss << std::endl;
+
+    fprintf(outstream, "%s", ss.str().c_str());
+#else
+    HANDLE hConsole = GetStdHandle(
+          _type == Logger::STDOUT ? STD_OUTPUT_HANDLE : STD_ERROR_HANDLE);
+
+    CONSOLE_SCREEN_BUFFER_INFO originalBufferInfo;
+    GetConsoleScreenBufferInfo(hConsole, &originalBufferInfo);
+
+    SetConsoleTextAttribute(hConsole, _color);
+
+    std::ostream &outStream =
+        _type == Logger::STDOUT ? std::cout : std::cerr;
+
+    outStream << _text;
+
+    SetConsoleTextAttribute(hConsole, originalBufferInfo.wAttributes);
+#endif
+  }
+
+  //////////////////////////////////////////////////
+  void AsyncLog::Write(const std::vector<LogRecord> &_batch)
+  {
+    // Straight to the file, since other threads may write to the stream
+    // buffer of the logger with ignlog
+    if (Console::log.Binary())
+    {
+      // Each record keeps the time, level and thread of its message, and
+      // the file is flushed once
+      for (std::size_t i = 0; i < _batch.size(); ++i)
+      {
+        const LogRecord &record = _batch[i];
+        Console::log.WriteLines(record.text, record.time, record.level,
+            record.thread, i + 1 == _batch.size());
+      }
+    }
+    else
+    {
+      // A single write to the log file, which flushes once
+      std::string fileText;
+      for (const LogRecord &record : _batch)
+        fileText += "(" + timeToIso(record.time) + ") " + record.text;
+      Console::log.WriteLines(fileText);
+    }
+
+    for (const LogRecord &record : _batch)
+    {
+      if (record.toTerminal)
+        WriteToTerminal(record.type, record.color, record.text);
+    }
+    fflush(stdout);
+  }
+
+  /// \brief Write a record, asynchronously if enabled.
+  /// \param[in] _record Record to write
+  void WriteRecord(LogRecord &_record)
+  {
+    AsyncGuard guard;
+    if (guard.log)
+    {
+      guard.log->Push(_record);
+      return;
+    }
+
+    // Asynchronous mode was disabled while the message was composed
+    if (!Console::log.Binary())
+      Console::log << "(" << timeToIso(_record.time) << ") ";
+    Console::log << _record.text;
+    if (_record.toTerminal)
+      WriteToTerminal(_record.type, _record.color, _record.text);
+  }
+
+  /// \brief Turn an unfinished message into a record.
+  /// \param[in] _message Message, emptied
+  /// \return The record.
+  LogRecord TakeRecord(PendingMessage &_message)
+  {
+    LogRecord record;
+    record.type = _message.type;
+    record.color = _message.color;
+    record.toTerminal = Console::Verbosity() >= _message.verbosity;
+    record.time = _message.timed ? _message.time : IGN_SYSTEM_TIME();
+    record.level = _message.verbosity;
+    record.thread = FileLogger::ThreadId();
+    record.text.swap(_message.text);
+    _message.timed = false;
+    return record;
+  }
+
+  /// \brief Set once the messages of the calling thread are destroyed, so
+  /// that the loggers don't touch them during shutdown.
+  thread_local bool tlsMessagesDestroyed = false;
+
+  /// \brief Messages being composed by the calling thread.
+  class ThreadMessages
+  {
+    /// \brief Constructor. Takes the slot of the thread first, so that
+    /// the slot is released after the unfinished messages are written.
+    public: ThreadMessages()
+    {
+      ThreadAsyncSlot();
+    }
+
+    /// \brief Destructor, writes the unfinished messages in asynchronous
+    /// mode.
+    public: ~ThreadMessages()
+    {
+      this->WriteUnfinished();
+      tlsMessagesDestroyed = true;
+    }
+
+    /// \brief Write the unfinished messages in asynchronous mode.
+    public: void WriteUnfinished()
+    {
+      if (!Console::Async())
+        return;
+
+      for (PendingMessage &message : this->messages)
+      {
+        if (!message.text.empty())
+        {
+          LogRecord record = TakeRecord(message);
+          WriteRecord(record);
+        }
+      }
+    }
+
+    /// \brief One message per logger
+    public: std::vector<PendingMessage> messages;
+  };
+
+  /// \brief Get the messages of the calling thread.
+  /// \return The messages, or null if they were destroyed.
+  ThreadMessages *Messages()
+  {
+    if (tlsMessagesDestroyed)
+      return nullptr;
+
+    thread_local ThreadMessages messages;
+    return &messages;
+  }
+
+  /// \brief Get the message that the calling thread composes for a
+  /// logger.
+  /// \param[in] _owner Logger buffer
+  /// \param[in] _type Terminal stream of the logger
+  /// \param[in] _color Color of the logger
+  /// \param[in] _verbosity Verbosity level of the logger
+  /// \return The message, or null during shutdown.
+  PendingMessage *Message(const void *_owner, const Logger::LogType _type,
+      const int _color, const int _verbosity)
+  {
+    ThreadMessages *messages = Messages();
+    if (!messages)
+      return nullptr;
+
+    for (PendingMessage &message : messages->messages)
+    {
+      if (message.owner == _owner)
+        return &message;
+    }
+
+    messages->messages.emplace_back();
+    PendingMessage &message = messages->messages.back();
+    message.owner = _owner;
+    message.type = _type;
+    message.color = _color;
+    message.verbosity = _verbosity;
+    return &message;
+  }
+
+  /// \brief Disables asynchronous logging at exit, writing what is left.
+  class AsyncShutdown
+  {
+    /// \brief Destructor
+    public: ~AsyncShutdown()
+    {
+      Console::SetAsync(false);
+    }
+  };
+
+  AsyncShutdown gAsyncShutdown;
+}
+
 //////////////////////////////////////////////////
 void Console::SetVerbosity(const int _level)
 {
@@ -76,6 +605,58 @@ std::string Console::Prefix()
   return customPrefix;
 }
 
+//////////////////////////////////////////////////
+void Console::SetAsync(const bool _async, const std::size_t _queueSize)
+{
+  std::lock_guard<std::mutex> lock(gAsyncMutex);
+
+  AsyncLog *old = gAsync.exchange(nullptr);
+  if (old)
+  {
+    // Threads that loaded the pointer before the exchange may still be
+    // pushing.
+    for (AsyncSlot *slot = gAsyncSlots.load(); slot; slot = slot->next)
+    {
+      while (slot->log.load() == old)
+        std::this_thread::yield();
+    }
+
+    gLastDropped = old->dropped.load();
+    delete old;
+  }
+
+  if (_async)
+  {
+    gLastDropped = 0;
+    gAsync = new AsyncLog(_queueSize);
+  }
+}
+
+//////////////////////////////////////////////////
+bool Console::Async()
+{
+  return gAsync.load() != nullptr;
+}
+
+//////////////////////////////////////////////////
+void Console::Flush()
+{
+  ThreadMessages *messages = Messages();
+  if (messages)
+    messages->WriteUnfinished();
+
+  AsyncGuard guard;
+  if (guard.log)
+    guard.log->Flush();
+}
+
+//////////////////////////////////////////////////
+uint64_t Console::DroppedCount()
+{
+  AsyncGuard guard;
+  return guard.log ? guard.log->dropped.load() : gLastDropped.load();
+}
+
 /////////////////////////////////////////////////
 Logger::Logger(const std::string &_prefix, const int _color,
                const LogType _type, const int _verbosity)
@@ -89,10 +670,44 @@ Logger::~Logger()
 {
 }
 
+/////////////////////////////////////////////////
+/// \brief Start a message: write the timestamp to the log file, or in
+/// asynchronous mode, remember the time for the background thread.
+/// \param[in] _buffer Buffer of the logger
+static void StartMessage(const std::streambuf *_buffer)
+{
+  const bool async = Console::Async();
+  if (!async && !Console::log.Binary())
+  {
+    Console::log << "(" << ignition::common::systemTimeIso() << ") ";
+    return;
+  }
+
+  // Remember the time for the records of the message
+  ThreadMessages *messages = Messages();
+  if (!messages)
+    return;
+
+  for (PendingMessage &message : messages->messages)
+  {
+    if (message.owner != _buffer)
+      continue;
+
+    // The previous message didn't end with a newline
+    if (async && !message.text.empty())
+    {
+      LogRecord record = TakeRecord(message);
+      WriteRecord(record);
+    }
+    message.time = IGN_SYSTEM_TIME();
+    message.timed = true;
+  }
+}
+
 /////////////////////////////////////////////////
 Logger &Logger::operator()()
 {
-  Console::log << "(" << ignition::common::systemTimeIso() << ") ";
+  StartMessage(this->rdbuf());
   (*this) << Console::Prefix() << this->prefix;
 
   return (*this);
@@ -103,7 +718,7 @@ Logger &Logger::operator()(const std::string &_file, int _line)
 {
   int index = _file.find_last_of("/") + 1;
 
-  Console::log << "(" << ignition::common::systemTimeIso() << ") ";
+  StartMessage(this->rdbuf());
   std::stringstream prefixString;
   prefixString << Console::Prefix() << this->prefix
     << "[" << _file.substr(index , _file.size() - index) << ":"
@@ -117,6 +732,9 @@ Logger &Logger::operator()(const std::string &_file, int _line)
 Logger::Buffer::Buffer(LogType _type, const int _color, const int _verbosity)
   :  type(_type), color(_color), verbosity(_verbosity)
 {
+  // Every write goes through overflow or xsputn, into the message of the
+  // calling thread, so that threads don't share a put area.
+  this->setp(nullptr, nullptr);
 }
 
 /////////////////////////////////////////////////
@@ -126,49 +744,82 @@ Logger::Buffer::~Buffer()
 }
 
 /////////////////////////////////////////////////
-int Logger::Buffer::sync()
+Logger::Buffer::int_type Logger::Buffer::overflow(int_type _c)
 {
-  std::string outstr = this->str();
-
-  // Log messages to disk
-  Console::log << outstr;
-  Console::log.flush();
-
-  // Output to terminal
-  if (Console::Verbosity() >= this->verbosity && !outstr.empty())
-  {
-#ifndef _WIN32
-    bool lastNewLine = outstr.back() == '\n';
-    FILE *outstream = this->type == Logger::STDOUT ? stdout : stderr;
-
-    if (lastNewLine)
-      outstr.pop_back();
+  if (traits_type::eq_int_type(_c, traits_type::eof()))
+    return traits_type::not_eof(_c);
 
-    std::stringstream ss;
-    ss << "\033[1;" << this->color << "m" << outstr << "\033[0m";
-    if (lastNewLine)
-      ss << std::endl;
+  const char c = traits_type::to_char_type(_c);
+  this->xsputn(&c, 1);
+  return _c;
+}
 
-    fprintf(outstream, "%s", ss.str().c_str());
-#else
-    HANDLE hConsole = GetStdHandle(
-          this->type == Logger::STDOUT ? STD_OUTPUT_HANDLE : STD_ERROR_HANDLE);
+/////////////////////////////////////////////////
+std::streamsize Logger::Buffer::xsputn(const char *_s, std::streamsize _n)
+{
+  PendingMessage *message =
+    Message(this, this->type, this->color, this->verbosity);
+  std::string &text = message ? message->text : this->fallback;
+  text.append(_s, static_cast<std::size_t>(_n));
+  return _n;
+}
 
-    CONSOLE_SCREEN_BUFFER_INFO originalBufferInfo;
-    GetConsoleScreenBufferInfo(hConsole, &originalBufferInfo);
+/////////////////////////////////////////////////
+int Logger::Buffer::sync()
+{
+  PendingMessage *message =
+    Message(this, this->type, this->color, this->verbosity);
+  std::string &text = message ? message->text : this->fallback;
+  if (text.empty())
+    return 0;
 
-    SetConsoleTextAttribute(hConsole, this->color);
+  if (message && Console::Async())
+  {
+    // Queue the complete lines, the rest waits for more text
+    const std::size_t end = text.rfind('\n');
+    if (end == std::string::npos)
+      return 0;
 
-    std::ostream &outStream =
-        this->type == Logger::STDOUT ? std::cout : std::cerr;
+    LogRecord record = TakeRecord(*message);
+    message->text = record.text.substr(end + 1);
+    record.text.resize(end + 1);
+    if (!message->text.empty())
+    {
+      message->time = record.time;
+      message->timed = true;
+    }
+    WriteRecord(record);
+    return 0;
+  }
 
-    outStream << outstr;
+  std::string outstr;
+  outstr.swap(text);
 
-    SetConsoleTextAttribute(hConsole, originalBufferInfo.wAttributes);
-#endif
+  // Log messages to disk. A binary log file gets the complete lines, with
+  // the time, level and thread of the message.
+  if (message && Console::log.Binary())
+  {
+    message->fileText += outstr;
+    const std::size_t end = message->fileText.rfind('\n');
+    if (end != std::string::npos)
+    {
+      Console::log.WriteLines(message->fileText.substr(0, end + 1),
+          message->timed ? message->time : IGN_SYSTEM_TIME(),
+          this->verbosity, FileLogger::ThreadId(), true);
+      message->fileText.erase(0, end + 1);
+      message->timed = !message->fileText.empty() && message->timed;
+    }
+  }
+  else
+  {
+    Console::log << outstr;
+    Console::log.flush();
   }
 
-  this->str("");
+  // Output to terminal
+  if (Console::Verbosity() >= this->verbosity)
+    WriteToTerminal(this->type, this->color, outstr);
+
   return 0;
 }
 
@@ -199,6 +850,26 @@ FileLogger::~FileLogger()
 /////////////////////////////////////////////////
 void FileLogger::Init(const std::string &_directory,
                       const std::string &_filename)
+{
+  this->Open(_directory, _filename, false);
+}
+
+/////////////////////////////////////////////////
+void FileLogger::InitBinary(const std::string &_directory,
+                            const std::string &_filename)
+{
+  this->Open(_directory, _filename, true);
+}
+
+/////////////////////////////////////////////////
+bool FileLogger::Binary() const
+{
+  return static_cast<FileLogger::Buffer*>(this->rdbuf())->binary;
+}
+
+/////////////////////////////////////////////////
+void FileLogger::Open(const std::string &_directory,
+                      const std::string &_filename, const bool _binary)
 {
   std::string logPath;
 
@@ -227,6 +898,8 @@ void FileLogger::Init(const std::string &_directory,
 
   logPath = logPath + "/" + _filename;
 
+  std::lock_guard<std::mutex> lock(buf->mutex);
+
   // Check if the Init method has been already called, and if so
   // remove current buffer.
   if (buf->stream)
@@ -235,10 +908,21 @@ void FileLogger::Init(const std::string &_directory,
     buf->stream = nullptr;
   }
 
-  buf->stream = new std::ofstream(logPath.c_str(), std::ios::out);
+  buf->stream = new std::ofstream(logPath.c_str(),
+      _binary ? std::ios::out | std::ios::binary : std::ios::out);
   if (!buf->stream->is_open())
     std::cerr << "Error opening log file: " << logPath << std::endl;
 
+  buf->binary = _binary;
+  buf->writtenFormats.clear();
+  if (_binary)
+  {
+    std::string header(binarylog::Magic, sizeof(binarylog::Magic));
+    binarylog::Append(header, binarylog::Version);
+    binarylog::Append(header, binarylog::ByteOrderMark);
+    buf->stream->write(header.data(), header.size());
+  }
+
   // Update the log directory name.
   if (isDirectory(logPath))
     this->logDirectory = logPath;
@@ -258,7 +942,8 @@ FileLogger &FileLogger::operator()()
   if (!this->initialized)
     this->Init(".ignition", "auto_default.log");
 
-  (*this) << "(" << ignition::common::systemTimeIso() << ") ";
+  if (!this->Binary())
+    (*this) << "(" << ignition::common::systemTimeIso() << ") ";
   return (*this);
 }
 
@@ -269,12 +954,44 @@ FileLogger &FileLogger::operator()(const std::string &_file, int _line)
     this->Init(".ignition", "auto_default.log");
 
   int index = _file.find_last_of("/") + 1;
-  (*this) << "(" << ignition::common::systemTimeIso() << ") ["
-    << _file.substr(index , _file.size() - index) << ":" << _line << "]";
+  if (!this->Binary())
+    (*this) << "(" << ignition::common::systemTimeIso() << ") ";
+  (*this) << "[" << _file.substr(index , _file.size() - index) << ":"
+    << _line << "]";
 
   return (*this);
 }
 
+/////////////////////////////////////////////////
+void FileLogger::WriteLines(const std::string &_text)
+{
+  this->WriteLines(_text, IGN_SYSTEM_TIME(), 0, ThreadId(), true);
+}
+
+/////////////////////////////////////////////////
+void FileLogger::WriteLines(const std::string &_text,
+    const std::chrono::system_clock::time_point &_time, const int _level,
+    const uint32_t _thread, const bool _flush)
+{
+  FileLogger::Buffer *buf = static_cast<FileLogger::Buffer*>(this->rdbuf());
+  buf->WriteText(_text, _time, _level, _thread);
+  if (!_flush)
+    return;
+
+  std::lock_guard<std::mutex> lock(buf->mutex);
+  if (buf->stream)
+    buf->stream->flush();
+}
+
+/////////////////////////////////////////////////
+uint32_t FileLogger::ThreadId()
+{
+  // Small ids for the threads, in order of first use
+  static std::atomic<uint32_t> threadCount{0};
+  thread_local const uint32_t threadId = ++threadCount;
+  return threadId;
+}
+
 /////////////////////////////////////////////////
 std::string FileLogger::LogDirectory() const
 {
@@ -304,10 +1021,142 @@ int FileLogger::Buffer::sync()
   if (!this->stream)
     return -1;
 
-  *this->stream << this->str();
+  const std::string text = this->str();
+  const std::size_t restSize = this->WriteText(text, IGN_SYSTEM_TIME(), 0,
+      FileLogger::ThreadId());
 
-  this->stream->flush();
+  // In a binary log file, the rest waits for more text
+  const std::string rest = text.substr(text.size() - restSize);
+  this->str(rest);
+  this->pbump(static_cast<int>(rest.size()));
 
-  this->str("");
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->stream->flush();
   return !(*this->stream);
 }
+
+/////////////////////////////////////////////////
+std::size_t FileLogger::Buffer::WriteText(const std::string &_text,
+    const std::chrono::system_clock::time_point &_time, const int _level,
+    const uint32_t _thread)
+{
+  if (!this->binary)
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->stream)
+      *this->stream << _text;
+    return 0;
+  }
+
+  // One record per complete line
+  std::size_t start = 0;
+  for (std::size_t end = _text.find('\n'); end != std::string::npos;
+       end = _text.find('\n', start))
+  {
+    std::string args;
+    detail::EncodeLogString(args,
+        std::string_view(_text.data() + start, end - start));
+    this->WriteRecord(nullptr, args, 1, _time, _level, _thread);
+    start = end + 1;
+  }
+  return _text.size() - start;
+}
+
+/////////////////////////////////////////////////
+void FileLogger::Buffer::WriteRecord(const LogFormat *_format,
+    const std::string &_args, const uint16_t _argCount)
+{
+  this->WriteRecord(_format, _args, _argCount, IGN_SYSTEM_TIME(),
+      _format->Level(), FileLogger::ThreadId());
+}
+
+/////////////////////////////////////////////////
+void FileLogger::Buffer::WriteRecord(const LogFormat *_format,
+    const std::string &_args, const uint16_t _argCount,
+    const std::chrono::system_clock::time_point &_time, const int _level,
+    const uint32_t _thread)
+{
+  const int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      _time.time_since_epoch()).count();
+
+  thread_local std::string record;
+  record.clear();
+  binarylog::Append(record, binarylog::MESSAGE_RECORD);
+  binarylog::Append(record, time);
+  binarylog::Append(record, _format ? _format->Id() : uint32_t(0));
+  binarylog::Append(record, _thread);
+  binarylog::Append(record, static_cast<uint8_t>(_level));
+  binarylog::Append(record, _argCount);
+  binarylog::Append(record, static_cast<uint32_t>(_args.size()));
+  record += _args;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (!this->stream || !this->binary)
+    return;
+
+  if (_format)
+  {
+    // Define the format the first time it is used in this file
+    const uint32_t id = _format->Id();
+    if (id >= this->writtenFormats.size())
+      this->writtenFormats.resize(id + 1, false);
+    if (!this->writtenFormats[id])
+    {
+      const std::string file = _format->File();
+      const std::string format = _format->Format();
+      std::string definition;
+      binarylog::Append(definition, binarylog::FORMAT_RECORD);
+      binarylog::Append(definition, id);
+      binarylog::Append(definition, static_cast<int32_t>(_format->Level()));
+      binarylog::Append(definition, static_cast<int32_t>(_format->Line()));
+      binarylog::Append(definition, static_cast<uint32_t>(file.size()));
+      definition += file;
+      binarylog::Append(definition, static_cast<uint32_t>(format.size()));
+      definition += format;
+      this->stream->write(definition.data(), definition.size());
+      this->writtenFormats[id] = true;
+    }
+  }
+
+  this->stream->write(record.data(), record.size());
+}
+
+/////////////////////////////////////////////////
+LogFormat::LogFormat(const int _level, const char *_file, const int _line,
+    const char *_format)
+  : level(_level), file(_file), line(_line), format(_format)
+{
+  // Id 0 is reserved for lines of text
+  static std::atomic<uint32_t> formatCount{0};
+  this->id = ++formatCount;
+}
+
+/////////////////////////////////////////////////
+uint32_t LogFormat::Id() const
+{
+  return this->id;
+}
+
+/////////////////////////////////////////////////
+int LogFormat::Level() const
+{
+  return this->level;
+}
+
+/////////////////////////////////////////////////
+const char *LogFormat::File() const
+{
+  return this->file;
+}
+
+/////////////////////////////////////////////////
+int LogFormat::Line() const
+{
+  return this->line;
+}
+
+/////////////////////////////////////////////////
+const char *LogFormat::Format() const
+{
+  return this->format;
+}
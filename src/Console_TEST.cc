@@ -18,6 +18,11 @@
 #include <gtest/gtest.h>
 #include <stdlib.h>
 
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "ignition/common/Console.hh"
 #include "ignition/common/Filesystem.hh"
 #include "ignition/common/Time.hh"
@@ -543,6 +548,175 @@ TEST_F(Console_TEST, LogDirectory)
   EXPECT_EQ(logDir, absPath);
 }
 
+/////////////////////////////////////////////////
+/// \brief Count the occurrences of a string in the log file.
+std::size_t CountInLog(const std::string &_logPath, const std::string &_text)
+{
+  const std::string content = GetLogContent(_logPath);
+  std::size_t count = 0;
+  for (std::size_t pos = content.find(_text); pos != std::string::npos;
+       pos = content.find(_text, pos + _text.size()))
+  {
+    ++count;
+  }
+  return count;
+}
+
+/////////////////////////////////////////////////
+/// \brief Test asynchronous logging from several threads
+TEST_F(Console_TEST, AsyncLog)
+{
+  std::string path = ignition::common::joinPaths(
+        IGN_TMP_DIR, ignition::common::uuid());
+  ignLogInit(path, "test.log");
+  std::string logPath = ignition::common::joinPaths(path, "test.log");
+
+  const int verbosity = ignition::common::Console::Verbosity();
+  ignition::common::Console::SetVerbosity(0);
+
+  EXPECT_FALSE(ignition::common::Console::Async());
+  ignition::common::Console::SetAsync(true);
+  EXPECT_TRUE(ignition::common::Console::Async());
+
+  const int threadCount = 4;
+  const int messagesPerThread = 200;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t)
+  {
+    threads.emplace_back([t, messagesPerThread]
+        {
+          for (int i = 0; i < messagesPerThread; ++i)
+            ignerr << "async " << t << "-" << i << " done" << std::endl;
+        });
+  }
+  // The log file can be written directly meanwhile
+  threads.emplace_back([messagesPerThread]
+      {
+        for (int i = 0; i < messagesPerThread; ++i)
+          ignlog << "direct " << i << " line" << std::endl;
+      });
+  for (auto &thread : threads)
+    thread.join();
+
+  // A message without a newline is written by Flush
+  igndbg << "unfinished";
+  ignition::common::Console::Flush();
+
+  EXPECT_EQ(0u, ignition::common::Console::DroppedCount());
+  EXPECT_EQ(static_cast<std::size_t>(threadCount * messagesPerThread),
+      CountInLog(logPath, " done"));
+  EXPECT_EQ(1u, CountInLog(logPath, "unfinished"));
+  EXPECT_EQ(static_cast<std::size_t>(messagesPerThread),
+      CountInLog(logPath, " line"));
+
+  // Messages are written whole, with the timestamp and prefix
+  const std::string content = GetLogContent(logPath);
+  for (int t = 0; t < threadCount; ++t)
+  {
+    std::ostringstream stream;
+    stream << "[Err] [Console_TEST.cc:";
+    EXPECT_NE(std::string::npos, content.find(stream.str()));
+    stream.str("");
+    stream << "async " << t << "-" << messagesPerThread - 1 << " done";
+    EXPECT_NE(std::string::npos, content.find(stream.str()));
+  }
+
+  ignition::common::Console::SetAsync(false);
+  EXPECT_FALSE(ignition::common::Console::Async());
+  ignition::common::Console::SetVerbosity(verbosity);
+}
+
+/////////////////////////////////////////////////
+/// \brief Messages that don't fit in the queue are dropped and counted
+TEST_F(Console_TEST, AsyncDropped)
+{
+  std::string path = ignition::common::joinPaths(
+        IGN_TMP_DIR, ignition::common::uuid());
+  ignLogInit(path, "test.log");
+  std::string logPath = ignition::common::joinPaths(path, "test.log");
+
+  const int verbosity = ignition::common::Console::Verbosity();
+  ignition::common::Console::SetVerbosity(0);
+  ignition::common::Console::SetAsync(true, 2);
+
+  const int messages = 20000;
+  for (int i = 0; i < messages; ++i)
+    igndbg << "burst " << i << " done" << std::endl;
+  ignition::common::Console::Flush();
+
+  // Every message is either written or counted as dropped
+  const uint64_t dropped = ignition::common::Console::DroppedCount();
+  EXPECT_EQ(static_cast<std::size_t>(messages),
+      CountInLog(logPath, " done") + dropped);
+
+  // The count survives disabling asynchronous mode
+  ignition::common::Console::SetAsync(false);
+  EXPECT_EQ(dropped, ignition::common::Console::DroppedCount());
+  ignition::common::Console::SetVerbosity(verbosity);
+}
+
+/////////////////////////////////////////////////
+/// \brief Asynchronous mode can be switched while threads use it, and
+/// threads can come and go
+TEST_F(Console_TEST, AsyncToggle)
+{
+  std::string path = ignition::common::joinPaths(
+        IGN_TMP_DIR, ignition::common::uuid());
+  ignLogInit(path, "test.log");
+  std::string logPath = ignition::common::joinPaths(path, "test.log");
+
+  const int verbosity = ignition::common::Console::Verbosity();
+  ignition::common::Console::SetVerbosity(0);
+
+  // The asynchronous log is replaced while other threads use it
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> users;
+  for (int t = 0; t < 4; ++t)
+  {
+    users.emplace_back([&stop]
+        {
+          while (!stop)
+          {
+            ignition::common::Console::DroppedCount();
+            ignition::common::Console::Flush();
+          }
+        });
+  }
+  for (int r = 0; r < 20; ++r)
+    ignition::common::Console::SetAsync(r % 2 == 0);
+  stop = true;
+  for (auto &thread : users)
+    thread.join();
+
+  // New threads take the places of the threads that exited
+  ignition::common::Console::SetAsync(true);
+  const int rounds = 10;
+  const int threadCount = 4;
+  const int messagesPerThread = 50;
+  for (int r = 0; r < rounds; ++r)
+  {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+      threads.emplace_back([messagesPerThread]
+          {
+            for (int i = 0; i < messagesPerThread; ++i)
+              ignerr << "toggle " << i << " done" << std::endl;
+          });
+    }
+    for (auto &thread : threads)
+      thread.join();
+  }
+  ignition::common::Console::Flush();
+
+  EXPECT_EQ(0u, ignition::common::Console::DroppedCount());
+  EXPECT_EQ(static_cast<std::size_t>(rounds * threadCount *
+        messagesPerThread), CountInLog(logPath, " done"));
+
+  ignition::common::Console::SetAsync(false);
+  ignition::common::Console::SetVerbosity(verbosity);
+}
+
 /////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
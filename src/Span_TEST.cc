@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "ignition/common/Span.hh"
+
+using namespace ignition;
+
+/////////////////////////////////////////////////
+TEST(Span, Empty)
+{
+  common::Span<int> span;
+  EXPECT_TRUE(span.empty());
+  EXPECT_EQ(0u, span.size());
+  EXPECT_EQ(nullptr, span.data());
+  EXPECT_EQ(span.begin(), span.end());
+}
+
+/////////////////////////////////////////////////
+TEST(Span, Container)
+{
+  std::vector<int> values = {1, 2, 3, 4};
+  common::Span<int> span(values);
+  ASSERT_EQ(4u, span.size());
+  EXPECT_EQ(values.data(), span.data());
+  EXPECT_EQ(4 * sizeof(int), span.size_bytes());
+  EXPECT_EQ(1, span.front());
+  EXPECT_EQ(4, span.back());
+
+  // Writes go to the container
+  for (int &v : span)
+    v *= 2;
+  span[0] = 10;
+  EXPECT_EQ(std::vector<int>({10, 4, 6, 8}), values);
+
+  common::Span<const int> constSpan = span;
+  EXPECT_EQ(28, std::accumulate(constSpan.begin(), constSpan.end(), 0));
+
+  auto middle = constSpan.subspan(1, 2);
+  ASSERT_EQ(2u, middle.size());
+  EXPECT_EQ(4, middle[0]);
+  EXPECT_EQ(6, middle[1]);
+
+  const std::array<float, 3> array = {{1.0f, 2.0f, 3.0f}};
+  common::Span<const float> arraySpan(array);
+  EXPECT_EQ(3u, arraySpan.size());
+  EXPECT_FLOAT_EQ(3.0f, arraySpan[2]);
+
+  // A span of const elements can not be converted to non-const
+  EXPECT_FALSE((std::is_convertible_v<common::Span<const int>,
+        common::Span<int>>));
+  EXPECT_FALSE((std::is_constructible_v<common::Span<int>,
+        const std::vector<int> &>));
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
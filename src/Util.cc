@@ -27,6 +27,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <cctype>
+#include <ctime>
 #include <fstream>
 #include <functional>
 #include <iomanip>
@@ -263,7 +264,15 @@ std::string ignition::common::timeToIso(
       epoch).count() - sec * IGN_SEC_TO_NANO;
 
   time_t tmSec = static_cast<time_t>(sec);
-  std::strftime(isoStr, sizeof(isoStr), "%FT%T", std::localtime(&tmSec));
+  // The asynchronous logger formats timestamps while other threads log,
+  // so use the thread safe versions of localtime
+  std::tm localTime;
+#ifdef _WIN32
+  localtime_s(&localTime, &tmSec);
+#else
+  localtime_r(&tmSec, &localTime);
+#endif
+  std::strftime(isoStr, sizeof(isoStr), "%FT%T", &localTime);
 
   return std::string(isoStr) + "." + std::to_string(nano);
 }
@@ -16,56 +16,533 @@
 */
 
 
-#include <queue>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "ignition/common/WorkerPool.hh"
 
 namespace igncmn = ignition::common;
 using namespace igncmn;
 
+/// \brief Key of an empty queue, less urgent than any work.
+static const int64_t EmptyKey = std::numeric_limits<int64_t>::max();
+
+/// \brief Default value of WorkerPool::AgingInterval, in nanoseconds.
+static const int64_t DefaultAgingInterval = 100000000;
+
+//////////////////////////////////////////////////
+/// \brief Get the time of a monotonic clock.
+/// \return Nanoseconds since an arbitrary epoch.
+static int64_t SteadyNow()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//////////////////////////////////////////////////
+/// \brief Convert a duration to nanoseconds.
+/// \param[in] _time Duration to convert
+/// \return Nanoseconds in _time.
+static int64_t ToNanoseconds(const Time &_time)
+{
+  return static_cast<int64_t>(_time.sec) * 1000000000 + _time.nsec;
+}
+
+//////////////////////////////////////////////////
+/// \brief Convert nanoseconds to a duration.
+/// \param[in] _ns Nanoseconds to convert
+/// \return Duration of _ns nanoseconds.
+static Time FromNanoseconds(const int64_t _ns)
+{
+  return Time(static_cast<int32_t>(_ns / 1000000000),
+              static_cast<int32_t>(_ns % 1000000000));
+}
+
 namespace ignition
 {
   namespace common
   {
-    /// \brief info needed to perform work
-    class WorkOrder
+    /// \brief A work item waiting in a queue, together with what the
+    /// scheduler needs to know about it.
+    class QueuedWork
     {
-      /// \brief Default constructor
-      public: WorkOrder() = default;
+      /// \brief Time by which the work should start, in nanoseconds of
+      /// SteadyNow(). The work with the smallest key runs first.
+      public: int64_t key = 0;
+
+      /// \brief Time at which the work was queued
+      public: int64_t queued = 0;
+
+      /// \brief Priority the work was added with
+      public: WorkerPool::Priority priority = WorkerPool::Priority::NORMAL;
+
+      /// \brief True if the work was added with a deadline
+      public: bool hasDeadline = false;
+
+      /// \brief The work
+      public: detail::WorkItem item;
+    };
 
-      /// \brief Constructor used by std::deque::emplace.
-      /// \param[in] _work Work function.
-      /// \param[in] _cb Callback function.
-      public: WorkOrder(const std::function<void()> &_work,
-                 const std::function<void()> &_cb)
-        : work(_work), callback(_cb) {}
+    /// \brief Ring buffer of queued work used as a FIFO queue. Unlike
+    /// std::deque, it keeps its storage when work is removed, so a queue
+    /// that has reached its working size never allocates again.
+    class WorkRing
+    {
+      /// \brief Constructor.
+      /// \param[in] _capacity Initial capacity, rounded up to a power of
+      /// two.
+      public: explicit WorkRing(const std::size_t _capacity = 16)
+      {
+        std::size_t capacity = 1;
+        while (capacity < _capacity)
+          capacity *= 2;
+        this->items.resize(capacity);
+      }
+
+      /// \brief Get whether the ring is empty.
+      /// \return True if there is no work.
+      public: bool Empty() const
+      {
+        return this->count == 0;
+      }
+
+      /// \brief Get the oldest work.
+      /// \pre The ring is not empty.
+      /// \return The oldest work.
+      public: const QueuedWork &Front() const
+      {
+        return this->items[this->head];
+      }
+
+      /// \brief Add work at the back, growing the storage if full.
+      /// \param[in] _work Work to add
+      /// \return True if the storage had to grow.
+      public: bool PushBack(QueuedWork &&_work)
+      {
+        bool grew = false;
+        if (this->count == this->items.size())
+        {
+          this->Grow();
+          grew = true;
+        }
+        this->items[this->Slot(this->count)] = std::move(_work);
+        ++this->count;
+        return grew;
+      }
+
+      /// \brief Remove the oldest work.
+      /// \pre The ring is not empty.
+      /// \return The removed work.
+      public: QueuedWork PopFront()
+      {
+        QueuedWork work = std::move(this->items[this->head]);
+        this->head = this->Slot(1);
+        --this->count;
+        return work;
+      }
+
+      /// \brief Get the storage index of the work at a position.
+      /// \param[in] _pos Position from the front
+      /// \return Index in the storage.
+      private: std::size_t Slot(const std::size_t _pos) const
+      {
+        return (this->head + _pos) & (this->items.size() - 1);
+      }
+
+      /// \brief Double the capacity, moving the work to the front of the
+      /// new storage.
+      private: void Grow()
+      {
+        std::vector<QueuedWork> bigger(this->items.size() * 2);
+        for (std::size_t i = 0; i < this->count; ++i)
+          bigger[i] = std::move(this->items[this->Slot(i)]);
+        this->items.swap(bigger);
+        this->head = 0;
+      }
+
+      /// \brief Storage, its size is always a power of two
+      private: std::vector<QueuedWork> items;
+
+      /// \brief Index of the oldest work in the storage
+      private: std::size_t head = 0;
+
+      /// \brief Amount of work in the ring
+      private: std::size_t count = 0;
+    };
 
-      /// \brief method that does the work
-      public: std::function<void()> work = std::function<void()>();
+    /// \brief Binary heap of queued work, most urgent first. The storage
+    /// is kept when work is removed, so a heap that has reached its working
+    /// size never allocates again.
+    class WorkHeap
+    {
+      /// \brief Get whether the heap is empty.
+      /// \return True if there is no work.
+      public: bool Empty() const
+      {
+        return this->items.empty();
+      }
+
+      /// \brief Get the most urgent work.
+      /// \pre The heap is not empty.
+      /// \return The most urgent work.
+      public: const QueuedWork &Front() const
+      {
+        return this->items.front();
+      }
+
+      /// \brief Add work, growing the storage if full.
+      /// \param[in] _work Work to add
+      /// \return True if the storage had to grow.
+      public: bool Push(QueuedWork &&_work)
+      {
+        const std::size_t capacity = this->items.capacity();
+        this->items.push_back(std::move(_work));
+        std::push_heap(this->items.begin(), this->items.end(), LessUrgent);
+        return this->items.capacity() != capacity;
+      }
+
+      /// \brief Remove the most urgent work.
+      /// \pre The heap is not empty.
+      /// \return The removed work.
+      public: QueuedWork PopFront()
+      {
+        std::pop_heap(this->items.begin(), this->items.end(), LessUrgent);
+        QueuedWork work = std::move(this->items.back());
+        this->items.pop_back();
+        return work;
+      }
+
+      /// \brief Heap order, earliest key first.
+      /// \param[in] _a First work
+      /// \param[in] _b Second work
+      /// \return True if _a is less urgent than _b.
+      private: static bool LessUrgent(const QueuedWork &_a,
+                                      const QueuedWork &_b)
+      {
+        return _a.key > _b.key;
+      }
+
+      /// \brief Storage of the heap
+      private: std::vector<QueuedWork> items;
+    };
 
-      /// \brief callback to invoke after working
-      public: std::function<void()> callback = std::function<void()>();
+    /// \brief Queue of work that hands out the most urgent work first.
+    ///
+    /// Work without a deadline gets a key that is its queuing time plus a
+    /// constant that only depends on its priority, so the keys of one
+    /// priority grow in queuing order. Such work goes in a FIFO ring per
+    /// priority, which is already sorted, and only work with a deadline
+    /// needs a heap. Taking work compares the front of every ring and of
+    /// the heap.
+    class UrgencyQueue
+    {
+      /// \brief Get whether the queue is empty.
+      /// \return True if there is no work.
+      public: bool Empty() const
+      {
+        return this->count == 0;
+      }
+
+      /// \brief Get the key of the most urgent work.
+      /// \return Key of the most urgent work, EmptyKey if there is none.
+      public: int64_t TopKey() const
+      {
+        int64_t key = EmptyKey;
+        this->MostUrgent(key);
+        return key;
+      }
+
+      /// \brief Add work.
+      /// \param[in] _work Work to add
+      /// \param[in] _hasDeadline True if the work has a deadline
+      /// \return True if the storage had to grow.
+      public: bool Push(QueuedWork &&_work, const bool _hasDeadline)
+      {
+        ++this->count;
+        if (_hasDeadline)
+          return this->deadlines.Push(std::move(_work));
+
+        return this->fifos[static_cast<std::size_t>(_work.priority)].PushBack(
+            std::move(_work));
+      }
+
+      /// \brief Remove the most urgent work.
+      /// \pre The queue is not empty.
+      /// \return The removed work.
+      public: QueuedWork PopFront()
+      {
+        int64_t key = EmptyKey;
+        const std::size_t source = this->MostUrgent(key);
+        --this->count;
+        if (source == this->fifos.size())
+          return this->deadlines.PopFront();
+        return this->fifos[source].PopFront();
+      }
+
+      /// \brief Get the priority of the most urgent work.
+      /// \pre The queue is not empty.
+      /// \return Priority of the most urgent work.
+      public: WorkerPool::Priority TopPriority() const
+      {
+        int64_t key = EmptyKey;
+        const std::size_t source = this->MostUrgent(key);
+        if (source == this->fifos.size())
+          return this->deadlines.Front().priority;
+        return static_cast<WorkerPool::Priority>(source);
+      }
+
+      /// \brief Find the most urgent work.
+      /// \param[out] _key Key of the most urgent work, unchanged if the
+      /// queue is empty.
+      /// \return Index of the ring holding it, or the number of rings if
+      /// it is in the heap of work with a deadline.
+      private: std::size_t MostUrgent(int64_t &_key) const
+      {
+        std::size_t source = this->fifos.size();
+        if (!this->deadlines.Empty())
+          _key = this->deadlines.Front().key;
+
+        // Higher priorities first, so that they win ties
+        for (std::size_t f = this->fifos.size(); f-- > 0;)
+        {
+          if (!this->fifos[f].Empty() && this->fifos[f].Front().key < _key)
+          {
+            _key = this->fifos[f].Front().key;
+            source = f;
+          }
+        }
+        return source;
+      }
+
+      /// \brief Work without a deadline, one ring per priority
+      private: std::array<WorkRing, WorkerPool::PriorityCount> fifos;
+
+      /// \brief Work with a deadline
+      private: WorkHeap deadlines;
+
+      /// \brief Amount of work in the queue
+      private: std::size_t count = 0;
+    };
+
+    /// \brief A heap of work guarded by its own mutex. The shared queue
+    /// scheduler uses a single one of these, while the work stealing
+    /// scheduler gives one to every worker thread. Aligned to a cache line
+    /// so that the mutexes of neighbouring queues don't share one.
+    class alignas(64) WorkQueue
+    {
+      /// \brief lock for orders access
+      public: std::mutex mtx;
+
+      /// \brief work waiting to be run
+      public: UrgencyQueue orders;
+
+      /// \brief Key of the most urgent work in orders, readable without
+      /// the lock so that workers can find the most urgent queue.
+      public: std::atomic<int64_t> topKey{EmptyKey};
+    };
+
+    /// \brief Histogram of wait times with logarithmic buckets. Every power
+    /// of two is split in SubBuckets buckets, so a percentile is within
+    /// 1 / SubBuckets of the true value. Safe to update from many threads.
+    class WaitHistogram
+    {
+      /// \brief Buckets per power of two
+      public: static const std::size_t SubBuckets = 8;
+
+      /// \brief Number of buckets, enough for waits of about 50 days in
+      /// microseconds. Longer waits go to the last bucket.
+      public: static const std::size_t BucketCount = SubBuckets * 40;
+
+      /// \brief Constructor
+      public: WaitHistogram()
+      {
+        this->Reset();
+      }
+
+      /// \brief Count one wait.
+      /// \param[in] _micro Wait in microseconds
+      public: void Add(const uint64_t _micro)
+      {
+        this->counts[Bucket(_micro)].fetch_add(1, std::memory_order_relaxed);
+      }
+
+      /// \brief Forget all the waits counted so far.
+      public: void Reset()
+      {
+        for (auto &count : this->counts)
+          count.store(0, std::memory_order_relaxed);
+      }
+
+      /// \brief Get a percentile of the waits.
+      /// \param[in] _percentile Percentile in [0, 100]
+      /// \return Upper bound of the bucket containing the percentile, in
+      /// microseconds, or zero if no wait was counted.
+      public: uint64_t Percentile(const double _percentile) const
+      {
+        uint64_t total = 0;
+        for (const auto &count : this->counts)
+          total += count.load(std::memory_order_relaxed);
+        if (total == 0)
+          return 0;
+
+        const double clamped = std::min(std::max(_percentile, 0.0), 100.0);
+        const uint64_t rank = std::max<uint64_t>(1u,
+            static_cast<uint64_t>(std::ceil(clamped / 100.0 * total)));
+
+        uint64_t seen = 0;
+        for (std::size_t b = 0; b < BucketCount; ++b)
+        {
+          seen += this->counts[b].load(std::memory_order_relaxed);
+          if (seen >= rank)
+            return UpperBound(b);
+        }
+        return UpperBound(BucketCount - 1);
+      }
+
+      /// \brief Get the bucket of a value. Values below SubBuckets get a
+      /// bucket each, larger ones share a bucket with the values that have
+      /// the same highest bits.
+      /// \param[in] _value Value to classify
+      /// \return Bucket index.
+      private: static std::size_t Bucket(const uint64_t _value)
+      {
+        if (_value < SubBuckets)
+          return static_cast<std::size_t>(_value);
+
+        // Index of the highest set bit, at least 3 since SubBuckets is 8
+        std::size_t exponent = 0;
+        uint64_t rest = _value;
+        for (std::size_t shift = 32; shift > 0; shift /= 2)
+        {
+          if ((rest >> shift) != 0)
+          {
+            rest >>= shift;
+            exponent += shift;
+          }
+        }
+
+        const std::size_t sub = (_value >> (exponent - 3)) & (SubBuckets - 1);
+        return std::min((exponent - 2) * SubBuckets + sub, BucketCount - 1);
+      }
+
+      /// \brief Get the largest value that falls in a bucket.
+      /// \param[in] _bucket Bucket index
+      /// \return Largest value of the bucket.
+      private: static uint64_t UpperBound(const std::size_t _bucket)
+      {
+        if (_bucket < SubBuckets)
+          return _bucket;
+
+        const std::size_t exponent = _bucket / SubBuckets + 2;
+        const uint64_t sub = _bucket % SubBuckets;
+        const uint64_t width = uint64_t(1) << (exponent - 3);
+        return (SubBuckets + sub) * width + width - 1;
+      }
+
+      /// \brief Number of waits in every bucket
+      private: std::array<std::atomic<uint64_t>, BucketCount> counts;
     };
 
     /// \brief Private implementation
     class WorkerPoolPrivate
     {
       /// \brief Does work until signaled to shut down
-      public: void Worker();
+      /// \param[in] _index Index of this worker in the workers list
+      public: void Worker(const std::size_t _index);
+
+      /// \brief Put a work item in one of the queues and wake up a worker.
+      /// \param[in] _item The work item to enqueue
+      /// \param[in] _options Priority and deadline of the work, null for
+      /// the default options
+      public: void Push(detail::WorkItem &&_item,
+                        const WorkerPool::TaskOptions *_options);
+
+      /// \brief Take the most urgent work out of the queues. A work
+      /// stealing worker takes the work of its own queue first, unless work
+      /// of a higher priority or with a deadline is waiting.
+      /// \param[in] _index Index of the worker asking for work
+      /// \param[out] _work The work that was taken
+      /// \return True if work was taken
+      public: bool Pop(const std::size_t _index, QueuedWork &_work);
+
+      /// \brief Take the most urgent work of a queue.
+      /// \pre The queue is locked and not empty.
+      /// \param[in] _queue The queue
+      /// \param[out] _work The work that was taken
+      public: void Take(WorkQueue &_queue, QueuedWork &_work);
+
+      /// \brief Get whether work of a higher priority, or work with a
+      /// deadline, is waiting in any queue, from the counters only.
+      /// \param[in] _priority Priority to compare to
+      /// \return True if such work is waiting.
+      public: bool MoreUrgentWaiting(const WorkerPool::Priority _priority)
+                  const;
+
+      /// \brief Mark one work order as finished, waking up anyone in
+      /// WaitForResults when it was the last one.
+      public: void Finished();
+
+      /// \brief Scheduler used to hand out work
+      public: WorkerPool::SchedulerType scheduler =
+                  WorkerPool::SchedulerType::SHARED_QUEUE;
 
       /// \brief threads that do work
       public: std::vector<std::thread> workers;
 
-      /// \brief queue of work for workers
-      public: std::queue<WorkOrder> workOrders;
+      /// \brief queues of work for workers. There is only one queue when
+      /// using the shared queue scheduler and one queue per worker when
+      /// using the work stealing scheduler.
+      public: std::vector<std::unique_ptr<WorkQueue>> queues;
+
+      /// \brief Queue that receives the next work order added from a thread
+      /// that is not a worker of this pool.
+      public: std::atomic<std::size_t> nextQueue{0};
+
+      /// \brief Number of work orders sitting in the queues
+      public: std::atomic<std::size_t> pendingOrders{0};
+
+      /// \brief Number of work orders that were added but haven't finished
+      /// running yet, including the ones sitting in the queues
+      public: std::atomic<std::size_t> unfinishedOrders{0};
+
+      /// \brief Number of work items added since the pool was created
+      public: std::atomic<std::size_t> addedWork{0};
+
+      /// \brief Number of heap allocations made while adding work, to store
+      /// a callable too large for a work item, to grow a queue, or for the
+      /// state shared by Submit and ParallelFor
+      public: std::atomic<std::size_t> allocations{0};
 
-      /// \brief used to count how many threads are actively working
-      public: int activeOrders = 0;
+      /// \brief Waiting time that separates two consecutive priorities, in
+      /// nanoseconds. See WorkerPool::SetAgingInterval.
+      public: std::atomic<int64_t> agingInterval{DefaultAgingInterval};
 
-      /// \brief lock for workOrders access
-      public: std::mutex queueMtx;
+      /// \brief Number of work orders sitting in the queues, per priority
+      public: std::array<std::atomic<std::size_t>,
+                         WorkerPool::PriorityCount> depth{};
+
+      /// \brief Number of work orders with a deadline sitting in the queues
+      public: std::atomic<std::size_t> deadlineOrders{0};
+
+      /// \brief Time spent in the queues by the work that was handed out,
+      /// per priority
+      public: std::array<WaitHistogram, WorkerPool::PriorityCount> waits;
+
+      /// \brief Number of workers that are blocked waiting for new work
+      public: std::atomic<std::size_t> sleepingWorkers{0};
+
+      /// \brief lock used together with the condition variables below
+      public: std::mutex signalMtx;
 
       /// \brief used to signal when all work is done
       public: std::condition_variable signalWorkDone;
@@ -74,123 +551,446 @@ namespace ignition
       public: std::condition_variable signalNewWork;
 
       /// \brief used to signal when the pool is being shut down
-      public: bool done = false;
+      public: std::atomic<bool> done{false};
     };
   }
 }
 
+/// \brief Pool whose worker is running on this thread, or null if this
+/// thread is not a worker thread.
+static thread_local WorkerPoolPrivate *tlWorkerPool = nullptr;
+
+/// \brief Index of the worker running on this thread in tlWorkerPool.
+static thread_local std::size_t tlWorkerIndex = 0;
+
 //////////////////////////////////////////////////
-void WorkerPoolPrivate::Worker()
+void WorkerPoolPrivate::Push(detail::WorkItem &&_item,
+    const WorkerPool::TaskOptions *_options)
 {
-  WorkOrder order;
+  std::size_t index = 0;
+  if (this->scheduler == WorkerPool::SchedulerType::WORK_STEALING)
+  {
+    // Work added by one of our own workers stays local to that worker,
+    // everything else is spread over all the queues.
+    if (tlWorkerPool == this)
+      index = tlWorkerIndex;
+    else
+      index = this->nextQueue.fetch_add(1) % this->queues.size();
+  }
 
-  // Run until pool is destructed, waiting for work
-  while (true)
+  // Work is ordered by the time at which it should start. Less important
+  // work gets more slack, but its start time still comes, so it can't be
+  // starved by a steady stream of more important work.
+  QueuedWork work;
+  work.queued = SteadyNow();
+  if (_options)
+    work.priority = _options->priority;
+  const std::size_t level = static_cast<std::size_t>(work.priority);
+  int64_t slack = static_cast<int64_t>(WorkerPool::PriorityCount - 1 - level)
+    * this->agingInterval.load(std::memory_order_relaxed);
+  const bool hasDeadline = _options && _options->deadline > Time::Zero;
+  if (hasDeadline)
+    slack = std::min(slack, ToNanoseconds(_options->deadline));
+  work.key = work.queued + slack;
+  work.hasDeadline = hasDeadline;
+
+  std::size_t newAllocations = _item.HeapAllocated() ? 1u : 0u;
+  work.item = std::move(_item);
+
+  ++this->unfinishedOrders;
+  ++this->depth[level];
+  if (hasDeadline)
+    ++this->deadlineOrders;
   {
-    // Scoped to release lock before doing work
-    {
-      std::unique_lock<std::mutex> queueLock(this->queueMtx);
+    WorkQueue &queue = *this->queues[index];
+    std::lock_guard<std::mutex> lock(queue.mtx);
+    if (queue.orders.Push(std::move(work), hasDeadline))
+      ++newAllocations;
+    queue.topKey.store(queue.orders.TopKey(), std::memory_order_relaxed);
+  }
+  ++this->pendingOrders;
 
-      // Wait for a work order
-      while (!this->done && this->workOrders.empty())
-        this->signalNewWork.wait(queueLock);
+  this->addedWork.fetch_add(1, std::memory_order_relaxed);
+  if (newAllocations > 0)
+    this->allocations.fetch_add(newAllocations, std::memory_order_relaxed);
 
-      // Destructor may have signaled to shutdown workers
-      if (this->done)
-        break;
+  // Only go through the signal mutex when somebody may be asleep. Both
+  // counters are sequentially consistent, so either we see the sleeping
+  // worker here, or the worker sees our pending order before it sleeps.
+  if (this->sleepingWorkers.load() > 0)
+  {
+    std::lock_guard<std::mutex> lock(this->signalMtx);
+    this->signalNewWork.notify_one();
+  }
+}
+
+//////////////////////////////////////////////////
+bool WorkerPoolPrivate::Pop(const std::size_t _index, QueuedWork &_work)
+{
+  const std::size_t count = this->queues.size();
 
-      // Take a work order from the queue
-      ++(this->activeOrders);
-      order = std::move(workOrders.front());
-      workOrders.pop();
+  // Our own queue comes first, which keeps work local and only touches our
+  // own cache lines. The other queues are only looked at when ours is
+  // empty, or when the counters show that more urgent work may wait
+  // elsewhere.
+  if (this->scheduler == WorkerPool::SchedulerType::WORK_STEALING)
+  {
+    WorkQueue &own = *this->queues[_index % count];
+    if (own.topKey.load(std::memory_order_relaxed) != EmptyKey)
+    {
+      std::lock_guard<std::mutex> lock(own.mtx);
+      if (!own.orders.Empty() &&
+          !this->MoreUrgentWaiting(own.orders.TopPriority()))
+      {
+        this->Take(own, _work);
+        return true;
+      }
     }
+  }
 
-    // Do the work
-    if (order.work)
-      order.work();
+  // Another worker may empty the chosen queue before we lock it, in which
+  // case we look again.
+  for (std::size_t attempt = 0; attempt < count; ++attempt)
+  {
+    // Find the queue with the most urgent work. Our own queue is looked at
+    // first, so it wins ties and keeps its work local.
+    std::size_t best = _index % count;
+    int64_t bestKey = this->queues[best]->topKey.load(
+        std::memory_order_relaxed);
+    for (std::size_t i = 1; i < count; ++i)
+    {
+      const std::size_t q = (_index + i) % count;
+      const int64_t key =
+        this->queues[q]->topKey.load(std::memory_order_relaxed);
+      if (key < bestKey)
+      {
+        best = q;
+        bestKey = key;
+      }
+    }
+
+    if (bestKey == EmptyKey)
+      return false;
+
+    WorkQueue &queue = *this->queues[best];
+    std::lock_guard<std::mutex> lock(queue.mtx);
+    if (queue.orders.Empty())
+      continue;
+
+    this->Take(queue, _work);
+    return true;
+  }
+
+  return false;
+}
 
-    if (order.callback)
-      order.callback();
+//////////////////////////////////////////////////
+void WorkerPoolPrivate::Take(WorkQueue &_queue, QueuedWork &_work)
+{
+  _work = _queue.orders.PopFront();
+  _queue.topKey.store(_queue.orders.TopKey(), std::memory_order_relaxed);
+  --this->pendingOrders;
+  --this->depth[static_cast<std::size_t>(_work.priority)];
+  if (_work.hasDeadline)
+    --this->deadlineOrders;
+}
 
+//////////////////////////////////////////////////
+bool WorkerPoolPrivate::MoreUrgentWaiting(
+    const WorkerPool::Priority _priority) const
+{
+  if (this->deadlineOrders.load(std::memory_order_relaxed) > 0)
+    return true;
+
+  for (std::size_t p = static_cast<std::size_t>(_priority) + 1;
+       p < WorkerPool::PriorityCount; ++p)
+  {
+    if (this->depth[p].load(std::memory_order_relaxed) > 0)
+      return true;
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////
+void WorkerPoolPrivate::Finished()
+{
+  if (--this->unfinishedOrders == 0)
+  {
+    std::lock_guard<std::mutex> lock(this->signalMtx);
+    this->signalWorkDone.notify_all();
+  }
+}
+
+//////////////////////////////////////////////////
+void WorkerPoolPrivate::Worker(const std::size_t _index)
+{
+  tlWorkerPool = this;
+  tlWorkerIndex = _index;
+
+  QueuedWork work;
+
+  // Run until pool is destructed, waiting for work
+  while (!this->done)
+  {
+    if (!this->Pop(_index, work))
     {
-      std::unique_lock<std::mutex> queueLock(this->queueMtx);
-      --(this->activeOrders);
-      if (this->workOrders.empty() && this->activeOrders <= 0)
-        this->signalWorkDone.notify_all();
+      // Wait for a work order
+      std::unique_lock<std::mutex> lock(this->signalMtx);
+      ++this->sleepingWorkers;
+      while (!this->done && this->pendingOrders.load() == 0)
+        this->signalNewWork.wait(lock);
+      --this->sleepingWorkers;
+      continue;
     }
+
+    const int64_t waited = std::max<int64_t>(0, SteadyNow() - work.queued);
+    this->waits[static_cast<std::size_t>(work.priority)].Add(
+        static_cast<uint64_t>(waited / 1000));
+
+    // Do the work
+    work.item();
+    work.item.Reset();
+    this->Finished();
   }
+
+  tlWorkerPool = nullptr;
 }
 
 //////////////////////////////////////////////////
 WorkerPool::WorkerPool(const unsigned int _minThreadCount)
+  : WorkerPool(_minThreadCount, SchedulerType::SHARED_QUEUE)
+{
+}
+
+//////////////////////////////////////////////////
+WorkerPool::WorkerPool(const unsigned int _minThreadCount,
+    const SchedulerType _scheduler)
   : dataPtr(new WorkerPoolPrivate)
 {
   unsigned int numWorkers = std::max(std::thread::hardware_concurrency(),
       std::max(_minThreadCount, 1u));
 
+  this->dataPtr->scheduler = _scheduler;
+
+  std::size_t numQueues =
+    _scheduler == SchedulerType::WORK_STEALING ? numWorkers : 1u;
+  for (std::size_t q = 0; q < numQueues; ++q)
+    this->dataPtr->queues.emplace_back(new WorkQueue);
+
   // create worker threads
   for (unsigned int w = 0; w < numWorkers; ++w)
   {
     this->dataPtr->workers.push_back(
-        std::thread(&WorkerPoolPrivate::Worker, this->dataPtr.get()));
+        std::thread(&WorkerPoolPrivate::Worker, this->dataPtr.get(), w));
   }
 }
 
 //////////////////////////////////////////////////
 WorkerPool::~WorkerPool()
 {
-  // shutdown worker threads
+  // shutdown worker threads, and wake up anyone waiting for results, which
+  // won't all come
   {
-    std::unique_lock<std::mutex> queueLock(this->dataPtr->queueMtx);
+    std::unique_lock<std::mutex> lock(this->dataPtr->signalMtx);
     this->dataPtr->done = true;
   }
   this->dataPtr->signalNewWork.notify_all();
+  this->dataPtr->signalWorkDone.notify_all();
 
   for (auto &t : this->dataPtr->workers)
   {
     t.join();
   }
 
+  // Drop the work that didn't start. Submitted tasks finish with an error
+  // when their work is destroyed, which may queue the work that depends on
+  // them, so keep going until the queues are empty.
+  QueuedWork work;
+  while (this->dataPtr->Pop(0, work))
+  {
+    work.item.Reset();
+    this->dataPtr->Finished();
+  }
+
   // Signal in case anyone is still waiting for work to finish
-  this->dataPtr->signalWorkDone.notify_all();
+  {
+    std::unique_lock<std::mutex> lock(this->dataPtr->signalMtx);
+    this->dataPtr->signalWorkDone.notify_all();
+  }
 }
 
 //////////////////////////////////////////////////
 void WorkerPool::AddWork(std::function<void()> _work, std::function<void()> _cb)
 {
-  std::unique_lock<std::mutex> queueLock(this->dataPtr->queueMtx);
-  this->dataPtr->workOrders.emplace(_work, _cb);
-  this->dataPtr->signalNewWork.notify_one();
+  // Moving std::function objects doesn't allocate, and two of them fit in
+  // a work item.
+  if (_cb)
+  {
+    auto item = [work = std::move(_work), cb = std::move(_cb)] ()
+    {
+      if (work)
+        work();
+      cb();
+    };
+    static_assert(detail::WorkItem::FitsInline<decltype(item)>(),
+        "Work with a callback must not allocate");
+    this->AddWorkItem(detail::WorkItem(std::move(item)), nullptr);
+  }
+  else
+  {
+    auto item = [work = std::move(_work)] ()
+    {
+      if (work)
+        work();
+    };
+    static_assert(detail::WorkItem::FitsInline<decltype(item)>(),
+        "Work must not allocate");
+    this->AddWorkItem(detail::WorkItem(std::move(item)), nullptr);
+  }
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::AddWorkItem(detail::WorkItem &&_item,
+    const TaskOptions *_options)
+{
+  this->dataPtr->Push(std::move(_item), _options);
 }
 
 //////////////////////////////////////////////////
 bool WorkerPool::WaitForResults(const Time &_timeout)
 {
   bool signaled = true;
-  std::unique_lock<std::mutex> queueLock(this->dataPtr->queueMtx);
+  std::unique_lock<std::mutex> lock(this->dataPtr->signalMtx);
 
   // Lambda to keep logic in one place for both cases
   std::function<bool()> haveResults = [this] () -> bool
     {
-      return this->dataPtr->done ||
-        (this->dataPtr->workOrders.empty() && !this->dataPtr->activeOrders);
+      return this->dataPtr->done || this->dataPtr->unfinishedOrders == 0;
     };
 
-  if (!haveResults())
-  {
-    if (Time::Zero == _timeout)
-    {
-      // Wait forever
-      this->dataPtr->signalWorkDone.wait(queueLock);
-    }
-    else
-    {
-      // Wait for timeout
-      signaled = this->dataPtr->signalWorkDone.wait_for(queueLock,
-          std::chrono::seconds(_timeout.sec) +
-          std::chrono::nanoseconds(_timeout.nsec),
-          haveResults);
-    }
-  }
+  signaled = detail::WaitFor(this->dataPtr->signalWorkDone, lock, _timeout,
+      haveResults);
   return signaled && !this->dataPtr->done;
 }
+
+//////////////////////////////////////////////////
+WorkerPool &WorkerPool::Shared()
+{
+  // Never destroyed, so that destructors of other static objects can still
+  // use it when the program exits.
+  static WorkerPool *pool = new WorkerPool(1u, SchedulerType::WORK_STEALING);
+  return *pool;
+}
+
+//////////////////////////////////////////////////
+std::size_t WorkerPool::GrainSize(const std::size_t _count,
+    const std::size_t _grain) const
+{
+  if (_grain > 0)
+    return _grain;
+
+  // A few chunks per thread, counting the calling thread, lets threads
+  // that finish early pick up the slack of the others.
+  const std::size_t chunksPerThread = 4;
+  const std::size_t chunks =
+    (this->dataPtr->workers.size() + 1) * chunksPerThread;
+  return std::max<std::size_t>(1u, (_count + chunks - 1) / chunks);
+}
+
+//////////////////////////////////////////////////
+std::size_t WorkerPool::AddedWorkCount() const
+{
+  return this->dataPtr->addedWork.load();
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::CountAllocations(const std::size_t _count)
+{
+  this->dataPtr->allocations.fetch_add(_count, std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////
+std::size_t WorkerPool::AllocationCount() const
+{
+  return this->dataPtr->allocations.load();
+}
+
+//////////////////////////////////////////////////
+double WorkerPool::AllocationsPerTask() const
+{
+  const std::size_t added = this->AddedWorkCount();
+  if (added == 0)
+    return 0.0;
+  return static_cast<double>(this->AllocationCount()) /
+    static_cast<double>(added);
+}
+
+//////////////////////////////////////////////////
+std::size_t WorkerPool::QueueDepth(const Priority _priority) const
+{
+  return this->dataPtr->depth[static_cast<std::size_t>(_priority)].load();
+}
+
+//////////////////////////////////////////////////
+Time WorkerPool::WaitTimePercentile(const Priority _priority,
+    const double _percentile) const
+{
+  const uint64_t micro = this->dataPtr->waits[
+    static_cast<std::size_t>(_priority)].Percentile(_percentile);
+  return FromNanoseconds(static_cast<int64_t>(micro) * 1000);
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::ResetWaitTimes()
+{
+  for (WaitHistogram &histogram : this->dataPtr->waits)
+    histogram.Reset();
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::SetAgingInterval(const Time &_interval)
+{
+  this->dataPtr->agingInterval = std::max<int64_t>(0,
+      ToNanoseconds(_interval));
+}
+
+//////////////////////////////////////////////////
+Time WorkerPool::AgingInterval() const
+{
+  return FromNanoseconds(this->dataPtr->agingInterval.load());
+}
+
+//////////////////////////////////////////////////
+WorkerPool::SchedulerType WorkerPool::Scheduler() const
+{
+  return this->dataPtr->scheduler;
+}
+
+//////////////////////////////////////////////////
+unsigned int WorkerPool::ThreadCount() const
+{
+  return static_cast<unsigned int>(this->dataPtr->workers.size());
+}
+
+//////////////////////////////////////////////////
+TaskGroup::TaskGroup(WorkerPool &_pool)
+  : pool(&_pool), state(std::make_shared<detail::TaskGroupState>())
+{
+}
+
+//////////////////////////////////////////////////
+TaskGroup::~TaskGroup()
+{
+}
+
+//////////////////////////////////////////////////
+bool TaskGroup::Wait(const Time &_timeout)
+{
+  return this->state->Wait(_timeout);
+}
+
+//////////////////////////////////////////////////
+std::size_t TaskGroup::PendingCount() const
+{
+  return this->state->Pending();
+}
@@ -17,7 +17,18 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <thread>
 
 #include "ignition/common/Console.hh"
 #include "ignition/common/WorkerPool.hh"
@@ -146,6 +157,697 @@ TEST(WorkerPool, ThingsRunInParallel)
   EXPECT_EQ(2, sentinel);
 }
 
+//////////////////////////////////////////////////
+TEST(WorkerPool, WorkStealingLotsOfWork)
+{
+  WorkerPool pool(2u, WorkerPool::SchedulerType::WORK_STEALING);
+  EXPECT_EQ(WorkerPool::SchedulerType::WORK_STEALING, pool.Scheduler());
+  EXPECT_GE(pool.ThreadCount(), 2u);
+
+  std::atomic<int> workSentinel(0);
+  std::atomic<int> cbSentinel(0);
+
+  for (int i = 0; i < 1000; i++)
+  {
+    pool.AddWork([&workSentinel] ()
+        {
+          workSentinel += 1;
+        },
+      [&cbSentinel] ()
+        {
+          cbSentinel += 2;
+        });
+  }
+  EXPECT_TRUE(pool.WaitForResults());
+  EXPECT_EQ(1000, workSentinel);
+  EXPECT_EQ(2000, cbSentinel);
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, WorkAddedFromWorkers)
+{
+  for (auto scheduler : {WorkerPool::SchedulerType::SHARED_QUEUE,
+                         WorkerPool::SchedulerType::WORK_STEALING})
+  {
+    WorkerPool pool(2u, scheduler);
+    std::atomic<int> sentinel(0);
+
+    // Every piece of work spawns more work from inside the worker thread,
+    // which must be accounted for by WaitForResults.
+    for (int i = 0; i < 10; ++i)
+    {
+      pool.AddWork([&pool, &sentinel] ()
+          {
+            for (int j = 0; j < 100; ++j)
+            {
+              pool.AddWork([&sentinel] ()
+                  {
+                    ++sentinel;
+                  });
+            }
+          });
+    }
+    EXPECT_TRUE(pool.WaitForResults());
+    EXPECT_EQ(1000, sentinel);
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, SubmitReturnsResult)
+{
+  WorkerPool pool;
+  TaskHandle<int> handle = pool.Submit([] () { return 42; });
+  EXPECT_TRUE(handle.Valid());
+  EXPECT_EQ(42, handle.Get());
+  EXPECT_TRUE(handle.Ready());
+
+  // Move-only callables are accepted
+  std::unique_ptr<int> value(new int(7));
+  auto moveOnly = pool.Submit([v = std::move(value)] () { return *v * 2; });
+  EXPECT_EQ(14, moveOnly.Get());
+
+  TaskHandle<void> voidHandle = pool.Submit([] () {});
+  EXPECT_TRUE(voidHandle.Wait());
+
+  TaskHandle<int> invalid;
+  EXPECT_FALSE(invalid.Valid());
+  EXPECT_FALSE(invalid.Ready());
+  EXPECT_FALSE(invalid.Wait());
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, SubmitForwardsExceptions)
+{
+  WorkerPool pool;
+  auto handle = pool.Submit([] () -> int
+      {
+        throw std::runtime_error("failed");
+      });
+  EXPECT_TRUE(handle.Wait());
+  EXPECT_THROW(handle.Get(), std::runtime_error);
+
+  // The pool keeps working after a task threw
+  EXPECT_EQ(3, pool.Submit([] () { return 3; }).Get());
+  EXPECT_TRUE(pool.WaitForResults());
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, SubmitAfterDependencies)
+{
+  WorkerPool pool(2u, WorkerPool::SchedulerType::WORK_STEALING);
+  std::atomic<bool> release(false);
+  std::atomic<int> finished(0);
+
+  auto first = pool.Submit([&release, &finished] ()
+      {
+        while (!release)
+          std::this_thread::yield();
+        ++finished;
+        return 2;
+      });
+  auto second = pool.Submit([&finished] ()
+      {
+        ++finished;
+        return 3;
+      });
+
+  auto product = pool.SubmitAfter({first, second}, [&finished, first, second]
+      {
+        EXPECT_EQ(2, finished);
+        return first.Get() * second.Get();
+      });
+
+  // Not all dependencies are done
+  EXPECT_FALSE(product.Wait(Time(0.01)));
+  release = true;
+  EXPECT_EQ(6, product.Get());
+
+  // Dependencies that already finished, or invalid ones, don't block
+  auto chained = pool.SubmitAfter({product, TaskHandle<int>()},
+      [product] { return product.Get() + 1; });
+  EXPECT_EQ(7, chained.Get());
+
+  // A continuation without dependencies runs right away
+  EXPECT_EQ(1, pool.SubmitAfter({}, [] { return 1; }).Get());
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, TaskGroupsWaitIndependently)
+{
+  WorkerPool pool(2u);
+  TaskGroup slowGroup(pool);
+  TaskGroup fastGroup(pool);
+
+  std::atomic<bool> release(false);
+  slowGroup.Submit([&release] ()
+      {
+        while (!release)
+          std::this_thread::yield();
+      });
+
+  std::atomic<int> sentinel(0);
+  for (int i = 0; i < 100; ++i)
+    fastGroup.Submit([&sentinel] () { ++sentinel; });
+
+  // The fast group doesn't wait on the slow group's work
+  EXPECT_TRUE(fastGroup.Wait());
+  EXPECT_EQ(100, sentinel);
+  EXPECT_EQ(0u, fastGroup.PendingCount());
+  EXPECT_EQ(1u, slowGroup.PendingCount());
+  EXPECT_FALSE(slowGroup.Wait(Time(0.01)));
+
+  // A continuation counts as group work as soon as it's submitted
+  auto last = fastGroup.Submit([] () { return 1; });
+  fastGroup.SubmitAfter({last}, [&sentinel] () { ++sentinel; });
+  EXPECT_TRUE(fastGroup.Wait());
+  EXPECT_EQ(101, sentinel);
+
+  release = true;
+  EXPECT_TRUE(slowGroup.Wait());
+  EXPECT_TRUE(pool.WaitForResults());
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, DestroyWithQueuedTasks)
+{
+  auto pool = std::make_unique<WorkerPool>(1u);
+
+  // Keep every worker busy until the pool is being destroyed, which wakes
+  // up everyone waiting for results
+  const unsigned int workers = std::max(std::thread::hardware_concurrency(),
+      1u);
+  WorkerPool *destroyed = pool.get();
+  std::atomic<unsigned int> started(0);
+  for (unsigned int w = 0; w < workers; ++w)
+  {
+    pool->AddWork([destroyed, &started] ()
+        {
+          ++started;
+          EXPECT_FALSE(destroyed->WaitForResults());
+        });
+  }
+  while (started < workers)
+    std::this_thread::yield();
+
+  std::atomic<int> ran(0);
+  auto queued = pool->Submit([&ran] () { ++ran; return 1; });
+  auto dependent = pool->SubmitAfter({queued}, [&ran] () { ++ran; });
+  TaskGroup group(*pool);
+  group.Submit([&ran] () { ++ran; });
+
+  pool.reset();
+
+  // The work that never ran finishes with an error instead of blocking
+  EXPECT_EQ(0, ran);
+  try
+  {
+    queued.Get();
+    FAIL() << "Expected a broken promise";
+  }
+  catch (const std::future_error &_e)
+  {
+    EXPECT_EQ(std::future_errc::broken_promise, _e.code());
+  }
+  EXPECT_TRUE(dependent.Wait());
+  EXPECT_THROW(dependent.Get(), std::future_error);
+  EXPECT_TRUE(group.Wait());
+  EXPECT_EQ(0u, group.PendingCount());
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, ParallelFor)
+{
+  WorkerPool pool(2u, WorkerPool::SchedulerType::WORK_STEALING);
+
+  for (std::size_t grain : {0u, 1u, 7u, 1000u, 5000u})
+  {
+    std::vector<int> visits(1000, 0);
+    pool.ParallelFor(0, visits.size(), grain,
+        [&visits] (const std::size_t _first, const std::size_t _last)
+        {
+          EXPECT_LT(_first, _last);
+          for (std::size_t i = _first; i < _last; ++i)
+            ++visits[i];
+        });
+    for (const int v : visits)
+      EXPECT_EQ(1, v);
+  }
+
+  // Offset range
+  std::atomic<std::size_t> sum(0);
+  pool.ParallelFor(10, 20, 3,
+      [&sum] (const std::size_t _first, const std::size_t _last)
+      {
+        for (std::size_t i = _first; i < _last; ++i)
+          sum += i;
+      });
+  EXPECT_EQ(145u, sum);
+
+  // Empty range
+  bool called = false;
+  pool.ParallelFor(5, 5, 0,
+      [&called] (const std::size_t, const std::size_t) { called = true; });
+  EXPECT_FALSE(called);
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, ParallelForNested)
+{
+  WorkerPool pool(2u, WorkerPool::SchedulerType::WORK_STEALING);
+  std::atomic<int> sentinel(0);
+
+  // The calling thread takes part in the work, so nesting from inside the
+  // workers can't run out of threads.
+  pool.ParallelFor(0, 8, 1,
+      [&pool, &sentinel] (const std::size_t, const std::size_t)
+      {
+        pool.ParallelFor(0, 100, 10,
+            [&sentinel] (const std::size_t _first, const std::size_t _last)
+            {
+              sentinel += static_cast<int>(_last - _first);
+            });
+      });
+  EXPECT_EQ(800, sentinel);
+  EXPECT_TRUE(pool.WaitForResults());
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, ParallelForException)
+{
+  WorkerPool pool(2u);
+  std::atomic<int> chunks(0);
+  EXPECT_THROW(pool.ParallelFor(0, 100, 1,
+      [&chunks] (const std::size_t _first, const std::size_t)
+      {
+        ++chunks;
+        if (_first == 10)
+          throw std::runtime_error("failed");
+      }), std::runtime_error);
+  EXPECT_LE(chunks, 100);
+  EXPECT_TRUE(pool.WaitForResults());
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, ParallelReduce)
+{
+  WorkerPool pool(2u, WorkerPool::SchedulerType::WORK_STEALING);
+  std::vector<double> values(10001);
+  for (std::size_t i = 0; i < values.size(); ++i)
+    values[i] = static_cast<double>(i);
+
+  for (std::size_t grain : {0u, 1u, 64u, 20000u})
+  {
+    double sum = pool.ParallelReduce(0, values.size(), grain, 0.0,
+        [&values] (const std::size_t _first, const std::size_t _last)
+        {
+          double partial = 0.0;
+          for (std::size_t i = _first; i < _last; ++i)
+            partial += values[i];
+          return partial;
+        },
+        [] (const double _a, const double _b) { return _a + _b; });
+    EXPECT_DOUBLE_EQ(50005000.0, sum);
+  }
+
+  // Chunk values are combined in order
+  std::string text = pool.ParallelReduce(0, 26, 1, std::string(),
+      [] (const std::size_t _first, const std::size_t)
+      {
+        return std::string(1, static_cast<char>('a' + _first));
+      },
+      [] (const std::string &_a, const std::string &_b) { return _a + _b; });
+  EXPECT_EQ("abcdefghijklmnopqrstuvwxyz", text);
+
+  // Empty range gives the identity
+  EXPECT_EQ(-1, pool.ParallelReduce(3, 3, 0, -1,
+      [] (const std::size_t, const std::size_t) { return 0; },
+      [] (const int _a, const int _b) { return _a + _b; }));
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, Shared)
+{
+  WorkerPool &pool = WorkerPool::Shared();
+  EXPECT_EQ(&pool, &WorkerPool::Shared());
+  EXPECT_EQ(WorkerPool::SchedulerType::WORK_STEALING, pool.Scheduler());
+  EXPECT_GE(pool.ThreadCount(), 1u);
+  EXPECT_EQ(4, pool.Submit([] () { return 4; }).Get());
+}
+
+//////////////////////////////////////////////////
+/// \brief Static object that uses the shared pool when it is destroyed,
+/// like a heightmap or a mesh held by a static cache. It is constructed
+/// before the shared pool, so it is destroyed after the pool would be if
+/// the pool were a plain function-local static.
+class SharedPoolUserAtExit
+{
+  public: ~SharedPoolUserAtExit()
+  {
+    std::atomic<int> sum(0);
+    WorkerPool::Shared().ParallelFor(0, 100, 1,
+        [&sum] (const std::size_t _first, const std::size_t _last)
+        {
+          for (std::size_t i = _first; i < _last; ++i)
+            sum += static_cast<int>(i);
+        });
+
+    // Too late to report a test failure, so fail the whole program.
+    if (sum != 4950)
+      std::abort();
+  }
+};
+
+static SharedPoolUserAtExit sharedPoolUserAtExit;
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, SharedAtExit)
+{
+  // The shared pool is still usable when sharedPoolUserAtExit is
+  // destroyed, after this program returns from main.
+  EXPECT_EQ(3, WorkerPool::Shared().Submit([] () { return 3; }).Get());
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, MoveOnlyWork)
+{
+  WorkerPool pool;
+  std::atomic<int> sum(0);
+
+  auto value = std::make_unique<int>(3);
+  pool.AddWork([&sum, value = std::move(value)] ()
+      {
+        sum += *value;
+      });
+  EXPECT_TRUE(pool.WaitForResults());
+  EXPECT_EQ(3, sum);
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, AllocationFreeSubmission)
+{
+  for (auto scheduler : {WorkerPool::SchedulerType::SHARED_QUEUE,
+                         WorkerPool::SchedulerType::WORK_STEALING})
+  {
+    WorkerPool pool(1u, scheduler);
+    std::atomic<int> sum(0);
+    EXPECT_EQ(0.0, pool.AllocationsPerTask());
+
+    auto addSmallWork = [&pool, &sum] (const int _count)
+    {
+      for (int i = 0; i < _count; ++i)
+      {
+        int a = i, b = 2 * i, c = 3 * i;
+        pool.AddWork([&sum, a, b, c] () { sum += a + b - c; });
+      }
+    };
+
+    // Hold every worker while the queues fill up with twice as much work as
+    // the rounds below add, so that they reach their working size.
+    std::atomic<unsigned int> started(0);
+    std::atomic<bool> release(false);
+    for (unsigned int w = 0; w < pool.ThreadCount(); ++w)
+    {
+      pool.AddWork([&started, &release] ()
+          {
+            ++started;
+            while (!release)
+              std::this_thread::yield();
+          });
+    }
+    while (started < pool.ThreadCount())
+      std::this_thread::yield();
+    addSmallWork(2000);
+    release = true;
+    EXPECT_TRUE(pool.WaitForResults());
+
+    const std::size_t warmAllocations = pool.AllocationCount();
+    for (int round = 0; round < 5; ++round)
+    {
+      addSmallWork(1000);
+      EXPECT_TRUE(pool.WaitForResults());
+    }
+    EXPECT_EQ(warmAllocations, pool.AllocationCount());
+    EXPECT_EQ(7000u + pool.ThreadCount(), pool.AddedWorkCount());
+    EXPECT_EQ(0, sum);
+
+    // Plain std::function work with a callback is stored inline as well
+    pool.AddWork([&sum] () { ++sum; }, [&sum] () { ++sum; });
+    EXPECT_TRUE(pool.WaitForResults());
+    EXPECT_EQ(2, sum);
+    EXPECT_EQ(warmAllocations, pool.AllocationCount());
+
+    // Large captures have to go to the heap, which is accounted for
+    std::array<char, 256> big;
+    big.fill(1);
+    pool.AddWork([&sum, big] () { sum += big[0]; });
+    EXPECT_TRUE(pool.WaitForResults());
+    EXPECT_EQ(3, sum);
+    EXPECT_EQ(warmAllocations + 1, pool.AllocationCount());
+    EXPECT_GT(pool.AllocationsPerTask(), 0.0);
+
+    // Submit allocates the state shared with its handle
+    const std::size_t beforeSubmit = pool.AllocationCount();
+    EXPECT_EQ(4, pool.Submit([] () { return 4; }).Get());
+    EXPECT_TRUE(pool.WaitForResults());
+    EXPECT_EQ(beforeSubmit + 1, pool.AllocationCount());
+
+    // and ParallelFor the state shared by its chunks
+    const std::size_t beforeFor = pool.AllocationCount();
+    pool.ParallelFor(0, 100, 10, [] (std::size_t, std::size_t) {});
+    EXPECT_TRUE(pool.WaitForResults());
+    EXPECT_EQ(beforeFor + 1, pool.AllocationCount());
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Keeps every worker of a pool busy until released, so that work
+/// can be queued up before any of it runs.
+class WorkerHold
+{
+  /// \brief Constructor, returns once every worker is held.
+  /// \param[in] _pool Pool to hold
+  public: explicit WorkerHold(WorkerPool &_pool)
+    : count(_pool.ThreadCount())
+  {
+    for (unsigned int w = 0; w < this->count; ++w)
+    {
+      _pool.AddWork(WorkerPool::TaskOptions(WorkerPool::Priority::CRITICAL),
+          [this] ()
+          {
+            ++this->held;
+            int available = this->tokens;
+            while (available == 0 ||
+                   !this->tokens.compare_exchange_weak(available,
+                       available - 1))
+            {
+              std::this_thread::yield();
+              available = this->tokens;
+            }
+            ++this->released;
+          });
+    }
+    while (this->held < this->count)
+      std::this_thread::yield();
+  }
+
+  /// \brief Destructor, releases every worker still held and waits for
+  /// them to be gone.
+  public: ~WorkerHold()
+  {
+    this->Release(this->count);
+    while (this->released < this->count)
+      std::this_thread::yield();
+  }
+
+  /// \brief Let some workers go.
+  /// \param[in] _workers Number of workers to release
+  public: void Release(const unsigned int _workers)
+  {
+    this->tokens += _workers;
+  }
+
+  /// \brief Number of workers in the pool
+  private: const unsigned int count;
+
+  /// \brief Number of workers that are held
+  private: std::atomic<unsigned int> held{0};
+
+  /// \brief Number of workers that were let go
+  private: std::atomic<unsigned int> released{0};
+
+  /// \brief Number of workers allowed to go
+  private: std::atomic<int> tokens{0};
+};
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, Priorities)
+{
+  for (auto scheduler : {WorkerPool::SchedulerType::SHARED_QUEUE,
+                         WorkerPool::SchedulerType::WORK_STEALING})
+  {
+    WorkerPool pool(2u, scheduler);
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto record = [&mutex, &order] (const std::string &_name)
+    {
+      return [&mutex, &order, _name] ()
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(_name);
+      };
+    };
+
+    WorkerPool::TaskOptions low(WorkerPool::Priority::LOW);
+    WorkerPool::TaskOptions normal;
+    WorkerPool::TaskOptions high(WorkerPool::Priority::HIGH);
+    WorkerPool::TaskOptions critical(WorkerPool::Priority::CRITICAL);
+    WorkerPool::TaskOptions deadline(WorkerPool::Priority::NORMAL,
+        Time(0, 1000000));
+
+    {
+      WorkerHold hold(pool);
+      pool.AddWork(low, record("low"));
+      pool.AddWork(normal, record("normal1"));
+      pool.AddWork(high, record("high"));
+      pool.AddWork(normal, record("normal2"));
+      pool.AddWork(critical, record("critical"));
+      pool.AddWork(deadline, record("deadline"));
+      TaskHandle<int> handle = pool.Submit(high, [] () { return 7; });
+
+      EXPECT_EQ(1u, pool.QueueDepth(WorkerPool::Priority::LOW));
+      EXPECT_EQ(3u, pool.QueueDepth(WorkerPool::Priority::NORMAL));
+      EXPECT_EQ(2u, pool.QueueDepth(WorkerPool::Priority::HIGH));
+      EXPECT_EQ(1u, pool.QueueDepth(WorkerPool::Priority::CRITICAL));
+
+      // A single worker runs all the queued work, in order of urgency
+      hold.Release(1);
+      EXPECT_EQ(7, handle.Get());
+      while (true)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (order.size() == 6u)
+          break;
+      }
+    }
+    EXPECT_TRUE(pool.WaitForResults());
+
+    std::vector<std::string> expected = {"critical", "deadline", "high",
+      "normal1", "normal2", "low"};
+    EXPECT_EQ(expected, order);
+    for (std::size_t p = 0; p < WorkerPool::PriorityCount; ++p)
+      EXPECT_EQ(0u, pool.QueueDepth(static_cast<WorkerPool::Priority>(p)));
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, OwnQueueFirst)
+{
+  WorkerPool pool(2u, WorkerPool::SchedulerType::WORK_STEALING);
+  std::mutex mutex;
+  std::vector<std::string> order;
+  auto record = [&mutex, &order] (const std::string &_name)
+  {
+    return [&mutex, &order, _name] ()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(_name);
+    };
+  };
+
+  {
+    // One worker stays held, the other one runs the spawner
+    WorkerHold hold(pool);
+    hold.Release(1);
+
+    std::atomic<bool> spawning(false);
+    std::atomic<bool> added(false);
+    pool.AddWork([&] ()
+        {
+          spawning = true;
+          while (!added)
+            std::this_thread::yield();
+
+          // Work added by a worker goes to its own queue
+          pool.AddWork(record("own1"));
+          pool.AddWork(record("own2"));
+          pool.AddWork(record("own3"));
+        });
+    while (!spawning)
+      std::this_thread::yield();
+
+    // One of these lands in the queue of the held worker. It is older,
+    // but the running worker drains its own queue before stealing it.
+    pool.AddWork(record("external"));
+    pool.AddWork(record("external"));
+    added = true;
+
+    while (true)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (order.size() == 5u)
+        break;
+    }
+  }
+  EXPECT_TRUE(pool.WaitForResults());
+
+  ASSERT_EQ(5u, order.size());
+  EXPECT_EQ("external", order.back());
+  std::vector<std::string> own;
+  for (const std::string &name : order)
+  {
+    if (name != "external")
+      own.push_back(name);
+  }
+  EXPECT_EQ(std::vector<std::string>({"own1", "own2", "own3"}), own);
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, LowPriorityDoesNotStarve)
+{
+  WorkerPool pool;
+  pool.SetAgingInterval(Time(0, 1000000));
+  EXPECT_EQ(Time(0, 1000000), pool.AgingInterval());
+
+  std::mutex mutex;
+  std::vector<int> order;
+  {
+    WorkerHold hold(pool);
+    pool.AddWork(WorkerPool::TaskOptions(WorkerPool::Priority::LOW),
+        [&mutex, &order] ()
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          order.push_back(0);
+        });
+
+    // Once the low priority work has waited more than three aging intervals
+    // it is more urgent than brand new critical work.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    pool.AddWork(WorkerPool::TaskOptions(WorkerPool::Priority::CRITICAL),
+        [&mutex, &order] ()
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          order.push_back(1);
+        });
+    hold.Release(1);
+    while (true)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (order.size() == 2u)
+        break;
+    }
+  }
+  EXPECT_TRUE(pool.WaitForResults());
+  EXPECT_EQ(std::vector<int>({0, 1}), order);
+
+  EXPECT_GE(pool.WaitTimePercentile(WorkerPool::Priority::LOW, 50),
+            Time(0, 10000000));
+  EXPECT_EQ(Time::Zero,
+            pool.WaitTimePercentile(WorkerPool::Priority::HIGH, 50));
+  pool.ResetWaitTimes();
+  EXPECT_EQ(Time::Zero,
+            pool.WaitTimePercentile(WorkerPool::Priority::LOW, 50));
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Prints a binary log file written by FileLogger::InitBinary as text.
+//
+// Usage: ign_log_decode4 <file> [max level]
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <ignition/common/BinaryLog.hh>
+
+int main(int argc, char **argv)
+{
+  if (argc < 2 || argc > 3)
+  {
+    std::cerr << "Usage: " << argv[0] << " <file> [max level]\n"
+              << "  Prints a binary log file as text. Messages with a level "
+              << "above max level\n  (1: errors, 2: warnings, 3: messages, "
+              << "4: debug) are skipped.\n";
+    return EXIT_FAILURE;
+  }
+
+  const int maxLevel = argc == 3 ? std::atoi(argv[2]) : 4;
+
+  ignition::common::BinaryLogReader reader(argv[1]);
+  if (!reader.Valid())
+    return EXIT_FAILURE;
+
+  ignition::common::BinaryLogRecord record;
+  while (reader.Next(record))
+  {
+    if (record.level <= maxLevel)
+      std::cout << record.ToString() << "\n";
+  }
+
+  return EXIT_SUCCESS;
+}
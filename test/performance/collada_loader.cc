@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/common/ColladaLoader.hh"
+#include "ignition/common/Filesystem.hh"
+#include "ignition/common/Mesh.hh"
+
+using namespace ignition;
+
+/////////////////////////////////////////////////
+/// \brief Write a COLLADA file with one node, geometry, material and
+/// effect per box, like the exports of large scenes.
+/// \param[in] _boxes Number of boxes
+/// \param[in] _filename Path to the file
+static void WriteBoxes(const int _boxes, const std::string &_filename)
+{
+  std::ofstream file(_filename);
+  file << "<?xml version=\"1.0\"?>\n"
+       << "<COLLADA xmlns=\"http://www.collada.org/2005/11/COLLADASchema\""
+       << " version=\"1.4.1\">\n"
+       << "<asset><unit meter=\"1\"/><up_axis>Z_UP</up_axis></asset>\n";
+
+  file << "<library_effects>\n";
+  for (int b = 0; b < _boxes; ++b)
+  {
+    file << "<effect id=\"effect" << b << "\"><profile_COMMON>"
+         << "<technique sid=\"common\"><phong><diffuse><color sid=\"diffuse\">"
+         << (b % 10) / 10.0 << " 0.5 0.5 1</color></diffuse></phong>"
+         << "</technique></profile_COMMON></effect>\n";
+  }
+  file << "</library_effects>\n<library_materials>\n";
+  for (int b = 0; b < _boxes; ++b)
+  {
+    file << "<material id=\"material" << b << "\">"
+         << "<instance_effect url=\"#effect" << b << "\"/></material>\n";
+  }
+
+  file << "</library_materials>\n<library_geometries>\n";
+  for (int b = 0; b < _boxes; ++b)
+  {
+    const std::string id = "box" + std::to_string(b);
+    file << "<geometry id=\"" << id << "\"><mesh>\n"
+         << "<source id=\"" << id << "-positions\"><float_array id=\"" << id
+         << "-positions-array\" count=\"24\">";
+    for (int v = 0; v < 8; ++v)
+    {
+      file << (v & 1 ? 0.5 : -0.5) << " " << (v & 2 ? 0.5 : -0.5) << " "
+           << (v & 4 ? 0.5 : -0.5) + b << " ";
+    }
+    file << "</float_array><technique_common><accessor source=\"#" << id
+         << "-positions-array\" count=\"8\" stride=\"3\">"
+         << "<param name=\"X\" type=\"float\"/><param name=\"Y\" "
+         << "type=\"float\"/><param name=\"Z\" type=\"float\"/>"
+         << "</accessor></technique_common></source>\n"
+         << "<source id=\"" << id << "-normals\"><float_array id=\"" << id
+         << "-normals-array\" count=\"18\">"
+         << "-1 0 0 1 0 0 0 -1 0 0 1 0 0 0 -1 0 0 1</float_array>"
+         << "<technique_common><accessor source=\"#" << id
+         << "-normals-array\" count=\"6\" stride=\"3\">"
+         << "<param name=\"X\" type=\"float\"/><param name=\"Y\" "
+         << "type=\"float\"/><param name=\"Z\" type=\"float\"/>"
+         << "</accessor></technique_common></source>\n"
+         << "<vertices id=\"" << id << "-vertices\"><input semantic="
+         << "\"POSITION\" source=\"#" << id << "-positions\"/></vertices>\n"
+         << "<triangles material=\"material\" count=\"12\">"
+         << "<input semantic=\"VERTEX\" source=\"#" << id
+         << "-vertices\" offset=\"0\"/><input semantic=\"NORMAL\" "
+         << "source=\"#" << id << "-normals\" offset=\"1\"/><p>"
+         << "0 0 4 0 6 0 0 0 6 0 2 0 1 1 3 1 7 1 1 1 7 1 5 1 "
+         << "0 2 1 2 5 2 0 2 5 2 4 2 2 3 6 3 7 3 2 3 7 3 3 3 "
+         << "0 4 2 4 3 4 0 4 3 4 1 4 4 5 5 5 7 5 4 5 7 5 6 5"
+         << "</p></triangles>\n</mesh></geometry>\n";
+  }
+
+  file << "</library_geometries>\n<library_visual_scenes>"
+       << "<visual_scene id=\"scene\">\n";
+  for (int b = 0; b < _boxes; ++b)
+  {
+    file << "<node id=\"node" << b << "\"><instance_geometry url=\"#box"
+         << b << "\"><bind_material><technique_common>"
+         << "<instance_material symbol=\"material\" target=\"#material" << b
+         << "\"/></technique_common></bind_material></instance_geometry>"
+         << "</node>\n";
+  }
+  file << "</visual_scene></library_visual_scenes>\n"
+       << "<scene><instance_visual_scene url=\"#scene\"/></scene>\n"
+       << "</COLLADA>\n";
+}
+
+/////////////////////////////////////////////////
+TEST(ColladaLoader, Boxes)
+{
+  const std::string path = common::joinPaths(common::cwd(), "tmp");
+  common::createDirectories(path);
+
+  std::cout << std::fixed;
+  std::cout << std::setprecision(2);
+  std::cout << "Boxes  Load (ms)\n";
+  for (const int boxes : {250, 1000, 4000})
+  {
+    const std::string filename = common::joinPaths(path,
+        "boxes" + std::to_string(boxes) + ".dae");
+    WriteBoxes(boxes, filename);
+
+    common::ColladaLoader loader;
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<common::Mesh> mesh(loader.Load(filename));
+    const double duration = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    ASSERT_NE(nullptr, mesh);
+    EXPECT_EQ(static_cast<unsigned int>(boxes), mesh->SubMeshCount());
+    EXPECT_EQ(static_cast<unsigned int>(boxes), mesh->MaterialCount());
+    EXPECT_EQ(36u * boxes, mesh->IndexCount());
+
+    std::cout << std::setw(5) << std::right << boxes
+              << std::setw(11) << std::right << duration << std::endl;
+    common::removeFile(filename);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+#include "ignition/common/DelegateEvent.hh"
+#include "ignition/common/Event.hh"
+
+using namespace ignition;
+
+/// \brief Number of calls to make through every event
+static const std::size_t CallsPerRun = 4000000;
+
+/////////////////////////////////////////////////
+/// \brief A subscriber with a small update, like most event callbacks.
+class Subscriber
+{
+  public: void OnUpdate(double _dt)
+  {
+    this->time += _dt;
+  }
+
+  public: double time = 0.0;
+};
+
+/////////////////////////////////////////////////
+/// \brief Signal an event until CallsPerRun subscriber calls were made.
+/// \return Average time per subscriber call in nanoseconds.
+template<typename EventType>
+static double RunSignals(EventType &_event, const std::size_t _subscribers)
+{
+  const std::size_t signals = CallsPerRun / _subscribers;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < signals; ++i)
+    _event(0.001);
+  const auto finish = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::nano>(finish - start).count() /
+    static_cast<double>(signals * _subscribers);
+}
+
+/////////////////////////////////////////////////
+TEST(EventSignal, ManySubscribers)
+{
+  struct TestData
+  {
+    std::size_t subscribers;
+    double eventT;
+    double delegateEventT;
+  };
+
+  std::vector<TestData> tests = {
+    {1, 0.0, 0.0}, {16, 0.0, 0.0}, {256, 0.0, 0.0}, {4096, 0.0, 0.0}};
+
+  for (TestData &test : tests)
+  {
+    std::vector<Subscriber> subscribers(test.subscribers);
+    common::EventT<void(double)> event;
+    common::DelegateEventT<void(double)> delegateEvent;
+    // Released before the events
+    std::vector<common::ConnectionPtr> connections;
+    for (Subscriber &sub : subscribers)
+    {
+      connections.push_back(event.Connect(
+          std::bind(&Subscriber::OnUpdate, &sub, std::placeholders::_1)));
+      connections.push_back(
+          delegateEvent.Connect<&Subscriber::OnUpdate>(&sub));
+    }
+
+    // Warm up before measuring
+    RunSignals(event, test.subscribers);
+    RunSignals(delegateEvent, test.subscribers);
+
+    test.eventT = RunSignals(event, test.subscribers);
+    test.delegateEventT = RunSignals(delegateEvent, test.subscribers);
+
+    for (const Subscriber &sub : subscribers)
+      EXPECT_GT(sub.time, 0.0);
+  }
+
+  std::cout << std::fixed;
+  std::cout << std::setprecision(2);
+  std::cout << "Subscribers      EventT  DelegateEventT (ns/call)\n";
+  for (const TestData &test : tests)
+  {
+    std::cout << std::setw(11) << std::right << test.subscribers
+              << std::setw(12) << std::right << test.eventT
+              << std::setw(16) << std::right << test.delegateEventT
+              << std::endl;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
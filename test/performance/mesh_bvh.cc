@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <vector>
+
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/MeshBVH.hh"
+#include "ignition/common/SubMesh.hh"
+
+using namespace ignition;
+
+/// \brief Number of rays cast in each test
+static const int RayCount = 10000;
+
+/// \brief Largest mesh for which the brute force loop is timed
+static const std::size_t MaxReferenceTriangles = 20000;
+
+/////////////////////////////////////////////////
+/// \brief Create a bumpy terrain of _size x _size quads.
+/// \param[in] _size Number of quads along each side
+/// \param[out] _mesh Mesh to fill
+static void CreateTerrain(const int _size, common::Mesh &_mesh)
+{
+  common::SubMesh submesh;
+  for (int x = 0; x <= _size; ++x)
+  {
+    for (int y = 0; y <= _size; ++y)
+    {
+      const double u = static_cast<double>(x) / _size;
+      const double v = static_cast<double>(y) / _size;
+      submesh.AddVertex(u * 100.0, v * 100.0,
+          5.0 * std::sin(u * 20.0) * std::cos(v * 15.0));
+    }
+  }
+  for (int x = 0; x < _size; ++x)
+  {
+    for (int y = 0; y < _size; ++y)
+    {
+      const unsigned int v = x * (_size + 1) + y;
+      for (unsigned int index : {v, v + _size + 1, v + _size + 2,
+                                 v, v + _size + 2, v + 1})
+      {
+        submesh.AddIndex(index);
+      }
+    }
+  }
+  _mesh.AddSubMesh(submesh);
+}
+
+/////////////////////////////////////////////////
+/// \brief Cast a ray against every triangle, like consumers did before.
+/// \param[in] _submesh The submesh
+/// \param[in] _origin Origin of the ray
+/// \param[in] _direction Unit direction of the ray
+/// \return Distance to the first hit, or infinity.
+static double BruteForce(const common::SubMesh &_submesh,
+    const math::Vector3d &_origin, const math::Vector3d &_direction)
+{
+  double best = std::numeric_limits<double>::infinity();
+  auto indices = _submesh.Indices();
+  for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+  {
+    const math::Vector3d v0 = _submesh.Vertex(indices[i]);
+    const math::Vector3d e1 = _submesh.Vertex(indices[i + 1]) - v0;
+    const math::Vector3d e2 = _submesh.Vertex(indices[i + 2]) - v0;
+    const math::Vector3d p = _direction.Cross(e2);
+    const double det = e1.Dot(p);
+    if (det == 0.0)
+      continue;
+    const math::Vector3d t = _origin - v0;
+    const double u = t.Dot(p) / det;
+    const math::Vector3d q = t.Cross(e1);
+    const double v = _direction.Dot(q) / det;
+    const double distance = e2.Dot(q) / det;
+    if (u >= 0.0 && v >= 0.0 && u + v <= 1.0 && distance >= 0.0 &&
+        distance < best)
+    {
+      best = distance;
+    }
+  }
+  return best;
+}
+
+/////////////////////////////////////////////////
+TEST(MeshBVH, Terrain)
+{
+  struct TestData
+  {
+    int size;
+    std::size_t triangles;
+    double reference;
+    double build;
+    double bvh;
+  };
+
+  std::vector<TestData> tests = {
+    {10, 0, 0.0, 0.0, 0.0}, {70, 0, 0.0, 0.0, 0.0},
+    {220, 0, 0.0, 0.0, 0.0}, {700, 0, 0.0, 0.0, 0.0}};
+
+  for (TestData &test : tests)
+  {
+    common::Mesh mesh;
+    CreateTerrain(test.size, mesh);
+    auto submesh = mesh.SubMeshByIndex(0).lock();
+    test.triangles = submesh->IndexCount() / 3;
+
+    auto start = std::chrono::steady_clock::now();
+    const common::MeshBVH bvh(mesh);
+    test.build = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    // Rays from above the terrain, like a lidar on a vehicle
+    std::vector<math::Vector3d> origins;
+    std::vector<math::Vector3d> directions;
+    for (int i = 0; i < RayCount; ++i)
+    {
+      const double angle = 2.0 * IGN_PI * i / RayCount;
+      origins.push_back(math::Vector3d(50.0 + 0.001 * i, 50.0, 8.0));
+      directions.push_back(math::Vector3d(std::cos(angle), std::sin(angle),
+            -0.1 - 0.2 * (i % 16) / 16.0).Normalize());
+    }
+
+    std::vector<double> distances(RayCount);
+    start = std::chrono::steady_clock::now();
+    common::MeshBVHHit hit;
+    for (int i = 0; i < RayCount; ++i)
+    {
+      distances[i] = bvh.Intersect(origins[i], directions[i], hit) ?
+        hit.distance : std::numeric_limits<double>::infinity();
+    }
+    test.bvh = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    if (test.triangles > MaxReferenceTriangles)
+      continue;
+
+    std::vector<double> expected(RayCount);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < RayCount; ++i)
+      expected[i] = BruteForce(*submesh, origins[i], directions[i]);
+    test.reference = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    for (int i = 0; i < RayCount; ++i)
+    {
+      if (std::isinf(expected[i]))
+        EXPECT_TRUE(std::isinf(distances[i]));
+      else
+        EXPECT_NEAR(expected[i], distances[i], 1e-9);
+    }
+  }
+
+  std::cout << std::fixed;
+  std::cout << std::setprecision(2);
+  std::cout << "Triangles  Brute force (ms)  BVH build (ms)  BVH rays (ms)\n";
+  for (const TestData &test : tests)
+  {
+    std::cout << std::setw(9) << std::right << test.triangles;
+    if (test.reference > 0.0)
+      std::cout << std::setw(18) << std::right << test.reference;
+    else
+      std::cout << std::setw(18) << std::right << "-";
+    std::cout << std::setw(16) << std::right << test.build
+              << std::setw(15) << std::right << test.bvh << std::endl;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <string>
+
+#include "ignition/common/Filesystem.hh"
+#include "ignition/common/Mesh.hh"
+#include "ignition/common/STLLoader.hh"
+#include "ignition/common/SubMesh.hh"
+
+using namespace ignition;
+
+/// \brief Number of quads along each side of the terrain
+static const int TerrainSize = 1000;
+
+/////////////////////////////////////////////////
+/// \brief Append the bytes of a float to a string.
+/// \param[in] _value The value
+/// \param[out] _content The string
+static void Append(const float _value, std::string &_content)
+{
+  char bytes[sizeof(float)];
+  std::memcpy(bytes, &_value, sizeof(float));
+  _content.append(bytes, sizeof(float));
+}
+
+/////////////////////////////////////////////////
+/// \brief Write a binary STL file of a flat terrain of _size x _size quads.
+/// \param[in] _size Number of quads along each side
+/// \param[in] _filename Path to the file
+static void WriteTerrain(const int _size, const std::string &_filename)
+{
+  std::string content(80, ' ');
+  const uint32_t count = 2 * _size * _size;
+  content.append(reinterpret_cast<const char *>(&count), sizeof(count));
+  content.reserve(84 + 50 * static_cast<std::size_t>(count));
+  for (int x = 0; x < _size; ++x)
+  {
+    for (int y = 0; y < _size; ++y)
+    {
+      const float corners[2][3][2] = {
+        {{0, 0}, {1, 0}, {1, 1}}, {{0, 0}, {1, 1}, {0, 1}}};
+      for (const auto &triangle : corners)
+      {
+        for (const float n : {0.0f, 0.0f, 1.0f})
+          Append(n, content);
+        for (const auto &corner : triangle)
+        {
+          Append(static_cast<float>(x + corner[0]), content);
+          Append(static_cast<float>(y + corner[1]), content);
+          Append(0.0f, content);
+        }
+        content.append(2, '\0');
+      }
+    }
+  }
+  std::ofstream file(_filename, std::ios::binary);
+  file.write(content.data(), content.size());
+}
+
+/////////////////////////////////////////////////
+TEST(STLLoader, Binary)
+{
+  const std::string path = common::joinPaths(common::cwd(), "tmp");
+  common::createDirectories(path);
+  const std::string filename = common::joinPaths(path, "terrain.stl");
+  WriteTerrain(TerrainSize, filename);
+  const double megabytes = (84.0 + 100.0 * TerrainSize * TerrainSize) / 1e6;
+
+  std::cout << std::fixed;
+  std::cout << std::setprecision(2);
+  std::cout << "Weld  Vertices  Load (ms)     MB/s\n";
+  for (const bool weld : {false, true})
+  {
+    common::STLLoader loader;
+    loader.SetWeldVertices(weld);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<common::Mesh> mesh(loader.Load(filename));
+    const double duration = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    ASSERT_NE(nullptr, mesh);
+    ASSERT_EQ(1u, mesh->SubMeshCount());
+    auto subMesh = mesh->SubMeshByIndex(0).lock();
+    EXPECT_EQ(6u * TerrainSize * TerrainSize, subMesh->IndexCount());
+    if (weld)
+    {
+      EXPECT_EQ((TerrainSize + 1u) * (TerrainSize + 1u),
+          subMesh->VertexCount());
+    }
+
+    std::cout << std::setw(4) << std::right << weld
+              << std::setw(10) << std::right << subMesh->VertexCount()
+              << std::setw(11) << std::right << duration
+              << std::setw(9) << std::right
+              << megabytes / (duration / 1000.0) << std::endl;
+  }
+
+  common::removeFile(filename);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+
+#include "ignition/common/SubMesh.hh"
+
+using namespace ignition;
+
+/// \brief Largest mesh for which the quadratic algorithm is timed
+static const std::size_t MaxReferenceTriangles = 20000;
+
+/////////////////////////////////////////////////
+/// \brief Create a bumpy grid of _size x _size quads where every triangle
+/// has its own vertices, like the meshes of STL files and scans.
+/// \param[in] _size Number of quads along each side
+/// \param[out] _submesh Mesh to fill
+static void CreateGrid(const int _size, common::SubMesh &_submesh)
+{
+  auto height = [](int _x, int _y)
+  {
+    return std::sin(_x * 0.05) * std::cos(_y * 0.07);
+  };
+
+  _submesh.SetVertexCount(_size * _size * 6);
+  _submesh.SetNormalCount(_size * _size * 6);
+  _submesh.SetIndexCount(_size * _size * 6);
+  auto vertices = _submesh.MutableVertices();
+  auto indices = _submesh.MutableIndices();
+
+  std::size_t v = 0;
+  for (int x = 0; x < _size; ++x)
+  {
+    for (int y = 0; y < _size; ++y)
+    {
+      const math::Vector3d corners[4] = {
+        {x * 0.01, y * 0.01, height(x, y)},
+        {(x + 1) * 0.01, y * 0.01, height(x + 1, y)},
+        {(x + 1) * 0.01, (y + 1) * 0.01, height(x + 1, y + 1)},
+        {x * 0.01, (y + 1) * 0.01, height(x, y + 1)}};
+      for (int c : {0, 1, 2, 0, 2, 3})
+      {
+        vertices[3 * v] = corners[c].X();
+        vertices[3 * v + 1] = corners[c].Y();
+        vertices[3 * v + 2] = corners[c].Z();
+        indices[v] = static_cast<unsigned int>(v);
+        ++v;
+      }
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief The previous algorithm, which compares every vertex with every
+/// triangle.
+/// \param[in] _submesh The mesh
+/// \return The normals.
+static std::vector<math::Vector3d> ReferenceNormals(
+    const common::SubMesh &_submesh)
+{
+  std::vector<math::Vector3d> vertices(_submesh.VertexCount());
+  for (std::size_t i = 0; i < vertices.size(); ++i)
+    vertices[i] = _submesh.Vertex(static_cast<unsigned int>(i));
+  auto indices = _submesh.Indices();
+  std::vector<math::Vector3d> normals(vertices.size());
+  for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+  {
+    const math::Vector3d &v1 = vertices[indices[i]];
+    const math::Vector3d &v2 = vertices[indices[i + 1]];
+    const math::Vector3d &v3 = vertices[indices[i + 2]];
+    math::Vector3d n = math::Vector3d::Normal(v1, v2, v3);
+    for (std::size_t j = 0; j < vertices.size(); ++j)
+    {
+      const math::Vector3d &v = vertices[j];
+      if (v == v1 || v == v2 || v == v3)
+        normals[j] += n;
+    }
+  }
+  for (auto &n : normals)
+    n.Normalize();
+  return normals;
+}
+
+/////////////////////////////////////////////////
+TEST(SubMeshNormals, Grid)
+{
+  struct TestData
+  {
+    int size;
+    std::size_t triangles;
+    double reference;
+    double recalculate;
+  };
+
+  std::vector<TestData> tests = {
+    {20, 0, 0.0, 0.0}, {70, 0, 0.0, 0.0}, {100, 0, 0.0, 0.0},
+    {300, 0, 0.0, 0.0}, {710, 0, 0.0, 0.0}};
+
+  for (TestData &test : tests)
+  {
+    common::SubMesh submesh;
+    CreateGrid(test.size, submesh);
+    test.triangles = submesh.IndexCount() / 3;
+
+    auto start = std::chrono::steady_clock::now();
+    submesh.RecalculateNormals();
+    test.recalculate = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    if (test.triangles > MaxReferenceTriangles)
+      continue;
+
+    start = std::chrono::steady_clock::now();
+    const auto expected = ReferenceNormals(submesh);
+    test.reference = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    ASSERT_EQ(expected.size(), submesh.NormalCount());
+    for (std::size_t i = 0; i < expected.size(); ++i)
+      EXPECT_EQ(expected[i], submesh.Normal(static_cast<unsigned int>(i)));
+  }
+
+  std::cout << std::fixed;
+  std::cout << std::setprecision(2);
+  std::cout << "Triangles   O(F*V) (ms)  RecalculateNormals (ms)\n";
+  for (const TestData &test : tests)
+  {
+    std::cout << std::setw(9) << std::right << test.triangles;
+    if (test.reference > 0.0)
+      std::cout << std::setw(14) << std::right << test.reference;
+    else
+      std::cout << std::setw(14) << std::right << "-";
+    std::cout << std::setw(25) << std::right << test.recalculate
+              << std::endl;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+#include "ignition/common/WorkerPool.hh"
+
+using WorkerPool = ignition::common::WorkerPool;
+
+/// \brief Number of long background jobs queued up front
+static const int NumJobs = 200;
+
+/// \brief Number of short callbacks added while the jobs run
+static const int NumCallbacks = 100;
+
+/////////////////////////////////////////////////
+/// \brief Busy wait, to simulate work.
+/// \param[in] _micro Microseconds to spin for
+static void Spin(const int _micro)
+{
+  const auto end = std::chrono::steady_clock::now() +
+    std::chrono::microseconds(_micro);
+  while (std::chrono::steady_clock::now() < end)
+  {
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Queue long jobs, then add short callbacks while the jobs run.
+/// \param[in] _callbackPriority Priority of the short callbacks
+static void RunCallbacks(const WorkerPool::Priority _callbackPriority)
+{
+  WorkerPool pool;
+
+  WorkerPool::TaskOptions jobOptions;
+  jobOptions.priority = WorkerPool::Priority::LOW;
+  for (int j = 0; j < NumJobs; ++j)
+    pool.AddWork(jobOptions, [] () { Spin(1000); });
+
+  WorkerPool::TaskOptions callbackOptions;
+  callbackOptions.priority = _callbackPriority;
+  for (int c = 0; c < NumCallbacks; ++c)
+  {
+    pool.AddWork(callbackOptions, [] () { Spin(10); });
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  EXPECT_TRUE(pool.WaitForResults());
+
+  std::cout << std::fixed << std::setprecision(3)
+            << "Callback wait p50: "
+            << pool.WaitTimePercentile(_callbackPriority, 50).Double() * 1e3
+            << "ms, p99: "
+            << pool.WaitTimePercentile(_callbackPriority, 99).Double() * 1e3
+            << "ms\n" << std::endl;
+}
+
+/////////////////////////////////////////////////
+TEST(WorkerPoolPriority, CallbacksBehindLongJobs)
+{
+  std::cout << " --- Callbacks with LOW priority, same as the jobs ---\n";
+  RunCallbacks(WorkerPool::Priority::LOW);
+
+  std::cout << " --- Callbacks with CRITICAL priority ---\n";
+  RunCallbacks(WorkerPool::Priority::CRITICAL);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
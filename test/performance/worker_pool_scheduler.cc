@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/common/WorkerPool.hh"
+
+using WorkerPool = ignition::common::WorkerPool;
+
+/// \brief Number of frames to simulate for every test
+static const std::size_t NumFrames = 50;
+
+/// \brief Number of small tasks added every frame
+static const std::size_t TasksPerFrame = 4000;
+
+/////////////////////////////////////////////////
+/// \brief A tiny piece of work, small enough that the cost of handing it
+/// out dominates.
+static void SmallWork(std::atomic<std::size_t> &_counter)
+{
+  volatile double x = 1.0;
+  for (int i = 0; i < 50; ++i)
+    x = x * 1.000001;
+  ++_counter;
+}
+
+/////////////////////////////////////////////////
+/// \brief Add all the work of one frame from the calling thread.
+/// \return Average time per frame in microseconds.
+static double RunExternalSubmit(WorkerPool &_pool)
+{
+  std::atomic<std::size_t> counter(0);
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t f = 0; f < NumFrames; ++f)
+  {
+    for (std::size_t t = 0; t < TasksPerFrame; ++t)
+      _pool.AddWork([&counter] () { SmallWork(counter); });
+    EXPECT_TRUE(_pool.WaitForResults());
+  }
+  const auto finish = std::chrono::steady_clock::now();
+  EXPECT_EQ(NumFrames * TasksPerFrame, counter);
+
+  return std::chrono::duration<double, std::micro>(finish - start).count() /
+    static_cast<double>(NumFrames);
+}
+
+/////////////////////////////////////////////////
+/// \brief Add a few tasks per frame which in turn add the small tasks from
+/// the worker threads.
+/// \return Average time per frame in microseconds.
+static double RunWorkerSubmit(WorkerPool &_pool)
+{
+  std::atomic<std::size_t> counter(0);
+  const std::size_t spawners = _pool.ThreadCount();
+  const std::size_t tasksPerSpawner = TasksPerFrame / spawners;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t f = 0; f < NumFrames; ++f)
+  {
+    for (std::size_t s = 0; s < spawners; ++s)
+    {
+      _pool.AddWork([&_pool, &counter, tasksPerSpawner] ()
+          {
+            for (std::size_t t = 0; t < tasksPerSpawner; ++t)
+              _pool.AddWork([&counter] () { SmallWork(counter); });
+          });
+    }
+    EXPECT_TRUE(_pool.WaitForResults());
+  }
+  const auto finish = std::chrono::steady_clock::now();
+  EXPECT_EQ(NumFrames * spawners * tasksPerSpawner, counter);
+
+  return std::chrono::duration<double, std::micro>(finish - start).count() /
+    static_cast<double>(NumFrames);
+}
+
+/////////////////////////////////////////////////
+/// \brief Compare the two schedulers of the current WorkerPool. The shared
+/// queue baseline is the SHARED_QUEUE mode of this pool, which already
+/// benefits from allocation free submission, not the original single
+/// queue implementation.
+TEST(WorkerPoolScheduler, Contention)
+{
+  struct TestData
+  {
+    std::string label;
+    WorkerPool::SchedulerType scheduler;
+    double external;
+    double fromWorkers;
+    double allocationsPerTask;
+  };
+
+  std::vector<TestData> tests = {
+    {"Shared queue", WorkerPool::SchedulerType::SHARED_QUEUE, 0.0, 0.0, 0.0},
+    {"Work stealing", WorkerPool::SchedulerType::WORK_STEALING, 0.0, 0.0,
+      0.0}};
+
+  for (TestData &test : tests)
+  {
+    WorkerPool pool(1u, test.scheduler);
+
+    // Warm up the threads and the queues before measuring
+    RunExternalSubmit(pool);
+
+    test.external = RunExternalSubmit(pool);
+    test.fromWorkers = RunWorkerSubmit(pool);
+    test.allocationsPerTask = pool.AllocationsPerTask();
+  }
+
+  std::cout << std::fixed;
+  std::cout << std::setprecision(2);
+  std::cout << "Threads: " << std::thread::hardware_concurrency()
+            << ", tasks per frame: " << TasksPerFrame << "\n"
+            << "The shared queue is the SHARED_QUEUE mode of the current "
+            << "pool, not the original implementation.\n\n";
+  for (const TestData &test : tests)
+  {
+    std::cout << " --- " << test.label << " result ---\n"
+              << "Added from caller:  " << std::setw(11) << std::right
+              << test.external << "us/frame\n"
+              << "Added from workers: " << std::setw(11) << std::right
+              << test.fromWorkers << "us/frame\n"
+              << "Allocations/task:   " << std::setw(11) << std::right
+              << test.allocationsPerTask << "\n" << std::endl;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}